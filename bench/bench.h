@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_BENCH_H
+#define QCA_BENCH_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct bench {
+	uint64_t iterations; /*< number of operations to run */
+	uint64_t bytes_per_op; /*< set by the benchmark for throughput */
+	uint64_t items_per_op; /*< e.g. frames per operation */
+	void *ctx;
+};
+
+/**
+ * @brief Function pointer type for a benchmark body.
+ *
+ * The body runs @p b->iterations operations. Setup that should not be
+ * measured goes to the setup function.
+ */
+typedef void (*bench_func_t)(struct bench *b);
+typedef int (*bench_setup_t)(struct bench *b);
+typedef void (*bench_teardown_t)(struct bench *b);
+
+struct bench_case {
+	const char *name;
+	bench_setup_t setup;
+	bench_func_t run;
+	bench_teardown_t teardown;
+};
+
+/**
+ * @brief Keeps the compiler from optimizing away a computed value.
+ */
+#define bench_keep(x)	__asm__ __volatile__("" : : "g"(x) : "memory")
+
+const struct bench_case *bench_qca_cases(size_t *count);
+const struct bench_case *bench_mme_cases(size_t *count);
+const struct bench_case *bench_nvm_cases(size_t *count);
+
+const char *bench_nvm_path(void);
+const char *bench_replay_path(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_BENCH_H */
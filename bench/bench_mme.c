@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "qca/mme.h"
+
+#include <string.h>
+
+#define BATCH		64U
+
+static struct {
+	uint8_t buf[1500];
+	struct qca_mme_host_action host_action;
+	struct qca_mme_sw_ver sw_ver;
+} m;
+
+static int setup(struct bench *b)
+{
+	memset(&m, 0, sizeof(m));
+	m.sw_ver.cookie = 0x12345678;
+	m.host_action.request = 1;
+
+	b->items_per_op = BATCH;
+
+	return 0;
+}
+
+static void run_encode_sw_ver(struct bench *b)
+{
+	struct qca_mme *mme = (struct qca_mme *)m.buf;
+
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (unsigned int j = 0; j < BATCH; j++) {
+			size_t len = qca_encode_mme(mme, QCA_MMTYPE_SW_VER,
+					&m.sw_ver, sizeof(m.sw_ver));
+			bench_keep(len);
+		}
+	}
+}
+
+static void run_encode_host_action(struct bench *b)
+{
+	struct qca_mme *mme = (struct qca_mme *)m.buf;
+
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (unsigned int j = 0; j < BATCH; j++) {
+			size_t len = qca_encode_mme(mme, QCA_MMTYPE_HST_ACTION,
+					&m.host_action, sizeof(m.host_action));
+			bench_keep(len);
+		}
+	}
+}
+
+static void run_encode_unknown(struct bench *b)
+{
+	struct qca_mme *mme = (struct qca_mme *)m.buf;
+
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (unsigned int j = 0; j < BATCH; j++) {
+			size_t len = qca_encode_mme(mme, QCA_MMTYPE_UNKNOWN,
+					NULL, 0);
+			bench_keep(len);
+		}
+	}
+}
+
+static void run_decode(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (unsigned int j = 0; j < BATCH; j++) {
+			qca_mmtype_t type = qca_decode_mme(m.buf,
+					sizeof(struct qca_mme_sw_ver_cnf),
+					(uint16_t)(0xA001 + j));
+			bench_keep(type);
+		}
+	}
+}
+
+static const struct bench_case cases[] = {
+	{ "mme_encode/sw_ver", setup, run_encode_sw_ver, NULL },
+	{ "mme_encode/host_action", setup, run_encode_host_action, NULL },
+	{ "mme_encode/unknown", setup, run_encode_unknown, NULL },
+	{ "mme_decode", setup, run_decode, NULL },
+};
+
+const struct bench_case *bench_mme_cases(size_t *count)
+{
+	*count = sizeof(cases) / sizeof(cases[0]);
+	return cases;
+}
@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+#include "qca/nvm.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHKSUM_BUFSIZE		(1024U * 1024U)
+
+struct reader {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+static struct {
+	uint8_t *data;
+	size_t size;
+	struct reader reader;
+	unsigned int headers;
+} m;
+
+/* Reads from memory so that the parser is measured rather than file I/O. */
+static size_t read_nvm(void *buf, size_t bufsize, void *ctx)
+{
+	struct reader *r = (struct reader *)ctx;
+	const size_t left = r->size - r->pos;
+	const size_t len = left < bufsize? left : bufsize;
+
+	memcpy(buf, &r->data[r->pos], len);
+	r->pos += len;
+
+	return len;
+}
+
+static bool on_header(const qca_nvm_header_t *header, void *ctx)
+{
+	(void)ctx;
+	bench_keep(header);
+	m.headers++;
+	return true;
+}
+
+static int setup_chksum(struct bench *b)
+{
+	if ((m.data = (uint8_t *)malloc(CHKSUM_BUFSIZE)) == NULL) {
+		return -ENOMEM;
+	}
+
+	for (size_t i = 0; i < CHKSUM_BUFSIZE; i++) {
+		m.data[i] = (uint8_t)(i * 31);
+	}
+
+	m.size = CHKSUM_BUFSIZE;
+	b->bytes_per_op = CHKSUM_BUFSIZE;
+	b->items_per_op = 1;
+
+	return 0;
+}
+
+static void run_chksum(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		uint32_t chksum = qca_calc_chksum(m.data, m.size, 0);
+		bench_keep(chksum);
+	}
+}
+
+static int setup_nvm(struct bench *b)
+{
+	FILE *f = fopen(bench_nvm_path(), "rb");
+
+	if (f == NULL) {
+		return -ENOENT;
+	}
+
+	fseek(f, 0, SEEK_END);
+	m.size = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if ((m.data = (uint8_t *)malloc(m.size)) == NULL ||
+			fread(m.data, 1, m.size, f) != m.size) {
+		fclose(f);
+		return -EIO;
+	}
+
+	fclose(f);
+
+	m.reader = (struct reader) { .data = m.data, .size = m.size };
+	m.headers = 0;
+	qca_nvm_iterate(read_nvm, m.size, on_header, &m.reader);
+
+	b->bytes_per_op = m.size;
+	b->items_per_op = m.headers;
+
+	return m.headers? 0 : -EINVAL;
+}
+
+static void run_iterate(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		m.reader.pos = 0;
+		qca_nvm_iterate(read_nvm, m.size, on_header, &m.reader);
+	}
+}
+
+static void run_offset(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		uint32_t offset;
+		m.reader.pos = 0;
+		qca_nvm_locate(QCA_NVM_IMAGE_PIB, read_nvm, &m.reader,
+				m.size, &offset);
+		bench_keep(offset);
+	}
+}
+
+static void teardown(struct bench *b)
+{
+	(void)b;
+	free(m.data);
+	memset(&m, 0, sizeof(m));
+}
+
+static const struct bench_case cases[] = {
+	{ "qca_calc_chksum/1MiB", setup_chksum, run_chksum, teardown },
+	{ "qca_nvm_iterate", setup_nvm, run_iterate, teardown },
+	{ "qca_nvm_offset/pib", setup_nvm, run_offset, teardown },
+};
+
+const struct bench_case *bench_nvm_cases(size_t *count)
+{
+	*count = sizeof(cases) / sizeof(cases[0]);
+	return cases;
+}
@@ -0,0 +1,358 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/spireplay.h"
+
+#define STREAM_FRAMES		256U
+#define CHUNK_SIZE		(QCA_MAX_BUFSIZE - 2U)
+#define EMU_BATCH		2U
+
+static struct {
+	struct qca_emu *emu;
+	struct qca_spireplay *replay;
+	uint8_t *stream;
+	size_t stream_len;
+	uint8_t *log;
+	uint64_t frames;
+	uint8_t frame[1500];
+	size_t frame_len;
+	bool initialized;
+} m;
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx)
+{
+	(void)ctx;
+	bench_keep(frame);
+	bench_keep(frame_size);
+	m.frames++;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+	/* xorshift32, to keep the streams identical across runs */
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static size_t put_frame(uint8_t *p, size_t len, uint8_t seed)
+{
+	const size_t frame_len = len + 10;
+
+	p[0] = (uint8_t)(frame_len >> 24);
+	p[1] = (uint8_t)(frame_len >> 16);
+	p[2] = (uint8_t)(frame_len >> 8);
+	p[3] = (uint8_t)frame_len;
+	memset(&p[4], 0xAA, 4);
+	p[8] = (uint8_t)len;
+	p[9] = (uint8_t)(len >> 8);
+	p[10] = 0;
+	p[11] = 0;
+	for (size_t i = 0; i < len; i++) {
+		p[12 + i] = (uint8_t)(seed + i);
+	}
+	p[12 + len] = 0x55;
+	p[13 + len] = 0x55;
+
+	return len + 14;
+}
+
+/* Builds a stream of frames as read from the chip, sizes spread from the
+ * Ethernet minimum to the maximum. With noise, runs of garbage are put in
+ * between to exercise the resync path. */
+static int build_stream(bool noisy)
+{
+	uint32_t seed = 0x12345678;
+	size_t off = 0;
+
+	if ((m.stream = (uint8_t *)malloc(STREAM_FRAMES * (1514 + 64)))
+			== NULL) {
+		return -ENOMEM;
+	}
+
+	for (unsigned int i = 0; i < STREAM_FRAMES; i++) {
+		const size_t len = 60 + (next_random(&seed) % (1500 - 60 + 1));
+
+		if (noisy && (i % 4) == 0) {
+			const size_t garbage = next_random(&seed) % 64;
+			for (size_t j = 0; j < garbage; j++) {
+				m.stream[off++] = (uint8_t)next_random(&seed);
+			}
+		}
+
+		off += put_frame(&m.stream[off], len, (uint8_t)i);
+	}
+
+	m.stream_len = off;
+
+	return 0;
+}
+
+static void count_stream_frames(void)
+{
+	m.frames = 0;
+	for (size_t off = 0; off < m.stream_len; off += CHUNK_SIZE) {
+		const size_t left = m.stream_len - off;
+		qca_input(&m.stream[off], left < CHUNK_SIZE? left : CHUNK_SIZE);
+	}
+}
+
+static int init(struct lm_spi_device *spi)
+{
+	const int err = qca_init(spi, on_frame, NULL);
+
+	m.initialized = err == 0;
+
+	return err;
+}
+
+static int setup_input(struct bench *b, bool noisy)
+{
+	int err;
+
+	if ((m.emu = qca_emu_create(NULL)) == NULL) {
+		return -ENOMEM;
+	}
+	if ((err = init(qca_emu_device(m.emu))) != 0 ||
+			(err = build_stream(noisy)) != 0) {
+		return err;
+	}
+
+	count_stream_frames();
+
+	b->bytes_per_op = m.stream_len;
+	b->items_per_op = m.frames;
+
+	return 0;
+}
+
+static int setup_input_clean(struct bench *b)
+{
+	return setup_input(b, false);
+}
+
+static int setup_input_noisy(struct bench *b)
+{
+	return setup_input(b, true);
+}
+
+static void run_input(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (size_t off = 0; off < m.stream_len; off += CHUNK_SIZE) {
+			const size_t left = m.stream_len - off;
+			qca_input(&m.stream[off],
+					left < CHUNK_SIZE? left : CHUNK_SIZE);
+		}
+	}
+}
+
+static void teardown(struct bench *b)
+{
+	(void)b;
+	if (m.initialized) {
+		qca_deinit();
+	}
+	qca_emu_destroy(m.emu);
+	qca_spireplay_destroy(m.replay);
+	free(m.stream);
+	free(m.log);
+	memset(&m, 0, sizeof(m));
+}
+
+static void discard_tx(const void *frame, size_t frame_size, void *ctx)
+{
+	(void)ctx;
+	bench_keep(frame);
+	bench_keep(frame_size);
+}
+
+static int setup_write(struct bench *b, size_t frame_len)
+{
+	const struct qca_emu_conf conf = {
+		.backend = QCA_EMU_BACKEND_CALLBACK,
+		.on_tx = discard_tx,
+	};
+	int err;
+
+	if ((m.emu = qca_emu_create(&conf)) == NULL) {
+		return -ENOMEM;
+	}
+	if ((err = init(qca_emu_device(m.emu))) != 0) {
+		return err;
+	}
+
+	m.frame_len = frame_len;
+	for (size_t i = 0; i < frame_len; i++) {
+		m.frame[i] = (uint8_t)i;
+	}
+
+	b->bytes_per_op = frame_len;
+	b->items_per_op = 1;
+
+	return qca_write_encoding(m.frame, m.frame_len);
+}
+
+static int setup_write_min(struct bench *b)
+{
+	return setup_write(b, QCA_MIN_PACKET_LEN);
+}
+
+static int setup_write_max(struct bench *b)
+{
+	return setup_write(b, 1500);
+}
+
+static void run_write(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		qca_write_encoding(m.frame, m.frame_len);
+	}
+}
+
+static int setup_rx_path(struct bench *b)
+{
+	int err;
+
+	if ((m.emu = qca_emu_create(NULL)) == NULL) {
+		return -ENOMEM;
+	}
+	if ((err = init(qca_emu_device(m.emu))) != 0) {
+		return err;
+	}
+
+	m.frame_len = 1000;
+	b->bytes_per_op = m.frame_len * EMU_BATCH;
+	b->items_per_op = EMU_BATCH;
+
+	return 0;
+}
+
+static void drain(void)
+{
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	int len;
+
+	while ((len = qca_read(buf, sizeof(buf))) > 0) {
+		qca_input(buf, (size_t)len);
+	}
+}
+
+/* The whole receive path against the emulator: register polling, buffer
+ * transfers and deframing. */
+static void run_rx_path(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		for (unsigned int j = 0; j < EMU_BATCH; j++) {
+			qca_emu_inject(m.emu, m.frame, m.frame_len);
+		}
+		drain();
+	}
+}
+
+static int load_file(const char *path, uint8_t **buf, size_t *len)
+{
+	FILE *f;
+
+	if (path == NULL || (f = fopen(path, "rb")) == NULL) {
+		return -ENOENT;
+	}
+
+	fseek(f, 0, SEEK_END);
+	*len = (size_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if ((*buf = (uint8_t *)malloc(*len)) == NULL ||
+			fread(*buf, 1, *len, f) != *len) {
+		fclose(f);
+		return -EIO;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void replay_once(void)
+{
+	struct qca_spireplay_stats stats;
+	uint32_t served = 0;
+
+	qca_spireplay_rewind(m.replay);
+
+	while (!qca_spireplay_done(m.replay)) {
+		uint8_t buf[QCA_MAX_BUFSIZE];
+		const int len = qca_read(buf, sizeof(buf));
+
+		if (len > 0) {
+			qca_input(buf, (size_t)len);
+		}
+
+		/* stop at the records the driver no longer asks for */
+		qca_spireplay_get_stats(m.replay, &stats);
+		if (stats.transactions == served) {
+			break;
+		}
+		served = stats.transactions;
+	}
+}
+
+static int setup_replay(struct bench *b)
+{
+	size_t len;
+	int err;
+
+	if (load_file(bench_replay_path(), &m.log, &len) != 0) {
+		return -ENOENT;
+	}
+	if ((m.replay = qca_spireplay_create(m.log, len, 0)) == NULL) {
+		return -EINVAL;
+	}
+
+	if ((err = init(qca_spireplay_device(m.replay))) != 0) {
+		return err;
+	}
+
+	m.frames = 0;
+	replay_once();
+
+	b->bytes_per_op = len;
+	b->items_per_op = m.frames;
+
+	return m.frames? 0 : -ENODATA;
+}
+
+static void run_replay(struct bench *b)
+{
+	for (uint64_t i = 0; i < b->iterations; i++) {
+		replay_once();
+	}
+}
+
+static const struct bench_case cases[] = {
+	{ "qca_input/clean", setup_input_clean, run_input, teardown },
+	{ "qca_input/noisy", setup_input_noisy, run_input, teardown },
+	{ "qca_write_encoding/60", setup_write_min, run_write, teardown },
+	{ "qca_write_encoding/1500", setup_write_max, run_write, teardown },
+	{ "qca_rx_path/emu", setup_rx_path, run_rx_path, teardown },
+	{ "qca_rx_path/replay", setup_replay, run_replay, teardown },
+};
+
+const struct bench_case *bench_qca_cases(size_t *count)
+{
+	*count = sizeof(cases) / sizeof(cases[0]);
+	return cases;
+}
@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !defined(QCA_BENCH_ASSETS_DIR)
+#define QCA_BENCH_ASSETS_DIR		"tests/assets"
+#endif
+
+#define DEFAULT_NVM_PATH		QCA_BENCH_ASSETS_DIR \
+	"/MAC-QCA7000-QCA7005-GP-v3.3.0.0010-00-X-ED.nvm"
+#define DEFAULT_REPEAT			5U
+#define DEFAULT_MIN_TIME_MS		200U
+#define MAX_REPEAT			64U
+
+struct sample {
+	double wall_ns;
+	double cpu_ns;
+};
+
+static struct {
+	const char *filter;
+	const char *output;
+	const char *nvm_path;
+	const char *replay_path;
+	unsigned int repeat;
+	unsigned int min_time_ms;
+} opt = {
+	.nvm_path = DEFAULT_NVM_PATH,
+	.repeat = DEFAULT_REPEAT,
+	.min_time_ms = DEFAULT_MIN_TIME_MS,
+};
+
+static uint64_t get_time_ns(clockid_t clk)
+{
+	struct timespec ts;
+	clock_gettime(clk, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	const double x = *(const double *)a;
+	const double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static struct sample measure(const struct bench_case *c, struct bench *b)
+{
+	const uint64_t wall0 = get_time_ns(CLOCK_MONOTONIC);
+	const uint64_t cpu0 = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+	(*c->run)(b);
+
+	const uint64_t cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu0;
+	const uint64_t wall = get_time_ns(CLOCK_MONOTONIC) - wall0;
+
+	return (struct sample) {
+		.wall_ns = (double)wall,
+		.cpu_ns = (double)cpu,
+	};
+}
+
+/* Doubles the iterations until a run takes at least the minimum time, so that
+ * every benchmark is measured over a comparable duration. */
+static uint64_t calibrate(const struct bench_case *c, struct bench *b)
+{
+	const double min_ns = (double)opt.min_time_ms * 1e6;
+
+	for (b->iterations = 1; ; b->iterations *= 2) {
+		const struct sample s = measure(c, b);
+
+		if (s.wall_ns >= min_ns || b->iterations >= (1ULL << 40)) {
+			break;
+		}
+		if (s.wall_ns * 4 < min_ns && b->iterations < (1ULL << 38)) {
+			b->iterations *= 2;
+		}
+	}
+
+	return b->iterations;
+}
+
+static void run_case(const struct bench_case *c, FILE *out, bool *first)
+{
+	struct bench b = { 0, };
+	double wall[MAX_REPEAT];
+	double cpu[MAX_REPEAT];
+
+	if (opt.filter && !strstr(c->name, opt.filter)) {
+		return;
+	}
+
+	fprintf(out, "%s\n    {\"name\": \"%s\", ", *first? "" : ",", c->name);
+	*first = false;
+
+	if (c->setup && (*c->setup)(&b) != 0) {
+		if (c->teardown) {
+			(*c->teardown)(&b);
+		}
+		fprintf(out, "\"skipped\": true}");
+		fprintf(stderr, "%-40s skipped\n", c->name);
+		return;
+	}
+
+	calibrate(c, &b);
+
+	for (unsigned int i = 0; i < opt.repeat; i++) {
+		const struct sample s = measure(c, &b);
+		wall[i] = s.wall_ns / (double)b.iterations;
+		cpu[i] = s.cpu_ns / (double)b.iterations;
+	}
+
+	if (c->teardown) {
+		(*c->teardown)(&b);
+	}
+
+	qsort(wall, opt.repeat, sizeof(wall[0]), compare_double);
+	qsort(cpu, opt.repeat, sizeof(cpu[0]), compare_double);
+
+	const double median = wall[opt.repeat / 2];
+	const double mbps = median > 0?
+		(double)b.bytes_per_op * 1e3 / median : 0;
+	const double items = median > 0?
+		(double)b.items_per_op * 1e9 / median : 0;
+
+	fprintf(out, "\"iterations\": %llu, \"repeat\": %u, "
+			"\"ns_per_op\": {\"min\": %.1f, \"median\": %.1f, "
+			"\"max\": %.1f}, \"cpu_ns_per_op\": %.1f, "
+			"\"bytes_per_op\": %llu, \"mb_per_s\": %.2f, "
+			"\"items_per_op\": %llu, \"items_per_s\": %.1f}",
+			(unsigned long long)b.iterations, opt.repeat,
+			wall[0], median, wall[opt.repeat - 1],
+			cpu[opt.repeat / 2],
+			(unsigned long long)b.bytes_per_op, mbps,
+			(unsigned long long)b.items_per_op, items);
+
+	fprintf(stderr, "%-40s %12.1f ns/op %10.2f MB/s %12.1f items/s\n",
+			c->name, median, mbps, items);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [options]\n"
+			"  --filter <substr>    run matching benchmarks only\n"
+			"  --repeat <n>         measurements per benchmark\n"
+			"  --min-time <ms>      minimum time per measurement\n"
+			"  --nvm <path>         NVM image for nvm benchmarks\n"
+			"  --replay <path>      SPI log for the replay benchmark\n"
+			"  --output <path>      write JSON there instead of stdout\n",
+			prog);
+}
+
+static int parse_args(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc? argv[i + 1] : NULL;
+
+		if (val == NULL) {
+			return -1;
+		} else if (!strcmp(arg, "--filter")) {
+			opt.filter = val;
+		} else if (!strcmp(arg, "--repeat")) {
+			opt.repeat = (unsigned int)strtoul(val, NULL, 0);
+		} else if (!strcmp(arg, "--min-time")) {
+			opt.min_time_ms = (unsigned int)strtoul(val, NULL, 0);
+		} else if (!strcmp(arg, "--nvm")) {
+			opt.nvm_path = val;
+		} else if (!strcmp(arg, "--replay")) {
+			opt.replay_path = val;
+		} else if (!strcmp(arg, "--output")) {
+			opt.output = val;
+		} else {
+			return -1;
+		}
+
+		i++;
+	}
+
+	if (opt.repeat == 0 || opt.repeat > MAX_REPEAT) {
+		return -1;
+	}
+
+	return 0;
+}
+
+const char *bench_nvm_path(void)
+{
+	return opt.nvm_path;
+}
+
+const char *bench_replay_path(void)
+{
+	return opt.replay_path;
+}
+
+int main(int argc, char **argv)
+{
+	const struct bench_case *(*suites[])(size_t *count) = {
+		bench_qca_cases,
+		bench_mme_cases,
+		bench_nvm_cases,
+	};
+	FILE *out = stdout;
+	bool first = true;
+
+	if (parse_args(argc, argv) != 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (opt.output && (out = fopen(opt.output, "w")) == NULL) {
+		perror(opt.output);
+		return 1;
+	}
+
+	fprintf(out, "{\n  \"format\": 1,\n  \"min_time_ms\": %u,\n"
+			"  \"results\": [", opt.min_time_ms);
+
+	for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+		size_t count;
+		const struct bench_case *cases = (*suites[i])(&count);
+
+		for (size_t j = 0; j < count; j++) {
+			run_case(&cases[j], out, &first);
+		}
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	return 0;
+}
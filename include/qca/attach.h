@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_ATTACH_H
+#define QCA_ATTACH_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#if !defined(QCA_ATTACH_VERSION_MAXLEN)
+#define QCA_ATTACH_VERSION_MAXLEN		64U
+#endif
+
+#define QCA_ATTACH_FINGERPRINT_INIT		0xcbf29ce484222325ULL
+
+/* What the host keeps across its restarts, e.g. in flash, to tell whether a
+ * modem found running has the images it would load anyway. The startup goes:
+ *
+ * 1. qca_init_with_conf() with warm_attach set. If qca_is_warm() is false,
+ *    reset and upload as usual and skip the rest.
+ * 2. Get the SW_VER confirmation, e.g. from qca/devinfo.h.
+ * 3. If qca_attach_match() with the saved record, carry on with the modem as
+ *    it is. Otherwise reset, upload, and qca_attach_save() once the modem
+ *    is back with the new firmware. */
+struct qca_attach_record {
+	uint64_t fingerprint; /*< of the images loaded */
+	uint8_t version_len;
+	uint8_t version[QCA_ATTACH_VERSION_MAXLEN]; /*< as SW_VER reported */
+};
+
+/**
+ * @brief Fingerprints the images, e.g. the firmware and then the PIB.
+ *
+ * @param[in] data The image.
+ * @param[in] len Length of the image.
+ * @param[in] fingerprint QCA_ATTACH_FINGERPRINT_INIT for the first image, or
+ *            the fingerprint of the images before.
+ *
+ * @return The fingerprint.
+ */
+uint64_t qca_attach_fingerprint(const void *data, size_t len,
+		uint64_t fingerprint);
+
+/**
+ * @brief Makes the record to keep after the images were loaded.
+ *
+ * @param[out] rec The record.
+ * @param[in] sw_ver_cnf Body of the SW_VER confirmation from the modem
+ *            running the images, i.e. struct qca_mme_sw_ver_cnf.
+ * @param[in] len Length of the body.
+ * @param[in] fingerprint Fingerprint of the images.
+ *
+ * @return 0 on success, -EINVAL if the confirmation is short, tells a
+ *         failure or has a version longer than QCA_ATTACH_VERSION_MAXLEN.
+ */
+int qca_attach_save(struct qca_attach_record *rec,
+		const void *sw_ver_cnf, size_t len, uint64_t fingerprint);
+
+/**
+ * @brief Tells whether the modem runs the images of the record.
+ *
+ * The version reported and the fingerprint of the images the host would
+ * load now both have to match the record.
+ *
+ * @param[in] rec The record saved.
+ * @param[in] sw_ver_cnf Body of the SW_VER confirmation.
+ * @param[in] len Length of the body.
+ * @param[in] fingerprint Fingerprint of the images the host would load.
+ *
+ * @return true if the modem can be kept as it is.
+ */
+bool qca_attach_match(const struct qca_attach_record *rec,
+		const void *sw_ver_cnf, size_t len, uint64_t fingerprint);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_ATTACH_H */
@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_CAPTURE_H
+#define QCA_CAPTURE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "qca.h"
+
+#if !defined(QCA_CAPTURE_DEFAULT_SLOTS)
+#define QCA_CAPTURE_DEFAULT_SLOTS		64U
+#endif
+#if !defined(QCA_CAPTURE_DEFAULT_POLL_INTERVAL_MS)
+#define QCA_CAPTURE_DEFAULT_POLL_INTERVAL_MS	10U
+#endif
+
+typedef enum {
+	QCA_CAPTURE_RX			= 0x01U,
+	QCA_CAPTURE_TX			= 0x02U,
+	QCA_CAPTURE_HOMEPLUG_ONLY	= 0x04U, /* HomePlug AV MMEs only */
+} qca_capture_flag_t;
+
+/**
+ * @brief Function pointer type for filtering frames to capture.
+ *
+ * It is called in the context of the RX or TX path. It should not block.
+ *
+ * @return true to capture the frame, false to skip.
+ */
+typedef bool (*qca_capture_filter_t)(qca_dir_t dir,
+		const void *frame, size_t frame_size, void *ctx);
+
+struct qca_capture_conf {
+	size_t slots; /*< number of frames the ring holds. Rounded up to a
+			power of 2. 0 for QCA_CAPTURE_DEFAULT_SLOTS */
+	size_t snaplen; /*< bytes to keep per frame. 0 for the whole frame */
+	uint32_t flags; /*< qca_capture_flag_t. 0 for both directions */
+	qca_capture_filter_t filter; /*< optional filter on top of flags */
+	void *filter_ctx;
+	uint32_t poll_interval_ms; /*< how often the writer drains the ring */
+};
+
+struct qca_capture_stats {
+	uint32_t captured; /*< frames put in the ring */
+	uint32_t filtered; /*< frames skipped by the filter */
+	uint32_t dropped; /*< frames lost as the ring was full */
+	uint32_t written; /*< frames written out */
+	uint32_t write_errors;
+};
+
+struct qca_capture;
+
+/**
+ * @brief Creates a capture instance.
+ *
+ * All the memory the capture needs is allocated here so that nothing is
+ * allocated on the RX or TX path.
+ *
+ * @param[in] conf Configuration. NULL for defaults.
+ *
+ * @return A capture instance on success, or NULL on failure.
+ */
+struct qca_capture *qca_capture_create(const struct qca_capture_conf *conf);
+
+/**
+ * @brief Destroys a capture instance, stopping it first if running.
+ *
+ * @param[in] cap The capture instance.
+ */
+void qca_capture_destroy(struct qca_capture *cap);
+
+/**
+ * @brief Starts capturing frames into a pcapng stream.
+ *
+ * The pcapng section and interface headers are written to @p fd right away
+ * and the frames are written from a background thread. The capture attaches
+ * itself to the driver with @ref qca_set_tap.
+ *
+ * @param[in] cap The capture instance.
+ * @param[in] fd File descriptor of a file, pipe or socket to write to. It
+ *            is not closed by the capture.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_capture_start(struct qca_capture *cap, int fd);
+
+/**
+ * @brief Stops capturing and flushes the frames left in the ring.
+ *
+ * @param[in] cap The capture instance.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_capture_stop(struct qca_capture *cap);
+
+/**
+ * @brief Puts a frame in the capture ring.
+ *
+ * This is what the driver tap calls. It never blocks and never allocates.
+ * Frames are dropped if the ring is full. It can be called directly to
+ * capture frames from other sources.
+ *
+ * @param[in] dir Direction of the frame.
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ * @param[in] ctx The capture instance.
+ */
+void qca_capture_frame(qca_dir_t dir,
+		const void *frame, size_t frame_size, void *ctx);
+
+/**
+ * @brief Gets the capture statistics.
+ *
+ * @param[in] cap The capture instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_capture_get_stats(const struct qca_capture *cap,
+		struct qca_capture_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_CAPTURE_H */
@@ -0,0 +1,606 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_CORO_HPP
+#define QCA_CORO_HPP
+
+/*
+ * C++20 coroutine front-end for management requests.
+ *
+ * A request is sent when awaited, and the coroutine resumes from
+ * event_loop::tick() once the confirmation has been fed to
+ * event_loop::input() along with the device it came in on, or the request
+ * has timed out or been cancelled.
+ * Everything runs on the thread calling tick(). Coroutine frames and
+ * confirmation buffers come from fixed pools, so a request allocates
+ * nothing from the heap unless a pool runs dry:
+ *
+ *   qca::task<void> probe(qca::device &dev) {
+ *           qca::response r = co_await dev.sw_version();
+ *           if (r.err == 0) {
+ *                   use(r.body(), r.body_len());
+ *           }
+ *   }
+ *
+ *   loop.spawn(probe(dev));
+ *   for (;;) {
+ *           while (recv(frame, &len)) {
+ *                   loop.input(dev, frame, len);
+ *           }
+ *           loop.tick(now_ms());
+ *   }
+ */
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <exception>
+#include <new>
+#include <utility>
+
+#include "qca/mme.h"
+
+#if !defined(QCA_CORO_FRAME_SIZE)
+#define QCA_CORO_FRAME_SIZE		512U
+#endif
+#if !defined(QCA_CORO_FRAMES)
+#define QCA_CORO_FRAMES			8U
+#endif
+#if !defined(QCA_CORO_BUFFERS)
+#define QCA_CORO_BUFFERS		4U
+#endif
+#if !defined(QCA_CORO_DEFAULT_TIMEOUT_MS)
+#define QCA_CORO_DEFAULT_TIMEOUT_MS	1000U
+#endif
+
+namespace qca {
+
+constexpr size_t FRAME_MAXLEN = 1514;
+
+/* Modules of RD_MOD */
+enum class module_id : uint8_t {
+	mac = 0x01, /* firmware */
+	pib = 0x02,
+};
+
+namespace detail {
+
+/* Free list of fixed blocks. It is not thread-safe, as everything runs on
+ * the event loop. */
+template <size_t BlockSize, size_t Count>
+class block_pool {
+public:
+	static block_pool &instance() noexcept {
+		static block_pool pool;
+		return pool;
+	}
+
+	void *allocate(size_t size) noexcept {
+		if (size > BlockSize || free_ == nullptr) {
+			return nullptr;
+		}
+		block *b = free_;
+		free_ = b->next;
+		return b->data;
+	}
+
+	bool deallocate(void *p) noexcept {
+		auto *b = static_cast<block *>(p);
+		if (b < &blocks_[0] || b >= &blocks_[Count]) {
+			return false;
+		}
+		b->next = free_;
+		free_ = b;
+		return true;
+	}
+
+private:
+	union block {
+		block *next;
+		alignas(std::max_align_t) unsigned char data[BlockSize];
+	};
+
+	block blocks_[Count];
+	block *free_;
+
+	block_pool() noexcept : free_(nullptr) {
+		for (size_t i = Count; i > 0; i--) {
+			blocks_[i - 1].next = free_;
+			free_ = &blocks_[i - 1];
+		}
+	}
+};
+
+using frame_pool = block_pool<QCA_CORO_FRAME_SIZE, QCA_CORO_FRAMES>;
+using buffer_pool = block_pool<FRAME_MAXLEN, QCA_CORO_BUFFERS>;
+
+inline uint16_t get_le16(const uint8_t *p) {
+	return static_cast<uint16_t>((p[1] << 8) | p[0]);
+}
+
+inline void put_le16(uint8_t *p, uint16_t v) {
+	p[0] = static_cast<uint8_t>(v);
+	p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+inline void put_le32(uint8_t *p, uint32_t v) {
+	for (int i = 0; i < 4; i++) {
+		p[i] = static_cast<uint8_t>(v >> (i * 8));
+	}
+}
+
+} /* namespace detail */
+
+/* A frame from the buffer pool, given back when destroyed. */
+class frame_buffer {
+public:
+	frame_buffer() noexcept = default;
+	frame_buffer(const frame_buffer &) = delete;
+	frame_buffer &operator=(const frame_buffer &) = delete;
+
+	frame_buffer(frame_buffer &&other) noexcept
+		: data_(std::exchange(other.data_, nullptr)),
+		size_(std::exchange(other.size_, 0)) {}
+
+	frame_buffer &operator=(frame_buffer &&other) noexcept {
+		if (this != &other) {
+			release();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+		}
+		return *this;
+	}
+
+	~frame_buffer() { release(); }
+
+	/* An empty buffer if the pool is exhausted. */
+	static frame_buffer copy_of(const void *frame, size_t size) noexcept {
+		frame_buffer buf;
+		if (size > FRAME_MAXLEN) {
+			return buf;
+		}
+		buf.data_ = static_cast<uint8_t *>(
+			detail::buffer_pool::instance().allocate(size));
+		if (buf.data_) {
+			memcpy(buf.data_, frame, size);
+			buf.size_ = size;
+		}
+		return buf;
+	}
+
+	const uint8_t *data() const noexcept { return data_; }
+	size_t size() const noexcept { return size_; }
+	explicit operator bool() const noexcept { return data_ != nullptr; }
+
+private:
+	uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+
+	void release() noexcept {
+		if (data_) {
+			detail::buffer_pool::instance().deallocate(data_);
+			data_ = nullptr;
+			size_ = 0;
+		}
+	}
+};
+
+/* The outcome of a request. */
+struct response {
+	int err; /* 0, -ETIMEDOUT, -ECANCELED, -ENOBUFS or a send error */
+	frame_buffer frame; /* the whole confirmation frame */
+
+	/* Body of the confirmation, right after the OUI. */
+	const uint8_t *body() const noexcept {
+		return frame.size() > QCA_MME_HEADER_LEN + QCA_MME_OUI_LEN?
+			frame.data() + QCA_MME_HEADER_LEN + QCA_MME_OUI_LEN :
+			nullptr;
+	}
+	size_t body_len() const noexcept {
+		return frame.size() > QCA_MME_HEADER_LEN + QCA_MME_OUI_LEN?
+			frame.size() - QCA_MME_HEADER_LEN - QCA_MME_OUI_LEN :
+			0;
+	}
+};
+
+template <typename T> class task;
+
+namespace detail {
+
+struct promise_base {
+	std::coroutine_handle<> continuation;
+
+	static void *operator new(size_t size) {
+		void *p = frame_pool::instance().allocate(size);
+		return p? p : ::operator new(size);
+	}
+	static void operator delete(void *p, size_t size) noexcept {
+		if (!frame_pool::instance().deallocate(p)) {
+			::operator delete(p, size);
+		}
+	}
+
+	struct final_awaiter {
+		bool await_ready() const noexcept { return false; }
+		template <typename P>
+		std::coroutine_handle<> await_suspend(
+				std::coroutine_handle<P> h) const noexcept {
+			auto next = h.promise().continuation;
+			return next? next : std::noop_coroutine();
+		}
+		void await_resume() const noexcept {}
+	};
+
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	final_awaiter final_suspend() const noexcept { return {}; }
+	void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+	T value;
+
+	task<T> get_return_object() noexcept;
+	void return_value(T v) noexcept { value = std::move(v); }
+	T result() noexcept { return std::move(value); }
+};
+
+template <>
+struct promise<void> : promise_base {
+	task<void> get_return_object() noexcept;
+	void return_void() const noexcept {}
+	void result() const noexcept {}
+};
+
+} /* namespace detail */
+
+/* A lazily started coroutine. Awaiting it runs it to completion. */
+template <typename T = void>
+class task {
+public:
+	using promise_type = detail::promise<T>;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	explicit task(handle_type h) noexcept : handle_(h) {}
+	task(const task &) = delete;
+	task &operator=(const task &) = delete;
+	task(task &&other) noexcept
+		: handle_(std::exchange(other.handle_, nullptr)) {}
+	task &operator=(task &&other) noexcept {
+		if (this != &other) {
+			if (handle_) {
+				handle_.destroy();
+			}
+			handle_ = std::exchange(other.handle_, nullptr);
+		}
+		return *this;
+	}
+	~task() {
+		if (handle_) {
+			handle_.destroy();
+		}
+	}
+
+	bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+	std::coroutine_handle<> await_suspend(
+			std::coroutine_handle<> caller) noexcept {
+		handle_.promise().continuation = caller;
+		return handle_;
+	}
+	T await_resume() noexcept { return handle_.promise().result(); }
+
+	handle_type release() noexcept {
+		return std::exchange(handle_, nullptr);
+	}
+
+private:
+	handle_type handle_;
+};
+
+namespace detail {
+
+template <typename T>
+inline task<T> promise<T>::get_return_object() noexcept {
+	return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() noexcept {
+	return task<void>(
+		std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+} /* namespace detail */
+
+class device;
+class event_loop;
+
+/* An outstanding request, linked in the event loop while it waits. It lives
+ * in the frame of the awaiting coroutine. */
+class request_awaiter {
+public:
+	request_awaiter(device &dev, qca_mmtype_t type,
+			const void *body, size_t body_len, uint32_t timeout_ms)
+		noexcept;
+	request_awaiter(const request_awaiter &) = delete;
+	request_awaiter &operator=(const request_awaiter &) = delete;
+
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<> h) noexcept;
+	response await_resume() noexcept {
+		return response{ err_, std::move(frame_) };
+	}
+
+private:
+	friend class event_loop;
+
+	device &dev_;
+	qca_mmtype_t type_;
+	const void *body_;
+	size_t body_len_;
+	uint32_t timeout_ms_;
+
+	request_awaiter *next_ = nullptr;
+	uint32_t deadline_ms_ = 0;
+	std::coroutine_handle<> handle_;
+	int err_ = 0;
+	frame_buffer frame_;
+};
+
+class event_loop {
+public:
+	event_loop() noexcept = default;
+	event_loop(const event_loop &) = delete;
+	event_loop &operator=(const event_loop &) = delete;
+
+	~event_loop() {
+		for (auto &h : spawned_) {
+			if (h) {
+				h.destroy();
+			}
+		}
+	}
+
+	/* Starts a top-level coroutine, owned by the loop until it finishes.
+	 * Returns -ENOSPC if QCA_CORO_FRAMES coroutines are already running. */
+	int spawn(task<void> t) noexcept {
+		for (auto &h : spawned_) {
+			if (!h) {
+				h = t.release();
+				h.resume();
+				return 0;
+			}
+		}
+		return -ENOSPC;
+	}
+
+	/* Completes the request of @p dev waiting for this confirmation, if
+	 * any. Only a frame from the modem address of @p dev is taken, so a
+	 * station on the powerline cannot answer in its place. The frame is
+	 * copied, so it need not outlive the call. */
+	bool input(const device &dev,
+			const void *frame, size_t frame_size) noexcept;
+
+	/* Expires requests and resumes the coroutines whose requests are done.
+	 * Returns the number of coroutines resumed. */
+	size_t tick(uint32_t now_ms) noexcept {
+		now_ms_ = now_ms;
+
+		for (request_awaiter **pp = &pending_; *pp;) {
+			request_awaiter *r = *pp;
+			if (qca_mme_is_expired(now_ms, r->deadline_ms_)) {
+				*pp = r->next_;
+				r->err_ = -ETIMEDOUT;
+				make_ready(r);
+			} else {
+				pp = &r->next_;
+			}
+		}
+
+		size_t n = 0;
+		while (ready_) {
+			request_awaiter *r = ready_;
+			ready_ = r->next_;
+			if (ready_ == nullptr) {
+				ready_tail_ = nullptr;
+			}
+			r->handle_.resume();
+			n++;
+		}
+
+		reap();
+
+		return n;
+	}
+
+	/* Completes the requests of @p dev with -ECANCELED, or of every
+	 * device if nullptr. */
+	void cancel(const device *dev = nullptr) noexcept;
+
+	uint32_t now() const noexcept { return now_ms_; }
+	bool idle() const noexcept { return !pending_ && !ready_; }
+
+private:
+	friend class request_awaiter;
+
+	request_awaiter *pending_ = nullptr;
+	request_awaiter *ready_ = nullptr;
+	request_awaiter *ready_tail_ = nullptr;
+	uint32_t now_ms_ = 0;
+	std::coroutine_handle<detail::promise<void>> spawned_[QCA_CORO_FRAMES];
+
+	void wait(request_awaiter *r) noexcept {
+		r->deadline_ms_ = now_ms_ + r->timeout_ms_;
+		r->next_ = pending_;
+		pending_ = r;
+	}
+
+	/* in the order completed */
+	void make_ready(request_awaiter *r) noexcept {
+		r->next_ = nullptr;
+		if (ready_tail_) {
+			ready_tail_->next_ = r;
+		} else {
+			ready_ = r;
+		}
+		ready_tail_ = r;
+	}
+
+	void reap() noexcept {
+		for (auto &h : spawned_) {
+			if (h && h.done()) {
+				h.destroy();
+				h = nullptr;
+			}
+		}
+	}
+};
+
+/* A modem at @p modem_mac reached through a send function, such as
+ * qca_write_encoding(). */
+class device {
+public:
+	using send_t = int (*)(const void *frame, size_t frame_size, void *ctx);
+
+	device(event_loop &loop, const uint8_t host_mac[6],
+			const uint8_t modem_mac[6],
+			send_t send, void *send_ctx) noexcept
+		: loop_(loop), send_(send), send_ctx_(send_ctx) {
+		memcpy(host_mac_, host_mac, sizeof(host_mac_));
+		memcpy(peer_mac_, modem_mac, sizeof(peer_mac_));
+	}
+
+	request_awaiter request(qca_mmtype_t type,
+			const void *body = nullptr, size_t body_len = 0,
+			uint32_t timeout_ms = QCA_CORO_DEFAULT_TIMEOUT_MS)
+			noexcept {
+		return request_awaiter(*this, type, body, body_len,
+				timeout_ms);
+	}
+
+	request_awaiter sw_version(
+			uint32_t timeout_ms = QCA_CORO_DEFAULT_TIMEOUT_MS)
+			noexcept {
+		return request(QCA_MMTYPE_SW_VER, nullptr, 0, timeout_ms);
+	}
+
+	/* Reads @p length bytes of a module, up to 1400 a request. */
+	task<response> module_read(module_id id, uint32_t offset,
+			uint16_t length,
+			uint32_t timeout_ms = QCA_CORO_DEFAULT_TIMEOUT_MS) {
+		uint8_t req[8] = { static_cast<uint8_t>(id), 0, };
+		detail::put_le16(&req[2], length);
+		detail::put_le32(&req[4], offset);
+		co_return co_await request(QCA_MMTYPE_RD_MOD,
+				req, sizeof(req), timeout_ms);
+	}
+
+	/* Modem address the requests go to and the confirmations must come
+	 * from, e.g. once the modem has been given another address. */
+	void set_peer(const uint8_t mac[6]) noexcept {
+		memcpy(peer_mac_, mac, sizeof(peer_mac_));
+	}
+
+	void cancel() noexcept { loop_.cancel(this); }
+
+private:
+	friend class request_awaiter;
+	friend class event_loop;
+
+	event_loop &loop_;
+	send_t send_;
+	void *send_ctx_;
+	uint8_t host_mac_[6];
+	uint8_t peer_mac_[6];
+
+	bool is_from(const uint8_t *src) const noexcept {
+		return !memcmp(peer_mac_, src, sizeof(peer_mac_));
+	}
+
+	int send_request(qca_mmtype_t type,
+			const void *body, size_t body_len) noexcept {
+		uint8_t frame[FRAME_MAXLEN];
+		auto *mme = reinterpret_cast<struct qca_mme *>(
+				&frame[QCA_MME_HEADER_LEN]);
+
+		if (body_len > FRAME_MAXLEN -
+				QCA_MME_HEADER_LEN - QCA_MME_OUI_LEN) {
+			return -EMSGSIZE;
+		}
+
+		size_t len = qca_mme_put_header(frame, peer_mac_, host_mac_,
+				qca_mme_mmtype(type, QCA_MME_REQ));
+		len += qca_encode_mme(mme, type, body, body_len);
+		if (len < 60) {
+			memset(&frame[len], 0, 60 - len);
+			len = 60;
+		}
+
+		return (*send_)(frame, len, send_ctx_);
+	}
+};
+
+inline request_awaiter::request_awaiter(device &dev, qca_mmtype_t type,
+		const void *body, size_t body_len, uint32_t timeout_ms) noexcept
+	: dev_(dev), type_(type), body_(body), body_len_(body_len),
+	timeout_ms_(timeout_ms) {}
+
+inline bool request_awaiter::await_suspend(std::coroutine_handle<> h) noexcept {
+	handle_ = h;
+
+	if ((err_ = dev_.send_request(type_, body_, body_len_)) < 0) {
+		return false; /* resume at once with the error */
+	}
+
+	err_ = 0;
+	dev_.loop_.wait(this);
+
+	return true;
+}
+
+inline bool event_loop::input(const device &dev,
+		const void *frame, size_t frame_size) noexcept {
+	const auto *p = static_cast<const uint8_t *>(frame);
+
+	if (frame_size < QCA_MME_HEADER_LEN || !dev.is_from(&p[6])) {
+		return false;
+	}
+
+	const uint16_t mmtype = detail::get_le16(&p[15]);
+
+	for (request_awaiter **pp = &pending_; *pp; pp = &(*pp)->next_) {
+		request_awaiter *r = *pp;
+		if (&r->dev_ != &dev ||
+				qca_mme_mmtype(r->type_, QCA_MME_CNF) != mmtype) {
+			continue;
+		}
+		*pp = r->next_;
+		r->frame_ = frame_buffer::copy_of(frame, frame_size);
+		r->err_ = r->frame_? 0 : -ENOBUFS;
+		make_ready(r);
+		return true;
+	}
+
+	return false;
+}
+
+inline void event_loop::cancel(const device *dev) noexcept {
+	for (request_awaiter **pp = &pending_; *pp;) {
+		request_awaiter *r = *pp;
+		if (dev == nullptr || &r->dev_ == dev) {
+			*pp = r->next_;
+			r->err_ = -ECANCELED;
+			make_ready(r);
+		} else {
+			pp = &r->next_;
+		}
+	}
+}
+
+} /* namespace qca */
+
+#endif /* QCA_CORO_HPP */
@@ -0,0 +1,150 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_DEVINFO_H
+#define QCA_DEVINFO_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mme.h"
+
+#if !defined(QCA_DEVINFO_MAXLEN)
+#define QCA_DEVINFO_MAXLEN			512U
+#endif
+#if !defined(QCA_DEVINFO_DEFAULT_TTL_MS)
+#define QCA_DEVINFO_DEFAULT_TTL_MS		10000U
+#endif
+#if !defined(QCA_DEVINFO_DEFAULT_TIMEOUT_MS)
+#define QCA_DEVINFO_DEFAULT_TIMEOUT_MS		1000U
+#endif
+
+typedef enum {
+	QCA_DEVINFO_SW_VER, /* struct qca_mme_sw_ver_cnf */
+	QCA_DEVINFO_NW_INFO,
+	QCA_DEVINFO_NW_STAT,
+	QCA_DEVINFO_MAX,
+} qca_devinfo_item_t;
+
+#define QCA_DEVINFO_MASK(item)		(1U << (item))
+#define QCA_DEVINFO_MASK_ALL		((1U << QCA_DEVINFO_MAX) - 1U)
+
+/**
+ * @brief Function pointer type for sending a query to the modem.
+ *
+ * The confirmation is expected to come back through
+ * @ref qca_devinfo_input. It should not block.
+ *
+ * @param[in] type The MME to request.
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_devinfo_request_t)(qca_mmtype_t type, void *ctx);
+
+struct qca_devinfo_conf {
+	uint32_t ttl_ms[QCA_DEVINFO_MAX]; /*< 0 for QCA_DEVINFO_DEFAULT_TTL_MS */
+	uint32_t timeout_ms; /*< before a query is sent again. 0 for
+			QCA_DEVINFO_DEFAULT_TIMEOUT_MS */
+	qca_devinfo_request_t request;
+	void *request_ctx;
+};
+
+struct qca_devinfo;
+
+/**
+ * @brief Creates a device info cache.
+ *
+ * The cache starts empty. The first @ref qca_devinfo_poll queries every
+ * item.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return A cache instance on success, or NULL on failure.
+ */
+struct qca_devinfo *qca_devinfo_create(const struct qca_devinfo_conf *conf);
+
+/**
+ * @brief Destroys the cache.
+ *
+ * @param[in] cache The cache instance.
+ */
+void qca_devinfo_destroy(struct qca_devinfo *cache);
+
+/**
+ * @brief Feeds a received MME to the cache.
+ *
+ * Confirmations of the cached items are stored. A link status indication
+ * marks the network items stale.
+ *
+ * @param[in] cache The cache instance.
+ * @param[in] mmtype MMTYPE as on the wire.
+ * @param[in] body Body of the MME, right after the OUI.
+ * @param[in] body_len Length of the body.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 if the MME was consumed, -ENOMSG if not of interest, or a
+ *         negative error code on failure.
+ */
+int qca_devinfo_input(struct qca_devinfo *cache, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms);
+
+/**
+ * @brief Queries the items that are stale or past their TTL.
+ *
+ * It is meant to be called periodically from a background context. An item
+ * is not queried again while its query is outstanding, up to the timeout.
+ *
+ * @param[in] cache The cache instance.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_devinfo_poll(struct qca_devinfo *cache, uint32_t now_ms);
+
+/**
+ * @brief Marks items stale so that the next poll refreshes them.
+ *
+ * The last values stay readable until refreshed.
+ *
+ * @param[in] cache The cache instance.
+ * @param[in] mask QCA_DEVINFO_MASK() of the items.
+ */
+void qca_devinfo_invalidate(struct qca_devinfo *cache, uint32_t mask);
+
+/**
+ * @brief Marks every item stale if the modem has restarted.
+ *
+ * @param[in] cache The cache instance.
+ * @param[in] int_src Value of the INT_SRC register.
+ */
+void qca_devinfo_handle_interrupt(struct qca_devinfo *cache, uint16_t int_src);
+
+/**
+ * @brief Reads a cached item.
+ *
+ * It never blocks nor talks to the modem. A reader racing with an update
+ * retries the copy a few times.
+ *
+ * @param[in] cache The cache instance.
+ * @param[in] item The item.
+ * @param[out] buf Buffer for the body of the confirmation.
+ * @param[in] bufsize Size of the buffer.
+ * @param[out] updated_ms When the item was last updated. May be NULL.
+ *
+ * @return The length of the item, which may exceed @p bufsize, -ENODATA if
+ *         not available yet, -EAGAIN if updates kept racing, or a negative
+ *         error code on failure.
+ */
+int qca_devinfo_get(const struct qca_devinfo *cache, qca_devinfo_item_t item,
+		void *buf, size_t bufsize, uint32_t *updated_ms);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_DEVINFO_H */
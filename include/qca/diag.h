@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_DIAG_H
+#define QCA_DIAG_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define QCA_TONEMAP_CARRIERS		1155U
+/* padded to a multiple of the vector width */
+#define QCA_TONEMAP_CARRIERS_PADDED	1168U
+
+typedef enum {
+	QCA_MOD_NONE,
+	QCA_MOD_BPSK,
+	QCA_MOD_QPSK,
+	QCA_MOD_8QAM,
+	QCA_MOD_16QAM,
+	QCA_MOD_64QAM,
+	QCA_MOD_256QAM,
+	QCA_MOD_1024QAM,
+} qca_mod_t;
+
+/*
+ * Per-carrier arrays, one array per attribute. The chip reports the bit
+ * loading of each carrier. The SNR is the least the loaded modulation needs,
+ * so it is a lower bound of the actual SNR of the carrier.
+ */
+struct qca_tonemap {
+	uint16_t nr_carriers; /*< carriers decoded */
+	uint16_t nr_active; /*< active carriers as reported */
+	uint8_t slot;
+	uint8_t num_slots;
+	uint8_t mod[QCA_TONEMAP_CARRIERS_PADDED]; /*< qca_mod_t */
+	uint8_t bits[QCA_TONEMAP_CARRIERS_PADDED]; /*< bits per symbol */
+	uint8_t snr[QCA_TONEMAP_CARRIERS_PADDED]; /*< dB */
+	uint8_t raw[QCA_TONEMAP_CARRIERS_PADDED / 2]; /*< as received */
+};
+
+struct qca_tonemap_summary {
+	uint16_t loaded; /*< carriers carrying data */
+	uint32_t bits_per_symbol;
+	uint8_t min_snr; /*< dB, over the loaded carriers */
+	uint8_t mean_snr; /*< dB, over the loaded carriers */
+	uint32_t phy_rate_kbps; /*< estimated from the bits per symbol */
+};
+
+struct qca_link_stats {
+	uint8_t link_id;
+	uint8_t tei;
+	uint8_t direction; /*< 0 for TX, 1 for RX */
+	uint64_t mpdu_acked;
+	uint64_t mpdu_collided; /*< TX only */
+	uint64_t mpdu_failed;
+	uint64_t pb_passed;
+	uint64_t pb_failed;
+	uint64_t tbe_passed; /*< RX only */
+	uint64_t tbe_failed; /*< RX only */
+	uint16_t pb_error_permille;
+};
+
+/**
+ * @brief Decodes a tone map confirmation, reporting the carriers that changed.
+ *
+ * The confirmation is compared to the one decoded last into @p tm and only
+ * the carriers that differ are unpacked, so re-polling a stable link costs
+ * little more than a compare. Zero @p tm before the first call.
+ *
+ * @param[in,out] tm The tone map to update.
+ * @param[in] cnf Body of the TONE_MAP or RX_TONE_MAP confirmation, right
+ *            after the OUI.
+ * @param[in] cnf_len Length of the body.
+ * @param[in] rx true for an RX_TONE_MAP confirmation.
+ * @param[out] changed Indices of the carriers that changed. May be NULL.
+ * @param[in] max_changed Capacity of @p changed.
+ *
+ * @return The number of carriers that changed, which may exceed
+ *         @p max_changed, or a negative error code on failure.
+ */
+int qca_tonemap_decode(struct qca_tonemap *tm, const void *cnf, size_t cnf_len,
+		bool rx, uint16_t *changed, size_t max_changed);
+
+/**
+ * @brief Summarises a tone map.
+ *
+ * @param[in] tm The tone map.
+ * @param[out] summary Pointer to the structure to store the summary.
+ */
+void qca_tonemap_summarize(const struct qca_tonemap *tm,
+		struct qca_tonemap_summary *summary);
+
+/**
+ * @brief Decodes a link statistics confirmation.
+ *
+ * @param[out] stats Pointer to the structure to store the statistics.
+ * @param[in] cnf Body of the LINK_STATS confirmation, right after the OUI.
+ * @param[in] cnf_len Length of the body.
+ *
+ * @return 0 on success, -EIO if the chip reported a failure, or a negative
+ *         error code on failure.
+ */
+int qca_link_stats_decode(struct qca_link_stats *stats,
+		const void *cnf, size_t cnf_len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_DIAG_H */
@@ -0,0 +1,168 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_EMU_H
+#define QCA_EMU_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "vspi.h"
+
+#define QCA_EMU_HW_BUFSIZE		3163U
+
+typedef enum {
+	QCA_EMU_INT_PKT_AVLBL		= 0x0001U,
+	QCA_EMU_INT_CPU_ON		= 0x0040U,
+	QCA_EMU_INT_RDBUF_ERR		= 0x0100U,
+	QCA_EMU_INT_WRBUF_ERR		= 0x0200U,
+	QCA_EMU_INT_WRBUF_BELOW_WM	= 0x0400U,
+} qca_emu_int_t;
+
+typedef enum {
+	QCA_EMU_BACKEND_LOOPBACK, /* frames sent by the host come back */
+	QCA_EMU_BACKEND_CALLBACK, /* frames sent by the host go to on_tx */
+	QCA_EMU_BACKEND_TAP, /* frames are exchanged with a Linux TAP */
+} qca_emu_backend_t;
+
+/**
+ * @brief Function pointer type for frames the host sends to the powerline.
+ */
+typedef void (*qca_emu_tx_handler_t)(const void *frame, size_t frame_size,
+		void *ctx);
+
+/**
+ * @brief Function pointer type for the interrupt line.
+ *
+ * It is called when an enabled interrupt gets raised, with the emulator lock
+ * held. It should not call back into the emulator.
+ */
+typedef void (*qca_emu_irq_handler_t)(uint16_t int_src, void *ctx);
+
+struct qca_emu_conf {
+	size_t rdbuf_size; /*< 0 for QCA_EMU_HW_BUFSIZE */
+	size_t wrbuf_size; /*< 0 for QCA_EMU_HW_BUFSIZE */
+	uint32_t transaction_ns; /*< fixed cost of each transaction */
+	uint32_t byte_ns; /*< cost per byte, e.g. 667 at 12MHz */
+
+	qca_emu_backend_t backend;
+	const char *tap_name; /*< interface name for the TAP backend */
+	qca_emu_tx_handler_t on_tx;
+	void *on_tx_ctx;
+	qca_emu_irq_handler_t on_irq;
+	void *on_irq_ctx;
+};
+
+struct qca_emu_stats {
+	uint32_t transactions;
+	uint32_t rx_frames; /*< frames put in the read buffer */
+	uint32_t rx_drops; /*< frames lost as the read buffer was full */
+	uint32_t tx_frames; /*< frames taken from the write buffer */
+	uint32_t tx_errors; /*< malformed frames in the write buffer */
+	uint32_t bus_errors; /*< transfers not matching BUFSIZE or space */
+	uint32_t resets;
+	uint64_t busy_ns; /*< time spent emulating the bus */
+};
+
+struct qca_emu;
+
+/**
+ * @brief Creates a QCA7000 emulator.
+ *
+ * The emulator models the SPI register map, the read and write buffers of the
+ * chip, the interrupt source and enable registers and the bus latency. It
+ * starts as if the chip just booted, with CPU_ON pending.
+ *
+ * @param[in] conf Configuration. NULL for a loopback with no bus latency.
+ *
+ * @return An emulator instance on success, or NULL on failure.
+ */
+struct qca_emu *qca_emu_create(const struct qca_emu_conf *conf);
+
+/**
+ * @brief Destroys the emulator.
+ *
+ * @param[in] emu The emulator instance.
+ */
+void qca_emu_destroy(struct qca_emu *emu);
+
+/**
+ * @brief Gets the SPI device to pass to @ref qca_init.
+ *
+ * @param[in] emu The emulator instance.
+ *
+ * @return The SPI device.
+ */
+struct lm_spi_device *qca_emu_device(struct qca_emu *emu);
+
+/**
+ * @brief Puts an Ethernet frame in the read buffer as if it came from the
+ * powerline.
+ *
+ * Frames shorter than the Ethernet minimum are padded.
+ *
+ * @param[in] emu The emulator instance.
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ *
+ * @return 0 on success, -ENOSPC if the read buffer is full, or a negative
+ *         error code on failure.
+ */
+int qca_emu_inject(struct qca_emu *emu, const void *frame, size_t frame_size);
+
+/**
+ * @brief Moves the frames pending on the TAP interface into the read buffer.
+ *
+ * @param[in] emu The emulator instance.
+ *
+ * @return The number of frames moved, or a negative error code on failure.
+ */
+int qca_emu_poll(struct qca_emu *emu);
+
+/**
+ * @brief Gets the file descriptor of the TAP interface.
+ *
+ * @param[in] emu The emulator instance.
+ *
+ * @return The file descriptor, or -1 for other backends.
+ */
+int qca_emu_tap_fd(const struct qca_emu *emu);
+
+/**
+ * @brief Checks the interrupt line.
+ *
+ * @param[in] emu The emulator instance.
+ *
+ * @return true if any enabled interrupt is pending.
+ */
+bool qca_emu_irq_pending(struct qca_emu *emu);
+
+/**
+ * @brief Resets the emulated chip as if SPI_CONFIG was written.
+ *
+ * @param[in] emu The emulator instance.
+ */
+void qca_emu_reset(struct qca_emu *emu);
+
+/**
+ * @brief Gets the emulator statistics.
+ *
+ * @param[in] emu The emulator instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_emu_get_stats(struct qca_emu *emu, struct qca_emu_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_EMU_H */
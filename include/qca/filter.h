@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_FILTER_H
+#define QCA_FILTER_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mme.h"
+
+/* The modem holds only a handful of classification rules. */
+#if !defined(QCA_FILTER_MAX_RULES)
+#define QCA_FILTER_MAX_RULES			8U
+#endif
+#if !defined(QCA_FILTER_MAX_GROUPS)
+#define QCA_FILTER_MAX_GROUPS			8U
+#endif
+#if !defined(QCA_FILTER_DEFAULT_TIMEOUT_MS)
+#define QCA_FILTER_DEFAULT_TIMEOUT_MS		1000U
+#endif
+
+#define QCA_FILTER_MAX_CLASSIFIERS		3U
+
+typedef enum {
+	QCA_FILTER_DROP, /* frames either way */
+	QCA_FILTER_DROP_TX, /* frames from the host to the powerline */
+	QCA_FILTER_DROP_RX, /* frames from the powerline to the host */
+} qca_filter_action_t;
+
+typedef enum {
+	QCA_FILTER_ETH_DA, /* 6 bytes */
+	QCA_FILTER_ETH_SA, /* 6 bytes */
+	QCA_FILTER_VLAN_ID, /* 2 bytes, of the outer tag */
+	QCA_FILTER_IPV4_PROTO, /* 1 byte */
+	QCA_FILTER_IPV4_SA, /* 4 bytes */
+	QCA_FILTER_IPV4_DA, /* 4 bytes */
+	QCA_FILTER_IPV6_SA, /* 16 bytes */
+	QCA_FILTER_IPV6_DA, /* 16 bytes */
+	QCA_FILTER_TCP_DP, /* 2 bytes */
+	QCA_FILTER_UDP_DP, /* 2 bytes */
+	QCA_FILTER_FIELD_MAX,
+} qca_filter_field_t;
+
+typedef enum {
+	QCA_FILTER_RULE_UNUSED,
+	QCA_FILTER_RULE_PENDING, /* not in the modem yet */
+	QCA_FILTER_RULE_ACTIVE, /* in the modem */
+	QCA_FILTER_RULE_REJECTED, /* refused by the modem. Not retried */
+} qca_filter_rule_state_t;
+
+struct qca_filter_classifier {
+	qca_filter_field_t field;
+	bool negate; /*< to match when the field differs */
+	uint8_t value[16]; /*< in network byte order, as long as the field */
+};
+
+struct qca_filter_rule {
+	qca_filter_action_t action;
+	bool match_any; /*< any of the classifiers rather than all of them */
+	uint8_t nr_classifiers; /*< 1 to QCA_FILTER_MAX_CLASSIFIERS */
+	struct qca_filter_classifier classifiers[QCA_FILTER_MAX_CLASSIFIERS];
+};
+
+struct qca_filter_rule_stats {
+	qca_filter_rule_state_t state;
+	uint32_t host_hits; /*< received frames matching the rule that still
+			made it to the host. For a group, the frames sent to
+			it */
+	uint32_t programmed; /*< times the modem took the rule, once plus once
+			every time it restarted */
+};
+
+/**
+ * @brief Function pointer type for sending a request to the modem.
+ *
+ * The confirmation is expected to come back through @ref qca_filter_input.
+ * It should not block.
+ *
+ * @param[in] type The MME to request.
+ * @param[in] msg Body of the request, to pass to qca_encode_mme().
+ * @param[in] msglen Length of the body.
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_filter_request_t)(qca_mmtype_t type,
+		const void *msg, size_t msglen, void *ctx);
+
+struct qca_filter_conf {
+	uint32_t timeout_ms; /*< before a request is sent again. 0 for
+			QCA_FILTER_DEFAULT_TIMEOUT_MS */
+	qca_filter_request_t request;
+	void *request_ctx;
+};
+
+struct qca_filter;
+
+/**
+ * @brief Creates a filter rule set to offload to the modem.
+ *
+ * Rules, multicast groups and the bandwidth limit are programmed as
+ * CLASSIFICATION, MULTICAST_INFO and BW_LIMIT requests that the modem
+ * forgets on reset, one request at a time from @ref qca_filter_poll, and
+ * programmed again once the modem has restarted.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return A filter instance on success, or NULL on failure.
+ */
+struct qca_filter *qca_filter_create(const struct qca_filter_conf *conf);
+
+/**
+ * @brief Destroys the filter.
+ *
+ * The rules are left in the modem until it resets.
+ *
+ * @param[in] filter The filter instance.
+ */
+void qca_filter_destroy(struct qca_filter *filter);
+
+/**
+ * @brief Adds a rule, to be programmed on the next poll.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] rule The rule.
+ *
+ * @return The rule ID on success, -ENOSPC if all the slots are taken,
+ *         -EINVAL if the rule is not valid, or a negative error code on
+ *         failure.
+ */
+int qca_filter_add(struct qca_filter *filter,
+		const struct qca_filter_rule *rule);
+
+/**
+ * @brief Removes a rule, from the modem too on the next poll.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] id The rule ID.
+ *
+ * @return 0 on success, -ENOENT if no such rule, or a negative error code
+ *         on failure.
+ */
+int qca_filter_remove(struct qca_filter *filter, int id);
+
+/**
+ * @brief Adds a multicast group to let through, on the next poll.
+ *
+ * Once any group is added, the modem drops multicast frames sent to groups
+ * that are not. Broadcast frames are always let through.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] group Destination address of the group.
+ *
+ * @return The group ID on success, -ENOSPC if all the slots are taken,
+ *         -EEXIST if the group is already added, -EINVAL if the address is
+ *         not multicast, or a negative error code on failure.
+ */
+int qca_filter_join(struct qca_filter *filter, const uint8_t group[6]);
+
+/**
+ * @brief Removes a multicast group, from the modem too on the next poll.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] id The group ID.
+ *
+ * @return 0 on success, -ENOENT if no such group, or a negative error code
+ *         on failure.
+ */
+int qca_filter_leave(struct qca_filter *filter, int id);
+
+/**
+ * @brief Limits the bandwidth the modem uses, on the next poll.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] mbps The limit in Mbps, or 0 for none.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_filter_set_bw_limit(struct qca_filter *filter, uint16_t mbps);
+
+/**
+ * @brief Feeds a received MME to the filter.
+ *
+ * A CLASSIFICATION, MULTICAST_INFO or BW_LIMIT confirmation completes the
+ * outstanding request of the same type.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] mmtype MMTYPE as on the wire.
+ * @param[in] body Body of the MME, right after the OUI.
+ * @param[in] body_len Length of the body.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 if the MME was consumed, -ENOMSG if not of interest, or a
+ *         negative error code on failure.
+ */
+int qca_filter_input(struct qca_filter *filter, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms);
+
+/**
+ * @brief Sends the next request needed to bring the modem in line.
+ *
+ * It is meant to be called periodically from a background context. No
+ * request is sent while one is outstanding, up to the timeout.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_filter_poll(struct qca_filter *filter, uint32_t now_ms);
+
+/**
+ * @brief Marks every rule to be programmed again if the modem has restarted.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] int_src Value of the INT_SRC register.
+ */
+void qca_filter_handle_interrupt(struct qca_filter *filter, uint16_t int_src);
+
+/**
+ * @brief Matches a received frame against the dropping rules on the host.
+ *
+ * Frames that the modem should have dropped still reach the host until the
+ * rules and the groups are programmed, e.g. right after the modem restarts.
+ * Dropping them here keeps the behaviour the same meanwhile. A field
+ * missing in the frame does not match.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] frame Ethernet frame.
+ * @param[in] frame_len Length of the frame.
+ *
+ * @return true if a rule matched and the frame is to be dropped.
+ */
+bool qca_filter_match(struct qca_filter *filter,
+		const void *frame, size_t frame_len);
+
+/**
+ * @brief Gets the state and the counters of a multicast group.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] id The group ID.
+ * @param[out] stats Where to store them.
+ *
+ * @return 0 on success, -ENOENT if no such group, or a negative error code
+ *         on failure.
+ */
+int qca_filter_get_group_stats(struct qca_filter *filter, int id,
+		struct qca_filter_rule_stats *stats);
+
+/**
+ * @brief Gets the state and the counters of a rule.
+ *
+ * @param[in] filter The filter instance.
+ * @param[in] id The rule ID.
+ * @param[out] stats Where to store them.
+ *
+ * @return 0 on success, -ENOENT if no such rule, or a negative error code
+ *         on failure.
+ */
+int qca_filter_get_stats(struct qca_filter *filter, int id,
+		struct qca_filter_rule_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_FILTER_H */
@@ -0,0 +1,177 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_LINKMON_H
+#define QCA_LINKMON_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if !defined(QCA_LINKMON_MAX_SUBSCRIBERS)
+#define QCA_LINKMON_MAX_SUBSCRIBERS		4U
+#endif
+#if !defined(QCA_LINKMON_DEFAULT_MIN_INTERVAL_MS)
+#define QCA_LINKMON_DEFAULT_MIN_INTERVAL_MS	200U
+#endif
+#if !defined(QCA_LINKMON_DEFAULT_MAX_INTERVAL_MS)
+#define QCA_LINKMON_DEFAULT_MAX_INTERVAL_MS	10000U
+#endif
+#if !defined(QCA_LINKMON_DEFAULT_TIMEOUT_MS)
+#define QCA_LINKMON_DEFAULT_TIMEOUT_MS		1000U
+#endif
+#if !defined(QCA_LINKMON_DEFAULT_MAX_MISSED)
+#define QCA_LINKMON_DEFAULT_MAX_MISSED		3U
+#endif
+
+typedef enum {
+	QCA_LINK_UNKNOWN, /* not known yet, or the modem does not respond */
+	QCA_LINK_DOWN,
+	QCA_LINK_UP,
+} qca_link_state_t;
+
+struct qca_linkmon_event {
+	qca_link_state_t state;
+	qca_link_state_t prev;
+	uint32_t timestamp_ms; /*< when the change was noticed */
+};
+
+/**
+ * @brief Function pointer type for sending a PL_LINK_STATUS request.
+ *
+ * The confirmation is expected to come back through
+ * @ref qca_linkmon_input. It should not block.
+ *
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_linkmon_request_t)(void *ctx);
+
+typedef void (*qca_linkmon_handler_t)(const struct qca_linkmon_event *event,
+		void *ctx);
+
+struct qca_linkmon_conf {
+	uint32_t min_interval_ms; /*< polling interval right after a change.
+			0 for QCA_LINKMON_DEFAULT_MIN_INTERVAL_MS */
+	uint32_t max_interval_ms; /*< polling interval when stable. 0 for
+			QCA_LINKMON_DEFAULT_MAX_INTERVAL_MS */
+	uint32_t timeout_ms; /*< for a confirmation. 0 for
+			QCA_LINKMON_DEFAULT_TIMEOUT_MS */
+	uint8_t max_missed; /*< confirmations missed in a row before the state
+			turns unknown. 0 for QCA_LINKMON_DEFAULT_MAX_MISSED */
+
+	qca_linkmon_request_t request;
+	void *request_ctx;
+};
+
+struct qca_linkmon;
+
+/**
+ * @brief Creates a link monitor.
+ *
+ * The state starts unknown and the first @ref qca_linkmon_poll queries the
+ * modem right away.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return A monitor instance on success, or NULL on failure.
+ */
+struct qca_linkmon *qca_linkmon_create(const struct qca_linkmon_conf *conf);
+
+/**
+ * @brief Destroys the monitor.
+ *
+ * @param[in] mon The monitor instance.
+ */
+void qca_linkmon_destroy(struct qca_linkmon *mon);
+
+/**
+ * @brief Registers a handler for link state changes.
+ *
+ * @param[in] mon The monitor instance.
+ * @param[in] handler The handler.
+ * @param[in] ctx User context passed to the handler.
+ *
+ * @return 0 on success, -ENOSPC if all the slots are taken, or a negative
+ *         error code on failure.
+ */
+int qca_linkmon_subscribe(struct qca_linkmon *mon,
+		qca_linkmon_handler_t handler, void *ctx);
+
+/**
+ * @brief Unregisters a handler.
+ *
+ * @param[in] mon The monitor instance.
+ * @param[in] handler The handler.
+ * @param[in] ctx User context the handler was registered with.
+ *
+ * @return 0 on success, -ENOENT if not registered, or a negative error code
+ *         on failure.
+ */
+int qca_linkmon_unsubscribe(struct qca_linkmon *mon,
+		qca_linkmon_handler_t handler, void *ctx);
+
+/**
+ * @brief Feeds a received MME to the monitor.
+ *
+ * A PL_LINK_STATUS confirmation updates the state. An unsolicited
+ * PL_LINK_STATUS indication makes the next poll query the modem at once.
+ *
+ * @param[in] mon The monitor instance.
+ * @param[in] mmtype MMTYPE as on the wire.
+ * @param[in] body Body of the MME, right after the OUI.
+ * @param[in] body_len Length of the body.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 if the MME was consumed, -ENOMSG if not of interest, or a
+ *         negative error code on failure.
+ */
+int qca_linkmon_input(struct qca_linkmon *mon, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms);
+
+/**
+ * @brief Resets the monitor if the modem has restarted.
+ *
+ * The state turns unknown and polling goes back to the shortest interval.
+ *
+ * @param[in] mon The monitor instance.
+ * @param[in] int_src Value of the INT_SRC register.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_linkmon_handle_interrupt(struct qca_linkmon *mon, uint16_t int_src,
+		uint32_t now_ms);
+
+/**
+ * @brief Queries the modem when the polling interval has elapsed.
+ *
+ * The interval starts short and doubles every time the state is confirmed
+ * unchanged, up to the maximum. Any change brings it back to the minimum.
+ *
+ * @param[in] mon The monitor instance.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return Milliseconds until the monitor needs to be polled again.
+ */
+uint32_t qca_linkmon_poll(struct qca_linkmon *mon, uint32_t now_ms);
+
+/**
+ * @brief Gets the current link state.
+ *
+ * @param[in] mon The monitor instance.
+ *
+ * @return The link state.
+ */
+qca_link_state_t qca_linkmon_state(const struct qca_linkmon *mon);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_LINKMON_H */
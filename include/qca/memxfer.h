@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_MEMXFER_H
+#define QCA_MEMXFER_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mme.h"
+
+#define QCA_MEMXFER_MAX_CHUNK			1024U
+#define QCA_MEMXFER_NO_RETRY			0xFFU /* for retries */
+
+#if !defined(QCA_MEMXFER_DEFAULT_WINDOW)
+#define QCA_MEMXFER_DEFAULT_WINDOW		4U
+#endif
+#if !defined(QCA_MEMXFER_DEFAULT_TIMEOUT_MS)
+#define QCA_MEMXFER_DEFAULT_TIMEOUT_MS		500U
+#endif
+#if !defined(QCA_MEMXFER_DEFAULT_RETRIES)
+#define QCA_MEMXFER_DEFAULT_RETRIES		3U
+#endif
+
+struct qca_mme_rd_mem {
+	uint32_t addr;
+	uint32_t len;
+} __attribute__((packed));
+
+struct qca_mme_rd_mem_cnf {
+	uint8_t status;
+	uint32_t addr;
+	uint32_t len;
+	uint8_t data[];
+} __attribute__((packed));
+
+struct qca_mme_wr_mem {
+	uint32_t addr;
+	uint32_t len;
+	uint8_t data[];
+} __attribute__((packed));
+
+struct qca_mme_wr_mem_cnf {
+	uint8_t status;
+	uint32_t addr;
+	uint32_t len;
+} __attribute__((packed));
+
+/**
+ * @brief Function pointer type for sending a request to the modem.
+ *
+ * The confirmation is expected to come back through
+ * @ref qca_memxfer_input. It should not block. It runs with the engine
+ * locked and must not call back into the engine.
+ *
+ * @param[in] type QCA_MMTYPE_RD_MEM or QCA_MMTYPE_WR_MEM.
+ * @param[in] body Body of the request, to go right after the OUI.
+ * @param[in] body_len Length of the body.
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_memxfer_send_t)(qca_mmtype_t type,
+		const void *body, size_t body_len, void *ctx);
+
+/**
+ * @brief Function pointer type for taking read data, in address order.
+ *
+ * It runs with the engine unlocked, like the progress callback, so it may
+ * cancel the transfer.
+ *
+ * @param[in] offset Offset from the start of the range.
+ * @param[in] data The data.
+ * @param[in] len Length of the data.
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code to abort the transfer.
+ */
+typedef int (*qca_memxfer_sink_t)(size_t offset,
+		const void *data, size_t len, void *ctx);
+
+/**
+ * @brief Function pointer type for reporting progress.
+ *
+ * @param[in] done Bytes transferred so far, in address order.
+ * @param[in] total Length of the range.
+ * @param[in] ctx User context.
+ */
+typedef void (*qca_memxfer_progress_t)(size_t done, size_t total, void *ctx);
+
+struct qca_memxfer_conf {
+	size_t window; /*< requests in flight at most. 0 for
+			QCA_MEMXFER_DEFAULT_WINDOW */
+	size_t chunk; /*< bytes a request. 0 or over the maximum for
+			QCA_MEMXFER_MAX_CHUNK */
+	uint32_t timeout_ms; /*< before a request is sent again. 0 for
+			QCA_MEMXFER_DEFAULT_TIMEOUT_MS */
+	uint8_t retries; /*< per request. 0 for QCA_MEMXFER_DEFAULT_RETRIES,
+			QCA_MEMXFER_NO_RETRY for none */
+
+	qca_memxfer_send_t send;
+	void *send_ctx;
+	qca_memxfer_progress_t on_progress;
+	void *on_progress_ctx;
+};
+
+struct qca_memxfer_stats {
+	uint32_t requests;
+	uint32_t retransmits;
+	uint32_t stale; /*< confirmations matching no request in flight */
+};
+
+struct qca_memxfer;
+
+/**
+ * @brief Creates a bulk memory transfer engine.
+ *
+ * A range is split into requests of up to @ref QCA_MEMXFER_MAX_CHUNK bytes,
+ * and a window of them is kept in flight at a time.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return An engine instance on success, or NULL on failure.
+ */
+struct qca_memxfer *qca_memxfer_create(const struct qca_memxfer_conf *conf);
+
+/**
+ * @brief Destroys the engine.
+ *
+ * @param[in] xfer The engine instance.
+ */
+void qca_memxfer_destroy(struct qca_memxfer *xfer);
+
+/**
+ * @brief Starts reading a memory range into a buffer.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[in] addr Start address.
+ * @param[out] buf Buffer of @p len bytes at least.
+ * @param[in] len Length of the range.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 on success, -EBUSY if a transfer is in progress, or a negative
+ *         error code on failure.
+ */
+int qca_memxfer_read(struct qca_memxfer *xfer, uint32_t addr,
+		void *buf, size_t len, uint32_t now_ms);
+
+/**
+ * @brief Starts reading a memory range into a sink.
+ *
+ * Confirmations may come in any order. The sink sees the data in address
+ * order nonetheless.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[in] addr Start address.
+ * @param[in] len Length of the range.
+ * @param[in] sink The sink, e.g. writing to a file.
+ * @param[in] sink_ctx User context passed to @p sink.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 on success, -EBUSY if a transfer is in progress, or a negative
+ *         error code on failure.
+ */
+int qca_memxfer_read_to(struct qca_memxfer *xfer, uint32_t addr, size_t len,
+		qca_memxfer_sink_t sink, void *sink_ctx, uint32_t now_ms);
+
+/**
+ * @brief Starts writing a buffer to a memory range.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[in] addr Start address.
+ * @param[in] data The data. It must stay valid until the transfer ends.
+ * @param[in] len Length of the data.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 on success, -EBUSY if a transfer is in progress, or a negative
+ *         error code on failure.
+ */
+int qca_memxfer_write(struct qca_memxfer *xfer, uint32_t addr,
+		const void *data, size_t len, uint32_t now_ms);
+
+/**
+ * @brief Feeds a received MME to the engine.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[in] mmtype MMTYPE as on the wire.
+ * @param[in] body Body of the MME, right after the OUI.
+ * @param[in] body_len Length of the body.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 if the MME was consumed, -ENOMSG if not of interest, or a
+ *         negative error code on failure.
+ */
+int qca_memxfer_input(struct qca_memxfer *xfer, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms);
+
+/**
+ * @brief Sends requests again that timed out.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_memxfer_poll(struct qca_memxfer *xfer, uint32_t now_ms);
+
+/**
+ * @brief Gets the state of the transfer.
+ *
+ * @param[in] xfer The engine instance.
+ *
+ * @return 1 while in progress, 0 when done, -ETIMEDOUT if a request ran out
+ *         of retries, -EIO if the modem refused a request, or another
+ *         negative error code the transfer was aborted with.
+ */
+int qca_memxfer_status(const struct qca_memxfer *xfer);
+
+/**
+ * @brief Aborts the transfer in progress.
+ *
+ * @param[in] xfer The engine instance.
+ */
+void qca_memxfer_cancel(struct qca_memxfer *xfer);
+
+/**
+ * @brief Gets the engine statistics.
+ *
+ * @param[in] xfer The engine instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_memxfer_get_stats(struct qca_memxfer *xfer,
+		struct qca_memxfer_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_MEMXFER_H */
@@ -13,6 +13,21 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+#define QCA_MME_ETHERTYPE		0x88E1U /* HomePlug AV */
+#define QCA_MME_MMV			0x01U
+#define QCA_MME_HEADER_LEN		19U /* ODA, OSA, type, MMV, MMTYPE, FMI */
+#define QCA_MME_OUI_LEN			3U
+
+/* Vendor MMTYPEs go on the wire as 0xA000 | (qca_mmtype_t << 2) | variant */
+#define QCA_MMTYPE_VENDOR		0xA000U
+#define QCA_MMTYPE_VENDOR_MASK		0xE000U
+#define QCA_MMTYPE_VARIANT_MASK		0x0003U
+
+/* INT_SRC bit the modem sets once its CPU is up, i.e. after a reboot. State
+ * cached from the modem is stale by then. */
+#define QCA_MME_INT_CPU_ON		0x0040U
 
 enum qca_mmtype {
 	QCA_MMTYPE_SW_VER		= 0x0000U,
@@ -71,6 +86,13 @@ enum qca_mmtype {
 
 typedef uint16_t qca_mmtype_t;
 
+typedef enum {
+	QCA_MME_REQ			= 0x0U,
+	QCA_MME_CNF			= 0x1U,
+	QCA_MME_IND			= 0x2U,
+	QCA_MME_RSP			= 0x3U,
+} qca_mme_variant_t;
+
 struct qca_mme {
 	uint8_t oui[3]; /*< Qualcomm OUI: 0x00, 0xB0, 0x52 */
 	uint8_t body[];
@@ -163,11 +185,162 @@ struct qca_mme_mo_cnf {
 	uint8_t data[];
 } __attribute__((packed));
 
+struct qca_mme_tone_map {
+	uint8_t mac[6]; /*< the peer the tone map is for */
+	uint8_t slot;
+} __attribute__((packed));
+
+struct qca_mme_tone_map_cnf {
+	uint8_t status;
+	uint8_t slot;
+	uint8_t num_slots;
+	uint16_t num_active_carriers;
+	uint8_t mod_carrier[]; /*< two carriers a byte, low nibble first */
+} __attribute__((packed));
+
+struct qca_mme_rx_tone_map {
+	uint8_t mac[6];
+	uint8_t slot;
+	uint8_t coupling;
+} __attribute__((packed));
+
+struct qca_mme_rx_tone_map_cnf {
+	uint8_t status;
+	uint8_t mac[6];
+	uint8_t slot;
+	uint8_t coupling;
+	uint8_t num_slots;
+	uint16_t num_active_carriers;
+	uint8_t mod_carrier[]; /*< two carriers a byte, low nibble first */
+} __attribute__((packed));
+
+struct qca_mme_link_stats {
+	uint8_t control; /*< 0 to read, 1 to read and clear */
+	uint8_t direction; /*< 0 for TX, 1 for RX */
+	uint8_t link_id;
+	uint8_t mac[6];
+} __attribute__((packed));
+
+struct qca_mme_link_stats_cnf {
+	uint8_t status;
+	uint8_t link_id;
+	uint8_t tei;
+	uint8_t direction;
+	uint8_t stats[]; /*< little endian 64-bit counters by direction */
+} __attribute__((packed));
+
+struct qca_mme_classifier {
+	uint8_t pid; /*< the field to look at */
+	uint8_t operand; /*< 0 if equal, 1 if not equal */
+	uint8_t value[16]; /*< in network byte order */
+} __attribute__((packed));
+
+struct qca_mme_classification {
+	uint8_t control; /*< 0 to add, 1 to remove */
+	uint8_t volatility; /*< 0 until the modem resets, 1 to persist */
+	uint8_t action;
+	uint8_t operand; /*< 0 if all classifiers match, 1 if any */
+	uint8_t num_classifiers;
+	struct qca_mme_classifier classifiers[3];
+	uint16_t cspec_version;
+	uint8_t vlan_tag[4];
+	uint8_t reserved[14];
+} __attribute__((packed));
+
+struct qca_mme_classification_cnf {
+	uint8_t status; /*< 0x00 on success */
+} __attribute__((packed));
+
+struct qca_mme_multicast_info {
+	uint8_t control; /*< 0 to add, 1 to remove */
+	uint8_t volatility; /*< 0 until the modem resets, 1 to persist */
+	uint8_t group[6]; /*< destination address of the group */
+} __attribute__((packed));
+
+struct qca_mme_multicast_info_cnf {
+	uint8_t status; /*< 0x00 on success */
+} __attribute__((packed));
+
+struct qca_mme_bw_limit {
+	uint8_t control; /*< 0 to read, 1 to set */
+	uint16_t limit; /*< in Mbps, 0 for none. Little endian */
+} __attribute__((packed));
+
+struct qca_mme_bw_limit_cnf {
+	uint8_t status; /*< 0x00 on success */
+	uint16_t limit;
+} __attribute__((packed));
+
 uint16_t qca_get_mmcode(qca_mmtype_t type);
 size_t qca_encode_mme(struct qca_mme *qca, qca_mmtype_t type,
 		const void *msg, size_t msglen);
 qca_mmtype_t qca_decode_mme(const void *data, size_t datasize, uint16_t mmtype);
 
+/**
+ * @brief Builds the wire MMTYPE of a vendor MME.
+ *
+ * @param[in] type The vendor MME.
+ * @param[in] variant REQ, CNF, IND or RSP.
+ *
+ * @return The MMTYPE as carried in the frame header.
+ */
+uint16_t qca_mme_mmtype(qca_mmtype_t type, qca_mme_variant_t variant);
+
+/**
+ * @brief Tells whether a wire MMTYPE is in the vendor-specific range.
+ *
+ * @param[in] mmtype The MMTYPE from the frame header.
+ *
+ * @return true if it is a vendor MME, false otherwise.
+ */
+bool qca_mme_is_vendor(uint16_t mmtype);
+
+/**
+ * @brief Gets the vendor MME a wire MMTYPE stands for.
+ *
+ * @param[in] mmtype The MMTYPE from the frame header.
+ *
+ * @return The vendor MME, without the variant.
+ */
+qca_mmtype_t qca_mme_type(uint16_t mmtype);
+
+/**
+ * @brief Gets the variant of a wire MMTYPE.
+ *
+ * @param[in] mmtype The MMTYPE from the frame header.
+ *
+ * @return REQ, CNF, IND or RSP.
+ */
+qca_mme_variant_t qca_mme_variant(uint16_t mmtype);
+
+/**
+ * @brief Writes the Ethernet and HomePlug AV header of an MME.
+ *
+ * The frame is not fragmented, so FMI is left zero.
+ *
+ * @param[out] frame The frame. At least QCA_MME_HEADER_LEN bytes.
+ * @param[in] dst Destination MAC address.
+ * @param[in] src Source MAC address.
+ * @param[in] mmtype The wire MMTYPE.
+ *
+ * @return QCA_MME_HEADER_LEN, where the MME body goes.
+ */
+size_t qca_mme_put_header(void *frame,
+		const uint8_t *dst, const uint8_t *src, uint16_t mmtype);
+
+/**
+ * @brief Tells whether a deadline in milliseconds has passed.
+ *
+ * The comparison holds across the wraparound of the 32-bit clock, as long
+ * as the deadline is less than half the range away.
+ *
+ * @param[in] now_ms The current time.
+ * @param[in] deadline_ms The deadline.
+ *
+ * @return true if @p now_ms is at or past @p deadline_ms.
+ */
+bool qca_mme_is_expired(uint32_t now_ms, uint32_t deadline_ms);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_MMEFRAG_H
+#define QCA_MMEFRAG_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define QCA_MMEFRAG_HEADER_LEN			19U /* up to and with FMI */
+#define QCA_MMEFRAG_MAX_FRAGMENTS		16U
+
+#if !defined(QCA_MMEFRAG_DEFAULT_CONTEXTS)
+#define QCA_MMEFRAG_DEFAULT_CONTEXTS		4U
+#endif
+#if !defined(QCA_MMEFRAG_DEFAULT_ARENA_SIZE)
+#define QCA_MMEFRAG_DEFAULT_ARENA_SIZE		16384U
+#endif
+#if !defined(QCA_MMEFRAG_DEFAULT_TIMEOUT_MS)
+#define QCA_MMEFRAG_DEFAULT_TIMEOUT_MS		1000U
+#endif
+#if !defined(QCA_MMEFRAG_DEFAULT_MTU)
+#define QCA_MMEFRAG_DEFAULT_MTU			1500U /* the driver limit */
+#endif
+
+/* A complete management message. The body is everything after the FMI, in
+ * one contiguous piece. */
+struct qca_mme_view {
+	uint8_t src[6];
+	uint16_t mmtype;
+	const uint8_t *body;
+	size_t body_len;
+};
+
+struct qca_mmefrag_conf {
+	size_t contexts; /*< messages reassembled at once. 0 for
+			QCA_MMEFRAG_DEFAULT_CONTEXTS */
+	size_t arena_size; /*< shared by all the reassembly buffers. 0 for
+			QCA_MMEFRAG_DEFAULT_ARENA_SIZE */
+	uint32_t timeout_ms; /*< for all the fragments of a message to arrive.
+			0 for QCA_MMEFRAG_DEFAULT_TIMEOUT_MS */
+};
+
+struct qca_mmefrag_stats {
+	uint32_t fragments; /*< fragments taken */
+	uint32_t reassembled; /*< messages completed from fragments */
+	uint32_t timeouts; /*< messages given up on */
+	uint32_t no_context; /*< fragments dropped for lack of a context */
+	uint32_t no_memory; /*< fragments dropped for lack of arena space */
+	uint32_t malformed; /*< fragments inconsistent with their message */
+};
+
+/**
+ * @brief Function pointer type for sending a fragment.
+ *
+ * @param[in] frame The Ethernet frame.
+ * @param[in] frame_size Length of the frame.
+ * @param[in] ctx User context.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_mmefrag_send_t)(const void *frame, size_t frame_size,
+		void *ctx);
+
+struct qca_mmefrag;
+
+/**
+ * @brief Creates a reassembler.
+ *
+ * @param[in] conf Configuration. NULL for defaults.
+ *
+ * @return A reassembler instance on success, or NULL on failure.
+ */
+struct qca_mmefrag *qca_mmefrag_create(const struct qca_mmefrag_conf *conf);
+
+/**
+ * @brief Destroys the reassembler.
+ *
+ * @param[in] frag The reassembler instance.
+ */
+void qca_mmefrag_destroy(struct qca_mmefrag *frag);
+
+/**
+ * @brief Feeds a received HomePlug AV frame.
+ *
+ * Fragments are collected per source address, MMTYPE and fragment sequence
+ * number, in a buffer sized from the first fragment received. A message
+ * that is not fragmented is passed through as a view on @p frame itself.
+ *
+ * The view of a reassembled message points into the arena and stays valid
+ * until the next call to this function or @ref qca_mmefrag_poll. Padding
+ * of a short last fragment is not told apart and ends up in the body.
+ *
+ * @param[in] frag The reassembler instance.
+ * @param[in] frame The Ethernet frame.
+ * @param[in] frame_size Length of the frame.
+ * @param[in] now_ms The current time in milliseconds.
+ * @param[out] view The complete message.
+ *
+ * @return 1 if a message is complete, 0 if more fragments are expected,
+ *         -ENOMSG if not a HomePlug AV frame, -ENOSPC if no context is
+ *         free, -ENOMEM if the arena is full, -EBADMSG if the fragment
+ *         does not fit its message, or a negative error code on failure.
+ */
+int qca_mmefrag_input(struct qca_mmefrag *frag,
+		const void *frame, size_t frame_size, uint32_t now_ms,
+		struct qca_mme_view *view);
+
+/**
+ * @brief Drops the messages whose fragments did not all arrive in time.
+ *
+ * @param[in] frag The reassembler instance.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_mmefrag_poll(struct qca_mmefrag *frag, uint32_t now_ms);
+
+/**
+ * @brief Gets the reassembly statistics.
+ *
+ * @param[in] frag The reassembler instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_mmefrag_get_stats(const struct qca_mmefrag *frag,
+		struct qca_mmefrag_stats *stats);
+
+/**
+ * @brief Sends a management message, split into fragments as needed.
+ *
+ * Each fragment is built in a frame of @p mtu bytes at most and handed to
+ * @p send in order. A message that fits in one frame goes unfragmented.
+ *
+ * @param[in] dst Destination address.
+ * @param[in] src Source address.
+ * @param[in] mmtype MMTYPE as on the wire.
+ * @param[in] fmsn Fragment sequence number, to tell messages apart.
+ * @param[in] body Body of the message, everything after the FMI.
+ * @param[in] body_len Length of the body.
+ * @param[in] mtu Frame size limit. 0 for QCA_MMEFRAG_DEFAULT_MTU.
+ * @param[in] send The function to send a fragment.
+ * @param[in] send_ctx User context passed to @p send.
+ *
+ * @return The number of fragments sent on success, -EMSGSIZE if the message
+ *         needs more than QCA_MMEFRAG_MAX_FRAGMENTS, or a negative error
+ *         code on failure.
+ */
+int qca_mmefrag_send(const uint8_t dst[6], const uint8_t src[6],
+		uint16_t mmtype, uint8_t fmsn, const void *body, size_t body_len,
+		size_t mtu, qca_mmefrag_send_t send, void *send_ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_MMEFRAG_H */
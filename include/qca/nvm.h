@@ -133,6 +133,10 @@ typedef size_t (*qca_nvm_reader_t)(void *buf, size_t bufsize, void *ctx);
  * @param[in] ctx The context pointer that can be used to pass additional
  *            information.
  *
+ * @note With QCA_STATIC, the read-ahead buffer is a single static one, so
+ *       iterations do not run concurrently. One started meanwhile, including
+ *       from the callback, returns -EBUSY.
+ *
  * @return 0 on success, or an error code on failure.
  */
 int qca_nvm_iterate(qca_nvm_reader_t reader, size_t nvm_size,
@@ -165,11 +169,28 @@ uint32_t qca_calc_chksum(const void *data, size_t len, uint32_t checksum);
  * @param[out] offset   Pointer to store the calculated offset for the specified
  *                      image type.
  *
+ * @note The reader is called with a NULL context. Use @ref qca_nvm_locate
+ *       for a reader that needs one.
+ *
  * @return 0 on success, or a negative error code on failure.
  */
 int qca_nvm_offset(qca_nvm_image_t type,
 		qca_nvm_reader_t reader, size_t nvm_size, uint32_t *offset);
 
+/**
+ * @brief Same as @ref qca_nvm_offset but with a context for the reader.
+ *
+ * @param[in]  type       The type of the NVM image to locate.
+ * @param[in]  reader     The reader instance used to access the NVM data.
+ * @param[in]  reader_ctx Context to be passed to the reader.
+ * @param[in]  nvm_size   The total size of the NVM data.
+ * @param[out] offset     Pointer to store the offset of the image header.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_nvm_locate(qca_nvm_image_t type, qca_nvm_reader_t reader,
+		void *reader_ctx, size_t nvm_size, uint32_t *offset);
+
 #if defined(__cplusplus)
 }
 #endif
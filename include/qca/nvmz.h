@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_NVMZ_H
+#define QCA_NVMZ_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The largest block a reader decompresses. Two blocks of it is all the RAM
+ * a reader takes, whatever the size of the image. */
+#if !defined(QCA_NVMZ_BLOCK_MAXLEN)
+#define QCA_NVMZ_BLOCK_MAXLEN			4096U
+#endif
+
+#define QCA_NVMZ_MAGIC				"QNVZ"
+
+/* A compressed NVM image is this header, then nr_blocks + 1 offsets of the
+ * blocks from the start of the image with the last one marking its end, then
+ * the blocks. Each block holds block_size bytes of the image, but the last
+ * one that may hold less, compressed with an LZ77 of byte-aligned sequences,
+ * or stored as is when it does not compress. All in little endian. */
+struct qca_nvmz_header {
+	uint8_t magic[4];
+	uint32_t size; /*< of the image uncompressed */
+	uint32_t block_size;
+	uint32_t nr_blocks;
+} __attribute__((packed));
+
+/**
+ * @brief Function pointer type for reading the compressed image.
+ *
+ * @param[in] offset Where to read from, from the start of the image.
+ * @param[out] buf Pointer to the buffer where the read data will be stored.
+ * @param[in] bufsize Number of bytes to read.
+ * @param[in] ctx User context.
+ *
+ * @return The number of bytes read. Less than @p bufsize on error.
+ */
+typedef size_t (*qca_nvmz_source_t)(uint32_t offset,
+		void *buf, size_t bufsize, void *ctx);
+
+struct qca_nvmz;
+
+/**
+ * @brief Opens a compressed NVM image for reading.
+ *
+ * @param[in] source The function to read the compressed image with.
+ * @param[in] source_ctx Context to be passed to the source.
+ *
+ * @return A reader instance on success, or NULL if the image is not valid,
+ *         has blocks larger than QCA_NVMZ_BLOCK_MAXLEN or on failure.
+ */
+struct qca_nvmz *qca_nvmz_create(qca_nvmz_source_t source, void *source_ctx);
+
+/**
+ * @brief Closes the reader.
+ *
+ * @param[in] z The reader instance.
+ */
+void qca_nvmz_destroy(struct qca_nvmz *z);
+
+/**
+ * @brief Gets the size of the image uncompressed.
+ *
+ * @param[in] z The reader instance.
+ *
+ * @return The size in bytes, to pass as nvm_size to qca/nvm.h.
+ */
+size_t qca_nvmz_size(const struct qca_nvmz *z);
+
+/**
+ * @brief Moves the read position, e.g. to a module found with
+ * @ref qca_nvm_locate.
+ *
+ * Only the block at the position gets decompressed, found in the index.
+ *
+ * @param[in] z The reader instance.
+ * @param[in] offset The position in the image uncompressed.
+ *
+ * @return 0 on success, or -EINVAL if beyond the end of the image.
+ */
+int qca_nvmz_seek(struct qca_nvmz *z, uint32_t offset);
+
+/**
+ * @brief Reads the image uncompressed from the read position on.
+ *
+ * This is a qca_nvm_reader_t, to pass to qca/nvm.h with the reader instance
+ * as the context.
+ *
+ * @param[out] buf Pointer to the buffer where the read data will be stored.
+ * @param[in] bufsize Size of the buffer.
+ * @param[in] ctx The reader instance.
+ *
+ * @return The number of bytes read. 0 at the end of the image or on error.
+ */
+size_t qca_nvmz_read(void *buf, size_t bufsize, void *ctx);
+
+/**
+ * @brief Gets the most bytes an image compresses to.
+ *
+ * @param[in] image_len Size of the image.
+ * @param[in] block_size Block size to compress with.
+ *
+ * @return The size in bytes.
+ */
+size_t qca_nvmz_bound(size_t image_len, size_t block_size);
+
+/**
+ * @brief Compresses an NVM image, e.g. offline before storing it.
+ *
+ * @param[in] image The NVM image.
+ * @param[in] image_len Size of the image.
+ * @param[in] block_size Block size, up to 65535. Readers take only up to
+ *            their QCA_NVMZ_BLOCK_MAXLEN.
+ * @param[out] buf Where to store the compressed image.
+ * @param[in] bufsize Size of the buffer. @ref qca_nvmz_bound is always
+ *            enough.
+ *
+ * @return The size of the compressed image, -ENOSPC if it does not fit in
+ *         the buffer, or a negative error code on failure.
+ */
+int qca_nvmz_compress(const void *image, size_t image_len, size_t block_size,
+		void *buf, size_t bufsize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_NVMZ_H */
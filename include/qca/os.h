@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_OS_H
+#define QCA_OS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The platform layer the driver core runs on. One of the following is chosen
+ * at build time:
+ *
+ * - default: POSIX threads. Waiters block on a condition variable.
+ * - QCA_OS_SPINLOCK: an atomic test-and-set lock for SMP or preemptive RTOS
+ *   targets without a cheap mutex. Waiters spin with QCA_OS_YIELD().
+ * - QCA_OS_IRQMASK: the lock masks interrupts, for a single core shared with
+ *   ISRs. QCA_OS_IRQ_SAVE() and QCA_OS_IRQ_RESTORE(flags) must be defined.
+ * - QCA_OS_NONE: no locking at all, for single-threaded bare metal.
+ * - QCA_OS_PORT: everything below is provided by the port, with the types
+ *   defined in qca_os_port.h.
+ *
+ * QCA_OS_TIME_US() overrides the monotonic clock, and QCA_OS_MALLOC() and
+ * QCA_OS_FREE() the allocator, whichever variant is chosen. */
+#if defined(QCA_OS_PORT)
+#include "qca_os_port.h"
+#elif defined(QCA_OS_SPINLOCK)
+typedef struct {
+	uint8_t locked;
+} qca_os_lock_t;
+typedef struct {
+	uint8_t unused;
+} qca_os_cond_t;
+#elif defined(QCA_OS_IRQMASK)
+#if !defined(QCA_OS_IRQ_SAVE) || !defined(QCA_OS_IRQ_RESTORE)
+#error "QCA_OS_IRQMASK requires QCA_OS_IRQ_SAVE() and QCA_OS_IRQ_RESTORE()"
+#endif
+typedef struct {
+	unsigned long flags;
+} qca_os_lock_t;
+typedef struct {
+	uint8_t unused;
+} qca_os_cond_t;
+#elif defined(QCA_OS_NONE)
+typedef struct {
+	uint8_t unused;
+} qca_os_lock_t;
+typedef struct {
+	uint8_t unused;
+} qca_os_cond_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t qca_os_lock_t;
+typedef pthread_cond_t qca_os_cond_t;
+#endif
+
+void qca_os_lock_init(qca_os_lock_t *lock);
+void qca_os_lock_deinit(qca_os_lock_t *lock);
+void qca_os_lock(qca_os_lock_t *lock);
+void qca_os_unlock(qca_os_lock_t *lock);
+
+void qca_os_cond_init(qca_os_cond_t *cond);
+void qca_os_cond_deinit(qca_os_cond_t *cond);
+
+/**
+ * @brief Waits for a wakeup with the lock held.
+ *
+ * The lock is released while waiting and taken again before returning.
+ * Wakeups may be spurious, so the caller checks its condition again. The
+ * variants other than pthread just drop the lock and yield for a moment.
+ * None of them may be called from an ISR.
+ *
+ * @param[in] cond The condition.
+ * @param[in] lock The lock held by the caller.
+ * @param[in] deadline_us Deadline in @ref qca_os_now_us time. 0 for none.
+ *
+ * @return 0 on wakeup, or -ETIMEDOUT if the deadline has passed.
+ */
+int qca_os_cond_wait(qca_os_cond_t *cond, qca_os_lock_t *lock,
+		uint64_t deadline_us);
+
+/**
+ * @brief Wakes up all waiters of the condition.
+ *
+ * @param[in] cond The condition.
+ */
+void qca_os_cond_broadcast(qca_os_cond_t *cond);
+
+/**
+ * @brief Returns monotonic time in microseconds.
+ *
+ * @return Time in microseconds.
+ */
+uint64_t qca_os_now_us(void);
+
+/**
+ * @brief Allocates memory, with QCA_OS_MALLOC() if defined.
+ *
+ * @param[in] size Size in bytes.
+ *
+ * @return The memory, not cleared, or NULL on failure.
+ */
+void *qca_os_malloc(size_t size);
+
+/**
+ * @brief Frees memory from @ref qca_os_malloc, with QCA_OS_FREE() if defined.
+ *
+ * @param[in] ptr The memory. NULL is ignored, as with free(), so an
+ *            override must accept it too.
+ */
+void qca_os_free(void *ptr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_OS_H */
@@ -0,0 +1,182 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_PROV_H
+#define QCA_PROV_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "mme.h"
+#include "nvm.h"
+
+#define QCA_PROV_CHUNK_MAXLEN			1024U
+
+#if !defined(QCA_PROV_DEFAULT_WORKERS)
+#define QCA_PROV_DEFAULT_WORKERS		4U
+#endif
+#if !defined(QCA_PROV_DEFAULT_TIMEOUT_MS)
+#define QCA_PROV_DEFAULT_TIMEOUT_MS		1000U
+#endif
+#if !defined(QCA_PROV_DEFAULT_RETRIES)
+#define QCA_PROV_DEFAULT_RETRIES		2U
+#endif
+
+/* Modules of WR_MOD, RD_MOD and MOD_NVM */
+typedef enum {
+	QCA_PROV_MODULE_FIRMWARE		= 0x01,
+	QCA_PROV_MODULE_PIB			= 0x02,
+} qca_prov_module_t;
+
+struct qca_mme_wr_mod {
+	uint8_t module_id;
+	uint8_t reserved;
+	uint16_t len;
+	uint32_t offset;
+	uint32_t chksum; /* of the data in this request */
+	uint8_t data[];
+} __attribute__((packed));
+
+struct qca_mme_wr_mod_cnf {
+	uint8_t status;
+	uint8_t module_id;
+	uint8_t reserved;
+	uint16_t len;
+	uint32_t offset;
+} __attribute__((packed));
+
+struct qca_mme_rd_mod {
+	uint8_t module_id;
+	uint8_t reserved;
+	uint16_t len;
+	uint32_t offset;
+} __attribute__((packed));
+
+struct qca_mme_rd_mod_cnf {
+	uint8_t status;
+	uint8_t reserved1[3];
+	uint8_t module_id;
+	uint8_t reserved2;
+	uint16_t len;
+	uint32_t offset;
+	uint32_t chksum;
+	uint8_t data[];
+} __attribute__((packed));
+
+struct qca_mme_mod_nvm {
+	uint8_t module_id;
+	uint8_t reserved;
+} __attribute__((packed));
+
+struct qca_mme_mod_nvm_cnf {
+	uint8_t status;
+	uint8_t module_id;
+} __attribute__((packed));
+
+typedef enum {
+	QCA_PROV_STAGE_ATTACH,
+	QCA_PROV_STAGE_SIGNATURE,
+	QCA_PROV_STAGE_PERSONALIZE,
+	QCA_PROV_STAGE_UPLOAD,
+	QCA_PROV_STAGE_VERIFY,
+	QCA_PROV_STAGE_COMMIT,
+	QCA_PROV_STAGE_DONE,
+} qca_prov_stage_t;
+
+struct lm_spi_device;
+
+struct qca_prov_board {
+	struct lm_spi_device *spi;
+	uint8_t mac[6];
+	uint8_t dak[16]; /*< as stored in the PIB, i.e. already hashed */
+	uint8_t nmk[16];
+};
+
+struct qca_prov_report {
+	qca_prov_stage_t stage; /*< where it stopped. DONE on success */
+	int err; /*< 0 on success, or a negative error code */
+	uint32_t elapsed_ms;
+	size_t bytes_written;
+	size_t bytes_verified;
+	uint32_t retransmits;
+};
+
+/**
+ * @brief Function pointer type for reporting the progress of a board.
+ *
+ * It is called from the worker thread of the board.
+ *
+ * @param[in] index Index of the board.
+ * @param[in] stage The stage the board has just entered.
+ * @param[in] ctx User context.
+ */
+typedef void (*qca_prov_stage_cb_t)(size_t index, qca_prov_stage_t stage,
+		void *ctx);
+
+struct qca_prov_conf {
+	const void *pib; /*< template, at least sizeof(qca_nvm_pib_t) */
+	size_t pib_len;
+	const void *firmware; /*< module uploaded as is. NULL to skip */
+	size_t firmware_len;
+
+	uint8_t host_mac[6]; /*< source address of the requests */
+	size_t workers; /*< boards run at once. 0 for
+			QCA_PROV_DEFAULT_WORKERS */
+	uint32_t timeout_ms; /*< for each confirmation. 0 for
+			QCA_PROV_DEFAULT_TIMEOUT_MS */
+	uint8_t retries; /*< per request. 0 for QCA_PROV_DEFAULT_RETRIES */
+	bool no_commit; /*< leave the modules in memory, not written to NVM */
+
+	qca_prov_stage_cb_t on_stage;
+	void *on_stage_ctx;
+};
+
+/**
+ * @brief Personalizes a PIB for a board.
+ *
+ * The MAC, DAK and NMK of the board are put in place and the PIB checksum is
+ * recalculated over the length given in the PIB header.
+ *
+ * @param[in,out] pib The PIB, at least sizeof(qca_nvm_pib_t) bytes.
+ * @param[in] pib_len Length of the PIB.
+ * @param[in] board The board.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_prov_personalize(void *pib, size_t pib_len,
+		const struct qca_prov_board *board);
+
+/**
+ * @brief Provisions boards concurrently.
+ *
+ * Each board is taken through the stages on a worker thread with a driver
+ * instance of its own: the SPI signature is checked, the PIB template is
+ * personalized, the firmware, if any, and the PIB are uploaded with WR_MOD,
+ * read back with RD_MOD and compared, and then committed to NVM with
+ * MOD_NVM. A failing board does not stop the others.
+ *
+ * It blocks until every board is done.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ * @param[in] boards The boards, one per SPI device.
+ * @param[in] nr_boards Number of the boards.
+ * @param[out] reports A report for each board, in the order of @p boards.
+ *
+ * @return The number of boards failed, or a negative error code on failure.
+ */
+int qca_prov_run(const struct qca_prov_conf *conf,
+		const struct qca_prov_board *boards, size_t nr_boards,
+		struct qca_prov_report *reports);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_PROV_H */
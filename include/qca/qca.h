@@ -18,6 +18,31 @@ extern "C" {
 #define QCA_MIN_PACKET_LEN	60U /* ethernet frame minimum length */
 #define QCA_SIGNATURE		0xAA55
 
+#if !defined(QCA_RXQ_DEFAULT_SIZE)
+#define QCA_RXQ_DEFAULT_SIZE	2048U
+#endif
+
+/* With QCA_STATIC, nothing is allocated at run time. Each device has an RX
+ * queue of QCA_STATIC_RXQ_SIZE, a power of 2, ignoring the sizes in
+ * struct qca_conf, and qca_dev_create() takes from a pool of
+ * QCA_STATIC_DEVICES besides the built-in device. */
+#if !defined(QCA_STATIC_RXQ_SIZE)
+#define QCA_STATIC_RXQ_SIZE	QCA_RXQ_DEFAULT_SIZE
+#endif
+#if !defined(QCA_STATIC_DEVICES)
+#define QCA_STATIC_DEVICES	1U
+#endif
+
+#if !defined(QCA_CALIBRATION_ROUNDS)
+#define QCA_CALIBRATION_ROUNDS	8U /* probes per transfer size */
+#endif
+#if !defined(QCA_CALIBRATION_BUDGET_US)
+#define QCA_CALIBRATION_BUDGET_US	500U /* bus held per transfer at most */
+#endif
+#if !defined(QCA_TX_COALESCE_MAX_FRAMES)
+#define QCA_TX_COALESCE_MAX_FRAMES	8U
+#endif
+
 enum {
 	QCA_REG_BUFFER		= 0x0000,
 	QCA_REG_BUFSIZE		= 0x0100,
@@ -36,8 +61,102 @@ typedef uint16_t qca_reg_t;
 
 typedef void (*qca_handler_t)(const void *frame, size_t frame_size, void *ctx);
 
+typedef enum {
+	QCA_DIR_RX,
+	QCA_DIR_TX,
+} qca_dir_t;
+
+typedef void (*qca_tap_t)(qca_dir_t dir,
+		const void *frame, size_t frame_size, void *ctx);
+
+/* Monotonic timestamps in microseconds of the stages a frame went through.
+ * The fields not applicable to the direction are 0. */
+struct qca_frame_meta {
+	qca_dir_t dir;
+	uint64_t read_us; /*< RX: SPI read of the last chunk of the frame done,
+			or 0 if the frame was not read by qca_read() */
+	uint64_t input_us; /*< RX: frame completed in qca_input() */
+	uint64_t handler_us; /*< RX: handler entered */
+	uint64_t done_us; /*< RX: handler returned */
+	uint64_t submit_us; /*< TX: qca_write_encoding() called */
+	uint64_t write_us; /*< TX: SPI write done */
+};
+
+typedef void (*qca_frame_meta_t)(const void *frame, size_t frame_size,
+		const struct qca_frame_meta *meta, void *ctx);
+
+typedef void (*qca_spi_trace_t)(const void *tx, size_t txsize,
+		const void *rx, size_t rxsize, int err, void *ctx);
+
+/* Bus access is granted by priority. Requests of the same priority are served
+ * in no particular order, and lower priorities wait as long as higher ones
+ * keep the bus busy. */
+typedef enum {
+	QCA_PRIO_HIGH, /* time-critical, e.g. TX for SLAC responses */
+	QCA_PRIO_NORMAL, /* RX drain and data TX */
+	QCA_PRIO_LOW, /* register access, e.g. diagnostics */
+	QCA_PRIO_MAX,
+} qca_prio_t;
+
+typedef enum {
+	QCA_BUS_OP_READ_REG,
+	QCA_BUS_OP_WRITE_REG,
+} qca_bus_op_type_t;
+
+struct qca_bus_op {
+	qca_bus_op_type_t type;
+	qca_reg_t reg;
+	uint16_t value; /*< the value to write, or the value read */
+};
+
 struct lm_spi_device;
 
+/* A segment of a vectored SPI transfer. */
+struct qca_iovec {
+	const void *base;
+	size_t len;
+};
+
+struct qca_conf {
+	size_t rxq_size; /*< initial RX queue size. 0 for QCA_RXQ_DEFAULT_SIZE */
+	size_t rxq_max_size; /*< the queue grows up to this size when a frame
+			does not fit. 0 or less than rxq_size to keep it fixed */
+	size_t rxq_high_watermark; /*< qca_read() stops draining the chip at or
+			above this level, reached while frames are held back
+			with qca_hold_rx(). 0 for 3/4 of the max size */
+	size_t rxq_low_watermark; /*< and resumes at or below this level.
+			0 for half of the high watermark. Both watermarks are
+			raised to at least one maximum frame */
+	bool warm_attach; /*< keep a modem that an earlier run left set up
+			running as it is. See @ref qca_is_warm */
+};
+
+struct qca_rxq_stats {
+	size_t capacity; /*< current size of the queue */
+	size_t length; /*< bytes pending in the queue */
+	size_t peak; /*< the highest level seen */
+	uint32_t overflow_drops; /*< bytes dropped as the queue was full */
+	uint32_t grows; /*< number of times the queue has grown */
+	uint32_t throttles; /*< number of times the high watermark was hit */
+	bool throttled; /*< true while reading is held back */
+};
+
+/* How SPI transfers are sized. @ref qca_calibrate fills it in from what it
+ * measures on the bus, and a profile saved from an earlier run can be put
+ * back with @ref qca_set_spi_profile instead. All 0 is the default: reads as
+ * large as the caller's buffer, one frame per write and the watermark
+ * registers left alone. */
+struct qca_spi_profile {
+	uint32_t transaction_ns; /*< fixed cost of a transaction */
+	uint32_t byte_ns; /*< cost per byte on the bus */
+	uint16_t rx_chunk; /*< the most bytes @ref qca_read fetches in a
+			transaction. 0 for no limit */
+	uint16_t tx_coalesce; /*< the most bytes @ref qca_write_frames packs
+			in a transaction. 0 for one frame per transaction */
+	uint16_t rdbuf_watermark; /*< for RDBUF_WATERMARK. 0 to leave it */
+	uint16_t wrbuf_watermark; /*< for WRBUF_WATERMARK. 0 to leave it */
+};
+
 /**
  * @brief Initializes the QCA device.
  *
@@ -53,6 +172,37 @@ struct lm_spi_device;
 int qca_init(struct lm_spi_device *spi_iface,
 		qca_handler_t handler, void *handler_ctx);
 
+/**
+ * @brief Initializes the QCA device with the given configuration.
+ *
+ * Same as @ref qca_init but with the RX queue sized and watermarked as
+ * specified in @p conf.
+ *
+ * @param[in] spi_iface Pointer to the SPI device interface.
+ * @param[in] conf Configuration. NULL for defaults.
+ * @param[in] handler Callback function to handle received data.
+ * @param[in] handler_ctx Context to be passed to the handler callback.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_init_with_conf(struct lm_spi_device *spi_iface,
+		const struct qca_conf *conf,
+		qca_handler_t handler, void *handler_ctx);
+
+/**
+ * @brief Tells whether the modem was found running at initialization.
+ *
+ * With warm_attach in struct qca_conf, initialization leaves a modem set up
+ * by an earlier run alone, as long as it has not rebooted since, e.g. after
+ * the host process restarted. Its firmware may still not be the one wanted,
+ * which the SW_VER confirmation and qca/attach.h tell, before skipping the
+ * reset and the upload. The frames it received meanwhile wait in the read
+ * buffer for @ref qca_read.
+ *
+ * @return true if the modem was attached warm, false if it was set up anew.
+ */
+bool qca_is_warm(void);
+
 /**
  * @brief Deinitializes the QCA device.
  *
@@ -96,6 +246,25 @@ int qca_read_reg(qca_reg_t reg, uint16_t *value);
  */
 int qca_write_reg(qca_reg_t reg, uint16_t value);
 
+/**
+ * @brief Runs register operations back to back in one bus grant.
+ *
+ * The operations run in order with no other request in between, e.g. an
+ * INT_SRC read followed by an RDBUF_AVAILABLE read, and stop at the first
+ * failure. @ref qca_read_reg and @ref qca_write_reg go at QCA_PRIO_LOW, so
+ * this is also the way to access registers at a higher priority.
+ *
+ * @param[in,out] ops The operations. Values read are stored in place.
+ * @param[in] nr_ops The number of operations.
+ * @param[in] prio The priority to get the bus with.
+ * @param[in] timeout_ms Time to wait for the bus. 0 to wait forever.
+ *
+ * @return 0 on success, -ETIMEDOUT if the bus was not granted in time, or a
+ *         negative error code on failure.
+ */
+int qca_bus_submit(struct qca_bus_op *ops, size_t nr_ops,
+		qca_prio_t prio, uint32_t timeout_ms);
+
 /**
  * @brief Clears any pending interrupts on the QCA device.
  *
@@ -115,8 +284,13 @@ int qca_clear_interrupt(void);
  * @param[out] buf Pointer to the buffer where the read data will be stored.
  * @param[in] bufsize Size of the buffer, in bytes.
  *
- * @return The number of bytes read on success, or a negative error code on
- *         failure.
+ * No more is read than the RX queue can take. Frames pile up in the queue
+ * while consumers hold them back with @ref qca_hold_rx. Once the queue
+ * reaches the high watermark, reading is held back, leaving the frames in
+ * the chip, until @ref qca_input brings it down to the low watermark.
+ *
+ * @return The number of bytes read on success, -EBUSY while held back by the
+ *         RX queue, or a negative error code on failure.
  */
 int qca_read(void *buf, size_t bufsize);
 
@@ -127,6 +301,9 @@ int qca_read(void *buf, size_t bufsize);
  * This function takes the input stream from SPI, decapsulates it, and then
  * delivers the resulting Ethernet frame to the specified callback function.
  *
+ * It may run in a different thread than @ref qca_read, but not concurrently
+ * with itself. The RX queue it grows is swapped under the bus lock.
+ *
  * @param[in] instream Pointer to the input stream data.
  * @param[in] instream_len Length of the input stream data.
  *
@@ -134,11 +311,27 @@ int qca_read(void *buf, size_t bufsize);
  */
 int qca_input(const void *instream, size_t instream_len);
 
+/**
+ * @brief Holds received frames back while consumers are behind.
+ *
+ * While held, @ref qca_input keeps the frames it completes in the RX queue,
+ * growing it up to rxq_max_size, instead of calling the handler. That is
+ * what brings the queue to the high watermark and stops @ref qca_read from
+ * draining the chip. Once released, the next @ref qca_input delivers the
+ * frames kept, and it may be called with no data for just that.
+ *
+ * It may be called from any context, e.g. by a consumer whose own queue got
+ * full or has drained.
+ *
+ * @param[in] hold true to hold frames back, false to release them.
+ */
+void qca_hold_rx(bool hold);
+
 /**
  * @brief Writes encoded data to the QCA device.
  *
  * This function encodes the given data and writes it to the QCA device over the
- * SPI interface.
+ * SPI interface. The bus is taken at QCA_PRIO_NORMAL.
  *
  * @param[in] data Pointer to the data to be encoded and written.
  * @param[in] datasize Size of the data to be encoded and written, in bytes.
@@ -147,6 +340,226 @@ int qca_input(const void *instream, size_t instream_len);
  */
 int qca_write_encoding(const void *data, size_t datasize);
 
+/**
+ * @brief Writes frames to the QCA device, several in one transaction.
+ *
+ * Frames are taken in order, each framed on its own, for as long as they fit
+ * in the chip write buffer and in the tx_coalesce bytes of the SPI profile.
+ * The first frame always goes alone if it has to. Without coalescing this
+ * is the same as @ref qca_write_encoding on the first frame.
+ *
+ * @param[in] frames The frames to write.
+ * @param[in] nr_frames The number of frames. Up to QCA_TX_COALESCE_MAX_FRAMES
+ *            are written at a time.
+ *
+ * @return The number of frames written from the start of @p frames, or a
+ *         negative error code if none was.
+ */
+int qca_write_frames(const struct qca_iovec *frames, size_t nr_frames);
+
+/**
+ * @brief Writes frames like @ref qca_write_frames, at the given priority.
+ *
+ * @ref qca_write_encoding and @ref qca_write_frames get the bus at
+ * QCA_PRIO_NORMAL, so that bulk data does not hold up control traffic.
+ * Time-critical frames, e.g. SLAC responses, go at QCA_PRIO_HIGH here.
+ *
+ * @param[in] frames The frames to write.
+ * @param[in] nr_frames The number of frames.
+ * @param[in] prio The priority to get the bus with.
+ *
+ * @return The number of frames written from the start of @p frames, or a
+ *         negative error code if none was.
+ */
+int qca_write_frames_prio(const struct qca_iovec *frames, size_t nr_frames,
+		qca_prio_t prio);
+
+/**
+ * @brief Measures the SPI bus and applies the transfer sizes that suit it.
+ *
+ * SIGNATURE register reads clocked out to sizes from 16 bytes up to a whole
+ * buffer are timed QCA_CALIBRATION_ROUNDS times each, keeping the fastest,
+ * and the fixed and per-byte costs are fitted to them. As the cost is linear,
+ * a larger transfer always moves more bytes per unit of time, so the sizes
+ * are bounded by latency instead: the read chunk is the most a transfer
+ * carries by the fitted cost within QCA_CALIBRATION_BUDGET_US, for the bus
+ * not to be held up longer, though at least a minimum frame. Writes are
+ * coalesced up to the same size, if at least two minimum frames fit.
+ * RDBUF_WATERMARK is set to a minimum frame so that the chip does not
+ * interrupt for a partial one, and WRBUF_WATERMARK so that it interrupts
+ * once a whole coalesced write fits again.
+ *
+ * The bus is taken at QCA_PRIO_LOW for each probe, letting traffic through in
+ * between, but the write buffer should be empty as its size is read from
+ * WRBUF_AVAILABLE.
+ *
+ * @note A reset brings the watermark registers back to their defaults. Apply
+ *       the profile again with @ref qca_set_spi_profile afterwards.
+ *
+ * @param[out] profile Where to store the profile applied. NULL if not needed.
+ *
+ * @return 0 on success, -EIO if the chip does not answer the probes, or a
+ *         negative error code on failure.
+ */
+int qca_calibrate(struct qca_spi_profile *profile);
+
+/**
+ * @brief Applies an SPI profile, e.g. one saved after @ref qca_calibrate.
+ *
+ * The sizes are capped to what a transaction can carry and the non-zero
+ * watermarks are written to the chip.
+ *
+ * @param[in] profile The profile. NULL to go back to the defaults, leaving
+ *            the watermark registers as they are.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_set_spi_profile(const struct qca_spi_profile *profile);
+
+/**
+ * @brief Gets the SPI profile in use.
+ *
+ * @param[out] profile Pointer to the structure to store the profile.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_get_spi_profile(struct qca_spi_profile *profile);
+
+/**
+ * @brief Gets the RX queue statistics.
+ *
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_get_rxq_stats(struct qca_rxq_stats *stats);
+
+/**
+ * @brief Sets a tap to observe Ethernet frames going in and out.
+ *
+ * The tap is called with every received frame right before the handler and
+ * with every frame written to the device successfully. It runs in the context
+ * of @ref qca_input and @ref qca_write_encoding, so it should return quickly.
+ *
+ * @note The tap should be set or cleared while no frame is in flight.
+ *
+ * @param[in] tap The tap function. NULL to clear.
+ * @param[in] tap_ctx Context to be passed to the tap.
+ */
+void qca_set_tap(qca_tap_t tap, void *tap_ctx);
+
+/**
+ * @brief Sets a callback to receive the timestamps of every frame.
+ *
+ * It is called with every received frame once the handler has returned, and
+ * with every frame written to the device successfully. Like the tap, it runs
+ * in the context of @ref qca_input and @ref qca_write_encoding. Frames are
+ * timestamped only while the callback is set, or always when built with
+ * QCA_STATS, in which case the stage latencies also go to the histograms.
+ *
+ * @note The callback should be set or cleared while no frame is in flight.
+ *
+ * @param[in] meta The callback. NULL to clear.
+ * @param[in] meta_ctx Context to be passed to the callback.
+ */
+void qca_set_frame_meta(qca_frame_meta_t meta, void *meta_ctx);
+
+/**
+ * @brief Sets a tracer to observe every SPI transaction.
+ *
+ * The tracer is called right after each transaction with the bytes sent and
+ * received and the result. It runs with the transaction lock held.
+ *
+ * @note The tracer should be set or cleared while the bus is idle.
+ *
+ * @param[in] tracer The tracer function. NULL to clear.
+ * @param[in] tracer_ctx Context to be passed to the tracer.
+ */
+void qca_set_spi_trace(qca_spi_trace_t tracer, void *tracer_ctx);
+
+/* The functions above drive a single built-in device. The qca_dev_*()
+ * variants below do the same on a device of their own, so that several
+ * modems can be driven at once, e.g. one per SPI bus. Each device has its own
+ * bus arbitration, RX queue, handler, tap and tracer. Statistics, when built
+ * with QCA_STATS, are still counted across all devices. */
+struct qca_dev;
+
+/**
+ * @brief Creates and initializes a QCA device.
+ *
+ * Same as @ref qca_init_with_conf but on a device of its own.
+ *
+ * @param[in] spi_iface Pointer to the SPI device interface.
+ * @param[in] conf Configuration. NULL for defaults.
+ * @param[in] handler Callback function to handle received data.
+ * @param[in] handler_ctx Context to be passed to the handler callback.
+ *
+ * @return A device instance on success, or NULL if the modem is not found or
+ *         on failure.
+ */
+struct qca_dev *qca_dev_create(struct lm_spi_device *spi_iface,
+		const struct qca_conf *conf,
+		qca_handler_t handler, void *handler_ctx);
+
+/**
+ * @brief Deinitializes and frees the device.
+ *
+ * @param[in] dev The device instance.
+ */
+void qca_dev_destroy(struct qca_dev *dev);
+
+bool qca_dev_is_warm(const struct qca_dev *dev);
+int qca_dev_reset(struct qca_dev *dev);
+int qca_dev_read_reg(struct qca_dev *dev, qca_reg_t reg, uint16_t *value);
+int qca_dev_write_reg(struct qca_dev *dev, qca_reg_t reg, uint16_t value);
+int qca_dev_bus_submit(struct qca_dev *dev,
+		struct qca_bus_op *ops, size_t nr_ops,
+		qca_prio_t prio, uint32_t timeout_ms);
+int qca_dev_clear_interrupt(struct qca_dev *dev);
+int qca_dev_read(struct qca_dev *dev, void *buf, size_t bufsize);
+int qca_dev_input(struct qca_dev *dev,
+		const void *instream, size_t instream_len);
+void qca_dev_hold_rx(struct qca_dev *dev, bool hold);
+int qca_dev_write_encoding(struct qca_dev *dev,
+		const void *data, size_t datasize);
+int qca_dev_write_frames(struct qca_dev *dev,
+		const struct qca_iovec *frames, size_t nr_frames);
+int qca_dev_write_frames_prio(struct qca_dev *dev,
+		const struct qca_iovec *frames, size_t nr_frames,
+		qca_prio_t prio);
+int qca_dev_calibrate(struct qca_dev *dev, struct qca_spi_profile *profile);
+int qca_dev_set_spi_profile(struct qca_dev *dev,
+		const struct qca_spi_profile *profile);
+int qca_dev_get_spi_profile(const struct qca_dev *dev,
+		struct qca_spi_profile *profile);
+int qca_dev_get_rxq_stats(struct qca_dev *dev, struct qca_rxq_stats *stats);
+void qca_dev_set_tap(struct qca_dev *dev, qca_tap_t tap, void *tap_ctx);
+void qca_dev_set_spi_trace(struct qca_dev *dev,
+		qca_spi_trace_t tracer, void *tracer_ctx);
+void qca_dev_set_frame_meta(struct qca_dev *dev,
+		qca_frame_meta_t meta, void *meta_ctx);
+
+/**
+ * @brief Sends the segments back to back in one chip select, then receives.
+ *
+ * The driver sends frames as a command and header, the caller's payload and
+ * a trailer without copying them together. Built with QCA_SPI_VECTORED, this
+ * is provided by the SPI port, e.g. as a DMA descriptor chain. Otherwise the
+ * driver gathers the segments into a bounce buffer and calls
+ * lm_spi_writeread() instead.
+ *
+ * @param[in] spi The SPI device.
+ * @param[in] iov The segments to send in order.
+ * @param[in] iovcnt The number of segments.
+ * @param[out] rx Buffer for the bytes received after the last segment.
+ * @param[in] rxsize Number of bytes to receive. 0 for none.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_spi_writev(struct lm_spi_device *spi,
+		const struct qca_iovec *iov, size_t iovcnt,
+		void *rx, size_t rxsize);
+
 #if defined(__cplusplus)
 }
 #endif
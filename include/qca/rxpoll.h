@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_RXPOLL_H
+#define QCA_RXPOLL_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "qca.h"
+
+#if !defined(QCA_RXPOLL_DEFAULT_BUDGET)
+#define QCA_RXPOLL_DEFAULT_BUDGET		16U
+#endif
+#if !defined(QCA_RXPOLL_DEFAULT_IDLE_ROUNDS)
+#define QCA_RXPOLL_DEFAULT_IDLE_ROUNDS		2U
+#endif
+#if !defined(QCA_RXPOLL_DEFAULT_INT_MASK)
+#define QCA_RXPOLL_DEFAULT_INT_MASK		0x0041U /* CPU_ON, PKT_AVLBL */
+#endif
+
+struct qca_rxpoll_conf {
+	uint16_t budget; /*< frames delivered a round at most. 0 for
+			QCA_RXPOLL_DEFAULT_BUDGET */
+	uint8_t idle_rounds; /*< empty rounds before interrupts are enabled
+			again. 0 for QCA_RXPOLL_DEFAULT_IDLE_ROUNDS */
+	uint16_t int_mask; /*< INT_ENABLE in interrupt mode. 0 for
+			QCA_RXPOLL_DEFAULT_INT_MASK */
+
+	qca_handler_t handler; /*< where received frames go */
+	void *handler_ctx;
+};
+
+struct qca_rxpoll_stats {
+	uint32_t interrupts; /*< taken in interrupt mode */
+	uint32_t rounds; /*< poll rounds run */
+	uint32_t frames; /*< frames delivered */
+	uint32_t budget_exhausted; /*< rounds stopped by the budget */
+	uint32_t empty_rounds; /*< rounds that found nothing */
+	uint32_t rearms; /*< returns to interrupt mode */
+	uint32_t rearm_aborts; /*< rearms given up as frames came in */
+	bool polling; /*< true while interrupts are masked */
+};
+
+struct qca_rxpoll;
+
+/**
+ * @brief Creates an adaptive RX engine.
+ *
+ * It starts in interrupt mode. The first packet-available interrupt masks
+ * the interrupt and switches to polling, which drains the chip a budget of
+ * frames at a time for as long as frames keep coming. Once the chip has
+ * been found empty for the configured rounds, the interrupt is enabled
+ * again.
+ *
+ * Pass @ref qca_rxpoll_handler and the engine to @ref qca_init or
+ * @ref qca_dev_create so that frames are counted against the budget on
+ * their way to the handler.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return An engine instance on success, or NULL on failure.
+ */
+struct qca_rxpoll *qca_rxpoll_create(const struct qca_rxpoll_conf *conf);
+
+/**
+ * @brief Destroys the engine.
+ *
+ * @param[in] rx The engine instance.
+ */
+void qca_rxpoll_destroy(struct qca_rxpoll *rx);
+
+/**
+ * @brief Delivers a received frame to the handler.
+ *
+ * It matches @ref qca_handler_t, with the engine as the context.
+ *
+ * @param[in] frame The Ethernet frame.
+ * @param[in] frame_size Length of the frame.
+ * @param[in] ctx The engine instance.
+ */
+void qca_rxpoll_handler(const void *frame, size_t frame_size, void *ctx);
+
+/**
+ * @brief Handles the interrupt line of the chip.
+ *
+ * It is to be called from task context once the line is asserted, as it
+ * accesses the bus. The interrupt sources are read and cleared, and if a
+ * frame is available the packet interrupt is masked and the engine
+ * switches to polling.
+ *
+ * @param[in] rx The engine instance.
+ * @param[in] dev The device the engine was given to. NULL for the one of
+ *            @ref qca_init.
+ * @param[out] int_src The interrupt sources, e.g. to spot CPU_ON. May be
+ *             NULL.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_rxpoll_interrupt(struct qca_rxpoll *rx, struct qca_dev *dev,
+		uint16_t *int_src);
+
+/**
+ * @brief Runs a poll round.
+ *
+ * Frames are drained until the budget is spent or the chip is empty.
+ *
+ * @param[in] rx The engine instance.
+ * @param[in] dev The device the engine was given to. NULL for the one of
+ *            @ref qca_init.
+ *
+ * @return 1 if still polling, so the round is to be run again soon, 0 if
+ *         back in interrupt mode, or a negative error code on failure.
+ */
+int qca_rxpoll_poll(struct qca_rxpoll *rx, struct qca_dev *dev);
+
+/**
+ * @brief Gets the engine statistics.
+ *
+ * @param[in] rx The engine instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_rxpoll_get_stats(const struct qca_rxpoll *rx,
+		struct qca_rxpoll_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_RXPOLL_H */
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_SLAC_H
+#define QCA_SLAC_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define QCA_SLAC_GROUPS			58U
+#define QCA_SLAC_RUN_ID_LEN		8U
+#define QCA_SLAC_ID_LEN			17U
+#define QCA_SLAC_NID_LEN		7U
+#define QCA_SLAC_NMK_LEN		16U
+
+#if !defined(QCA_SLAC_DEFAULT_SESSIONS)
+#define QCA_SLAC_DEFAULT_SESSIONS	4U
+#endif
+#if !defined(QCA_SLAC_DEFAULT_NUM_SOUNDS)
+#define QCA_SLAC_DEFAULT_NUM_SOUNDS	10U
+#endif
+#if !defined(QCA_SLAC_DEFAULT_TIMEOUT_100MS)
+#define QCA_SLAC_DEFAULT_TIMEOUT_100MS	6U /* TT_EVSE_match_MNBS */
+#endif
+#if !defined(QCA_SLAC_SESSION_TIMEOUT_MS)
+#define QCA_SLAC_SESSION_TIMEOUT_MS	10000U
+#endif
+
+/* HomePlug GreenPHY MMTYPEs of the SLAC exchange */
+enum qca_slac_mmtype {
+	QCA_SLAC_MMTYPE_SLAC_PARM_REQ		= 0x6064U,
+	QCA_SLAC_MMTYPE_SLAC_PARM_CNF		= 0x6065U,
+	QCA_SLAC_MMTYPE_START_ATTEN_CHAR_IND	= 0x606AU,
+	QCA_SLAC_MMTYPE_ATTEN_CHAR_IND		= 0x606EU,
+	QCA_SLAC_MMTYPE_ATTEN_CHAR_RSP		= 0x606FU,
+	QCA_SLAC_MMTYPE_MNBC_SOUND_IND		= 0x6076U,
+	QCA_SLAC_MMTYPE_SLAC_MATCH_REQ		= 0x607CU,
+	QCA_SLAC_MMTYPE_SLAC_MATCH_CNF		= 0x607DU,
+	QCA_SLAC_MMTYPE_ATTEN_PROFILE_IND	= 0x6086U,
+};
+
+typedef enum {
+	QCA_SLAC_EVT_ATTEN_DONE, /* ATTEN_CHAR.IND sent with the averages */
+	QCA_SLAC_EVT_MATCHED, /* SLAC_MATCH.CNF sent. The EV joins the AVLN */
+	QCA_SLAC_EVT_TIMEOUT, /* the session expired before matching */
+} qca_slac_event_t;
+
+struct qca_slac_result {
+	uint8_t pev_mac[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t num_sounds; /*< sounds received, up to the number requested */
+	uint8_t num_groups;
+	uint8_t avg[QCA_SLAC_GROUPS]; /*< average attenuation per group, dB */
+	uint8_t avg_total; /*< average over all the groups, dB */
+};
+
+/**
+ * @brief Function pointer type for sending a frame built by the engine.
+ *
+ * Responses are timing-critical. They would typically go to the high
+ * priority TX queue.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+typedef int (*qca_slac_send_t)(const void *frame, size_t frame_size,
+		void *ctx);
+
+/**
+ * @brief Function pointer type for session events.
+ *
+ * It is called in the context of @ref qca_slac_input or @ref qca_slac_poll.
+ */
+typedef void (*qca_slac_event_handler_t)(qca_slac_event_t event,
+		const struct qca_slac_result *result, void *ctx);
+
+struct qca_slac_conf {
+	uint8_t evse_mac[6]; /*< MAC address of the EVSE host */
+	uint8_t evse_id[QCA_SLAC_ID_LEN]; /*< sent as RESP_ID in ATTEN_CHAR */
+	uint8_t nid[QCA_SLAC_NID_LEN]; /*< network the EV is let into */
+	uint8_t nmk[QCA_SLAC_NMK_LEN];
+	uint8_t num_sounds; /*< 0 for QCA_SLAC_DEFAULT_NUM_SOUNDS */
+	uint8_t timeout_100ms; /*< 0 for QCA_SLAC_DEFAULT_TIMEOUT_100MS */
+	size_t max_sessions; /*< EVs handled at once. 0 for
+			QCA_SLAC_DEFAULT_SESSIONS */
+
+	qca_slac_send_t send;
+	void *send_ctx;
+	qca_slac_event_handler_t on_event;
+	void *on_event_ctx;
+};
+
+struct qca_slac;
+
+/**
+ * @brief Creates an EVSE-side SLAC engine.
+ *
+ * The engine answers CM_SLAC_PARM, collects the attenuation profiles the
+ * modem reports for the M-SOUNDs of each EV, sends CM_ATTEN_CHAR with the
+ * averages and answers CM_SLAC_MATCH with the network key. Several EVs are
+ * handled at once, each in its own session keyed by the RunID.
+ *
+ * It does no I/O and keeps no clock. Frames are fed in and sent out through
+ * the callback, and the time is passed in.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return An engine instance on success, or NULL on failure.
+ */
+struct qca_slac *qca_slac_create(const struct qca_slac_conf *conf);
+
+/**
+ * @brief Destroys the engine.
+ *
+ * @param[in] slac The engine instance.
+ */
+void qca_slac_destroy(struct qca_slac *slac);
+
+/**
+ * @brief Processes a received Ethernet frame.
+ *
+ * Frames other than the SLAC MMEs are ignored.
+ *
+ * @param[in] slac The engine instance.
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ * @param[in] now_ms The current time in milliseconds.
+ *
+ * @return 0 if the frame was consumed, -ENOMSG if not a SLAC frame, or a
+ *         negative error code on failure.
+ */
+int qca_slac_input(struct qca_slac *slac,
+		const void *frame, size_t frame_size, uint32_t now_ms);
+
+/**
+ * @brief Runs the timers.
+ *
+ * A session whose sound window ran out is characterised with the sounds
+ * received so far. Sessions that stall are expired.
+ *
+ * @param[in] slac The engine instance.
+ * @param[in] now_ms The current time in milliseconds.
+ */
+void qca_slac_poll(struct qca_slac *slac, uint32_t now_ms);
+
+/**
+ * @brief Gets the number of sessions in progress.
+ *
+ * @param[in] slac The engine instance.
+ *
+ * @return The number of sessions.
+ */
+size_t qca_slac_sessions(const struct qca_slac *slac);
+
+/**
+ * @brief Averages attenuation profiles.
+ *
+ * @param[out] avg Average per group, rounded to the nearest dB.
+ * @param[in] sum Sum of the profiles per group.
+ * @param[in] count Number of profiles summed.
+ * @param[in] num_groups Number of groups.
+ *
+ * @return The average over all the groups.
+ */
+uint8_t qca_slac_average(uint8_t *avg, const uint16_t *sum, uint16_t count,
+		size_t num_groups);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_SLAC_H */
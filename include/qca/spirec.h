@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_SPIREC_H
+#define QCA_SPIREC_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * SPI log format, all little-endian:
+ *
+ *   header: "QSPI", u8 version, u8 reserved[3]
+ *   record: u32 timestamp in microseconds since the recording started,
+ *           u16 txsize, u16 rxsize, i16 result,
+ *           tx bytes, rx bytes
+ *
+ * The SPI command is the first two tx bytes of each record.
+ */
+#define QCA_SPIREC_MAGIC		"QSPI"
+#define QCA_SPIREC_VERSION		1U
+#define QCA_SPIREC_HEADER_LEN		8U
+#define QCA_SPIREC_RECORD_HEADER_LEN	10U
+
+#if !defined(QCA_SPIREC_BUFSIZE)
+#define QCA_SPIREC_BUFSIZE		16384U /* must be a power of two */
+#endif
+#if !defined(QCA_SPIREC_POLL_INTERVAL_MS)
+#define QCA_SPIREC_POLL_INTERVAL_MS	10U
+#endif
+
+struct qca_spirec_stats {
+	uint32_t records;
+	uint32_t bytes;
+	uint32_t dropped; /*< records that did not fit in the buffer */
+	uint32_t write_errors;
+};
+
+struct qca_spirec;
+
+/**
+ * @brief Creates an SPI recorder writing to the given file descriptor.
+ *
+ * The log header is written right away.
+ *
+ * @param[in] fd File descriptor to write the log to. It is not closed by the
+ *            recorder.
+ *
+ * @return A recorder instance on success, or NULL on failure.
+ */
+struct qca_spirec *qca_spirec_create(int fd);
+
+/**
+ * @brief Destroys the recorder, stopping and flushing it first if running.
+ *
+ * @param[in] rec The recorder instance.
+ */
+void qca_spirec_destroy(struct qca_spirec *rec);
+
+/**
+ * @brief Starts recording every SPI transaction the driver issues.
+ *
+ * The recorder attaches itself with @ref qca_set_spi_trace and spawns a
+ * writer thread that drains the buffered records to the file descriptor.
+ *
+ * @param[in] rec The recorder instance.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_spirec_start(struct qca_spirec *rec);
+
+/**
+ * @brief Stops recording and flushes the buffered records.
+ *
+ * @param[in] rec The recorder instance.
+ *
+ * @return 0 on success, -EIO if any write to the file descriptor failed, or
+ *         another negative error code on failure.
+ */
+int qca_spirec_stop(struct qca_spirec *rec);
+
+/**
+ * @brief Appends a transaction to the log.
+ *
+ * This is the tracer the recorder attaches to the driver. It runs with the
+ * bus lock held, so it only copies the record into a buffer of
+ * QCA_SPIREC_BUFSIZE bytes and never touches the file descriptor. Records
+ * that do not fit are dropped and counted in the statistics.
+ */
+void qca_spirec_trace(const void *tx, size_t txsize,
+		const void *rx, size_t rxsize, int err, void *ctx);
+
+/**
+ * @brief Gets the recorder statistics.
+ *
+ * @param[in] rec The recorder instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_spirec_get_stats(const struct qca_spirec *rec,
+		struct qca_spirec_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_SPIREC_H */
@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_SPIREPLAY_H
+#define QCA_SPIREPLAY_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "vspi.h"
+
+#if !defined(QCA_SPIREPLAY_SEARCH_WINDOW)
+#define QCA_SPIREPLAY_SEARCH_WINDOW	8U
+#endif
+
+typedef enum {
+	QCA_SPIREPLAY_LOOP		= 0x01U, /* rewind at the end of log */
+} qca_spireplay_flag_t;
+
+struct qca_spireplay_stats {
+	uint32_t transactions; /*< transactions served from the log */
+	uint32_t mismatches; /*< transactions not found in the log */
+	uint32_t skipped; /*< records skipped to resync */
+	uint32_t loops; /*< number of rewinds */
+};
+
+struct qca_spireplay;
+
+/**
+ * @brief Creates a virtual SPI device replaying a recorded SPI log.
+ *
+ * Each transaction is answered with the next record carrying the same SPI
+ * command, searching up to QCA_SPIREPLAY_SEARCH_WINDOW records ahead so that
+ * a driver issuing a slightly different sequence stays in sync. Transactions
+ * not found are answered with zeros and the log position is kept.
+ *
+ * @param[in] log The log produced by the recorder. It is not copied and must
+ *            stay valid for the lifetime of the replay.
+ * @param[in] log_size Size of the log.
+ * @param[in] flags qca_spireplay_flag_t.
+ *
+ * @return A replay instance on success, or NULL if the log is malformed or
+ *         on allocation failure.
+ */
+struct qca_spireplay *qca_spireplay_create(const void *log, size_t log_size,
+		uint32_t flags);
+
+/**
+ * @brief Destroys the replay instance.
+ *
+ * @param[in] replay The replay instance.
+ */
+void qca_spireplay_destroy(struct qca_spireplay *replay);
+
+/**
+ * @brief Gets the SPI device to pass to @ref qca_init.
+ *
+ * @param[in] replay The replay instance.
+ *
+ * @return The SPI device.
+ */
+struct lm_spi_device *qca_spireplay_device(struct qca_spireplay *replay);
+
+/**
+ * @brief Rewinds the replay to the first record.
+ *
+ * @param[in] replay The replay instance.
+ */
+void qca_spireplay_rewind(struct qca_spireplay *replay);
+
+/**
+ * @brief Checks whether every record has been replayed.
+ *
+ * @param[in] replay The replay instance.
+ *
+ * @return true at the end of the log, false otherwise. Always false with
+ *         QCA_SPIREPLAY_LOOP.
+ */
+bool qca_spireplay_done(const struct qca_spireplay *replay);
+
+/**
+ * @brief Gets the replay statistics.
+ *
+ * @param[in] replay The replay instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_spireplay_get_stats(const struct qca_spireplay *replay,
+		struct qca_spireplay_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_SPIREPLAY_H */
@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_STATS_H
+#define QCA_STATS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Bucket 0 counts samples under 1us, bucket n samples in [2^(n-1), 2^n) us
+ * and the last one everything above. */
+#define QCA_STATS_HIST_BUCKETS		16U
+
+typedef enum {
+	QCA_STATS_RX_FRAMES,
+	QCA_STATS_RX_BYTES,
+	QCA_STATS_TX_FRAMES,
+	QCA_STATS_TX_BYTES,
+	QCA_STATS_SPI_REG_READ,
+	QCA_STATS_SPI_REG_WRITE,
+	QCA_STATS_SPI_BUF_READ,
+	QCA_STATS_SPI_BUF_WRITE,
+	QCA_STATS_RESYNC_DROPS, /* bytes */
+	QCA_STATS_EAGAIN,
+	QCA_STATS_EIO,
+	QCA_STATS_LOCK_ACQUIRED,
+	QCA_STATS_LOCK_WAIT_US,
+	QCA_STATS_BUS_TIMEOUTS,
+	QCA_STATS_COUNTER_MAX,
+} qca_stats_counter_t;
+
+typedef enum {
+	QCA_STATS_HIST_SPI_LATENCY,
+	QCA_STATS_HIST_RX_LATENCY, /* from SPI read completion to handler */
+	QCA_STATS_HIST_BUS_WAIT_HIGH, /* bus waits by qca_prio_t */
+	QCA_STATS_HIST_BUS_WAIT_NORMAL,
+	QCA_STATS_HIST_BUS_WAIT_LOW,
+	QCA_STATS_HIST_RX_QUEUE, /* from SPI read completion to frame completion
+				    in qca_input() */
+	QCA_STATS_HIST_RX_HANDLER, /* time spent in the handler */
+	QCA_STATS_HIST_TX_LATENCY, /* from qca_write_encoding() to SPI write
+				      completion, bus wait included */
+	QCA_STATS_HIST_MAX,
+} qca_stats_hist_t;
+
+struct qca_stats_hist {
+	uint32_t count;
+	uint32_t sum_us;
+	uint32_t max_us;
+	uint32_t buckets[QCA_STATS_HIST_BUCKETS];
+};
+
+/* All counters wrap around. Take the difference of two snapshots for rates. */
+struct qca_stats {
+	uint32_t counters[QCA_STATS_COUNTER_MAX];
+	struct qca_stats_hist hists[QCA_STATS_HIST_MAX];
+};
+
+/**
+ * @brief Takes a snapshot of the driver statistics.
+ *
+ * Each counter is read atomically, but the snapshot as a whole is not
+ * consistent with respect to concurrent updates.
+ *
+ * @param[out] snapshot Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, -ENOTSUP if compiled without QCA_STATS, or a negative
+ *         error code on failure.
+ */
+int qca_stats_snapshot(struct qca_stats *snapshot);
+
+/**
+ * @brief Resets all the counters and histograms to zero.
+ */
+void qca_stats_reset(void);
+
+/**
+ * @brief Gets the name of a counter.
+ *
+ * @param[in] counter The counter.
+ *
+ * @return The name of the counter, or NULL if out of range.
+ */
+const char *qca_stats_counter_stringify(qca_stats_counter_t counter);
+
+#if defined(QCA_STATS)
+void qca_stats_add(qca_stats_counter_t counter, uint32_t n);
+void qca_stats_record(qca_stats_hist_t hist, uint32_t us);
+uint64_t qca_stats_now_us(void);
+
+#define QCA_STATS_ADD(counter, n)	qca_stats_add(counter, (uint32_t)(n))
+#define QCA_STATS_INC(counter)		qca_stats_add(counter, 1)
+#define QCA_STATS_RECORD(hist, us)	qca_stats_record(hist, (uint32_t)(us))
+#define QCA_STATS_NOW()			qca_stats_now_us()
+#else
+#define QCA_STATS_ADD(counter, n)
+#define QCA_STATS_INC(counter)
+#define QCA_STATS_RECORD(hist, us)
+#define QCA_STATS_NOW()			0
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_STATS_H */
@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_TAPBRIDGE_H
+#define QCA_TAPBRIDGE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "qca/qca.h"
+
+#if !defined(QCA_TAPBRIDGE_DEFAULT_BATCH)
+#define QCA_TAPBRIDGE_DEFAULT_BATCH		16U
+#endif
+#if !defined(QCA_TAPBRIDGE_DEFAULT_POLL_MS)
+#define QCA_TAPBRIDGE_DEFAULT_POLL_MS		10U
+#endif
+#if !defined(QCA_TAPBRIDGE_DEFAULT_RX_BUFSIZE)
+#define QCA_TAPBRIDGE_DEFAULT_RX_BUFSIZE	8192U
+#endif
+
+/**
+ * @brief Function pointer type for sending frames to the modem.
+ *
+ * It matches @ref qca_write_frames, which may take fewer frames than given.
+ *
+ * @param[in] frames The Ethernet frames.
+ * @param[in] nr_frames The number of frames.
+ * @param[in] ctx User context.
+ *
+ * @return The number of frames sent from the start of @p frames, or a
+ *         negative error code if none was.
+ */
+typedef int (*qca_tapbridge_send_t)(const struct qca_iovec *frames,
+		size_t nr_frames, void *ctx);
+
+/**
+ * @brief Function pointer type for draining the modem.
+ *
+ * Received frames are expected to reach @ref qca_tapbridge_handler.
+ *
+ * @param[in] buf Scratch buffer.
+ * @param[in] bufsize Size of the buffer.
+ * @param[in] ctx User context.
+ *
+ * @return The number of bytes drained, 0 if nothing was pending, or a
+ *         negative error code on failure.
+ */
+typedef int (*qca_tapbridge_pump_t)(void *buf, size_t bufsize, void *ctx);
+
+struct qca_tapbridge_conf {
+	const char *ifname; /*< TAP interface to create or attach to. NULL to
+			let the kernel name it */
+	bool use_fd; /*< use fd instead of opening a TAP interface */
+	int fd; /*< an already open TAP or packet socket, if use_fd is set.
+			It is not closed on destroy */
+	size_t batch; /*< frames moved per wakeup at most. 0 for
+			QCA_TAPBRIDGE_DEFAULT_BATCH */
+	uint32_t poll_ms; /*< idle wait of both threads. 0 for
+			QCA_TAPBRIDGE_DEFAULT_POLL_MS */
+	size_t rx_bufsize; /*< bytes drained from the modem at once. 0 for
+			QCA_TAPBRIDGE_DEFAULT_RX_BUFSIZE. Creation fails if it
+			is less than QCA_MAX_BUFSIZE */
+
+	qca_tapbridge_send_t send; /*< NULL for qca_write_frames() */
+	void *send_ctx;
+	qca_tapbridge_pump_t pump; /*< NULL for qca_read() and qca_input() */
+	void *pump_ctx;
+};
+
+struct qca_tapbridge_stats {
+	uint32_t rx_frames; /*< from the modem to the interface */
+	uint32_t rx_bytes;
+	uint32_t rx_errors;
+	uint32_t tx_frames; /*< from the interface to the modem */
+	uint32_t tx_bytes;
+	uint32_t tx_errors;
+	uint32_t tx_batches; /*< wakeups that moved at least a frame */
+};
+
+struct qca_tapbridge;
+
+/**
+ * @brief Creates a bridge between the modem and a TAP interface.
+ *
+ * Two threads are started. The RX thread drains the modem with the pump,
+ * and the frames come out of @ref qca_tapbridge_handler straight into the
+ * interface. The TX thread reads frames off the interface and sends those
+ * of a wakeup together.
+ *
+ * Pass @ref qca_tapbridge_handler and the bridge to @ref qca_init so that
+ * received frames reach the interface.
+ *
+ * A zeroed configuration opens a new TAP interface with the defaults.
+ *
+ * @param[in] conf Configuration. It must not be NULL.
+ *
+ * @return A bridge instance on success, or NULL on failure.
+ */
+struct qca_tapbridge *qca_tapbridge_create(
+		const struct qca_tapbridge_conf *conf);
+
+/**
+ * @brief Stops the threads and destroys the bridge.
+ *
+ * @param[in] bridge The bridge instance.
+ */
+void qca_tapbridge_destroy(struct qca_tapbridge *bridge);
+
+/**
+ * @brief Writes a received frame to the interface.
+ *
+ * It matches @ref qca_handler_t, with the bridge as the context. The frame
+ * is written from the buffer of the caller without a copy.
+ *
+ * @param[in] frame The Ethernet frame.
+ * @param[in] frame_size Length of the frame.
+ * @param[in] ctx The bridge instance.
+ */
+void qca_tapbridge_handler(const void *frame, size_t frame_size, void *ctx);
+
+/**
+ * @brief Gets the file descriptor of the interface.
+ *
+ * @param[in] bridge The bridge instance.
+ *
+ * @return The file descriptor, or -1 if not available.
+ */
+int qca_tapbridge_fd(const struct qca_tapbridge *bridge);
+
+/**
+ * @brief Gets the bridge statistics.
+ *
+ * @param[in] bridge The bridge instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_tapbridge_get_stats(const struct qca_tapbridge *bridge,
+		struct qca_tapbridge_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_TAPBRIDGE_H */
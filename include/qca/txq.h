@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_TXQ_H
+#define QCA_TXQ_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "qca.h"
+
+#if !defined(QCA_TXQ_DEFAULT_DEPTH)
+#define QCA_TXQ_DEFAULT_DEPTH		8U
+#endif
+
+/*
+ * The queues are served from QCA_PRIO_HIGH down. A queue with weight 0 is
+ * strict: it is always served before the queues below it. Queues with a
+ * weight share the bus in proportion to it, e.g. weights of 4 and 1 let a
+ * diagnostics upload take one frame in five while IP traffic is pending.
+ */
+struct qca_txq_conf {
+	size_t depth[QCA_PRIO_MAX]; /*< frames per queue. 0 for
+			QCA_TXQ_DEFAULT_DEPTH */
+	uint8_t weight[QCA_PRIO_MAX]; /*< 0 for strict priority */
+};
+
+struct qca_txq_stats {
+	uint32_t enqueued[QCA_PRIO_MAX];
+	uint32_t sent[QCA_PRIO_MAX];
+	uint32_t drops[QCA_PRIO_MAX]; /*< frames refused as the queue was full */
+	uint32_t peak[QCA_PRIO_MAX]; /*< the most frames queued at once */
+	uint32_t errors; /*< failed writes. The frame stays queued */
+};
+
+struct qca_txq;
+
+/**
+ * @brief Creates TX queues.
+ *
+ * All the frame memory is allocated here.
+ *
+ * @param[in] conf Configuration. NULL for strict priority queues of
+ *            QCA_TXQ_DEFAULT_DEPTH frames.
+ *
+ * @return A queue instance on success, or NULL on failure.
+ */
+struct qca_txq *qca_txq_create(const struct qca_txq_conf *conf);
+
+/**
+ * @brief Destroys the queues, discarding the frames left.
+ *
+ * @param[in] txq The queue instance.
+ */
+void qca_txq_destroy(struct qca_txq *txq);
+
+/**
+ * @brief Classifies a frame by its EtherType.
+ *
+ * HomePlug MMEs, which carry SLAC and the other CM_* messages, are high
+ * priority. IPv4, IPv6 and ARP are normal and the rest low.
+ *
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ *
+ * @return The priority of the frame.
+ */
+qca_prio_t qca_txq_classify(const void *frame, size_t frame_size);
+
+/**
+ * @brief Copies a frame into the queue of the given priority.
+ *
+ * @param[in] txq The queue instance.
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ * @param[in] prio The queue to put the frame in.
+ *
+ * @return 0 on success, -ENOBUFS if the queue is full, or a negative error
+ *         code on failure.
+ */
+int qca_txq_enqueue(struct qca_txq *txq,
+		const void *frame, size_t frame_size, qca_prio_t prio);
+
+/**
+ * @brief Copies a frame into the queue that @ref qca_txq_classify picks.
+ *
+ * @param[in] txq The queue instance.
+ * @param[in] frame Pointer to the Ethernet frame.
+ * @param[in] frame_size Size of the frame.
+ *
+ * @return 0 on success, -ENOBUFS if the queue is full, or a negative error
+ *         code on failure.
+ */
+int qca_txq_send(struct qca_txq *txq, const void *frame, size_t frame_size);
+
+/**
+ * @brief Writes queued frames to the chip with @ref qca_write_frames_prio.
+ *
+ * Each write gets the bus at the priority of the queue it came from.
+ * The queue is picked again for every write, so a high priority frame
+ * queued meanwhile goes next. A write carries one frame, or as many from the
+ * head of the same queue as the SPI profile coalesces, within the share of a
+ * weighted queue. A frame that fails to write stays at the head of its
+ * queue, e.g. while the chip write buffer is full.
+ *
+ * @note Only one context may flush at a time. Enqueueing is thread-safe.
+ *
+ * @param[in] txq The queue instance.
+ * @param[in] budget The most frames to write. 0 for no limit.
+ *
+ * @return The number of frames written, or a negative error code if none
+ *         could be written.
+ */
+int qca_txq_flush(struct qca_txq *txq, size_t budget);
+
+/**
+ * @brief Gets the number of frames in a queue.
+ *
+ * @param[in] txq The queue instance.
+ * @param[in] prio The queue.
+ *
+ * @return The number of frames queued.
+ */
+size_t qca_txq_length(struct qca_txq *txq, qca_prio_t prio);
+
+/**
+ * @brief Gets the queue statistics.
+ *
+ * @param[in] txq The queue instance.
+ * @param[out] stats Pointer to the structure to store the statistics.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int qca_txq_get_stats(struct qca_txq *txq, struct qca_txq_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_TXQ_H */
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef QCA_VSPI_H
+#define QCA_VSPI_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "qca.h"
+
+/*
+ * Virtual SPI devices let the driver run against software instead of a chip,
+ * e.g. to replay recorded traffic or to emulate QCA7000 on a host without PLC
+ * hardware. src/vspi.c implements lm_spi_writeread() on top of them, so it is
+ * linked in place of the libmcu SPI port, not together with it.
+ *
+ * An implementation embeds struct lm_spi_device as its first member. It also
+ * provides qca_spi_writev(), so the driver may be built with QCA_SPI_VECTORED
+ * against it. Devices without writev get the segments gathered.
+ */
+struct lm_spi_device;
+
+typedef int (*qca_vspi_writeread_t)(struct lm_spi_device *self,
+		const void *tx, size_t txsize, void *rx, size_t rxsize);
+typedef int (*qca_vspi_writev_t)(struct lm_spi_device *self,
+		const struct qca_iovec *iov, size_t iovcnt,
+		void *rx, size_t rxsize);
+
+struct lm_spi_device {
+	qca_vspi_writeread_t writeread;
+	qca_vspi_writev_t writev; /*< optional */
+};
+
+int lm_spi_writeread(struct lm_spi_device *self,
+		const void *txdata, size_t txdata_len,
+		void *rxbuf, size_t rxbuf_len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* QCA_VSPI_H */
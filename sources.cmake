@@ -1,6 +1,41 @@
 list(APPEND QCA_SRCS
 	${CMAKE_CURRENT_LIST_DIR}/src/qca.c
+	${CMAKE_CURRENT_LIST_DIR}/src/os.c
 	${CMAKE_CURRENT_LIST_DIR}/src/mme.c
+	${CMAKE_CURRENT_LIST_DIR}/src/mmefrag.c
 	${CMAKE_CURRENT_LIST_DIR}/src/nvm.c
+	${CMAKE_CURRENT_LIST_DIR}/src/stats.c
+	${CMAKE_CURRENT_LIST_DIR}/src/txq.c
+	${CMAKE_CURRENT_LIST_DIR}/src/rxpoll.c
+	${CMAKE_CURRENT_LIST_DIR}/src/slac.c
+	${CMAKE_CURRENT_LIST_DIR}/src/diag.c
+	${CMAKE_CURRENT_LIST_DIR}/src/devinfo.c
+	${CMAKE_CURRENT_LIST_DIR}/src/linkmon.c
+	${CMAKE_CURRENT_LIST_DIR}/src/memxfer.c
+	${CMAKE_CURRENT_LIST_DIR}/src/attach.c
+	${CMAKE_CURRENT_LIST_DIR}/src/nvmz.c
+	${CMAKE_CURRENT_LIST_DIR}/src/filter.c
+)
+# Virtual SPI devices. These implement lm_spi_writeread() and are linked in
+# place of the libmcu SPI port to run the driver without hardware.
+list(APPEND QCA_VSPI_SRCS
+	${CMAKE_CURRENT_LIST_DIR}/src/vspi.c
+	${CMAKE_CURRENT_LIST_DIR}/src/spireplay.c
+	${CMAKE_CURRENT_LIST_DIR}/src/emu.c
+)
+# The NVM image compressor, for tools/nvmz_pack.c. Devices only read images.
+list(APPEND QCA_NVMZ_PACK_SRCS
+	${CMAKE_CURRENT_LIST_DIR}/src/nvmz_pack.c
+)
+# Host tools on POSIX threads and file descriptors: capture, SPI recording
+# and factory provisioning.
+list(APPEND QCA_HOST_SRCS
+	${CMAKE_CURRENT_LIST_DIR}/src/capture.c
+	${CMAKE_CURRENT_LIST_DIR}/src/spirec.c
+	${CMAKE_CURRENT_LIST_DIR}/src/prov.c
+)
+# Bridges the modem to a TAP interface. Linux only.
+list(APPEND QCA_TAPBRIDGE_SRCS
+	${CMAKE_CURRENT_LIST_DIR}/src/tapbridge.c
 )
 list(APPEND QCA_INCS ${CMAKE_CURRENT_LIST_DIR}/include)
@@ -4,7 +4,42 @@ endif
 
 QCA_SRCS := \
 $(qca-basedir)src/qca.c \
+$(qca-basedir)src/os.c \
 $(qca-basedir)src/mme.c \
+$(qca-basedir)src/mmefrag.c \
 $(qca-basedir)src/nvm.c \
+$(qca-basedir)src/stats.c \
+$(qca-basedir)src/txq.c \
+$(qca-basedir)src/rxpoll.c \
+$(qca-basedir)src/slac.c \
+$(qca-basedir)src/diag.c \
+$(qca-basedir)src/devinfo.c \
+$(qca-basedir)src/linkmon.c \
+$(qca-basedir)src/memxfer.c \
+$(qca-basedir)src/attach.c \
+$(qca-basedir)src/nvmz.c \
+$(qca-basedir)src/filter.c \
+
+# Virtual SPI devices. These implement lm_spi_writeread() and are linked in
+# place of the libmcu SPI port to run the driver without hardware.
+QCA_VSPI_SRCS := \
+$(qca-basedir)src/vspi.c \
+$(qca-basedir)src/spireplay.c \
+$(qca-basedir)src/emu.c \
+
+# The NVM image compressor, for tools/nvmz_pack.c. Devices only read images.
+QCA_NVMZ_PACK_SRCS := \
+$(qca-basedir)src/nvmz_pack.c \
+
+# Host tools on POSIX threads and file descriptors: capture, SPI recording
+# and factory provisioning.
+QCA_HOST_SRCS := \
+$(qca-basedir)src/capture.c \
+$(qca-basedir)src/spirec.c \
+$(qca-basedir)src/prov.c \
+
+# Bridges the modem to a TAP interface. Linux only.
+QCA_TAPBRIDGE_SRCS := \
+$(qca-basedir)src/tapbridge.c \
 
 QCA_INCS := $(qca-basedir)include
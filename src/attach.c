@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/attach.h"
+#include "qca/mme.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define FNV_PRIME			0x100000001b3ULL
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+/* Gets the version out of the confirmation. Returns its length, or -EINVAL
+ * if it is missing. */
+static int get_version(const void *sw_ver_cnf, size_t len,
+		const uint8_t **version)
+{
+	const struct qca_mme_sw_ver_cnf *cnf =
+		(const struct qca_mme_sw_ver_cnf *)sw_ver_cnf;
+	const size_t offset = offsetof(struct qca_mme_sw_ver_cnf, version);
+
+	if (cnf == NULL || len < offset || cnf->status != 0 ||
+			cnf->version_len == 0) {
+		return -EINVAL;
+	}
+
+	*version = cnf->version;
+
+	return (int)MIN(cnf->version_len, len - offset);
+}
+
+/* FNV-1a, 64 bits */
+uint64_t qca_attach_fingerprint(const void *data, size_t len,
+		uint64_t fingerprint)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	for (size_t i = 0; i < len; i++) {
+		fingerprint ^= p[i];
+		fingerprint *= FNV_PRIME;
+	}
+
+	return fingerprint;
+}
+
+int qca_attach_save(struct qca_attach_record *rec,
+		const void *sw_ver_cnf, size_t len, uint64_t fingerprint)
+{
+	const uint8_t *version;
+	const int version_len = get_version(sw_ver_cnf, len, &version);
+
+	if (rec == NULL || version_len < 0 ||
+			version_len > (int)QCA_ATTACH_VERSION_MAXLEN) {
+		return -EINVAL;
+	}
+
+	memset(rec, 0, sizeof(*rec));
+	rec->fingerprint = fingerprint;
+	rec->version_len = (uint8_t)version_len;
+	memcpy(rec->version, version, (size_t)version_len);
+
+	return 0;
+}
+
+bool qca_attach_match(const struct qca_attach_record *rec,
+		const void *sw_ver_cnf, size_t len, uint64_t fingerprint)
+{
+	const uint8_t *version;
+	const int version_len = get_version(sw_ver_cnf, len, &version);
+
+	if (rec == NULL || version_len < 0 ||
+			rec->fingerprint != fingerprint ||
+			rec->version_len != version_len) {
+		return false;
+	}
+
+	return memcmp(rec->version, version, (size_t)version_len) == 0;
+}
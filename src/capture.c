@@ -0,0 +1,441 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/capture.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ETH_HEADER_LEN			14U
+#define ETHERTYPE_HOMEPLUG_AV		0x88E1U
+#define ETH_MAXLEN			1518U
+
+#define PCAPNG_SHB			0x0A0D0D0AU
+#define PCAPNG_IDB			0x00000001U
+#define PCAPNG_EPB			0x00000006U
+#define PCAPNG_BYTE_ORDER_MAGIC		0x1A2B3C4DU
+#define PCAPNG_LINKTYPE_ETHERNET	1U
+#define PCAPNG_OPT_EPB_FLAGS		2U
+#define PCAPNG_EPB_FLAG_INBOUND		1U
+#define PCAPNG_EPB_FLAG_OUTBOUND	2U
+#define PCAPNG_EPB_FIXED_LEN		(28U + 12U + 4U) /* + flags, endofopt */
+
+#define WRITE_BATCH_SIZE		4096U
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+#define load(p)			__atomic_load_n(p, __ATOMIC_RELAXED)
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define inc(p)			__atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+
+struct slot {
+	size_t seq;
+	uint64_t timestamp_us;
+	uint32_t orig_len;
+	uint16_t len;
+	uint8_t dir;
+	uint8_t data[];
+};
+
+struct qca_capture {
+	struct qca_capture_conf conf;
+
+	uint8_t *slots;
+	size_t slot_size;
+	size_t mask;
+	size_t enqueue_pos; /* shared by producers */
+	size_t dequeue_pos; /* owned by the writer */
+
+	struct qca_capture_stats stats;
+
+	pthread_t writer;
+	int fd;
+	bool running;
+
+	uint8_t batch[WRITE_BATCH_SIZE];
+	size_t batch_len;
+};
+
+static struct slot *get_slot(struct qca_capture *cap, size_t pos)
+{
+	return (struct slot *)&cap->slots[(pos & cap->mask) * cap->slot_size];
+}
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static size_t round_up_pow2(size_t n)
+{
+	size_t v = 1;
+	while (v < n) {
+		v <<= 1;
+	}
+	return v;
+}
+
+static size_t pad4(size_t n)
+{
+	return (n + 3U) & ~(size_t)3U;
+}
+
+static size_t pad8(size_t n)
+{
+	return (n + 7U) & ~(size_t)7U;
+}
+
+static bool is_homeplug(const void *frame, size_t frame_size)
+{
+	const uint8_t *p = (const uint8_t *)frame;
+
+	if (frame_size < ETH_HEADER_LEN) {
+		return false;
+	}
+
+	return (((uint16_t)p[12] << 8) | p[13]) == ETHERTYPE_HOMEPLUG_AV;
+}
+
+static bool filter(const struct qca_capture *cap,
+		qca_dir_t dir, const void *frame, size_t frame_size)
+{
+	const uint32_t flags = cap->conf.flags;
+	const uint32_t dirmask = dir == QCA_DIR_RX?
+		QCA_CAPTURE_RX : QCA_CAPTURE_TX;
+
+	if (!(flags & dirmask)) {
+		return false;
+	}
+	if ((flags & QCA_CAPTURE_HOMEPLUG_ONLY) &&
+			!is_homeplug(frame, frame_size)) {
+		return false;
+	}
+	if (cap->conf.filter && !(*cap->conf.filter)(dir,
+			frame, frame_size, cap->conf.filter_ctx)) {
+		return false;
+	}
+
+	return true;
+}
+
+static int write_all(int fd, const void *data, size_t datasize)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (datasize > 0) {
+		const ssize_t n = write(fd, p, datasize);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+
+		p += n;
+		datasize -= (size_t)n;
+	}
+
+	return 0;
+}
+
+static void flush_batch(struct qca_capture *cap)
+{
+	if (cap->batch_len == 0) {
+		return;
+	}
+
+	if (write_all(cap->fd, cap->batch, cap->batch_len) != 0) {
+		inc(&cap->stats.write_errors);
+	}
+
+	cap->batch_len = 0;
+}
+
+static void put_u32(struct qca_capture *cap, uint32_t value)
+{
+	memcpy(&cap->batch[cap->batch_len], &value, sizeof(value));
+	cap->batch_len += sizeof(value);
+}
+
+static void put_u16(struct qca_capture *cap, uint16_t value)
+{
+	memcpy(&cap->batch[cap->batch_len], &value, sizeof(value));
+	cap->batch_len += sizeof(value);
+}
+
+static int write_headers(struct qca_capture *cap)
+{
+	const uint32_t shb_len = 28;
+	const uint32_t idb_len = 20;
+
+	put_u32(cap, PCAPNG_SHB);
+	put_u32(cap, shb_len);
+	put_u32(cap, PCAPNG_BYTE_ORDER_MAGIC);
+	put_u16(cap, 1); /* major version */
+	put_u16(cap, 0); /* minor version */
+	put_u32(cap, 0xffffffffU); /* section length unspecified */
+	put_u32(cap, 0xffffffffU);
+	put_u32(cap, shb_len);
+
+	put_u32(cap, PCAPNG_IDB);
+	put_u32(cap, idb_len);
+	put_u16(cap, PCAPNG_LINKTYPE_ETHERNET);
+	put_u16(cap, 0); /* reserved */
+	put_u32(cap, (uint32_t)cap->conf.snaplen);
+	put_u32(cap, idb_len);
+
+	const int err = write_all(cap->fd, cap->batch, cap->batch_len);
+	cap->batch_len = 0;
+
+	return err;
+}
+
+static void write_packet(struct qca_capture *cap, const struct slot *slot)
+{
+	const size_t padded = pad4(slot->len);
+	const uint32_t block_len = (uint32_t)(PCAPNG_EPB_FIXED_LEN + padded);
+	static const uint8_t zeros[4];
+
+	if (cap->batch_len + block_len > sizeof(cap->batch)) {
+		flush_batch(cap);
+	}
+
+	put_u32(cap, PCAPNG_EPB);
+	put_u32(cap, block_len);
+	put_u32(cap, 0); /* interface id */
+	put_u32(cap, (uint32_t)(slot->timestamp_us >> 32));
+	put_u32(cap, (uint32_t)slot->timestamp_us);
+	put_u32(cap, slot->len);
+	put_u32(cap, slot->orig_len);
+	memcpy(&cap->batch[cap->batch_len], slot->data, slot->len);
+	cap->batch_len += slot->len;
+	memcpy(&cap->batch[cap->batch_len], zeros, padded - slot->len);
+	cap->batch_len += padded - slot->len;
+	put_u16(cap, PCAPNG_OPT_EPB_FLAGS);
+	put_u16(cap, 4);
+	put_u32(cap, slot->dir == QCA_DIR_RX?
+			PCAPNG_EPB_FLAG_INBOUND : PCAPNG_EPB_FLAG_OUTBOUND);
+	put_u32(cap, 0); /* opt_endofopt */
+	put_u32(cap, block_len);
+}
+
+static size_t drain(struct qca_capture *cap)
+{
+	size_t count = 0;
+
+	for (;; count++) {
+		const size_t pos = cap->dequeue_pos;
+		struct slot *slot = get_slot(cap, pos);
+
+		if (load_acquire(&slot->seq) != pos + 1) {
+			break; /* empty */
+		}
+
+		write_packet(cap, slot);
+		store_release(&slot->seq, pos + cap->mask + 1);
+		cap->dequeue_pos = pos + 1;
+		inc(&cap->stats.written);
+	}
+
+	flush_batch(cap);
+
+	return count;
+}
+
+static void *writer_task(void *arg)
+{
+	struct qca_capture *cap = (struct qca_capture *)arg;
+	const struct timespec interval = {
+		.tv_sec = cap->conf.poll_interval_ms / 1000U,
+		.tv_nsec = (long)(cap->conf.poll_interval_ms % 1000U) * 1000000L,
+	};
+
+	while (load_acquire(&cap->running)) {
+		if (drain(cap) == 0) {
+			nanosleep(&interval, NULL);
+		}
+	}
+
+	drain(cap);
+
+	return NULL;
+}
+
+void qca_capture_frame(qca_dir_t dir,
+		const void *frame, size_t frame_size, void *ctx)
+{
+	struct qca_capture *cap = (struct qca_capture *)ctx;
+
+	if (!filter(cap, dir, frame, frame_size)) {
+		inc(&cap->stats.filtered);
+		return;
+	}
+
+	size_t pos = load(&cap->enqueue_pos);
+	struct slot *slot;
+
+	for (;;) {
+		slot = get_slot(cap, pos);
+		const size_t seq = load_acquire(&slot->seq);
+		const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&cap->enqueue_pos,
+					&pos, pos + 1, true,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			inc(&cap->stats.dropped);
+			return;
+		} else {
+			pos = load(&cap->enqueue_pos);
+		}
+	}
+
+	const size_t len = frame_size < cap->conf.snaplen?
+		frame_size : cap->conf.snaplen;
+
+	slot->timestamp_us = get_time_us();
+	slot->orig_len = (uint32_t)frame_size;
+	slot->len = (uint16_t)len;
+	slot->dir = (uint8_t)dir;
+	memcpy(slot->data, frame, len);
+
+	store_release(&slot->seq, pos + 1);
+	inc(&cap->stats.captured);
+}
+
+int qca_capture_start(struct qca_capture *cap, int fd)
+{
+	if (cap == NULL || fd < 0) {
+		return -EINVAL;
+	}
+	if (cap->running) {
+		return -EALREADY;
+	}
+
+	cap->fd = fd;
+
+	int err = write_headers(cap);
+
+	if (err) {
+		return err;
+	}
+
+	cap->running = true;
+
+	if ((err = pthread_create(&cap->writer, NULL, writer_task, cap))) {
+		cap->running = false;
+		return -err;
+	}
+
+	qca_set_tap(qca_capture_frame, cap);
+
+	return 0;
+}
+
+int qca_capture_stop(struct qca_capture *cap)
+{
+	if (cap == NULL) {
+		return -EINVAL;
+	}
+	if (!cap->running) {
+		return -EALREADY;
+	}
+
+	qca_set_tap(NULL, NULL);
+
+	store_release(&cap->running, false);
+	pthread_join(cap->writer, NULL);
+
+	return 0;
+}
+
+int qca_capture_get_stats(const struct qca_capture *cap,
+		struct qca_capture_stats *stats)
+{
+	if (cap == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	stats->captured = load(&cap->stats.captured);
+	stats->filtered = load(&cap->stats.filtered);
+	stats->dropped = load(&cap->stats.dropped);
+	stats->written = load(&cap->stats.written);
+	stats->write_errors = load(&cap->stats.write_errors);
+
+	return 0;
+}
+
+struct qca_capture *qca_capture_create(const struct qca_capture_conf *conf)
+{
+	struct qca_capture *cap = (struct qca_capture *)calloc(1, sizeof(*cap));
+
+	if (cap == NULL) {
+		return NULL;
+	}
+
+	if (conf) {
+		cap->conf = *conf;
+	}
+
+	if (cap->conf.slots == 0) {
+		cap->conf.slots = QCA_CAPTURE_DEFAULT_SLOTS;
+	}
+	if (cap->conf.snaplen == 0 || cap->conf.snaplen > ETH_MAXLEN) {
+		cap->conf.snaplen = ETH_MAXLEN;
+	}
+	if ((cap->conf.flags & (QCA_CAPTURE_RX | QCA_CAPTURE_TX)) == 0) {
+		cap->conf.flags |= QCA_CAPTURE_RX | QCA_CAPTURE_TX;
+	}
+	if (cap->conf.poll_interval_ms == 0) {
+		cap->conf.poll_interval_ms =
+			QCA_CAPTURE_DEFAULT_POLL_INTERVAL_MS;
+	}
+
+	const size_t nslots = round_up_pow2(cap->conf.slots);
+
+	cap->mask = nslots - 1;
+	cap->slot_size = pad8(sizeof(struct slot) + cap->conf.snaplen);
+	cap->slots = (uint8_t *)malloc(nslots * cap->slot_size);
+
+	if (cap->slots == NULL) {
+		QCA_ERROR("failed to allocate %u slots", nslots);
+		free(cap);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < nslots; i++) {
+		get_slot(cap, i)->seq = i;
+	}
+
+	return cap;
+}
+
+void qca_capture_destroy(struct qca_capture *cap)
+{
+	if (cap == NULL) {
+		return;
+	}
+
+	if (cap->running) {
+		qca_capture_stop(cap);
+	}
+
+	free(cap->slots);
+	free(cap);
+}
@@ -0,0 +1,251 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/devinfo.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define READ_RETRIES			4
+
+#define NETWORK_ITEMS			(QCA_DEVINFO_MASK(QCA_DEVINFO_NW_INFO) | \
+					QCA_DEVINFO_MASK(QCA_DEVINFO_NW_STAT))
+
+#define load(p)			__atomic_load_n(p, __ATOMIC_RELAXED)
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store(p, v)		__atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+/* Readers copy an entry without a lock and retry if the sequence number
+ * moved meanwhile. An odd number means an update is in progress. */
+struct entry {
+	uint32_t seq;
+	uint32_t updated_ms;
+	uint16_t len;
+	uint8_t data[QCA_DEVINFO_MAXLEN];
+
+	/* owned by the writer */
+	bool stale;
+	bool pending;
+	uint32_t requested_ms;
+};
+
+struct qca_devinfo {
+	struct qca_devinfo_conf conf;
+	qca_os_lock_t lock; /* serializes writers only */
+	struct entry entries[QCA_DEVINFO_MAX];
+};
+
+static const qca_mmtype_t item_types[QCA_DEVINFO_MAX] = {
+	[QCA_DEVINFO_SW_VER] = QCA_MMTYPE_SW_VER,
+	[QCA_DEVINFO_NW_INFO] = QCA_MMTYPE_NW_INFO,
+	[QCA_DEVINFO_NW_STAT] = QCA_MMTYPE_NW_STAT,
+};
+
+static int get_item(qca_mmtype_t type)
+{
+	for (int i = 0; i < QCA_DEVINFO_MAX; i++) {
+		if (item_types[i] == type) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void update_entry(struct entry *e, const void *data, size_t len,
+		uint32_t now)
+{
+	const uint32_t seq = load(&e->seq);
+
+	store(&e->seq, seq + 1);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(e->data, data, len);
+	store(&e->len, (uint16_t)len);
+	store(&e->updated_ms, now);
+
+	store_release(&e->seq, seq + 2);
+
+	e->stale = false;
+	e->pending = false;
+}
+
+static bool needs_refresh(const struct qca_devinfo *cache, int item,
+		uint32_t now)
+{
+	const struct entry *e = &cache->entries[item];
+
+	if (e->pending) {
+		return qca_mme_is_expired(now, e->requested_ms + cache->conf.timeout_ms);
+	}
+
+	return e->stale || load(&e->len) == 0 ||
+		qca_mme_is_expired(now, e->updated_ms + cache->conf.ttl_ms[item]);
+}
+
+int qca_devinfo_input(struct qca_devinfo *cache, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms)
+{
+	if (cache == NULL || (body == NULL && body_len)) {
+		return -EINVAL;
+	}
+
+	if (!qca_mme_is_vendor(mmtype)) {
+		return -ENOMSG;
+	}
+
+	const qca_mmtype_t type = qca_mme_type(mmtype);
+	const qca_mme_variant_t sub = qca_mme_variant(mmtype);
+
+	if (type == QCA_MMTYPE_PL_LINK_STATUS && sub == QCA_MME_IND) {
+		qca_devinfo_invalidate(cache, NETWORK_ITEMS);
+		return 0;
+	}
+
+	const int item = get_item(type);
+
+	if (item < 0 || sub != QCA_MME_CNF) {
+		return -ENOMSG;
+	}
+
+	qca_os_lock(&cache->lock);
+	update_entry(&cache->entries[item], body,
+			body_len < QCA_DEVINFO_MAXLEN? body_len :
+			QCA_DEVINFO_MAXLEN, now_ms);
+	qca_os_unlock(&cache->lock);
+
+	return 0;
+}
+
+void qca_devinfo_poll(struct qca_devinfo *cache, uint32_t now_ms)
+{
+	if (cache == NULL || cache->conf.request == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < QCA_DEVINFO_MAX; i++) {
+		struct entry *e = &cache->entries[i];
+
+		qca_os_lock(&cache->lock);
+		const bool refresh = needs_refresh(cache, i, now_ms);
+		if (refresh) {
+			e->pending = true;
+			e->requested_ms = now_ms;
+		}
+		qca_os_unlock(&cache->lock);
+
+		/* a failed request is retried after the timeout */
+		if (refresh) {
+			(*cache->conf.request)(item_types[i],
+					cache->conf.request_ctx);
+		}
+	}
+}
+
+void qca_devinfo_invalidate(struct qca_devinfo *cache, uint32_t mask)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	qca_os_lock(&cache->lock);
+	for (int i = 0; i < QCA_DEVINFO_MAX; i++) {
+		if (mask & QCA_DEVINFO_MASK(i)) {
+			cache->entries[i].stale = true;
+			cache->entries[i].pending = false;
+		}
+	}
+	qca_os_unlock(&cache->lock);
+}
+
+void qca_devinfo_handle_interrupt(struct qca_devinfo *cache, uint16_t int_src)
+{
+	if (int_src & QCA_MME_INT_CPU_ON) {
+		qca_devinfo_invalidate(cache, QCA_DEVINFO_MASK_ALL);
+	}
+}
+
+int qca_devinfo_get(const struct qca_devinfo *cache, qca_devinfo_item_t item,
+		void *buf, size_t bufsize, uint32_t *updated_ms)
+{
+	if (cache == NULL || item >= QCA_DEVINFO_MAX ||
+			(buf == NULL && bufsize)) {
+		return -EINVAL;
+	}
+
+	const struct entry *e = &cache->entries[item];
+
+	for (int i = 0; i < READ_RETRIES; i++) {
+		const uint32_t seq = load_acquire(&e->seq);
+
+		if (seq & 1U) {
+			continue;
+		}
+
+		const uint16_t len = load(&e->len);
+		const uint32_t updated = load(&e->updated_ms);
+
+		memcpy(buf, e->data, len < bufsize? len : bufsize);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (load(&e->seq) != seq) {
+			continue;
+		}
+
+		if (len == 0) {
+			return -ENODATA;
+		}
+		if (updated_ms) {
+			*updated_ms = updated;
+		}
+
+		return len;
+	}
+
+	return -EAGAIN;
+}
+
+struct qca_devinfo *qca_devinfo_create(const struct qca_devinfo_conf *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	struct qca_devinfo *cache =
+		(struct qca_devinfo *)qca_os_malloc(sizeof(*cache));
+
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	memset(cache, 0, sizeof(*cache));
+
+	cache->conf = *conf;
+
+	for (int i = 0; i < QCA_DEVINFO_MAX; i++) {
+		if (cache->conf.ttl_ms[i] == 0) {
+			cache->conf.ttl_ms[i] = QCA_DEVINFO_DEFAULT_TTL_MS;
+		}
+	}
+	if (cache->conf.timeout_ms == 0) {
+		cache->conf.timeout_ms = QCA_DEVINFO_DEFAULT_TIMEOUT_MS;
+	}
+
+	qca_os_lock_init(&cache->lock);
+
+	return cache;
+}
+
+void qca_devinfo_destroy(struct qca_devinfo *cache)
+{
+	if (cache) {
+		qca_os_lock_deinit(&cache->lock);
+		qca_os_free(cache);
+	}
+}
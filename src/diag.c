@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/diag.h"
+#include "qca/mme.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define CHUNK_SIZE			16U
+#define TX_STATS_LEN			(5U * 8U)
+#define RX_STATS_LEN			(6U * 8U)
+
+/* HomePlug AV symbol of 40.96us plus the 5.56us guard interval, with the
+ * 16/21 turbo code rate */
+#define SYMBOL_NS			46520U
+#define FEC_RATE_NUM			16U
+#define FEC_RATE_DEN			21U
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+#if !defined(MAX)
+#define MAX(a, b)			(((a) > (b))? (a) : (b))
+#endif
+
+static const uint8_t mod_bits[16] = { 0, 1, 2, 3, 4, 6, 8, 10, };
+/* the least SNR in dB for each modulation at the target error rate */
+static const uint8_t mod_snr[16] = { 0, 2, 5, 9, 12, 18, 24, 30, };
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return (uint16_t)(((uint16_t)p[1] << 8) | p[0]);
+}
+
+static uint64_t get_le64(const uint8_t *p)
+{
+	uint64_t v = 0;
+
+	for (int i = 7; i >= 0; i--) {
+		v = (v << 8) | p[i];
+	}
+
+	return v;
+}
+
+static size_t update_carrier(struct qca_tonemap *tm, size_t carrier,
+		uint8_t mod, uint16_t *changed, size_t max_changed, size_t n)
+{
+	if (carrier >= QCA_TONEMAP_CARRIERS || tm->mod[carrier] == mod) {
+		return n;
+	}
+
+	tm->mod[carrier] = mod;
+	tm->bits[carrier] = mod_bits[mod];
+	tm->snr[carrier] = mod_snr[mod];
+
+	if (changed && n < max_changed) {
+		changed[n] = (uint16_t)carrier;
+	}
+
+	return n + 1;
+}
+
+int qca_tonemap_decode(struct qca_tonemap *tm, const void *cnf, size_t cnf_len,
+		bool rx, uint16_t *changed, size_t max_changed)
+{
+	const size_t hlen = rx? sizeof(struct qca_mme_rx_tone_map_cnf) :
+		sizeof(struct qca_mme_tone_map_cnf);
+	const uint8_t *p = (const uint8_t *)cnf;
+
+	if (tm == NULL || p == NULL || cnf_len < hlen) {
+		return -EINVAL;
+	}
+
+	if (p[0] != 0) {
+		return -EIO;
+	}
+
+	if (rx) {
+		const struct qca_mme_rx_tone_map_cnf *c =
+			(const struct qca_mme_rx_tone_map_cnf *)cnf;
+		tm->slot = c->slot;
+		tm->num_slots = c->num_slots;
+	} else {
+		const struct qca_mme_tone_map_cnf *c =
+			(const struct qca_mme_tone_map_cnf *)cnf;
+		tm->slot = c->slot;
+		tm->num_slots = c->num_slots;
+	}
+
+	tm->nr_active = get_le16(&p[hlen - 2]);
+
+	const uint8_t *src = &p[hlen];
+	const size_t len = MIN(cnf_len - hlen, sizeof(tm->raw));
+	const size_t old_len = (tm->nr_carriers + 1U) / 2U;
+	const size_t end = MAX(len, old_len);
+	size_t n = 0;
+
+	for (size_t i = 0; i < end; i += CHUNK_SIZE) {
+		const size_t chunk = MIN(CHUNK_SIZE, end - i);
+
+		/* most of the map stays the same between polls */
+		if (i + chunk <= len && !memcmp(&tm->raw[i], &src[i], chunk)) {
+			continue;
+		}
+
+		for (size_t j = i; j < i + chunk; j++) {
+			const uint8_t byte = j < len? src[j] : 0;
+
+			if (byte == tm->raw[j]) {
+				continue;
+			}
+
+			n = update_carrier(tm, j * 2, byte & 0xfU,
+					changed, max_changed, n);
+			n = update_carrier(tm, j * 2 + 1, byte >> 4,
+					changed, max_changed, n);
+			tm->raw[j] = byte;
+		}
+	}
+
+	tm->nr_carriers = (uint16_t)MIN(len * 2, QCA_TONEMAP_CARRIERS);
+
+	return (int)n;
+}
+
+/* Reductions over the whole padded arrays. The padding stays zero, and the
+ * fixed trip count lets the compiler vectorize the loops. */
+void qca_tonemap_summarize(const struct qca_tonemap *tm,
+		struct qca_tonemap_summary *summary)
+{
+	uint32_t bits = 0;
+	uint32_t snr = 0;
+	uint32_t loaded = 0;
+	uint8_t min_snr = UINT8_MAX;
+
+	for (size_t i = 0; i < QCA_TONEMAP_CARRIERS_PADDED; i++) {
+		bits += tm->bits[i];
+		snr += tm->snr[i];
+		loaded += tm->mod[i] != 0;
+	}
+
+	/* Unloaded carriers have no SNR to take the minimum of. They read as
+	 * 0 dB, so they are masked up to the maximum instead. */
+	for (size_t i = 0; i < QCA_TONEMAP_CARRIERS_PADDED; i++) {
+		const uint8_t mask = (uint8_t)-(tm->mod[i] == 0);
+		const uint8_t v = (uint8_t)(tm->snr[i] | mask);
+		min_snr = MIN(min_snr, v);
+	}
+
+	summary->loaded = (uint16_t)loaded;
+	summary->bits_per_symbol = bits;
+	summary->min_snr = (uint8_t)(loaded? min_snr : 0);
+	summary->mean_snr = (uint8_t)(loaded? snr / loaded : 0);
+	summary->phy_rate_kbps = (uint32_t)((uint64_t)bits * 1000000U *
+			FEC_RATE_NUM / ((uint64_t)SYMBOL_NS * FEC_RATE_DEN));
+}
+
+int qca_link_stats_decode(struct qca_link_stats *stats,
+		const void *cnf, size_t cnf_len)
+{
+	const struct qca_mme_link_stats_cnf *c =
+		(const struct qca_mme_link_stats_cnf *)cnf;
+
+	if (stats == NULL || c == NULL || cnf_len < sizeof(*c)) {
+		return -EINVAL;
+	}
+
+	if (c->status != 0) {
+		return -EIO;
+	}
+
+	const uint8_t *p = c->stats;
+	const size_t len = cnf_len - sizeof(*c);
+
+	memset(stats, 0, sizeof(*stats));
+	stats->link_id = c->link_id;
+	stats->tei = c->tei;
+	stats->direction = c->direction;
+
+	if (c->direction == 0) {
+		if (len < TX_STATS_LEN) {
+			return -EBADMSG;
+		}
+		stats->mpdu_acked = get_le64(&p[0]);
+		stats->mpdu_collided = get_le64(&p[8]);
+		stats->mpdu_failed = get_le64(&p[16]);
+		stats->pb_passed = get_le64(&p[24]);
+		stats->pb_failed = get_le64(&p[32]);
+	} else {
+		if (len < RX_STATS_LEN) {
+			return -EBADMSG;
+		}
+		stats->mpdu_acked = get_le64(&p[0]);
+		stats->mpdu_failed = get_le64(&p[8]);
+		stats->pb_passed = get_le64(&p[16]);
+		stats->pb_failed = get_le64(&p[24]);
+		stats->tbe_passed = get_le64(&p[32]);
+		stats->tbe_failed = get_le64(&p[40]);
+	}
+
+	const uint64_t pbs = stats->pb_passed + stats->pb_failed;
+
+	if (pbs) {
+		stats->pb_error_permille =
+			(uint16_t)(stats->pb_failed * 1000U / pbs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,564 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/emu.h"
+#include "qca/qca.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#endif
+
+#define HW_LEN_FIELD		4U /* hw-generated frame length */
+#define SOF_LEN			4U
+#define HEADER_LEN		(SOF_LEN + 2U/*length*/ + 2U/*version*/)
+#define EOF_LEN			2U
+#define ETH_MAXLEN		1500U
+#define FRAME_OVERHEAD		(HEADER_LEN + EOF_LEN)
+
+#define CMD_READ		0x80U
+#define CMD_INTERNAL		0x40U
+
+#define SPI_CONFIG_RESET	0x40U
+
+struct fifo {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+};
+
+struct qca_emu {
+	struct lm_spi_device dev; /* must be the first member */
+	struct qca_emu_conf conf;
+
+	pthread_mutex_t lock;
+
+	struct fifo rdbuf;
+	struct fifo wrbuf;
+
+	uint16_t bufsize; /* length of the next buffer transfer */
+	uint16_t int_src;
+	uint16_t int_enable;
+	uint16_t rdbuf_watermark;
+	uint16_t wrbuf_watermark;
+	uint16_t spi_config;
+	uint16_t act_ctr;
+
+	int tapfd;
+
+	struct qca_emu_stats stats;
+};
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/* Spins rather than sleeps as a transaction typically takes a few
+ * microseconds, well below the sleep granularity. */
+static void emulate_bus_time(struct qca_emu *emu, size_t nbytes)
+{
+	const uint64_t cost = emu->conf.transaction_ns +
+		(uint64_t)emu->conf.byte_ns * nbytes;
+
+	if (cost == 0) {
+		return;
+	}
+
+	const uint64_t deadline = get_time_ns() + cost;
+
+	while (get_time_ns() < deadline) {
+		/* spin */
+	}
+
+	emu->stats.busy_ns += cost;
+}
+
+static size_t fifo_space(const struct fifo *q)
+{
+	return q->size - q->len;
+}
+
+static void fifo_push(struct fifo *q, const void *data, size_t datasize)
+{
+	memcpy(&q->buf[q->len], data, datasize);
+	q->len += datasize;
+}
+
+static void fifo_pop(struct fifo *q, void *buf, size_t len)
+{
+	if (buf) {
+		memcpy(buf, q->buf, len);
+	}
+	memmove(q->buf, &q->buf[len], q->len - len);
+	q->len -= len;
+}
+
+static bool is_irq_pending(const struct qca_emu *emu)
+{
+	return (emu->int_src & emu->int_enable) != 0;
+}
+
+/* The interrupt line is asserted on the transition only. */
+static void notify_irq(struct qca_emu *emu, bool was_pending)
+{
+	if (!was_pending && is_irq_pending(emu) && emu->conf.on_irq) {
+		(*emu->conf.on_irq)(emu->int_src, emu->conf.on_irq_ctx);
+	}
+}
+
+static void raise_interrupt(struct qca_emu *emu, uint16_t intr)
+{
+	const bool was_pending = is_irq_pending(emu);
+	emu->int_src |= intr;
+	notify_irq(emu, was_pending);
+}
+
+static void update_rdbuf_interrupt(struct qca_emu *emu)
+{
+	if (emu->rdbuf.len > 0 && emu->rdbuf.len >= emu->rdbuf_watermark) {
+		raise_interrupt(emu, QCA_EMU_INT_PKT_AVLBL);
+	}
+}
+
+static int put_rx_frame(struct qca_emu *emu, const void *frame, size_t len)
+{
+	const size_t padded = len < QCA_MIN_PACKET_LEN? QCA_MIN_PACKET_LEN : len;
+	const size_t frame_len = padded + FRAME_OVERHEAD;
+	static const uint8_t zeros[QCA_MIN_PACKET_LEN];
+
+	if (len > ETH_MAXLEN) {
+		return -EINVAL;
+	}
+	if (fifo_space(&emu->rdbuf) < HW_LEN_FIELD + frame_len) {
+		emu->stats.rx_drops++;
+		return -ENOSPC;
+	}
+
+	const uint8_t hdr[HW_LEN_FIELD + HEADER_LEN] = {
+		(uint8_t)(frame_len >> 24), (uint8_t)(frame_len >> 16),
+		(uint8_t)(frame_len >> 8), (uint8_t)frame_len,
+		0xAA, 0xAA, 0xAA, 0xAA,
+		(uint8_t)padded, (uint8_t)(padded >> 8),
+		0, 0,
+	};
+	const uint8_t eof[EOF_LEN] = { 0x55, 0x55 };
+
+	fifo_push(&emu->rdbuf, hdr, sizeof(hdr));
+	fifo_push(&emu->rdbuf, frame, len);
+	fifo_push(&emu->rdbuf, zeros, padded - len);
+	fifo_push(&emu->rdbuf, eof, sizeof(eof));
+
+	emu->stats.rx_frames++;
+	update_rdbuf_interrupt(emu);
+
+	return 0;
+}
+
+static void forward_tx_frame(struct qca_emu *emu, const uint8_t *frame,
+		size_t len)
+{
+	emu->stats.tx_frames++;
+
+	switch (emu->conf.backend) {
+	case QCA_EMU_BACKEND_LOOPBACK:
+		put_rx_frame(emu, frame, len);
+		break;
+	case QCA_EMU_BACKEND_CALLBACK:
+		if (emu->conf.on_tx) {
+			(*emu->conf.on_tx)(frame, len, emu->conf.on_tx_ctx);
+		}
+		break;
+	case QCA_EMU_BACKEND_TAP:
+		if (emu->tapfd >= 0 && write(emu->tapfd, frame, len) < 0) {
+			emu->stats.tx_errors++;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* The modem takes complete frames off the write buffer as soon as they are
+ * in. Garbage is skipped a byte at a time, as the chip would resync. */
+static void drain_wrbuf(struct qca_emu *emu)
+{
+	struct fifo *q = &emu->wrbuf;
+
+	while (q->len >= FRAME_OVERHEAD) {
+		const uint8_t *p = q->buf;
+		const size_t len = (size_t)p[4] | ((size_t)p[5] << 8);
+
+		if (p[0] != 0xAA || p[1] != 0xAA || p[2] != 0xAA ||
+				p[3] != 0xAA || len > ETH_MAXLEN) {
+			fifo_pop(q, NULL, 1);
+			emu->stats.tx_errors++;
+			continue;
+		}
+
+		if (q->len < len + FRAME_OVERHEAD) {
+			break;
+		}
+
+		if (p[HEADER_LEN + len] != 0x55 ||
+				p[HEADER_LEN + len + 1] != 0x55) {
+			fifo_pop(q, NULL, 1);
+			emu->stats.tx_errors++;
+			continue;
+		}
+
+		forward_tx_frame(emu, &p[HEADER_LEN], len);
+		fifo_pop(q, NULL, len + FRAME_OVERHEAD);
+	}
+
+	if (emu->wrbuf_watermark && q->len <= emu->wrbuf_watermark) {
+		raise_interrupt(emu, QCA_EMU_INT_WRBUF_BELOW_WM);
+	}
+}
+
+static void reset_chip(struct qca_emu *emu)
+{
+	emu->rdbuf.len = 0;
+	emu->wrbuf.len = 0;
+	emu->bufsize = 0;
+	emu->int_src = 0;
+	emu->int_enable = 0;
+	emu->rdbuf_watermark = 0;
+	emu->wrbuf_watermark = 0;
+	emu->spi_config = 0;
+	emu->act_ctr = 0;
+	emu->stats.resets++;
+
+	emu->int_src = QCA_EMU_INT_CPU_ON;
+}
+
+static uint16_t read_register(struct qca_emu *emu, qca_reg_t reg)
+{
+	switch (reg) {
+	case QCA_REG_BUFSIZE:
+		return emu->bufsize;
+	case QCA_REG_WRBUF_AVAILABLE:
+		return (uint16_t)fifo_space(&emu->wrbuf);
+	case QCA_REG_RDBUF_AVAILABLE:
+		return (uint16_t)emu->rdbuf.len;
+	case QCA_REG_SPI_CONFIG:
+		return emu->spi_config;
+	case QCA_REG_SPI_STATUS:
+		return 0;
+	case QCA_REG_INT_SRC:
+		return emu->int_src;
+	case QCA_REG_INT_ENABLE:
+		return emu->int_enable;
+	case QCA_REG_RDBUF_WATERMARK:
+		return emu->rdbuf_watermark;
+	case QCA_REG_WRBUF_WATERMARK:
+		return emu->wrbuf_watermark;
+	case QCA_REG_SIGNATURE:
+		return QCA_SIGNATURE;
+	case QCA_REG_ACT_CTR:
+		return emu->act_ctr;
+	default:
+		return 0;
+	}
+}
+
+static void write_register(struct qca_emu *emu, qca_reg_t reg, uint16_t value)
+{
+	switch (reg) {
+	case QCA_REG_BUFSIZE:
+		emu->bufsize = value;
+		break;
+	case QCA_REG_SPI_CONFIG:
+		if (value & SPI_CONFIG_RESET) {
+			reset_chip(emu);
+		} else {
+			emu->spi_config = value;
+		}
+		break;
+	case QCA_REG_INT_SRC: /* write 1 to clear */
+		emu->int_src = (uint16_t)(emu->int_src & ~value);
+		break;
+	case QCA_REG_INT_ENABLE: {
+		const bool was_pending = is_irq_pending(emu);
+		emu->int_enable = value;
+		notify_irq(emu, was_pending);
+		break;
+	}
+	case QCA_REG_RDBUF_WATERMARK:
+		emu->rdbuf_watermark = value;
+		break;
+	case QCA_REG_WRBUF_WATERMARK:
+		emu->wrbuf_watermark = value;
+		break;
+	case QCA_REG_ACT_CTR:
+		emu->act_ctr = value;
+		break;
+	default:
+		break;
+	}
+}
+
+static int read_external(struct qca_emu *emu, void *rx, size_t rxsize)
+{
+	if (rxsize != emu->bufsize || rxsize > emu->rdbuf.len) {
+		emu->stats.bus_errors++;
+		raise_interrupt(emu, QCA_EMU_INT_RDBUF_ERR);
+		memset(rx, 0, rxsize);
+		return 0;
+	}
+
+	fifo_pop(&emu->rdbuf, rx, rxsize);
+	emu->bufsize = 0;
+
+	return 0;
+}
+
+static int write_external(struct qca_emu *emu, const uint8_t *data, size_t len)
+{
+	if (len != emu->bufsize || len > fifo_space(&emu->wrbuf)) {
+		emu->stats.bus_errors++;
+		raise_interrupt(emu, QCA_EMU_INT_WRBUF_ERR);
+		return 0;
+	}
+
+	fifo_push(&emu->wrbuf, data, len);
+	emu->bufsize = 0;
+	drain_wrbuf(emu);
+
+	return 0;
+}
+
+static int emu_writeread(struct lm_spi_device *self,
+		const void *tx, size_t txsize, void *rx, size_t rxsize)
+{
+	struct qca_emu *emu = (struct qca_emu *)self;
+	const uint8_t *cmd = (const uint8_t *)tx;
+	int err = 0;
+
+	if (tx == NULL || txsize < 2) {
+		return -EINVAL;
+	}
+
+	const bool read_req = (cmd[0] & CMD_READ) != 0;
+	const bool internal = (cmd[0] & CMD_INTERNAL) != 0;
+	const qca_reg_t reg = (qca_reg_t)(((cmd[0] & 0x3FU) << 8) | cmd[1]);
+
+	pthread_mutex_lock(&emu->lock);
+
+	emulate_bus_time(emu, txsize + rxsize);
+	emu->stats.transactions++;
+
+	if (internal && read_req) {
+		if (rx == NULL || rxsize < 2) {
+			err = -EINVAL;
+		} else {
+			const uint16_t value = read_register(emu, reg);
+			uint8_t *p = (uint8_t *)rx;
+			p[0] = (uint8_t)(value >> 8);
+			p[1] = (uint8_t)value;
+		}
+	} else if (internal) {
+		if (txsize < 4) {
+			err = -EINVAL;
+		} else {
+			write_register(emu, reg,
+					(uint16_t)((cmd[2] << 8) | cmd[3]));
+		}
+	} else if (read_req) {
+		err = read_external(emu, rx, rxsize);
+	} else {
+		err = write_external(emu, &cmd[2], txsize - 2);
+	}
+
+	pthread_mutex_unlock(&emu->lock);
+
+	return err;
+}
+
+static int open_tap(const char *name)
+{
+#if defined(__linux__)
+	struct ifreq ifr = { 0, };
+	const int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+
+	if (fd < 0) {
+		return -errno;
+	}
+
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	if (name) {
+		strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+	}
+
+	if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+		const int err = -errno;
+		close(fd);
+		return err;
+	}
+
+	return fd;
+#else
+	(void)name;
+	return -ENOTSUP;
+#endif
+}
+
+int qca_emu_poll(struct qca_emu *emu)
+{
+	uint8_t frame[ETH_MAXLEN + 18];
+	int count = 0;
+
+	if (emu == NULL) {
+		return -EINVAL;
+	}
+	if (emu->tapfd < 0) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&emu->lock);
+
+	while (fifo_space(&emu->rdbuf) >= HW_LEN_FIELD + FRAME_OVERHEAD +
+			ETH_MAXLEN) {
+		const ssize_t n = read(emu->tapfd, frame, sizeof(frame));
+
+		if (n <= 0) {
+			break;
+		}
+		if (put_rx_frame(emu, frame, (size_t)n) == 0) {
+			count++;
+		}
+	}
+
+	pthread_mutex_unlock(&emu->lock);
+
+	return count;
+}
+
+int qca_emu_inject(struct qca_emu *emu, const void *frame, size_t frame_size)
+{
+	if (emu == NULL || frame == NULL) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&emu->lock);
+	const int err = put_rx_frame(emu, frame, frame_size);
+	pthread_mutex_unlock(&emu->lock);
+
+	return err;
+}
+
+int qca_emu_tap_fd(const struct qca_emu *emu)
+{
+	return emu->tapfd;
+}
+
+bool qca_emu_irq_pending(struct qca_emu *emu)
+{
+	pthread_mutex_lock(&emu->lock);
+	const bool pending = is_irq_pending(emu);
+	pthread_mutex_unlock(&emu->lock);
+
+	return pending;
+}
+
+void qca_emu_reset(struct qca_emu *emu)
+{
+	pthread_mutex_lock(&emu->lock);
+	reset_chip(emu);
+	pthread_mutex_unlock(&emu->lock);
+}
+
+int qca_emu_get_stats(struct qca_emu *emu, struct qca_emu_stats *stats)
+{
+	if (emu == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&emu->lock);
+	*stats = emu->stats;
+	pthread_mutex_unlock(&emu->lock);
+
+	return 0;
+}
+
+struct lm_spi_device *qca_emu_device(struct qca_emu *emu)
+{
+	return &emu->dev;
+}
+
+struct qca_emu *qca_emu_create(const struct qca_emu_conf *conf)
+{
+	struct qca_emu *emu = (struct qca_emu *)calloc(1, sizeof(*emu));
+
+	if (emu == NULL) {
+		return NULL;
+	}
+
+	if (conf) {
+		emu->conf = *conf;
+	}
+	if (emu->conf.rdbuf_size == 0) {
+		emu->conf.rdbuf_size = QCA_EMU_HW_BUFSIZE;
+	}
+	if (emu->conf.wrbuf_size == 0) {
+		emu->conf.wrbuf_size = QCA_EMU_HW_BUFSIZE;
+	}
+
+	emu->rdbuf.size = emu->conf.rdbuf_size;
+	emu->wrbuf.size = emu->conf.wrbuf_size;
+	emu->rdbuf.buf = (uint8_t *)malloc(emu->rdbuf.size);
+	emu->wrbuf.buf = (uint8_t *)malloc(emu->wrbuf.size);
+	emu->tapfd = -1;
+
+	if (emu->rdbuf.buf == NULL || emu->wrbuf.buf == NULL) {
+		goto out_free;
+	}
+
+	if (emu->conf.backend == QCA_EMU_BACKEND_TAP &&
+			(emu->tapfd = open_tap(emu->conf.tap_name)) < 0) {
+		goto out_free;
+	}
+
+	pthread_mutex_init(&emu->lock, NULL);
+	emu->dev.writeread = emu_writeread;
+	reset_chip(emu);
+	emu->stats.resets = 0;
+
+	return emu;
+
+out_free:
+	free(emu->rdbuf.buf);
+	free(emu->wrbuf.buf);
+	free(emu);
+	return NULL;
+}
+
+void qca_emu_destroy(struct qca_emu *emu)
+{
+	if (emu == NULL) {
+		return;
+	}
+
+	if (emu->tapfd >= 0) {
+		close(emu->tapfd);
+	}
+
+	pthread_mutex_destroy(&emu->lock);
+	free(emu->rdbuf.buf);
+	free(emu->wrbuf.buf);
+	free(emu);
+}
@@ -0,0 +1,830 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/filter.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define ETHERTYPE_VLAN			0x8100U
+#define ETHERTYPE_IPV4			0x0800U
+#define ETHERTYPE_IPV6			0x86DDU
+#define IPPROTO_TCP			6U
+#define IPPROTO_UDP			17U
+
+#if !defined(ARRAY_COUNT)
+#define ARRAY_COUNT(x)			(sizeof(x) / sizeof((x)[0]))
+#endif
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+enum control {
+	CONTROL_ADD			= 0x00,
+	CONTROL_REMOVE			= 0x01,
+};
+
+enum bw_control {
+	BW_CONTROL_READ			= 0x00,
+	BW_CONTROL_SET			= 0x01,
+};
+
+enum volatility {
+	VOLATILITY_TEMP			= 0x00,
+	VOLATILITY_PERM			= 0x01,
+};
+
+enum action {
+	ACTION_DROP			= 0x05,
+	ACTION_DROP_TX			= 0x06,
+	ACTION_DROP_RX			= 0x07,
+};
+
+enum operand {
+	OPERAND_ALL			= 0x00,
+	OPERAND_ANY			= 0x01,
+};
+
+enum rule_state {
+	RULE_UNUSED,
+	RULE_ADD, /* to be added */
+	RULE_ADDING, /* added, waiting for the confirmation */
+	RULE_ACTIVE,
+	RULE_REMOVE, /* to be removed */
+	RULE_REMOVING, /* removed, waiting for the confirmation */
+	RULE_REJECTED,
+};
+
+struct field {
+	uint8_t pid;
+	uint8_t len;
+};
+
+/* What the modem is to be told about, a rule, a group or the limit */
+struct slot {
+	enum rule_state state;
+	uint32_t host_hits;
+	uint32_t programmed;
+};
+
+struct rule {
+	struct qca_filter_rule rule;
+	struct slot slot;
+};
+
+struct group {
+	uint8_t addr[6];
+	struct slot slot;
+};
+
+struct bw_limit {
+	uint16_t mbps;
+	struct slot slot; /* only ever added */
+};
+
+struct request {
+	qca_mmtype_t type;
+	size_t msglen;
+	union {
+		struct qca_mme_classification classification;
+		struct qca_mme_multicast_info multicast_info;
+		struct qca_mme_bw_limit bw_limit;
+	} msg;
+};
+
+struct qca_filter {
+	struct qca_filter_conf conf;
+	qca_os_lock_t lock;
+
+	struct rule rules[QCA_FILTER_MAX_RULES];
+	struct group groups[QCA_FILTER_MAX_GROUPS];
+	struct bw_limit bw_limit;
+
+	struct slot *outstanding; /* what a request is out for, or NULL */
+	qca_mmtype_t outstanding_type;
+	uint32_t requested_ms;
+};
+
+static const struct field fields[QCA_FILTER_FIELD_MAX] = {
+	[QCA_FILTER_ETH_DA]     = { .pid = 0x00, .len = 6 },
+	[QCA_FILTER_ETH_SA]     = { .pid = 0x01, .len = 6 },
+	[QCA_FILTER_VLAN_ID]    = { .pid = 0x03, .len = 2 },
+	[QCA_FILTER_IPV4_PROTO] = { .pid = 0x05, .len = 1 },
+	[QCA_FILTER_IPV4_SA]    = { .pid = 0x06, .len = 4 },
+	[QCA_FILTER_IPV4_DA]    = { .pid = 0x07, .len = 4 },
+	[QCA_FILTER_IPV6_SA]    = { .pid = 0x0A, .len = 16 },
+	[QCA_FILTER_IPV6_DA]    = { .pid = 0x0B, .len = 16 },
+	[QCA_FILTER_TCP_DP]     = { .pid = 0x0D, .len = 2 },
+	[QCA_FILTER_UDP_DP]     = { .pid = 0x0F, .len = 2 },
+};
+
+static const uint8_t actions[] = {
+	[QCA_FILTER_DROP]    = ACTION_DROP,
+	[QCA_FILTER_DROP_TX] = ACTION_DROP_TX,
+	[QCA_FILTER_DROP_RX] = ACTION_DROP_RX,
+};
+
+static uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+/* The frame broken down to where each field is, or NULL if it has none. */
+struct frame {
+	const uint8_t *field[QCA_FILTER_FIELD_MAX];
+	uint8_t vlan_id[2];
+};
+
+static void parse_l4(struct frame *f, const uint8_t *l4, size_t len,
+		uint8_t proto)
+{
+	if (proto == IPPROTO_TCP && len >= 20) {
+		f->field[QCA_FILTER_TCP_DP] = &l4[2];
+	} else if (proto == IPPROTO_UDP && len >= 8) {
+		f->field[QCA_FILTER_UDP_DP] = &l4[2];
+	}
+}
+
+static void parse_ipv4(struct frame *f, const uint8_t *ip, size_t len)
+{
+	const size_t ihl = (size_t)(ip[0] & 0xfU) * 4;
+
+	if (len < 20 || ihl < 20 || ihl > len) {
+		return;
+	}
+
+	f->field[QCA_FILTER_IPV4_PROTO] = &ip[9];
+	f->field[QCA_FILTER_IPV4_SA] = &ip[12];
+	f->field[QCA_FILTER_IPV4_DA] = &ip[16];
+
+	/* only the first fragment carries the ports */
+	if ((get_be16(&ip[6]) & 0x1fffU) == 0) {
+		parse_l4(f, &ip[ihl], len - ihl, ip[9]);
+	}
+}
+
+static void parse_ipv6(struct frame *f, const uint8_t *ip, size_t len)
+{
+	if (len < 40) {
+		return;
+	}
+
+	f->field[QCA_FILTER_IPV6_SA] = &ip[8];
+	f->field[QCA_FILTER_IPV6_DA] = &ip[24];
+
+	/* extension headers are not walked through */
+	parse_l4(f, &ip[40], len - 40, ip[6]);
+}
+
+static void parse(struct frame *f, const uint8_t *p, size_t len)
+{
+	memset(f, 0, sizeof(*f));
+
+	if (len < 14) {
+		return;
+	}
+
+	f->field[QCA_FILTER_ETH_DA] = &p[0];
+	f->field[QCA_FILTER_ETH_SA] = &p[6];
+
+	size_t offset = 12;
+	uint16_t type = get_be16(&p[offset]);
+
+	if (type == ETHERTYPE_VLAN) {
+		if (len < 18) {
+			return;
+		}
+		f->vlan_id[0] = p[14] & 0xfU;
+		f->vlan_id[1] = p[15];
+		f->field[QCA_FILTER_VLAN_ID] = f->vlan_id;
+		offset += 4;
+		type = get_be16(&p[offset]);
+	}
+
+	offset += 2;
+
+	if (type == ETHERTYPE_IPV4) {
+		parse_ipv4(f, &p[offset], len - offset);
+	} else if (type == ETHERTYPE_IPV6) {
+		parse_ipv6(f, &p[offset], len - offset);
+	}
+}
+
+static bool match_classifier(const struct frame *f,
+		const struct qca_filter_classifier *c)
+{
+	const uint8_t *value = f->field[c->field];
+
+	if (value == NULL) {
+		return false;
+	}
+
+	const bool equal = memcmp(value, c->value, fields[c->field].len) == 0;
+
+	return c->negate? !equal : equal;
+}
+
+static bool match_rule(const struct frame *f, const struct qca_filter_rule *r)
+{
+	for (uint8_t i = 0; i < r->nr_classifiers; i++) {
+		if (match_classifier(f, &r->classifiers[i]) == r->match_any) {
+			return r->match_any;
+		}
+	}
+
+	return !r->match_any;
+}
+
+/* Whether the host is to act as if the modem had it, programmed or not */
+static bool is_in_effect(const struct slot *slot)
+{
+	switch (slot->state) {
+	case RULE_ADD:
+	case RULE_ADDING:
+	case RULE_ACTIVE:
+	case RULE_REJECTED:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool drops_rx(const struct rule *r)
+{
+	return is_in_effect(&r->slot) && (r->rule.action == QCA_FILTER_DROP ||
+			r->rule.action == QCA_FILTER_DROP_RX);
+}
+
+static bool is_multicast(const uint8_t *addr)
+{
+	static const uint8_t broadcast[6] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	};
+
+	return (addr[0] & 1U) && memcmp(addr, broadcast, 6) != 0;
+}
+
+/* Multicast frames to a group not listed are dropped once any is listed */
+static bool drops_group(struct qca_filter *filter, const uint8_t *da)
+{
+	bool listed = false;
+	bool any = false;
+
+	for (int i = 0; i < (int)QCA_FILTER_MAX_GROUPS; i++) {
+		struct group *g = &filter->groups[i];
+
+		if (!is_in_effect(&g->slot)) {
+			continue;
+		}
+
+		any = true;
+
+		if (memcmp(g->addr, da, sizeof(g->addr)) == 0) {
+			g->slot.host_hits++;
+			listed = true;
+		}
+	}
+
+	return any && !listed;
+}
+
+static bool is_valid(const struct qca_filter_rule *rule)
+{
+	if ((unsigned)rule->action >= ARRAY_COUNT(actions) ||
+			rule->nr_classifiers == 0 ||
+			rule->nr_classifiers > QCA_FILTER_MAX_CLASSIFIERS) {
+		return false;
+	}
+
+	for (uint8_t i = 0; i < rule->nr_classifiers; i++) {
+		if ((unsigned)rule->classifiers[i].field >=
+				QCA_FILTER_FIELD_MAX) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void encode_rule(struct request *req,
+		const struct qca_filter_rule *rule, enum control control)
+{
+	struct qca_mme_classification *msg = &req->msg.classification;
+
+	req->type = QCA_MMTYPE_CLASSIIFCATION;
+	req->msglen = sizeof(*msg);
+	memset(msg, 0, sizeof(*msg));
+
+	msg->control = (uint8_t)control;
+	msg->volatility = VOLATILITY_TEMP;
+	msg->action = actions[rule->action];
+	msg->operand = rule->match_any? OPERAND_ANY : OPERAND_ALL;
+	msg->num_classifiers = rule->nr_classifiers;
+
+	for (uint8_t i = 0; i < rule->nr_classifiers; i++) {
+		const struct qca_filter_classifier *c = &rule->classifiers[i];
+
+		msg->classifiers[i].pid = fields[c->field].pid;
+		msg->classifiers[i].operand = c->negate? 1 : 0;
+		memcpy(msg->classifiers[i].value, c->value,
+				fields[c->field].len);
+	}
+}
+
+static void encode_group(struct request *req,
+		const struct group *group, enum control control)
+{
+	struct qca_mme_multicast_info *msg = &req->msg.multicast_info;
+
+	req->type = QCA_MMTYPE_MULTICAST_INFO;
+	req->msglen = sizeof(*msg);
+	memset(msg, 0, sizeof(*msg));
+
+	msg->control = (uint8_t)control;
+	msg->volatility = VOLATILITY_TEMP;
+	memcpy(msg->group, group->addr, sizeof(msg->group));
+}
+
+static void encode_bw_limit(struct request *req, const struct bw_limit *bw)
+{
+	struct qca_mme_bw_limit *msg = &req->msg.bw_limit;
+
+	req->type = QCA_MMTYPE_BW_LIMIT;
+	req->msglen = sizeof(*msg);
+	memset(msg, 0, sizeof(*msg));
+
+	msg->control = BW_CONTROL_SET;
+	put_le16((uint8_t *)&msg->limit, bw->mbps);
+}
+
+static qca_filter_rule_state_t get_public_state(enum rule_state state)
+{
+	switch (state) {
+	case RULE_ADD:
+	case RULE_ADDING:
+		return QCA_FILTER_RULE_PENDING;
+	case RULE_ACTIVE:
+		return QCA_FILTER_RULE_ACTIVE;
+	case RULE_REJECTED:
+		return QCA_FILTER_RULE_REJECTED;
+	default:
+		return QCA_FILTER_RULE_UNUSED;
+	}
+}
+
+static bool is_removed(enum rule_state state)
+{
+	return state == RULE_UNUSED ||
+		state == RULE_REMOVE || state == RULE_REMOVING;
+}
+
+/* Moves the slot on to waiting for the confirmation, if it needs a request */
+static bool take(struct slot *slot, enum control *control)
+{
+	if (slot->state == RULE_ADD) {
+		slot->state = RULE_ADDING;
+		*control = CONTROL_ADD;
+	} else if (slot->state == RULE_REMOVE) {
+		slot->state = RULE_REMOVING;
+		*control = CONTROL_REMOVE;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static bool prepare_request(struct qca_filter *filter, struct request *req)
+{
+	enum control control;
+
+	for (int i = 0; i < (int)QCA_FILTER_MAX_RULES; i++) {
+		struct rule *r = &filter->rules[i];
+
+		if (take(&r->slot, &control)) {
+			encode_rule(req, &r->rule, control);
+			filter->outstanding = &r->slot;
+			return true;
+		}
+	}
+
+	for (int i = 0; i < (int)QCA_FILTER_MAX_GROUPS; i++) {
+		struct group *g = &filter->groups[i];
+
+		if (take(&g->slot, &control)) {
+			encode_group(req, g, control);
+			filter->outstanding = &g->slot;
+			return true;
+		}
+	}
+
+	if (take(&filter->bw_limit.slot, &control)) {
+		encode_bw_limit(req, &filter->bw_limit);
+		filter->outstanding = &filter->bw_limit.slot;
+		return true;
+	}
+
+	return false;
+}
+
+static void complete(struct qca_filter *filter, uint8_t status)
+{
+	struct slot *slot = filter->outstanding;
+
+	filter->outstanding = NULL;
+
+	switch (slot->state) {
+	case RULE_ADDING:
+		if (status == 0) {
+			slot->state = RULE_ACTIVE;
+			slot->programmed++;
+		} else {
+			QCA_ERROR("MME %d rejected: %u",
+					filter->outstanding_type, status);
+			slot->state = RULE_REJECTED;
+		}
+		break;
+	case RULE_REMOVE: /* removed while being added */
+		if (status != 0) {
+			slot->state = RULE_UNUSED;
+		}
+		break;
+	case RULE_REMOVING:
+		slot->state = RULE_UNUSED;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Sent again as the modem may not have taken it */
+static void retry(struct slot *slot)
+{
+	if (slot->state == RULE_ADDING) {
+		slot->state = RULE_ADD;
+	} else if (slot->state == RULE_REMOVING) {
+		slot->state = RULE_REMOVE;
+	}
+}
+
+/* The modem has forgotten everything it was told */
+static void reset(struct slot *slot)
+{
+	switch (slot->state) {
+	case RULE_ADDING:
+	case RULE_ACTIVE:
+		slot->state = RULE_ADD;
+		break;
+	case RULE_REMOVE:
+	case RULE_REMOVING:
+		slot->state = RULE_UNUSED;
+		break;
+	default:
+		break;
+	}
+}
+
+static int remove_slot(struct qca_filter *filter, struct slot *slot)
+{
+	int err = 0;
+
+	qca_os_lock(&filter->lock);
+	switch (slot->state) {
+	case RULE_ADD:
+	case RULE_REJECTED:
+		slot->state = RULE_UNUSED;
+		break;
+	case RULE_ADDING: /* removed once the add is confirmed */
+	case RULE_ACTIVE:
+		slot->state = RULE_REMOVE;
+		break;
+	default:
+		err = -ENOENT;
+		break;
+	}
+	qca_os_unlock(&filter->lock);
+
+	return err;
+}
+
+static int get_slot_stats(struct qca_filter *filter, const struct slot *slot,
+		struct qca_filter_rule_stats *stats)
+{
+	int err = 0;
+
+	qca_os_lock(&filter->lock);
+	if (is_removed(slot->state)) {
+		err = -ENOENT;
+	} else {
+		*stats = (struct qca_filter_rule_stats) {
+			.state = get_public_state(slot->state),
+			.host_hits = slot->host_hits,
+			.programmed = slot->programmed,
+		};
+	}
+	qca_os_unlock(&filter->lock);
+
+	return err;
+}
+
+int qca_filter_input(struct qca_filter *filter, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms)
+{
+	(void)now_ms;
+
+	if (filter == NULL || (body == NULL && body_len)) {
+		return -EINVAL;
+	}
+
+	if (!qca_mme_is_vendor(mmtype) ||
+			qca_mme_variant(mmtype) != QCA_MME_CNF) {
+		return -ENOMSG;
+	}
+
+	const qca_mmtype_t type = qca_mme_type(mmtype);
+
+	if (type != QCA_MMTYPE_CLASSIIFCATION &&
+			type != QCA_MMTYPE_MULTICAST_INFO &&
+			type != QCA_MMTYPE_BW_LIMIT) {
+		return -ENOMSG;
+	}
+
+	/* every one of them leads with the status */
+	if (body_len < sizeof(struct qca_mme_classification_cnf)) {
+		return -EINVAL;
+	}
+
+	const uint8_t status = *(const uint8_t *)body;
+
+	qca_os_lock(&filter->lock);
+	if (filter->outstanding != NULL && filter->outstanding_type == type) {
+		complete(filter, status);
+	}
+	qca_os_unlock(&filter->lock);
+
+	return 0;
+}
+
+void qca_filter_poll(struct qca_filter *filter, uint32_t now_ms)
+{
+	if (filter == NULL || filter->conf.request == NULL) {
+		return;
+	}
+
+	struct request req;
+	bool send = false;
+
+	qca_os_lock(&filter->lock);
+
+	if (filter->outstanding != NULL) {
+		if (!qca_mme_is_expired(now_ms, filter->requested_ms +
+				filter->conf.timeout_ms)) {
+			goto out;
+		}
+
+		retry(filter->outstanding);
+		filter->outstanding = NULL;
+	}
+
+	if (prepare_request(filter, &req)) {
+		filter->outstanding_type = req.type;
+		filter->requested_ms = now_ms;
+		send = true;
+	}
+out:
+	qca_os_unlock(&filter->lock);
+
+	/* a failed request is retried after the timeout */
+	if (send) {
+		(*filter->conf.request)(req.type, &req.msg, req.msglen,
+				filter->conf.request_ctx);
+	}
+}
+
+void qca_filter_handle_interrupt(struct qca_filter *filter, uint16_t int_src)
+{
+	if (filter == NULL || !(int_src & QCA_MME_INT_CPU_ON)) {
+		return;
+	}
+
+	qca_os_lock(&filter->lock);
+	for (int i = 0; i < (int)QCA_FILTER_MAX_RULES; i++) {
+		reset(&filter->rules[i].slot);
+	}
+	for (int i = 0; i < (int)QCA_FILTER_MAX_GROUPS; i++) {
+		reset(&filter->groups[i].slot);
+	}
+
+	reset(&filter->bw_limit.slot);
+	/* no limit is what the modem starts with */
+	if (filter->bw_limit.mbps == 0) {
+		filter->bw_limit.slot.state = RULE_UNUSED;
+	}
+
+	filter->outstanding = NULL;
+	qca_os_unlock(&filter->lock);
+}
+
+bool qca_filter_match(struct qca_filter *filter,
+		const void *frame, size_t frame_len)
+{
+	if (filter == NULL || frame == NULL) {
+		return false;
+	}
+
+	struct frame f;
+	bool matched = false;
+
+	parse(&f, (const uint8_t *)frame, frame_len);
+
+	qca_os_lock(&filter->lock);
+	for (int i = 0; i < (int)QCA_FILTER_MAX_RULES; i++) {
+		struct rule *r = &filter->rules[i];
+
+		if (drops_rx(r) && match_rule(&f, &r->rule)) {
+			r->slot.host_hits++;
+			matched = true;
+		}
+	}
+
+	const uint8_t *da = f.field[QCA_FILTER_ETH_DA];
+	if (da != NULL && is_multicast(da) && drops_group(filter, da)) {
+		matched = true;
+	}
+	qca_os_unlock(&filter->lock);
+
+	return matched;
+}
+
+int qca_filter_add(struct qca_filter *filter,
+		const struct qca_filter_rule *rule)
+{
+	if (filter == NULL || rule == NULL || !is_valid(rule)) {
+		return -EINVAL;
+	}
+
+	int id = -ENOSPC;
+
+	qca_os_lock(&filter->lock);
+	for (int i = 0; i < (int)QCA_FILTER_MAX_RULES; i++) {
+		struct rule *r = &filter->rules[i];
+
+		if (r->slot.state == RULE_UNUSED) {
+			*r = (struct rule) {
+				.rule = *rule,
+				.slot.state = RULE_ADD,
+			};
+			id = i;
+			break;
+		}
+	}
+	qca_os_unlock(&filter->lock);
+
+	return id;
+}
+
+int qca_filter_remove(struct qca_filter *filter, int id)
+{
+	if (filter == NULL) {
+		return -EINVAL;
+	}
+	if (id < 0 || id >= (int)QCA_FILTER_MAX_RULES) {
+		return -ENOENT;
+	}
+
+	return remove_slot(filter, &filter->rules[id].slot);
+}
+
+int qca_filter_join(struct qca_filter *filter, const uint8_t group[6])
+{
+	if (filter == NULL || group == NULL || !is_multicast(group)) {
+		return -EINVAL;
+	}
+
+	int id = -ENOSPC;
+
+	qca_os_lock(&filter->lock);
+	for (int i = 0; i < (int)QCA_FILTER_MAX_GROUPS; i++) {
+		const struct group *g = &filter->groups[i];
+
+		if (!is_removed(g->slot.state) &&
+				memcmp(g->addr, group, sizeof(g->addr)) == 0) {
+			id = -EEXIST;
+			goto out;
+		}
+	}
+
+	for (int i = 0; i < (int)QCA_FILTER_MAX_GROUPS; i++) {
+		struct group *g = &filter->groups[i];
+
+		if (g->slot.state == RULE_UNUSED) {
+			*g = (struct group) {
+				.slot.state = RULE_ADD,
+			};
+			memcpy(g->addr, group, sizeof(g->addr));
+			id = i;
+			break;
+		}
+	}
+out:
+	qca_os_unlock(&filter->lock);
+
+	return id;
+}
+
+int qca_filter_leave(struct qca_filter *filter, int id)
+{
+	if (filter == NULL) {
+		return -EINVAL;
+	}
+	if (id < 0 || id >= (int)QCA_FILTER_MAX_GROUPS) {
+		return -ENOENT;
+	}
+
+	return remove_slot(filter, &filter->groups[id].slot);
+}
+
+int qca_filter_set_bw_limit(struct qca_filter *filter, uint16_t mbps)
+{
+	if (filter == NULL) {
+		return -EINVAL;
+	}
+
+	qca_os_lock(&filter->lock);
+	filter->bw_limit.mbps = mbps;
+	/* sent again once confirmed if a request is already out */
+	filter->bw_limit.slot.state = RULE_ADD;
+	qca_os_unlock(&filter->lock);
+
+	return 0;
+}
+
+int qca_filter_get_stats(struct qca_filter *filter, int id,
+		struct qca_filter_rule_stats *stats)
+{
+	if (filter == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+	if (id < 0 || id >= (int)QCA_FILTER_MAX_RULES) {
+		return -ENOENT;
+	}
+
+	return get_slot_stats(filter, &filter->rules[id].slot, stats);
+}
+
+int qca_filter_get_group_stats(struct qca_filter *filter, int id,
+		struct qca_filter_rule_stats *stats)
+{
+	if (filter == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+	if (id < 0 || id >= (int)QCA_FILTER_MAX_GROUPS) {
+		return -ENOENT;
+	}
+
+	return get_slot_stats(filter, &filter->groups[id].slot, stats);
+}
+
+struct qca_filter *qca_filter_create(const struct qca_filter_conf *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	struct qca_filter *filter =
+		(struct qca_filter *)qca_os_malloc(sizeof(*filter));
+
+	if (filter == NULL) {
+		return NULL;
+	}
+
+	memset(filter, 0, sizeof(*filter));
+	filter->conf = *conf;
+
+	if (filter->conf.timeout_ms == 0) {
+		filter->conf.timeout_ms = QCA_FILTER_DEFAULT_TIMEOUT_MS;
+	}
+
+	qca_os_lock_init(&filter->lock);
+
+	return filter;
+}
+
+void qca_filter_destroy(struct qca_filter *filter)
+{
+	if (filter) {
+		qca_os_lock_deinit(&filter->lock);
+		qca_os_free(filter);
+	}
+}
@@ -0,0 +1,265 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/linkmon.h"
+#include "qca/mme.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+struct subscriber {
+	qca_linkmon_handler_t handler;
+	void *ctx;
+};
+
+struct qca_linkmon {
+	struct qca_linkmon_conf conf;
+	struct subscriber subscribers[QCA_LINKMON_MAX_SUBSCRIBERS];
+
+	qca_link_state_t state;
+	uint32_t interval_ms;
+	uint32_t next_poll_ms;
+	uint32_t requested_ms;
+	uint8_t missed;
+	bool pending;
+	bool started;
+};
+
+static void notify(struct qca_linkmon *mon, qca_link_state_t state,
+		uint32_t now)
+{
+	const struct qca_linkmon_event event = {
+		.state = state,
+		.prev = mon->state,
+		.timestamp_ms = now,
+	};
+
+	mon->state = state;
+
+	for (size_t i = 0; i < QCA_LINKMON_MAX_SUBSCRIBERS; i++) {
+		const struct subscriber *s = &mon->subscribers[i];
+
+		if (s->handler) {
+			(*s->handler)(&event, s->ctx);
+		}
+	}
+}
+
+static void poll_soon(struct qca_linkmon *mon, uint32_t now)
+{
+	mon->interval_ms = mon->conf.min_interval_ms;
+	mon->next_poll_ms = now;
+}
+
+static void update_state(struct qca_linkmon *mon, qca_link_state_t state,
+		uint32_t now)
+{
+	if (state != mon->state) {
+		notify(mon, state, now);
+		mon->interval_ms = mon->conf.min_interval_ms;
+	} else {
+		mon->interval_ms = MIN(mon->interval_ms * 2,
+				mon->conf.max_interval_ms);
+	}
+
+	mon->next_poll_ms = now + mon->interval_ms;
+}
+
+static void handle_timeout(struct qca_linkmon *mon, uint32_t now)
+{
+	mon->pending = false;
+
+	if (++mon->missed >= mon->conf.max_missed &&
+			mon->state != QCA_LINK_UNKNOWN) {
+		notify(mon, QCA_LINK_UNKNOWN, now);
+	}
+
+	poll_soon(mon, now);
+}
+
+int qca_linkmon_input(struct qca_linkmon *mon, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms)
+{
+	const uint8_t *p = (const uint8_t *)body;
+
+	if (mon == NULL || (p == NULL && body_len)) {
+		return -EINVAL;
+	}
+
+	if (!qca_mme_is_vendor(mmtype) ||
+			qca_mme_type(mmtype) != QCA_MMTYPE_PL_LINK_STATUS) {
+		return -ENOMSG;
+	}
+
+	switch (qca_mme_variant(mmtype)) {
+	case QCA_MME_IND:
+		/* the layout of the indication is not documented, so it only
+		 * triggers a query */
+		poll_soon(mon, now_ms);
+		return 0;
+	case QCA_MME_CNF:
+		break;
+	default:
+		return -ENOMSG;
+	}
+
+	/* status followed by the link status */
+	if (body_len < 2) {
+		return -EBADMSG;
+	}
+
+	mon->pending = false;
+	mon->missed = 0;
+
+	if (p[0] != 0) {
+		poll_soon(mon, now_ms);
+		return -EIO;
+	}
+
+	update_state(mon, p[1]? QCA_LINK_UP : QCA_LINK_DOWN, now_ms);
+
+	return 0;
+}
+
+void qca_linkmon_handle_interrupt(struct qca_linkmon *mon, uint16_t int_src,
+		uint32_t now_ms)
+{
+	if (mon == NULL || !(int_src & QCA_MME_INT_CPU_ON)) {
+		return;
+	}
+
+	mon->pending = false;
+	mon->missed = 0;
+
+	if (mon->state != QCA_LINK_UNKNOWN) {
+		notify(mon, QCA_LINK_UNKNOWN, now_ms);
+	}
+
+	poll_soon(mon, now_ms);
+}
+
+uint32_t qca_linkmon_poll(struct qca_linkmon *mon, uint32_t now_ms)
+{
+	if (mon == NULL) {
+		return 0;
+	}
+
+	if (mon->pending && qca_mme_is_expired(now_ms,
+			mon->requested_ms + mon->conf.timeout_ms)) {
+		handle_timeout(mon, now_ms);
+	}
+
+	if (!mon->pending && (!mon->started ||
+			qca_mme_is_expired(now_ms, mon->next_poll_ms))) {
+		mon->started = true;
+		mon->pending = true;
+		mon->requested_ms = now_ms;
+
+		/* a failed request is handled as a missed confirmation */
+		if (mon->conf.request) {
+			(*mon->conf.request)(mon->conf.request_ctx);
+		}
+	}
+
+	const uint32_t deadline = mon->pending?
+		mon->requested_ms + mon->conf.timeout_ms : mon->next_poll_ms;
+
+	return qca_mme_is_expired(now_ms, deadline)? 0 : deadline - now_ms;
+}
+
+qca_link_state_t qca_linkmon_state(const struct qca_linkmon *mon)
+{
+	return mon? mon->state : QCA_LINK_UNKNOWN;
+}
+
+int qca_linkmon_subscribe(struct qca_linkmon *mon,
+		qca_linkmon_handler_t handler, void *ctx)
+{
+	if (mon == NULL || handler == NULL) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < QCA_LINKMON_MAX_SUBSCRIBERS; i++) {
+		struct subscriber *s = &mon->subscribers[i];
+
+		if (s->handler == NULL) {
+			s->handler = handler;
+			s->ctx = ctx;
+			return 0;
+		}
+	}
+
+	return -ENOSPC;
+}
+
+int qca_linkmon_unsubscribe(struct qca_linkmon *mon,
+		qca_linkmon_handler_t handler, void *ctx)
+{
+	if (mon == NULL || handler == NULL) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < QCA_LINKMON_MAX_SUBSCRIBERS; i++) {
+		struct subscriber *s = &mon->subscribers[i];
+
+		if (s->handler == handler && s->ctx == ctx) {
+			memset(s, 0, sizeof(*s));
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+struct qca_linkmon *qca_linkmon_create(const struct qca_linkmon_conf *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	struct qca_linkmon *mon =
+		(struct qca_linkmon *)qca_os_malloc(sizeof(*mon));
+
+	if (mon == NULL) {
+		return NULL;
+	}
+
+	memset(mon, 0, sizeof(*mon));
+
+	mon->conf = *conf;
+
+	if (mon->conf.min_interval_ms == 0) {
+		mon->conf.min_interval_ms = QCA_LINKMON_DEFAULT_MIN_INTERVAL_MS;
+	}
+	if (mon->conf.max_interval_ms == 0) {
+		mon->conf.max_interval_ms = QCA_LINKMON_DEFAULT_MAX_INTERVAL_MS;
+	}
+	if (mon->conf.max_interval_ms < mon->conf.min_interval_ms) {
+		mon->conf.max_interval_ms = mon->conf.min_interval_ms;
+	}
+	if (mon->conf.timeout_ms == 0) {
+		mon->conf.timeout_ms = QCA_LINKMON_DEFAULT_TIMEOUT_MS;
+	}
+	if (mon->conf.max_missed == 0) {
+		mon->conf.max_missed = QCA_LINKMON_DEFAULT_MAX_MISSED;
+	}
+
+	mon->state = QCA_LINK_UNKNOWN;
+	mon->interval_ms = mon->conf.min_interval_ms;
+
+	return mon;
+}
+
+void qca_linkmon_destroy(struct qca_linkmon *mon)
+{
+	qca_os_free(mon);
+}
@@ -0,0 +1,522 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/memxfer.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef enum {
+	OP_NONE,
+	OP_READ,
+	OP_WRITE,
+} op_t;
+
+typedef enum {
+	SLOT_FREE,
+	SLOT_INFLIGHT,
+	SLOT_DONE,
+} slot_state_t;
+
+/* Chunk k of a transfer lives in slot k % window. Slots complete in any
+ * order but are retired from the head only, which keeps the sink and the
+ * progress in address order. */
+struct slot {
+	uint32_t addr;
+	uint16_t len;
+	uint8_t state;
+	uint8_t tries;
+	uint32_t sent_ms;
+	uint8_t *data; /* held here until retired, for a read into a sink */
+};
+
+struct qca_memxfer {
+	struct qca_memxfer_conf conf;
+	qca_os_lock_t lock;
+
+	op_t op;
+	int status;
+	uint32_t addr;
+	size_t len;
+	size_t nr_chunks;
+	size_t head; /* first chunk not retired yet */
+	size_t next; /* next chunk to send */
+	size_t done;
+	bool retiring; /* the head being handed out with the lock released */
+
+	uint8_t *buf;
+	const uint8_t *src;
+	qca_memxfer_sink_t sink;
+	void *sink_ctx;
+
+	struct qca_memxfer_stats stats;
+
+	struct slot *slots;
+	uint8_t *arena;
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static struct slot *get_slot(struct qca_memxfer *xfer, size_t chunk)
+{
+	return &xfer->slots[chunk % xfer->conf.window];
+}
+
+static void finish(struct qca_memxfer *xfer, int status)
+{
+	xfer->op = OP_NONE;
+	__atomic_store_n(&xfer->status, status, __ATOMIC_RELAXED);
+
+	for (size_t i = 0; i < xfer->conf.window; i++) {
+		xfer->slots[i].state = SLOT_FREE;
+	}
+}
+
+static void send_slot(struct qca_memxfer *xfer, struct slot *slot,
+		uint32_t now)
+{
+	uint8_t body[sizeof(struct qca_mme_wr_mem) + QCA_MEMXFER_MAX_CHUNK];
+	size_t body_len = sizeof(struct qca_mme_rd_mem);
+	qca_mmtype_t type = QCA_MMTYPE_RD_MEM;
+
+	put_le32(&body[offsetof(struct qca_mme_rd_mem, addr)], slot->addr);
+	put_le32(&body[offsetof(struct qca_mme_rd_mem, len)], slot->len);
+
+	if (xfer->op == OP_WRITE) {
+		type = QCA_MMTYPE_WR_MEM;
+		memcpy(&body[offsetof(struct qca_mme_wr_mem, data)],
+				&xfer->src[slot->addr - xfer->addr], slot->len);
+		body_len = sizeof(struct qca_mme_wr_mem) + slot->len;
+	}
+
+	slot->tries++;
+	slot->sent_ms = now;
+	xfer->stats.requests++;
+
+	/* a failed send is retried after the timeout */
+	(*xfer->conf.send)(type, body, body_len, xfer->conf.send_ctx);
+}
+
+static void fill_window(struct qca_memxfer *xfer, uint32_t now)
+{
+	while (xfer->op != OP_NONE && xfer->next < xfer->nr_chunks &&
+			xfer->next - xfer->head < xfer->conf.window) {
+		struct slot *slot = get_slot(xfer, xfer->next);
+		const size_t offset = xfer->next * xfer->conf.chunk;
+		const size_t left = xfer->len - offset;
+
+		slot->addr = xfer->addr + (uint32_t)offset;
+		slot->len = (uint16_t)(left < xfer->conf.chunk?
+				left : xfer->conf.chunk);
+		slot->state = SLOT_INFLIGHT;
+		slot->tries = 0;
+
+		xfer->next++;
+		send_slot(xfer, slot, now);
+	}
+}
+
+static bool is_running(const struct qca_memxfer *xfer)
+{
+	return __atomic_load_n(&xfer->status, __ATOMIC_RELAXED) > 0;
+}
+
+/* Hands the chunks done at the head to the sink and the progress callback,
+ * in address order. It is called with the lock held and releases it around
+ * the callbacks, so that these may call back in, e.g. to cancel. The chunks
+ * claimed stay in their slots meanwhile, as the window does not move and a
+ * new transfer does not start while retiring. */
+static void retire(struct qca_memxfer *xfer, uint32_t now)
+{
+	while (!xfer->retiring && xfer->op != OP_NONE) {
+		size_t end = xfer->head;
+
+		while (end < xfer->next &&
+				get_slot(xfer, end)->state == SLOT_DONE) {
+			end++;
+		}
+
+		if (end == xfer->head) {
+			break;
+		}
+
+		const size_t head = xfer->head;
+		size_t done = xfer->done;
+		int err = 0;
+
+		xfer->retiring = true;
+		qca_os_unlock(&xfer->lock);
+
+		for (size_t i = head; i < end && is_running(xfer); i++) {
+			const struct slot *slot = get_slot(xfer, i);
+
+			if (xfer->sink && (err = (*xfer->sink)(
+					slot->addr - xfer->addr, slot->data,
+					slot->len, xfer->sink_ctx)) < 0) {
+				break;
+			}
+
+			done += slot->len;
+		}
+
+		if (err == 0 && xfer->conf.on_progress && is_running(xfer)) {
+			(*xfer->conf.on_progress)(done, xfer->len,
+					xfer->conf.on_progress_ctx);
+		}
+
+		qca_os_lock(&xfer->lock);
+		xfer->retiring = false;
+
+		if (xfer->op == OP_NONE) { /* cancelled meanwhile */
+			break;
+		}
+		if (err < 0) {
+			finish(xfer, err);
+			break;
+		}
+
+		for (size_t i = head; i < end; i++) {
+			get_slot(xfer, i)->state = SLOT_FREE;
+		}
+
+		xfer->head = end;
+		xfer->done = done;
+
+		if (xfer->head == xfer->nr_chunks) {
+			finish(xfer, 0);
+			break;
+		}
+
+		fill_window(xfer, now);
+	}
+}
+
+static struct slot *find_inflight(struct qca_memxfer *xfer, uint32_t addr)
+{
+	const uint32_t offset = addr - xfer->addr;
+
+	if (offset >= xfer->len || offset % xfer->conf.chunk) {
+		return NULL;
+	}
+
+	const size_t chunk = offset / xfer->conf.chunk;
+
+	if (chunk < xfer->head || chunk >= xfer->next) {
+		return NULL;
+	}
+
+	struct slot *slot = get_slot(xfer, chunk);
+
+	return slot->state == SLOT_INFLIGHT? slot : NULL;
+}
+
+static int complete(struct qca_memxfer *xfer, qca_mmtype_t type,
+		const uint8_t *p, size_t len)
+{
+	if ((type == QCA_MMTYPE_RD_MEM && xfer->op != OP_READ) ||
+			(type == QCA_MMTYPE_WR_MEM && xfer->op != OP_WRITE)) {
+		xfer->stats.stale++;
+		return 0;
+	}
+
+	const uint8_t status = p[offsetof(struct qca_mme_rd_mem_cnf, status)];
+	const uint32_t addr =
+		get_le32(&p[offsetof(struct qca_mme_rd_mem_cnf, addr)]);
+	const uint32_t mlen =
+		get_le32(&p[offsetof(struct qca_mme_rd_mem_cnf, len)]);
+	struct slot *slot = find_inflight(xfer, addr);
+
+	if (slot == NULL || mlen != slot->len) {
+		xfer->stats.stale++;
+		return 0;
+	}
+
+	if (status != 0) {
+		finish(xfer, -EIO);
+		return 0;
+	}
+
+	if (xfer->op == OP_READ) {
+		const uint8_t *data = &p[sizeof(struct qca_mme_rd_mem_cnf)];
+
+		if (len < sizeof(struct qca_mme_rd_mem_cnf) + mlen) {
+			return -EBADMSG;
+		}
+
+		if (xfer->buf) {
+			memcpy(&xfer->buf[addr - xfer->addr], data, mlen);
+		} else {
+			memcpy(slot->data, data, mlen);
+		}
+	}
+
+	slot->state = SLOT_DONE;
+
+	return 0;
+}
+
+int qca_memxfer_input(struct qca_memxfer *xfer, uint16_t mmtype,
+		const void *body, size_t body_len, uint32_t now_ms)
+{
+	if (xfer == NULL || (body == NULL && body_len)) {
+		return -EINVAL;
+	}
+
+	if (!qca_mme_is_vendor(mmtype) ||
+			qca_mme_variant(mmtype) != QCA_MME_CNF) {
+		return -ENOMSG;
+	}
+
+	const qca_mmtype_t type = qca_mme_type(mmtype);
+
+	if (type != QCA_MMTYPE_RD_MEM && type != QCA_MMTYPE_WR_MEM) {
+		return -ENOMSG;
+	}
+
+	if (body_len < sizeof(struct qca_mme_wr_mem_cnf)) {
+		return -EBADMSG;
+	}
+
+	qca_os_lock(&xfer->lock);
+	const int err = complete(xfer, type, (const uint8_t *)body, body_len);
+	retire(xfer, now_ms);
+	qca_os_unlock(&xfer->lock);
+
+	return err;
+}
+
+void qca_memxfer_poll(struct qca_memxfer *xfer, uint32_t now_ms)
+{
+	if (xfer == NULL) {
+		return;
+	}
+
+	qca_os_lock(&xfer->lock);
+
+	for (size_t i = xfer->head; xfer->op != OP_NONE && i < xfer->next;
+			i++) {
+		struct slot *slot = get_slot(xfer, i);
+
+		if (slot->state != SLOT_INFLIGHT || !qca_mme_is_expired(now_ms,
+				slot->sent_ms + xfer->conf.timeout_ms)) {
+			continue;
+		}
+
+		if (slot->tries > xfer->conf.retries) {
+			finish(xfer, -ETIMEDOUT);
+			break;
+		}
+
+		xfer->stats.retransmits++;
+		send_slot(xfer, slot, now_ms);
+	}
+
+	qca_os_unlock(&xfer->lock);
+}
+
+static int start(struct qca_memxfer *xfer, op_t op, uint32_t addr,
+		size_t len, uint32_t now)
+{
+	if ((uint64_t)addr + len > (uint64_t)UINT32_MAX + 1) {
+		return -ERANGE;
+	}
+
+	xfer->op = op;
+	__atomic_store_n(&xfer->status, 1, __ATOMIC_RELAXED);
+	xfer->addr = addr;
+	xfer->len = len;
+	xfer->nr_chunks = (len + xfer->conf.chunk - 1) / xfer->conf.chunk;
+	xfer->head = 0;
+	xfer->next = 0;
+	xfer->done = 0;
+
+	if (len == 0) {
+		finish(xfer, 0);
+	}
+
+	fill_window(xfer, now);
+
+	return 0;
+}
+
+int qca_memxfer_read(struct qca_memxfer *xfer, uint32_t addr,
+		void *buf, size_t len, uint32_t now_ms)
+{
+	if (xfer == NULL || (buf == NULL && len)) {
+		return -EINVAL;
+	}
+
+	int err = -EBUSY;
+
+	qca_os_lock(&xfer->lock);
+	if (xfer->op == OP_NONE && !xfer->retiring) {
+		xfer->buf = (uint8_t *)buf;
+		xfer->src = NULL;
+		xfer->sink = NULL;
+		err = start(xfer, OP_READ, addr, len, now_ms);
+	}
+	qca_os_unlock(&xfer->lock);
+
+	return err;
+}
+
+int qca_memxfer_read_to(struct qca_memxfer *xfer, uint32_t addr, size_t len,
+		qca_memxfer_sink_t sink, void *sink_ctx, uint32_t now_ms)
+{
+	if (xfer == NULL || sink == NULL) {
+		return -EINVAL;
+	}
+
+	int err = -EBUSY;
+
+	qca_os_lock(&xfer->lock);
+	if (xfer->op == OP_NONE && !xfer->retiring) {
+		xfer->buf = NULL;
+		xfer->src = NULL;
+		xfer->sink = sink;
+		xfer->sink_ctx = sink_ctx;
+		err = start(xfer, OP_READ, addr, len, now_ms);
+	}
+	qca_os_unlock(&xfer->lock);
+
+	return err;
+}
+
+int qca_memxfer_write(struct qca_memxfer *xfer, uint32_t addr,
+		const void *data, size_t len, uint32_t now_ms)
+{
+	if (xfer == NULL || (data == NULL && len)) {
+		return -EINVAL;
+	}
+
+	int err = -EBUSY;
+
+	qca_os_lock(&xfer->lock);
+	if (xfer->op == OP_NONE && !xfer->retiring) {
+		xfer->buf = NULL;
+		xfer->src = (const uint8_t *)data;
+		xfer->sink = NULL;
+		err = start(xfer, OP_WRITE, addr, len, now_ms);
+	}
+	qca_os_unlock(&xfer->lock);
+
+	return err;
+}
+
+int qca_memxfer_status(const struct qca_memxfer *xfer)
+{
+	if (xfer == NULL) {
+		return -EINVAL;
+	}
+
+	return __atomic_load_n(&xfer->status, __ATOMIC_RELAXED);
+}
+
+void qca_memxfer_cancel(struct qca_memxfer *xfer)
+{
+	if (xfer == NULL) {
+		return;
+	}
+
+	qca_os_lock(&xfer->lock);
+	if (xfer->op != OP_NONE) {
+		finish(xfer, -ECANCELED);
+	}
+	qca_os_unlock(&xfer->lock);
+}
+
+int qca_memxfer_get_stats(struct qca_memxfer *xfer,
+		struct qca_memxfer_stats *stats)
+{
+	if (xfer == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	qca_os_lock(&xfer->lock);
+	*stats = xfer->stats;
+	qca_os_unlock(&xfer->lock);
+
+	return 0;
+}
+
+struct qca_memxfer *qca_memxfer_create(const struct qca_memxfer_conf *conf)
+{
+	if (conf == NULL || conf->send == NULL) {
+		return NULL;
+	}
+
+	struct qca_memxfer *xfer =
+		(struct qca_memxfer *)qca_os_malloc(sizeof(*xfer));
+
+	if (xfer == NULL) {
+		return NULL;
+	}
+
+	memset(xfer, 0, sizeof(*xfer));
+
+	xfer->conf = *conf;
+
+	if (xfer->conf.window == 0) {
+		xfer->conf.window = QCA_MEMXFER_DEFAULT_WINDOW;
+	}
+	if (xfer->conf.chunk == 0 || xfer->conf.chunk > QCA_MEMXFER_MAX_CHUNK) {
+		xfer->conf.chunk = QCA_MEMXFER_MAX_CHUNK;
+	}
+	if (xfer->conf.timeout_ms == 0) {
+		xfer->conf.timeout_ms = QCA_MEMXFER_DEFAULT_TIMEOUT_MS;
+	}
+	if (xfer->conf.retries == 0) {
+		xfer->conf.retries = QCA_MEMXFER_DEFAULT_RETRIES;
+	} else if (xfer->conf.retries == QCA_MEMXFER_NO_RETRY) {
+		xfer->conf.retries = 0;
+	}
+
+	xfer->slots = (struct slot *)
+		qca_os_malloc(xfer->conf.window * sizeof(*xfer->slots));
+	xfer->arena = (uint8_t *)
+		qca_os_malloc(xfer->conf.window * xfer->conf.chunk);
+
+	if (xfer->slots == NULL || xfer->arena == NULL) {
+		qca_os_free(xfer->arena);
+		qca_os_free(xfer->slots);
+		qca_os_free(xfer);
+		return NULL;
+	}
+
+	memset(xfer->slots, 0, xfer->conf.window * sizeof(*xfer->slots));
+
+	for (size_t i = 0; i < xfer->conf.window; i++) {
+		xfer->slots[i].data = &xfer->arena[i * xfer->conf.chunk];
+	}
+
+	qca_os_lock_init(&xfer->lock);
+
+	return xfer;
+}
+
+void qca_memxfer_destroy(struct qca_memxfer *xfer)
+{
+	if (xfer) {
+		qca_os_lock_deinit(&xfer->lock);
+		qca_os_free(xfer->arena);
+		qca_os_free(xfer->slots);
+		qca_os_free(xfer);
+	}
+}
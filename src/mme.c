@@ -84,6 +84,17 @@ static struct encoder encoders[] = {
 	{ .type = QCA_MMTYPE_SW_VER,           .func = encode_generic },
 	{ .type = QCA_MMTYPE_HST_ACTION,       .func = encode_generic },
 	{ .type = QCA_MMTYPE_WRITE_EXC_APPLET, .func = encode_generic },
+	{ .type = QCA_MMTYPE_TONE_MAP,         .func = encode_generic },
+	{ .type = QCA_MMTYPE_RX_TONE_MAP,      .func = encode_generic },
+	{ .type = QCA_MMTYPE_LINK_STATS,       .func = encode_generic },
+	{ .type = QCA_MMTYPE_WR_MOD,           .func = encode_generic },
+	{ .type = QCA_MMTYPE_RD_MOD,           .func = encode_generic },
+	{ .type = QCA_MMTYPE_MOD_NVM,          .func = encode_generic },
+	{ .type = QCA_MMTYPE_RD_MEM,           .func = encode_generic },
+	{ .type = QCA_MMTYPE_WR_MEM,           .func = encode_generic },
+	{ .type = QCA_MMTYPE_CLASSIIFCATION,   .func = encode_generic },
+	{ .type = QCA_MMTYPE_MULTICAST_INFO,   .func = encode_generic },
+	{ .type = QCA_MMTYPE_BW_LIMIT,         .func = encode_generic },
 };
 
 static size_t encode(struct qca_mme *qca, qca_mmtype_t type,
@@ -120,6 +131,50 @@ qca_mmtype_t qca_decode_mme(const void *data, size_t datasize, uint16_t mmtype)
 {
 	return decode((const struct qca_mme *)data, datasize, mmtype);
 }
+
+uint16_t qca_mme_mmtype(qca_mmtype_t type, qca_mme_variant_t variant)
+{
+	return (uint16_t)(QCA_MMTYPE_VENDOR | (type << 2) |
+			(variant & QCA_MMTYPE_VARIANT_MASK));
+}
+
+bool qca_mme_is_vendor(uint16_t mmtype)
+{
+	return (mmtype & QCA_MMTYPE_VENDOR_MASK) == QCA_MMTYPE_VENDOR;
+}
+
+qca_mmtype_t qca_mme_type(uint16_t mmtype)
+{
+	return (qca_mmtype_t)((mmtype & ~QCA_MMTYPE_VENDOR_MASK) >> 2);
+}
+
+qca_mme_variant_t qca_mme_variant(uint16_t mmtype)
+{
+	return (qca_mme_variant_t)(mmtype & QCA_MMTYPE_VARIANT_MASK);
+}
+
+size_t qca_mme_put_header(void *frame,
+		const uint8_t *dst, const uint8_t *src, uint16_t mmtype)
+{
+	uint8_t *p = (uint8_t *)frame;
+
+	memcpy(&p[0], dst, 6);
+	memcpy(&p[6], src, 6);
+	p[12] = (uint8_t)(QCA_MME_ETHERTYPE >> 8);
+	p[13] = (uint8_t)QCA_MME_ETHERTYPE;
+	p[14] = QCA_MME_MMV;
+	p[15] = (uint8_t)mmtype;
+	p[16] = (uint8_t)(mmtype >> 8);
+	p[17] = 0; /* FMI: not fragmented */
+	p[18] = 0;
+
+	return QCA_MME_HEADER_LEN;
+}
+
+bool qca_mme_is_expired(uint32_t now_ms, uint32_t deadline_ms)
+{
+	return (int32_t)(now_ms - deadline_ms) >= 0;
+}
 #if 0
 size_t qca_pack_pib_read(struct eth *buf, size_t bufsize, uint32_t offset)
 {
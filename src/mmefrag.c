@@ -0,0 +1,446 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/mmefrag.h"
+#include "qca/mme.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define HPAV_MMV_1_0			0x00U
+#define HPAV_HEADER_1_0_LEN		17U /* no FMI */
+#define ETH_MINLEN			60U
+#define ETH_MAXLEN			1514U
+#define FRAGMENT_MAXLEN			(ETH_MAXLEN - QCA_MMEFRAG_HEADER_LEN)
+
+#define OFFSET_OSA			6U
+#define OFFSET_ETHERTYPE		12U
+#define OFFSET_MMV			14U
+#define OFFSET_MMTYPE			15U
+#define OFFSET_FMI			17U
+#define OFFSET_FMSN			18U
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+/* A message being reassembled. Every fragment but the last carries the
+ * same length, so the position of a fragment follows from its number once
+ * any but the last has arrived. Until then the last fragment is parked at
+ * the position it would have with fragments of the maximum length. */
+struct context {
+	bool used;
+	uint8_t src[6];
+	uint16_t mmtype;
+	uint8_t fmsn;
+	uint8_t nf;
+	uint16_t received; /* bitmap of fragment numbers */
+	size_t frag_len; /* 0 while unknown */
+	size_t last_len;
+	size_t offset; /* of the buffer in the arena */
+	size_t size;
+	uint32_t started_ms;
+};
+
+struct qca_mmefrag {
+	struct qca_mmefrag_conf conf;
+	struct context *contexts;
+	struct context *delivered; /* released on the next call */
+	uint8_t *arena;
+	struct qca_mmefrag_stats stats;
+};
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return (uint16_t)(((uint16_t)p[1] << 8) | p[0]);
+}
+
+static void release(struct context *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+static void release_delivered(struct qca_mmefrag *frag)
+{
+	if (frag->delivered) {
+		release(frag->delivered);
+		frag->delivered = NULL;
+	}
+}
+
+static void expire(struct qca_mmefrag *frag, uint32_t now)
+{
+	for (size_t i = 0; i < frag->conf.contexts; i++) {
+		struct context *ctx = &frag->contexts[i];
+
+		if (ctx->used && qca_mme_is_expired(now,
+				ctx->started_ms + frag->conf.timeout_ms)) {
+			frag->stats.timeouts++;
+			release(ctx);
+		}
+	}
+}
+
+static bool overlaps(const struct qca_mmefrag *frag, size_t offset,
+		size_t size)
+{
+	for (size_t i = 0; i < frag->conf.contexts; i++) {
+		const struct context *ctx = &frag->contexts[i];
+
+		if (ctx->used && offset < ctx->offset + ctx->size &&
+				ctx->offset < offset + size) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* First fit. The candidates are the start of the arena and the end of each
+ * buffer in use, which is where every gap begins. */
+static int allocate(const struct qca_mmefrag *frag, size_t size,
+		size_t *offset)
+{
+	for (size_t i = 0; i <= frag->conf.contexts; i++) {
+		size_t candidate = 0;
+
+		if (i < frag->conf.contexts) {
+			const struct context *ctx = &frag->contexts[i];
+			if (!ctx->used) {
+				continue;
+			}
+			candidate = ctx->offset + ctx->size;
+		}
+
+		if (candidate + size <= frag->conf.arena_size &&
+				!overlaps(frag, candidate, size)) {
+			*offset = candidate;
+			return 0;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+static struct context *find_context(struct qca_mmefrag *frag,
+		const uint8_t *src, uint16_t mmtype, uint8_t fmsn)
+{
+	for (size_t i = 0; i < frag->conf.contexts; i++) {
+		struct context *ctx = &frag->contexts[i];
+
+		if (ctx->used && ctx->mmtype == mmtype && ctx->fmsn == fmsn &&
+				!memcmp(ctx->src, src, sizeof(ctx->src))) {
+			return ctx;
+		}
+	}
+
+	return NULL;
+}
+
+static int new_context(struct qca_mmefrag *frag, struct context **out,
+		const uint8_t *src, uint16_t mmtype, uint8_t fmsn,
+		uint8_t nf, uint8_t fn, size_t len, uint32_t now)
+{
+	struct context *ctx = NULL;
+
+	for (size_t i = 0; i < frag->conf.contexts; i++) {
+		if (!frag->contexts[i].used) {
+			ctx = &frag->contexts[i];
+			break;
+		}
+	}
+
+	if (ctx == NULL) {
+		frag->stats.no_context++;
+		return -ENOSPC;
+	}
+
+	/* the last fragment may be short, so it tells nothing of the rest */
+	const bool last = fn == nf - 1;
+	const size_t size = last? (nf - 1U) * FRAGMENT_MAXLEN + len : nf * len;
+
+	if (allocate(frag, size, &ctx->offset) != 0) {
+		frag->stats.no_memory++;
+		return -ENOMEM;
+	}
+
+	memcpy(ctx->src, src, sizeof(ctx->src));
+	ctx->mmtype = mmtype;
+	ctx->fmsn = fmsn;
+	ctx->nf = nf;
+	ctx->size = size;
+	ctx->started_ms = now;
+	ctx->used = true;
+
+	*out = ctx;
+
+	return 0;
+}
+
+static int store(struct qca_mmefrag *frag, struct context *ctx,
+		uint8_t fn, const uint8_t *body, size_t len)
+{
+	uint8_t *buf = &frag->arena[ctx->offset];
+	const bool last = fn == ctx->nf - 1;
+
+	if (!last) {
+		if (ctx->frag_len == 0) {
+			const bool parked =
+				(ctx->received >> (ctx->nf - 1U)) & 1U;
+
+			ctx->frag_len = len;
+
+			if (parked) {
+				memmove(&buf[(ctx->nf - 1U) * len],
+					&buf[(ctx->nf - 1U) * FRAGMENT_MAXLEN],
+					ctx->last_len);
+			}
+		}
+
+		if (len != ctx->frag_len || ctx->last_len > len) {
+			return -EBADMSG;
+		}
+	} else if (ctx->frag_len && len > ctx->frag_len) {
+		return -EBADMSG;
+	}
+
+	const size_t pos = (size_t)fn *
+		(ctx->frag_len? ctx->frag_len : FRAGMENT_MAXLEN);
+
+	if (pos + len > ctx->size) {
+		return -EBADMSG;
+	}
+
+	memcpy(&buf[pos], body, len);
+
+	if (last) {
+		ctx->last_len = len;
+	}
+
+	ctx->received |= (uint16_t)(1U << fn);
+
+	return 0;
+}
+
+int qca_mmefrag_input(struct qca_mmefrag *frag,
+		const void *frame, size_t frame_size, uint32_t now_ms,
+		struct qca_mme_view *view)
+{
+	const uint8_t *p = (const uint8_t *)frame;
+
+	if (frag == NULL || p == NULL || view == NULL) {
+		return -EINVAL;
+	}
+
+	release_delivered(frag);
+	expire(frag, now_ms);
+
+	if (frame_size < HPAV_HEADER_1_0_LEN || QCA_MME_ETHERTYPE !=
+			(((uint16_t)p[OFFSET_ETHERTYPE] << 8) |
+			 p[OFFSET_ETHERTYPE + 1])) {
+		return -ENOMSG;
+	}
+
+	memcpy(view->src, &p[OFFSET_OSA], sizeof(view->src));
+	view->mmtype = get_le16(&p[OFFSET_MMTYPE]);
+
+	if (p[OFFSET_MMV] == HPAV_MMV_1_0) {
+		view->body = &p[HPAV_HEADER_1_0_LEN];
+		view->body_len = frame_size - HPAV_HEADER_1_0_LEN;
+		return 1;
+	}
+
+	if (frame_size < QCA_MMEFRAG_HEADER_LEN) {
+		return -EBADMSG;
+	}
+
+	const uint8_t nf = (uint8_t)((p[OFFSET_FMI] >> 4) + 1U);
+	const uint8_t fn = p[OFFSET_FMI] & 0xfU;
+	const uint8_t fmsn = p[OFFSET_FMSN];
+	const uint8_t *body = &p[QCA_MMEFRAG_HEADER_LEN];
+	const size_t len = frame_size - QCA_MMEFRAG_HEADER_LEN;
+
+	if (nf == 1) {
+		view->body = body;
+		view->body_len = len;
+		return 1;
+	}
+
+	if (fn >= nf || len == 0 || len > FRAGMENT_MAXLEN) {
+		frag->stats.malformed++;
+		return -EBADMSG;
+	}
+
+	struct context *ctx = find_context(frag, view->src, view->mmtype, fmsn);
+	int err;
+
+	if (ctx == NULL && (err = new_context(frag, &ctx, view->src,
+			view->mmtype, fmsn, nf, fn, len, now_ms)) != 0) {
+		return err;
+	}
+
+	if (ctx->nf != nf) {
+		frag->stats.malformed++;
+		return -EBADMSG;
+	}
+
+	frag->stats.fragments++;
+
+	if (ctx->received & (1U << fn)) {
+		return 0; /* duplicate */
+	}
+
+	if ((err = store(frag, ctx, fn, body, len)) != 0) {
+		QCA_ERROR("fragment %u/%u does not fit", fn, nf);
+		frag->stats.malformed++;
+		release(ctx);
+		return err;
+	}
+
+	if (ctx->received != (uint16_t)((1U << nf) - 1U)) {
+		return 0;
+	}
+
+	view->body = &frag->arena[ctx->offset];
+	view->body_len = (nf - 1U) * ctx->frag_len + ctx->last_len;
+	frag->delivered = ctx;
+	frag->stats.reassembled++;
+
+	return 1;
+}
+
+void qca_mmefrag_poll(struct qca_mmefrag *frag, uint32_t now_ms)
+{
+	if (frag) {
+		release_delivered(frag);
+		expire(frag, now_ms);
+	}
+}
+
+int qca_mmefrag_get_stats(const struct qca_mmefrag *frag,
+		struct qca_mmefrag_stats *stats)
+{
+	if (frag == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	*stats = frag->stats;
+
+	return 0;
+}
+
+int qca_mmefrag_send(const uint8_t dst[6], const uint8_t src[6],
+		uint16_t mmtype, uint8_t fmsn, const void *body, size_t body_len,
+		size_t mtu, qca_mmefrag_send_t send, void *send_ctx)
+{
+	const uint8_t *p = (const uint8_t *)body;
+	uint8_t frame[ETH_MAXLEN];
+
+	if (mtu == 0) {
+		mtu = QCA_MMEFRAG_DEFAULT_MTU;
+	}
+	if (mtu > sizeof(frame)) {
+		mtu = sizeof(frame);
+	}
+
+	if (!dst || !src || !send || (!p && body_len) ||
+			mtu <= QCA_MMEFRAG_HEADER_LEN) {
+		return -EINVAL;
+	}
+
+	const size_t chunk = mtu - QCA_MMEFRAG_HEADER_LEN;
+	const size_t nf = body_len? (body_len + chunk - 1) / chunk : 1;
+
+	if (nf > QCA_MMEFRAG_MAX_FRAGMENTS) {
+		return -EMSGSIZE;
+	}
+
+	memcpy(&frame[0], dst, 6);
+	memcpy(&frame[OFFSET_OSA], src, 6);
+	frame[OFFSET_ETHERTYPE] = (uint8_t)(QCA_MME_ETHERTYPE >> 8);
+	frame[OFFSET_ETHERTYPE + 1] = (uint8_t)QCA_MME_ETHERTYPE;
+	frame[OFFSET_MMV] = 0x01;
+	frame[OFFSET_MMTYPE] = (uint8_t)mmtype;
+	frame[OFFSET_MMTYPE + 1] = (uint8_t)(mmtype >> 8);
+	frame[OFFSET_FMSN] = nf > 1? fmsn : 0;
+
+	for (size_t fn = 0; fn < nf; fn++) {
+		const size_t offset = fn * chunk;
+		const size_t len = body_len - offset < chunk?
+			body_len - offset : chunk;
+		size_t frame_size = QCA_MMEFRAG_HEADER_LEN + len;
+
+		frame[OFFSET_FMI] = (uint8_t)(((nf - 1U) << 4) | fn);
+
+		if (len) {
+			memcpy(&frame[QCA_MMEFRAG_HEADER_LEN], &p[offset], len);
+		}
+		if (frame_size < ETH_MINLEN) {
+			memset(&frame[frame_size], 0, ETH_MINLEN - frame_size);
+			frame_size = ETH_MINLEN;
+		}
+
+		const int err = (*send)(frame, frame_size, send_ctx);
+
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	return (int)nf;
+}
+
+struct qca_mmefrag *qca_mmefrag_create(const struct qca_mmefrag_conf *conf)
+{
+	struct qca_mmefrag *frag =
+		(struct qca_mmefrag *)qca_os_malloc(sizeof(*frag));
+
+	if (frag == NULL) {
+		return NULL;
+	}
+
+	memset(frag, 0, sizeof(*frag));
+
+	if (conf) {
+		frag->conf = *conf;
+	}
+
+	if (frag->conf.contexts == 0) {
+		frag->conf.contexts = QCA_MMEFRAG_DEFAULT_CONTEXTS;
+	}
+	if (frag->conf.arena_size == 0) {
+		frag->conf.arena_size = QCA_MMEFRAG_DEFAULT_ARENA_SIZE;
+	}
+	if (frag->conf.timeout_ms == 0) {
+		frag->conf.timeout_ms = QCA_MMEFRAG_DEFAULT_TIMEOUT_MS;
+	}
+
+	frag->contexts = (struct context *)
+		qca_os_malloc(frag->conf.contexts * sizeof(*frag->contexts));
+	frag->arena = (uint8_t *)qca_os_malloc(frag->conf.arena_size);
+
+	if (frag->contexts == NULL || frag->arena == NULL) {
+		QCA_ERROR("failed to allocate the arena");
+		qca_mmefrag_destroy(frag);
+		return NULL;
+	}
+
+	memset(frag->contexts, 0,
+			frag->conf.contexts * sizeof(*frag->contexts));
+
+	return frag;
+}
+
+void qca_mmefrag_destroy(struct qca_mmefrag *frag)
+{
+	if (frag) {
+		qca_os_free(frag->arena);
+		qca_os_free(frag->contexts);
+		qca_os_free(frag);
+	}
+}
@@ -17,10 +17,33 @@
 #define MIN(a, b)		(((a) > (b))? (b) : (a))
 #endif
 
+#define ROUNDUP_POW2(n)		(SMEAR((size_t)(n) - 1) + 1)
+#define SMEAR(x)		SMEAR16((x) | ((x) >> 16))
+#define SMEAR16(x)		SMEAR8((x) | ((x) >> 8))
+#define SMEAR8(x)		SMEAR4((x) | ((x) >> 4))
+#define SMEAR4(x)		SMEAR2((x) | ((x) >> 2))
+#define SMEAR2(x)		((x) | ((x) >> 1))
+
+/* the ring buffer indexes by masking */
+#define RING_SIZE		ROUNDUP_POW2(QCA_NVM_BUFSIZE * 2)
+
+_Static_assert((RING_SIZE & (RING_SIZE - 1)) == 0,
+		"the NVM ring buffer must be a power of two");
+_Static_assert(RING_SIZE >= QCA_NVM_BUFSIZE * 2,
+		"the NVM ring buffer must hold QCA_NVM_BUFSIZE twice");
+
 #if !defined(QCA_DEBUG)
 #define QCA_DEBUG(...)
 #endif
 
+#if defined(QCA_STATIC)
+/* Kept out of the stack for small-stack targets. It is used by one
+ * iteration at a time. Another one meanwhile gets -EBUSY. */
+static struct ringbuf ring;
+static uint8_t ring_mem[RING_SIZE];
+static bool ring_busy;
+#endif
+
 struct header_iterator_ctx {
 	qca_nvm_image_t type;
 	struct {
@@ -44,20 +67,30 @@ static uint32_t calc_chksum(const void *data, size_t len, uint32_t checksum)
 	return ~checksum;
 }
 
-static int iterate_nvm_header(qca_nvm_reader_t reader, size_t nvm_size,
-		qca_nvm_header_callback_t cb, void *ctx)
+static int iterate_nvm_header(qca_nvm_reader_t reader, void *reader_ctx,
+		size_t nvm_size, qca_nvm_header_callback_t cb, void *ctx)
 {
 	struct ringbuf *q;
 	size_t index = 0;
 	size_t next = 0;
 
-
 	if (!reader) {
 		return -EINVAL;
 	}
-	if (!(q = ringbuf_create(QCA_NVM_BUFSIZE * 2))) {
+#if defined(QCA_STATIC)
+	if (__atomic_exchange_n(&ring_busy, true, __ATOMIC_ACQUIRE)) {
+		return -EBUSY;
+	}
+	if (!ringbuf_create_static(&ring, ring_mem, sizeof(ring_mem))) {
+		__atomic_store_n(&ring_busy, false, __ATOMIC_RELEASE);
+		return -EINVAL;
+	}
+	q = &ring;
+#else
+	if (!(q = ringbuf_create(RING_SIZE))) {
 		return -ENOMEM;
 	}
+#endif
 
 	if (nvm_size == 0) {
 		nvm_size = (size_t)-1; /* up to EOF */
@@ -65,7 +98,7 @@ static int iterate_nvm_header(qca_nvm_reader_t reader, size_t nvm_size,
 
 	while (index < nvm_size && next != (size_t)-1) {
 		uint8_t buf[sizeof(qca_nvm_header_t)];
-		const size_t len = reader(buf, sizeof(buf), ctx);
+		const size_t len = reader(buf, sizeof(buf), reader_ctx);
 
 		if (len > 0) {
 			ringbuf_write(q, buf, len);
@@ -100,7 +133,11 @@ static int iterate_nvm_header(qca_nvm_reader_t reader, size_t nvm_size,
 		}
 	}
 
+#if defined(QCA_STATIC)
+	__atomic_store_n(&ring_busy, false, __ATOMIC_RELEASE);
+#else
 	ringbuf_destroy(q);
+#endif
 
 	return 0;
 }
@@ -127,17 +164,22 @@ uint32_t qca_calc_chksum(const void *data, size_t len, uint32_t checksum)
 int qca_nvm_iterate(qca_nvm_reader_t reader, size_t nvm_size,
 		qca_nvm_header_callback_t cb, void *ctx)
 {
-	return iterate_nvm_header(reader, nvm_size, cb, ctx);
+	return iterate_nvm_header(reader, ctx, nvm_size, cb, ctx);
 }
 
-int qca_nvm_offset(qca_nvm_image_t type,
-		qca_nvm_reader_t reader, size_t nvm_size, uint32_t *offset)
+int qca_nvm_locate(qca_nvm_image_t type, qca_nvm_reader_t reader,
+		void *reader_ctx, size_t nvm_size, uint32_t *offset)
 {
 	struct header_iterator_ctx ctx = {
 		.type = type,
 	};
 
-	iterate_nvm_header(reader, nvm_size, on_nvm_header_for_offset, &ctx);
+	const int err = iterate_nvm_header(reader, reader_ctx, nvm_size,
+			on_nvm_header_for_offset, &ctx);
+
+	if (err) {
+		return err;
+	}
 
 	if (offset) {
 		*offset = ctx.offset.header;
@@ -145,3 +187,9 @@ int qca_nvm_offset(qca_nvm_image_t type,
 
 	return ctx.offset.header? 0 : -ENOENT;
 }
+
+int qca_nvm_offset(qca_nvm_image_t type,
+		qca_nvm_reader_t reader, size_t nvm_size, uint32_t *offset)
+{
+	return qca_nvm_locate(type, reader, NULL, nvm_size, offset);
+}
@@ -0,0 +1,259 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/nvmz.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define NO_BLOCK			UINT32_MAX
+#define LEN_EXTENDED			15U
+#define MIN_MATCH			4U
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+struct qca_nvmz {
+	qca_nvmz_source_t source;
+	void *source_ctx;
+
+	uint32_t size;
+	uint32_t block_size;
+	uint32_t nr_blocks;
+
+	uint32_t pos;
+	uint32_t cached; /* block in the buffer, or NO_BLOCK */
+	uint32_t cached_len;
+
+	uint8_t block[QCA_NVMZ_BLOCK_MAXLEN];
+	uint8_t packed[QCA_NVMZ_BLOCK_MAXLEN];
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool read_source(const struct qca_nvmz *z,
+		uint32_t offset, void *buf, size_t len)
+{
+	return (*z->source)(offset, buf, len, z->source_ctx) == len;
+}
+
+/* Reads a length continued in bytes of 255 while the nibble is saturated.
+ * Returns false on running out of input. */
+static bool get_len(const uint8_t **p, const uint8_t *end, size_t *len)
+{
+	if (*len != LEN_EXTENDED) {
+		return true;
+	}
+
+	uint8_t c;
+
+	do {
+		if (*p >= end) {
+			return false;
+		}
+		c = *(*p)++;
+		*len += c;
+	} while (c == 255);
+
+	return true;
+}
+
+/* Every sequence is a token of the literal length and the match length less
+ * MIN_MATCH in nibbles, the literals, then a 16-bit distance back. The last
+ * sequence of a block has literals only. */
+static int decompress(const uint8_t *src, size_t srclen,
+		uint8_t *dst, size_t dstlen)
+{
+	const uint8_t *p = src;
+	const uint8_t *end = &src[srclen];
+	size_t out = 0;
+
+	while (out < dstlen) {
+		if (p >= end) {
+			return -EINVAL;
+		}
+
+		const uint8_t token = *p++;
+		size_t len = token >> 4;
+
+		if (!get_len(&p, end, &len) || len > (size_t)(end - p) ||
+				len > dstlen - out) {
+			return -EINVAL;
+		}
+
+		memcpy(&dst[out], p, len);
+		p += len;
+		out += len;
+
+		if (out == dstlen) {
+			break;
+		}
+		if (end - p < 2) {
+			return -EINVAL;
+		}
+
+		const size_t distance = (size_t)p[0] | ((size_t)p[1] << 8);
+		p += 2;
+		len = token & 0xfU;
+
+		if (!get_len(&p, end, &len)) {
+			return -EINVAL;
+		}
+
+		len += MIN_MATCH;
+
+		if (distance == 0 || distance > out || len > dstlen - out) {
+			return -EINVAL;
+		}
+
+		/* byte by byte as the match may overlap itself */
+		for (size_t i = 0; i < len; i++, out++) {
+			dst[out] = dst[out - distance];
+		}
+	}
+
+	return 0;
+}
+
+static int load_block(struct qca_nvmz *z, uint32_t index)
+{
+	uint8_t offsets[8];
+
+	if (z->cached == index) {
+		return 0;
+	}
+
+	const uint32_t at = (uint32_t)sizeof(struct qca_nvmz_header) +
+		index * 4U;
+	const uint32_t raw_len = MIN(z->block_size,
+			z->size - index * z->block_size);
+
+	z->cached = NO_BLOCK;
+
+	if (!read_source(z, at, offsets, sizeof(offsets))) {
+		return -EIO;
+	}
+
+	const uint32_t start = get_le32(&offsets[0]);
+	const uint32_t end = get_le32(&offsets[4]);
+
+	if (end < start || end - start > raw_len) {
+		QCA_ERROR("corrupted block %u: %u-%u", index, start, end);
+		return -EINVAL;
+	}
+
+	const uint32_t len = end - start;
+
+	if (len == raw_len) { /* stored */
+		if (!read_source(z, start, z->block, len)) {
+			return -EIO;
+		}
+	} else if (!read_source(z, start, z->packed, len) ||
+			decompress(z->packed, len, z->block, raw_len)) {
+		QCA_ERROR("failed to decompress block %u", index);
+		return -EINVAL;
+	}
+
+	z->cached = index;
+	z->cached_len = raw_len;
+
+	return 0;
+}
+
+size_t qca_nvmz_read(void *buf, size_t bufsize, void *ctx)
+{
+	struct qca_nvmz *z = (struct qca_nvmz *)ctx;
+	uint8_t *p = (uint8_t *)buf;
+	size_t total = 0;
+
+	while (total < bufsize && z->pos < z->size) {
+		const uint32_t index = z->pos / z->block_size;
+		const uint32_t offset = z->pos % z->block_size;
+
+		if (load_block(z, index) != 0) {
+			break;
+		}
+
+		const size_t len = MIN(bufsize - total,
+				(size_t)(z->cached_len - offset));
+
+		memcpy(&p[total], &z->block[offset], len);
+		total += len;
+		z->pos += (uint32_t)len;
+	}
+
+	return total;
+}
+
+int qca_nvmz_seek(struct qca_nvmz *z, uint32_t offset)
+{
+	if (offset > z->size) {
+		return -EINVAL;
+	}
+
+	z->pos = offset;
+
+	return 0;
+}
+
+size_t qca_nvmz_size(const struct qca_nvmz *z)
+{
+	return z->size;
+}
+
+struct qca_nvmz *qca_nvmz_create(qca_nvmz_source_t source, void *source_ctx)
+{
+	struct qca_nvmz_header hdr;
+
+	if (source == NULL ||
+			(*source)(0, &hdr, sizeof(hdr), source_ctx) !=
+			sizeof(hdr) ||
+			memcmp(hdr.magic, QCA_NVMZ_MAGIC, sizeof(hdr.magic))) {
+		return NULL;
+	}
+
+	const uint8_t *p = (const uint8_t *)&hdr;
+	const uint32_t size = get_le32(&p[4]);
+	const uint32_t block_size = get_le32(&p[8]);
+	const uint32_t nr_blocks = get_le32(&p[12]);
+
+	if (block_size == 0 || block_size > QCA_NVMZ_BLOCK_MAXLEN ||
+			nr_blocks != (uint32_t)(((uint64_t)size +
+					block_size - 1) / block_size)) {
+		QCA_ERROR("unsupported image: %u in %u", size, block_size);
+		return NULL;
+	}
+
+	struct qca_nvmz *z = (struct qca_nvmz *)qca_os_malloc(sizeof(*z));
+
+	if (z) {
+		memset(z, 0, sizeof(*z));
+		z->source = source;
+		z->source_ctx = source_ctx;
+		z->size = size;
+		z->block_size = block_size;
+		z->nr_blocks = nr_blocks;
+		z->cached = NO_BLOCK;
+	}
+
+	return z;
+}
+
+void qca_nvmz_destroy(struct qca_nvmz *z)
+{
+	qca_os_free(z);
+}
@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* The compressor of qca/nvmz.h, apart from the reader so that devices only
+ * reading images do not link it in. */
+
+#include "qca/nvmz.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define BLOCK_SIZE_MAX			0xffffU /* for 16-bit distances */
+#define LEN_EXTENDED			15U
+#define MIN_MATCH			4U
+#define HASH_BITS			12U
+
+struct output {
+	uint8_t *p;
+	size_t len;
+	size_t cap;
+};
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t hash(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return (v * 2654435761U) >> (32U - HASH_BITS);
+}
+
+static bool put(struct output *out, const void *data, size_t len)
+{
+	if (len > out->cap - out->len) {
+		return false;
+	}
+
+	memcpy(&out->p[out->len], data, len);
+	out->len += len;
+
+	return true;
+}
+
+static bool put_byte(struct output *out, uint8_t c)
+{
+	return put(out, &c, 1);
+}
+
+static bool put_len(struct output *out, size_t len)
+{
+	if (len < LEN_EXTENDED) {
+		return true;
+	}
+
+	for (len -= LEN_EXTENDED; len >= 255; len -= 255) {
+		if (!put_byte(out, 255)) {
+			return false;
+		}
+	}
+
+	return put_byte(out, (uint8_t)len);
+}
+
+static bool put_sequence(struct output *out,
+		const uint8_t *literals, size_t nr_literals,
+		size_t distance, size_t match_len)
+{
+	const size_t lit = nr_literals < LEN_EXTENDED?
+		nr_literals : LEN_EXTENDED;
+	const size_t mat = match_len == 0? 0 :
+		(match_len - MIN_MATCH < LEN_EXTENDED?
+			match_len - MIN_MATCH : LEN_EXTENDED);
+
+	if (!put_byte(out, (uint8_t)((lit << 4) | mat)) ||
+			!put_len(out, nr_literals) ||
+			!put(out, literals, nr_literals)) {
+		return false;
+	}
+
+	if (match_len == 0) {
+		return true;
+	}
+
+	const uint8_t d[2] = { (uint8_t)distance, (uint8_t)(distance >> 8) };
+
+	return put(out, d, sizeof(d)) && put_len(out, match_len - MIN_MATCH);
+}
+
+/* Greedy, with the last position of each hashed 4 bytes as the only
+ * candidate. Returns false if it does not come out smaller than the block. */
+static bool compress_block(const uint8_t *src, size_t len, struct output *out)
+{
+	int32_t last[1U << HASH_BITS];
+	size_t anchor = 0;
+	size_t i = 0;
+
+	memset(last, 0xff, sizeof(last));
+
+	while (i + MIN_MATCH <= len) {
+		const uint32_t h = hash(&src[i]);
+		const int32_t candidate = last[h];
+
+		last[h] = (int32_t)i;
+
+		if (candidate < 0 ||
+				memcmp(&src[candidate], &src[i], MIN_MATCH)) {
+			i++;
+			continue;
+		}
+
+		size_t match_len = MIN_MATCH;
+
+		while (i + match_len < len &&
+				src[(size_t)candidate + match_len] ==
+				src[i + match_len]) {
+			match_len++;
+		}
+
+		if (!put_sequence(out, &src[anchor], i - anchor,
+				i - (size_t)candidate, match_len)) {
+			return false;
+		}
+
+		i += match_len;
+		anchor = i;
+	}
+
+	if (anchor < len &&
+			!put_sequence(out, &src[anchor], len - anchor, 0, 0)) {
+		return false;
+	}
+
+	return true;
+}
+
+size_t qca_nvmz_bound(size_t image_len, size_t block_size)
+{
+	const size_t nr_blocks = block_size?
+		(image_len + block_size - 1) / block_size : 0;
+
+	return sizeof(struct qca_nvmz_header) + (nr_blocks + 1) * 4 +
+		image_len;
+}
+
+int qca_nvmz_compress(const void *image, size_t image_len, size_t block_size,
+		void *buf, size_t bufsize)
+{
+	const uint8_t *src = (const uint8_t *)image;
+	uint8_t *dst = (uint8_t *)buf;
+
+	if ((image == NULL && image_len) || buf == NULL ||
+			block_size == 0 || block_size > BLOCK_SIZE_MAX ||
+			image_len > UINT32_MAX) {
+		return -EINVAL;
+	}
+
+	const size_t nr_blocks = (image_len + block_size - 1) / block_size;
+	const size_t index_len = (nr_blocks + 1) * 4;
+	size_t len = sizeof(struct qca_nvmz_header) + index_len;
+
+	if (len > bufsize) {
+		return -ENOSPC;
+	}
+
+	memcpy(dst, QCA_NVMZ_MAGIC, 4);
+	put_le32(&dst[4], (uint32_t)image_len);
+	put_le32(&dst[8], (uint32_t)block_size);
+	put_le32(&dst[12], (uint32_t)nr_blocks);
+
+	for (size_t i = 0; i < nr_blocks; i++) {
+		const size_t offset = i * block_size;
+		const size_t raw_len = image_len - offset < block_size?
+			image_len - offset : block_size;
+		const size_t room = bufsize - len;
+		/* one byte short of the block so that it compresses or is
+		 * stored as is */
+		struct output out = {
+			.p = &dst[len],
+			.cap = room < raw_len? room : raw_len - 1,
+		};
+
+		put_le32(&dst[sizeof(struct qca_nvmz_header) + i * 4],
+				(uint32_t)len);
+
+		if (!compress_block(&src[offset], raw_len, &out)) {
+			if (raw_len > room) {
+				return -ENOSPC;
+			}
+			memcpy(&dst[len], &src[offset], raw_len);
+			out.len = raw_len;
+		}
+
+		len += out.len;
+	}
+
+	put_le32(&dst[sizeof(struct qca_nvmz_header) + nr_blocks * 4],
+			(uint32_t)len);
+
+	return len > INT32_MAX? -EOVERFLOW : (int)len;
+}
@@ -0,0 +1,201 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/os.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if !defined(QCA_OS_TIME_US)
+#include <time.h>
+#endif
+
+#if !defined(QCA_OS_PORT)
+uint64_t qca_os_now_us(void)
+{
+#if defined(QCA_OS_TIME_US)
+	return (uint64_t)QCA_OS_TIME_US();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+#endif
+}
+
+void *qca_os_malloc(size_t size)
+{
+#if defined(QCA_OS_MALLOC)
+	return QCA_OS_MALLOC(size);
+#else
+	return malloc(size);
+#endif
+}
+
+void qca_os_free(void *ptr)
+{
+#if defined(QCA_OS_FREE)
+	QCA_OS_FREE(ptr);
+#else
+	free(ptr);
+#endif
+}
+#endif /* !QCA_OS_PORT */
+
+#if defined(QCA_OS_PORT)
+/* provided by the port */
+#elif defined(QCA_OS_SPINLOCK) || defined(QCA_OS_IRQMASK) || \
+	defined(QCA_OS_NONE)
+#if !defined(QCA_OS_YIELD)
+#if defined(QCA_OS_SPINLOCK)
+#include <sched.h>
+#define QCA_OS_YIELD()		sched_yield()
+#else
+#define QCA_OS_YIELD()
+#endif
+#endif
+
+void qca_os_lock_init(qca_os_lock_t *lock)
+{
+	*lock = (qca_os_lock_t) { 0, };
+}
+
+void qca_os_lock_deinit(qca_os_lock_t *lock)
+{
+	(void)lock;
+}
+
+void qca_os_lock(qca_os_lock_t *lock)
+{
+#if defined(QCA_OS_SPINLOCK)
+	while (__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED)) {
+			/* spin on a plain load not to bounce the cache line */
+		}
+	}
+#elif defined(QCA_OS_IRQMASK)
+	lock->flags = (unsigned long)QCA_OS_IRQ_SAVE();
+#else
+	(void)lock;
+#endif
+}
+
+void qca_os_unlock(qca_os_lock_t *lock)
+{
+#if defined(QCA_OS_SPINLOCK)
+	__atomic_clear(&lock->locked, __ATOMIC_RELEASE);
+#elif defined(QCA_OS_IRQMASK)
+	QCA_OS_IRQ_RESTORE(lock->flags);
+#else
+	(void)lock;
+#endif
+}
+
+void qca_os_cond_init(qca_os_cond_t *cond)
+{
+	(void)cond;
+}
+
+void qca_os_cond_deinit(qca_os_cond_t *cond)
+{
+	(void)cond;
+}
+
+/* Nothing to block on. Letting go of the lock for a moment lets another
+ * thread, or with QCA_OS_IRQMASK a pending interrupt, make progress. It is
+ * not ISR-safe: called from an ISR, nothing else runs until it returns, so
+ * it only spins until the deadline, or forever without one. */
+int qca_os_cond_wait(qca_os_cond_t *cond, qca_os_lock_t *lock,
+		uint64_t deadline_us)
+{
+	(void)cond;
+
+	qca_os_unlock(lock);
+	QCA_OS_YIELD();
+	qca_os_lock(lock);
+
+	if (deadline_us && qca_os_now_us() >= deadline_us) {
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+void qca_os_cond_broadcast(qca_os_cond_t *cond)
+{
+	(void)cond;
+}
+#else /* pthread */
+void qca_os_lock_init(qca_os_lock_t *lock)
+{
+	pthread_mutex_init(lock, NULL);
+}
+
+void qca_os_lock_deinit(qca_os_lock_t *lock)
+{
+	pthread_mutex_destroy(lock);
+}
+
+void qca_os_lock(qca_os_lock_t *lock)
+{
+	pthread_mutex_lock(lock);
+}
+
+void qca_os_unlock(qca_os_lock_t *lock)
+{
+	pthread_mutex_unlock(lock);
+}
+
+void qca_os_cond_init(qca_os_cond_t *cond)
+{
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+void qca_os_cond_deinit(qca_os_cond_t *cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+int qca_os_cond_wait(qca_os_cond_t *cond, qca_os_lock_t *lock,
+		uint64_t deadline_us)
+{
+	if (deadline_us == 0) {
+		pthread_cond_wait(cond, lock);
+		return 0;
+	}
+
+#if defined(QCA_OS_TIME_US)
+	/* the condition variable runs on CLOCK_MONOTONIC, not on the
+	 * overridden clock. Convert the time left. */
+	const uint64_t now = qca_os_now_us();
+	const uint64_t left = deadline_us > now? deadline_us - now : 0;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const uint64_t abs_us = (uint64_t)ts.tv_sec * 1000000U +
+		(uint64_t)ts.tv_nsec / 1000U + left;
+#else
+	const uint64_t abs_us = deadline_us;
+	struct timespec ts;
+#endif
+	ts.tv_sec = (time_t)(abs_us / 1000000U);
+	ts.tv_nsec = (long)(abs_us % 1000000U) * 1000L;
+
+	if (pthread_cond_timedwait(cond, lock, &ts) == ETIMEDOUT) {
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+void qca_os_cond_broadcast(qca_os_cond_t *cond)
+{
+	pthread_cond_broadcast(cond);
+}
+#endif
@@ -0,0 +1,466 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/prov.h"
+#include "qca/qca.h"
+#include "qca/mme.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#define ETH_MINLEN			60U
+#define ETH_MAXLEN			1514U
+
+#define POLL_INTERVAL_NS		1000000L
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+struct runner {
+	const struct qca_prov_conf *conf;
+	const struct qca_prov_board *boards;
+	struct qca_prov_report *reports;
+	size_t nr_boards;
+	size_t next; /* the next board to take */
+};
+
+struct board {
+	const struct runner *runner;
+	size_t index;
+	struct qca_dev *dev;
+	struct qca_prov_report *report;
+
+	uint16_t expected; /* MMTYPE of the confirmation waited for */
+	bool received;
+	size_t cnf_len;
+	uint8_t cnf[ETH_MAXLEN]; /* body of the confirmation */
+	uint8_t rx[QCA_MAX_BUFSIZE];
+	uint8_t tx[ETH_MAXLEN];
+	uint8_t pib[];
+};
+
+static const uint8_t local_modem[6] = { 0x00, 0xB0, 0x52, 0x00, 0x00, 0x01 };
+
+static uint32_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000 +
+			(uint64_t)ts.tv_nsec / 1000000);
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx)
+{
+	struct board *b = (struct board *)ctx;
+	const uint8_t *p = (const uint8_t *)frame;
+
+	if (b->received || frame_size < QCA_MME_HEADER_LEN + QCA_MME_OUI_LEN ||
+			(((uint16_t)p[12] << 8) | p[13]) != QCA_MME_ETHERTYPE ||
+			get_le16(&p[15]) != b->expected) {
+		return;
+	}
+
+	b->cnf_len = MIN(frame_size - QCA_MME_HEADER_LEN - QCA_MME_OUI_LEN,
+			sizeof(b->cnf));
+	memcpy(b->cnf, &p[QCA_MME_HEADER_LEN + QCA_MME_OUI_LEN], b->cnf_len);
+	b->received = true;
+}
+
+static int send_request(struct board *b, qca_mmtype_t type,
+		const void *body, size_t body_len)
+{
+	uint8_t *frame = b->tx;
+	size_t len = qca_mme_put_header(frame, local_modem,
+			b->runner->conf->host_mac,
+			qca_mme_mmtype(type, QCA_MME_REQ));
+	len += qca_encode_mme((struct qca_mme *)&frame[len],
+			type, body, body_len);
+	if (len < ETH_MINLEN) {
+		memset(&frame[len], 0, ETH_MINLEN - len);
+		len = ETH_MINLEN;
+	}
+
+	return qca_dev_write_encoding(b->dev, frame, len);
+}
+
+static int wait_confirmation(struct board *b, uint32_t deadline)
+{
+	const struct timespec interval = { .tv_nsec = POLL_INTERVAL_NS };
+
+	while (!b->received) {
+		const int n = qca_dev_read(b->dev, b->rx, sizeof(b->rx));
+
+		if (n > 0) {
+			qca_dev_input(b->dev, b->rx, (size_t)n);
+			continue;
+		}
+		if (qca_mme_is_expired(now_ms(), deadline)) {
+			return -ETIMEDOUT;
+		}
+
+		nanosleep(&interval, NULL);
+	}
+
+	return 0;
+}
+
+/* Sends a request and waits for its confirmation, retrying on timeout.
+ * Returns the length of the confirmation body in b->cnf. */
+static int transact(struct board *b, qca_mmtype_t type,
+		const void *body, size_t body_len)
+{
+	const struct qca_prov_conf *conf = b->runner->conf;
+	int err = -ETIMEDOUT;
+
+	b->expected = qca_mme_mmtype(type, QCA_MME_CNF);
+
+	for (unsigned int i = 0; i <= conf->retries; i++) {
+		if (i > 0) {
+			b->report->retransmits++;
+		}
+
+		b->received = false;
+
+		if ((err = send_request(b, type, body, body_len)) < 0) {
+			continue;
+		}
+		if ((err = wait_confirmation(b, now_ms() + conf->timeout_ms))
+				== 0) {
+			return (int)b->cnf_len;
+		}
+	}
+
+	return err;
+}
+
+static int write_module(struct board *b, qca_prov_module_t module,
+		const uint8_t *data, size_t len)
+{
+	uint8_t req[sizeof(struct qca_mme_wr_mod) + QCA_PROV_CHUNK_MAXLEN];
+
+	for (size_t offset = 0; offset < len;) {
+		const uint16_t n = (uint16_t)MIN(len - offset,
+				QCA_PROV_CHUNK_MAXLEN);
+
+		memset(req, 0, sizeof(struct qca_mme_wr_mod));
+		req[offsetof(struct qca_mme_wr_mod, module_id)] =
+			(uint8_t)module;
+		put_le16(&req[offsetof(struct qca_mme_wr_mod, len)], n);
+		put_le32(&req[offsetof(struct qca_mme_wr_mod, offset)],
+				(uint32_t)offset);
+		put_le32(&req[offsetof(struct qca_mme_wr_mod, chksum)],
+				qca_calc_chksum(&data[offset], n, 0));
+		memcpy(&req[sizeof(struct qca_mme_wr_mod)], &data[offset], n);
+
+		const int rc = transact(b, QCA_MMTYPE_WR_MOD,
+				req, sizeof(struct qca_mme_wr_mod) + n);
+
+		if (rc < 0) {
+			return rc;
+		}
+		if ((size_t)rc < sizeof(struct qca_mme_wr_mod_cnf) ||
+				b->cnf[0] != 0 ||
+				get_le32(&b->cnf[offsetof(struct
+					qca_mme_wr_mod_cnf, offset)])
+				!= offset) {
+			QCA_ERROR("board %u: WR_MOD refused at %u",
+					b->index, offset);
+			return -EIO;
+		}
+
+		offset += n;
+		b->report->bytes_written += n;
+	}
+
+	return 0;
+}
+
+static int verify_module(struct board *b, qca_prov_module_t module,
+		const uint8_t *data, size_t len)
+{
+	const size_t hlen = sizeof(struct qca_mme_rd_mod_cnf);
+	uint8_t req[sizeof(struct qca_mme_rd_mod)];
+
+	for (size_t offset = 0; offset < len;) {
+		const uint16_t n = (uint16_t)MIN(len - offset,
+				QCA_PROV_CHUNK_MAXLEN);
+
+		memset(req, 0, sizeof(req));
+		req[offsetof(struct qca_mme_rd_mod, module_id)] =
+			(uint8_t)module;
+		put_le16(&req[offsetof(struct qca_mme_rd_mod, len)], n);
+		put_le32(&req[offsetof(struct qca_mme_rd_mod, offset)],
+				(uint32_t)offset);
+
+		const int rc = transact(b, QCA_MMTYPE_RD_MOD, req, sizeof(req));
+
+		if (rc < 0) {
+			return rc;
+		}
+		if ((size_t)rc < hlen + n || b->cnf[0] != 0 ||
+				get_le16(&b->cnf[offsetof(struct
+					qca_mme_rd_mod_cnf, len)]) != n ||
+				memcmp(&b->cnf[hlen], &data[offset], n)) {
+			QCA_ERROR("board %u: mismatch at %u", b->index, offset);
+			return -EIO;
+		}
+
+		offset += n;
+		b->report->bytes_verified += n;
+	}
+
+	return 0;
+}
+
+static int commit_module(struct board *b, qca_prov_module_t module)
+{
+	const struct qca_mme_mod_nvm req = { .module_id = (uint8_t)module };
+	const int rc = transact(b, QCA_MMTYPE_MOD_NVM, &req, sizeof(req));
+
+	if (rc < 0) {
+		return rc;
+	}
+	if ((size_t)rc < sizeof(struct qca_mme_mod_nvm_cnf) ||
+			b->cnf[0] != 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void enter(struct board *b, qca_prov_stage_t stage)
+{
+	const struct qca_prov_conf *conf = b->runner->conf;
+
+	b->report->stage = stage;
+
+	if (conf->on_stage) {
+		(*conf->on_stage)(b->index, stage, conf->on_stage_ctx);
+	}
+}
+
+static int provision(struct board *b, const struct qca_prov_board *board)
+{
+	const struct qca_prov_conf *conf = b->runner->conf;
+	uint16_t signature = 0;
+	int err;
+
+	enter(b, QCA_PROV_STAGE_ATTACH);
+	if ((b->dev = qca_dev_create(board->spi, NULL, on_frame, b)) == NULL) {
+		return -ENODEV;
+	}
+
+	enter(b, QCA_PROV_STAGE_SIGNATURE);
+	if ((err = qca_dev_read_reg(b->dev, QCA_REG_SIGNATURE, &signature))) {
+		return err;
+	}
+	if (signature != QCA_SIGNATURE) {
+		QCA_ERROR("board %u: signature %x", b->index, signature);
+		return -ENODEV;
+	}
+
+	enter(b, QCA_PROV_STAGE_PERSONALIZE);
+	memcpy(b->pib, conf->pib, conf->pib_len);
+	if ((err = qca_prov_personalize(b->pib, conf->pib_len, board))) {
+		return err;
+	}
+
+	enter(b, QCA_PROV_STAGE_UPLOAD);
+	if (conf->firmware && (err = write_module(b, QCA_PROV_MODULE_FIRMWARE,
+			(const uint8_t *)conf->firmware, conf->firmware_len))) {
+		return err;
+	}
+	if ((err = write_module(b, QCA_PROV_MODULE_PIB,
+			b->pib, conf->pib_len))) {
+		return err;
+	}
+
+	enter(b, QCA_PROV_STAGE_VERIFY);
+	if (conf->firmware && (err = verify_module(b, QCA_PROV_MODULE_FIRMWARE,
+			(const uint8_t *)conf->firmware, conf->firmware_len))) {
+		return err;
+	}
+	if ((err = verify_module(b, QCA_PROV_MODULE_PIB,
+			b->pib, conf->pib_len))) {
+		return err;
+	}
+
+	if (!conf->no_commit) {
+		enter(b, QCA_PROV_STAGE_COMMIT);
+		if (conf->firmware && (err = commit_module(b,
+				QCA_PROV_MODULE_FIRMWARE))) {
+			return err;
+		}
+		if ((err = commit_module(b, QCA_PROV_MODULE_PIB))) {
+			return err;
+		}
+	}
+
+	enter(b, QCA_PROV_STAGE_DONE);
+
+	return 0;
+}
+
+static void run_board(struct runner *r, size_t index)
+{
+	struct qca_prov_report *report = &r->reports[index];
+	struct board *b = (struct board *)calloc(1,
+			sizeof(*b) + r->conf->pib_len);
+	const uint32_t t0 = now_ms();
+
+	memset(report, 0, sizeof(*report));
+
+	if (b == NULL) {
+		report->err = -ENOMEM;
+		return;
+	}
+
+	b->runner = r;
+	b->index = index;
+	b->report = report;
+
+	report->err = provision(b, &r->boards[index]);
+	report->elapsed_ms = now_ms() - t0;
+
+	qca_dev_destroy(b->dev);
+	free(b);
+}
+
+static void *worker(void *arg)
+{
+	struct runner *r = (struct runner *)arg;
+	size_t index;
+
+	while ((index = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED))
+			< r->nr_boards) {
+		run_board(r, index);
+	}
+
+	return NULL;
+}
+
+int qca_prov_personalize(void *pib, size_t pib_len,
+		const struct qca_prov_board *board)
+{
+	if (pib == NULL || board == NULL || pib_len < sizeof(qca_nvm_pib_t)) {
+		return -EINVAL;
+	}
+
+	uint8_t *p = (uint8_t *)pib;
+	size_t len = get_le16(&p[offsetof(qca_nvm_pib_t, length)]);
+
+	if (len < sizeof(qca_nvm_pib_t) || len > pib_len) {
+		len = pib_len;
+	}
+
+	memcpy(&p[offsetof(qca_nvm_pib_t, mac)], board->mac, sizeof(board->mac));
+	memcpy(&p[offsetof(qca_nvm_pib_t, dak)], board->dak, sizeof(board->dak));
+	memcpy(&p[offsetof(qca_nvm_pib_t, nmk)], board->nmk, sizeof(board->nmk));
+
+	put_le32(&p[offsetof(qca_nvm_pib_t, checksum)], 0);
+	put_le32(&p[offsetof(qca_nvm_pib_t, checksum)],
+			qca_calc_chksum(p, len, 0));
+
+	return 0;
+}
+
+int qca_prov_run(const struct qca_prov_conf *conf,
+		const struct qca_prov_board *boards, size_t nr_boards,
+		struct qca_prov_report *reports)
+{
+	if (conf == NULL || conf->pib == NULL ||
+			conf->pib_len < sizeof(qca_nvm_pib_t) ||
+			(boards == NULL && nr_boards) ||
+			(reports == NULL && nr_boards)) {
+		return -EINVAL;
+	}
+
+	struct qca_prov_conf c = *conf;
+
+	if (c.workers == 0) {
+		c.workers = QCA_PROV_DEFAULT_WORKERS;
+	}
+	if (c.timeout_ms == 0) {
+		c.timeout_ms = QCA_PROV_DEFAULT_TIMEOUT_MS;
+	}
+	if (c.retries == 0) {
+		c.retries = QCA_PROV_DEFAULT_RETRIES;
+	}
+
+	struct runner r = {
+		.conf = &c,
+		.boards = boards,
+		.reports = reports,
+		.nr_boards = nr_boards,
+	};
+	const size_t nr_workers = MIN(c.workers, nr_boards);
+	pthread_t *threads = (pthread_t *)calloc(nr_workers? nr_workers : 1,
+			sizeof(*threads));
+	size_t started = 0;
+
+	if (threads == NULL) {
+		return -ENOMEM;
+	}
+
+	while (started < nr_workers &&
+			pthread_create(&threads[started], NULL, worker, &r) == 0) {
+		started++;
+	}
+
+	/* with no thread at all, the boards are run here one by one */
+	if (started == 0) {
+		worker(&r);
+	}
+
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+
+	int failed = 0;
+
+	for (size_t i = 0; i < nr_boards; i++) {
+		if (reports[i].err) {
+			failed++;
+		}
+	}
+
+	return failed;
+}
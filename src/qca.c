@@ -5,111 +5,307 @@
  */
 
 #include "qca/qca.h"
+#include "qca/stats.h"
+#include "qca/os.h"
 
 #include <errno.h>
 #include <string.h>
-#include <pthread.h>
-#include <stdlib.h>
 
 #include "libmcu/ringbuf.h"
 #include "libmcu/spi.h"
 
-#define QCA_RXQ_MAXSIZE		2048
 #define QCA_SPI_WRAPPER_LEN	10
 #define QCA_ETH_MAXLEN		1500
+#define QCA_RX_PREFIX_LEN	12 /* hw-generated frame length + SOF + PL + Ver */
+#define QCA_RX_POSTFIX_LEN	2 /* 0x5555 */
+#define QCA_RX_FRAME_MAXLEN	\
+	(QCA_RX_PREFIX_LEN + QCA_ETH_MAXLEN + QCA_RX_POSTFIX_LEN)
+#define QCA_RX_FRAME_MINLEN	\
+	(QCA_RX_PREFIX_LEN + QCA_MIN_PACKET_LEN + QCA_RX_POSTFIX_LEN)
+#define QCA_ACT_CTR_ATTACHED	2U
+#define QCA_INT_PKT_AVLBL	0x0001U
+#define QCA_INT_CPU_ON		0x0040U
+#define QCA_XFER_MAXLEN		(QCA_MAX_BUFSIZE - 2) /* but the command */
+
+#if !defined(ARRAY_COUNT)
+#define ARRAY_COUNT(x)		(sizeof(x) / sizeof((x)[0]))
+#endif
 
 #if !defined(MIN)
 #define MIN(a, b)		(((a) > (b))? (b) : (a))
 #endif
 
+#if !defined(MAX)
+#define MAX(a, b)		(((a) > (b))? (a) : (b))
+#endif
+
 #if !defined(QCA_ERROR)
 #define QCA_ERROR(...)
 #endif
 
-static struct {
+struct qca_dev {
 	struct lm_spi_device *spi;
 	struct ringbuf *rxq;
-	pthread_mutex_t transaction_lock;
+	struct {
+		size_t capacity;
+		size_t max_capacity;
+		size_t high_watermark;
+		size_t low_watermark;
+		struct qca_rxq_stats stats;
+		uint64_t last_read_us; /* 0 unless timestamping */
+		bool held; /* consumers behind. Frames are kept queued */
+		uint8_t frame[QCA_ETH_MAXLEN]; /* the frame being delivered */
+	} rx;
+	struct {
+		qca_os_lock_t lock;
+		qca_os_cond_t cond;
+		bool busy;
+		unsigned int waiting[QCA_PRIO_MAX];
+	} bus;
 	qca_handler_t cb;
 	void *cb_ctx;
-} m;
+	qca_tap_t tap;
+	void *tap_ctx;
+	qca_spi_trace_t tracer;
+	void *tracer_ctx;
+	qca_frame_meta_t meta;
+	void *meta_ctx;
+	struct qca_spi_profile profile; /* accessed with the bus held */
+	bool warm; /* attached to a modem left running */
+#if defined(QCA_STATIC)
+	struct ringbuf rxq_static;
+	uint8_t rxq_mem[QCA_STATIC_RXQ_SIZE];
+	bool used; /* keep it last not to be cleared on allocation */
+#endif
+};
 
-static int writeread(struct lm_spi_device *iface, const void *tx, size_t txsize,
-		void *rx, size_t rxsize)
+/* The instance behind the qca_*() calls that take no device */
+static struct qca_dev m;
+
+#if defined(QCA_STATIC)
+static struct qca_dev devs[QCA_STATIC_DEVICES];
+#endif
+
+static uint64_t now_us(void)
 {
-	return lm_spi_writeread(iface, tx, txsize, rx, rxsize);
+	return qca_os_now_us();
 }
 
-static uint16_t get_spi_frame_len(const void *frame, size_t frame_size)
+/* Frames are timestamped only when someone is looking, so that a build
+ * without statistics does not read the clock for nothing. */
+static bool is_timestamping(const struct qca_dev *d)
 {
-	if (frame_size < 6) {
-		return 0;
+#if defined(QCA_STATS)
+	(void)d;
+	return true;
+#else
+	return d->meta != NULL;
+#endif
+}
+
+static void record_rx_latency(const struct qca_frame_meta *meta)
+{
+#if defined(QCA_STATS)
+	if (meta->read_us) {
+		QCA_STATS_RECORD(QCA_STATS_HIST_RX_QUEUE,
+				meta->input_us - meta->read_us);
+		QCA_STATS_RECORD(QCA_STATS_HIST_RX_LATENCY,
+				meta->handler_us - meta->read_us);
+	}
+	QCA_STATS_RECORD(QCA_STATS_HIST_RX_HANDLER,
+			meta->done_us - meta->handler_us);
+#else
+	(void)meta;
+#endif
+}
+
+#if defined(QCA_STATS)
+static qca_stats_counter_t get_transaction_type(const void *tx)
+{
+	const uint8_t cmd = *(const uint8_t *)tx;
+	const bool read_req = (cmd & 0x80) != 0;
+
+	if (cmd & 0x40) { /* register address mode */
+		return read_req? QCA_STATS_SPI_REG_READ : QCA_STATS_SPI_REG_WRITE;
 	}
 
-	const uint8_t *p = (const uint8_t *)frame;
-	return (uint16_t)((uint16_t)p[5] << 8) | p[4];
+	return read_req? QCA_STATS_SPI_BUF_READ : QCA_STATS_SPI_BUF_WRITE;
 }
+#endif
 
-static bool validate_frame(const void *frame, size_t frame_size)
+static size_t gather(uint8_t *buf, size_t bufsize,
+		const struct qca_iovec *iov, size_t iovcnt)
 {
-	const uint8_t *p = (const uint8_t *)frame;
+	size_t len = 0;
 
-	if (frame_size < QCA_SPI_WRAPPER_LEN || frame_size > QCA_MAX_BUFSIZE) {
-		return false;
+	for (size_t i = 0; i < iovcnt; i++) {
+		if (iov[i].len > bufsize - len) {
+			return 0;
+		}
+		memcpy(&buf[len], iov[i].base, iov[i].len);
+		len += iov[i].len;
 	}
 
-	if ((p[0] != 0xaa) || ((p[0] ^ p[1] ^ p[2] ^ p[3]) != 0x00)) {
-		return false;
+	return len;
+}
+
+static int transfer(struct lm_spi_device *iface,
+		const struct qca_iovec *iov, size_t iovcnt,
+		void *rx, size_t rxsize)
+{
+#if defined(QCA_SPI_VECTORED)
+	return qca_spi_writev(iface, iov, iovcnt, rx, rxsize);
+#else
+	if (iovcnt == 1) {
+		return lm_spi_writeread(iface, iov[0].base, iov[0].len,
+				rx, rxsize);
 	}
 
-	uint16_t len = get_spi_frame_len(frame, frame_size);
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	const size_t len = gather(buf, sizeof(buf), iov, iovcnt);
 
-	if (len > QCA_ETH_MAXLEN ||
-			frame_size < (size_t)(len + QCA_SPI_WRAPPER_LEN)) {
-		return false;
+	if (len == 0) {
+		return -EINVAL;
 	}
 
-	if ((p[len + 8] != 0x55) || ((p[len + 8] ^ p[len + 9]) != 0x00)) {
-		return false;
+	return lm_spi_writeread(iface, buf, len, rx, rxsize);
+#endif
+}
+
+static void trace(struct qca_dev *d, const struct qca_iovec *iov, size_t iovcnt,
+		const void *rx, size_t rxsize, int err)
+{
+	if (iovcnt == 1) {
+		(*d->tracer)(iov[0].base, iov[0].len, rx, rxsize, err,
+				d->tracer_ctx);
+		return;
 	}
 
-	return true;
+	/* the tracer sees the transaction as it went on the wire */
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	const size_t len = gather(buf, sizeof(buf), iov, iovcnt);
+
+	(*d->tracer)(buf, len, rx, rxsize, err, d->tracer_ctx);
 }
 
-static size_t get_frame_size(const void *frame)
+static int writeread_vec(struct qca_dev *d,
+		const struct qca_iovec *iov, size_t iovcnt,
+		void *rx, size_t rxsize)
 {
-	uint16_t len = get_spi_frame_len(frame, 6);
-	size_t frame_size = len + QCA_SPI_WRAPPER_LEN;
+#if defined(QCA_STATS)
+	const uint64_t t0 = qca_stats_now_us();
+	const int err = transfer(d->spi, iov, iovcnt, rx, rxsize);
+
+	QCA_STATS_RECORD(QCA_STATS_HIST_SPI_LATENCY, qca_stats_now_us() - t0);
+	QCA_STATS_INC(get_transaction_type(iov[0].base));
+#else
+	const int err = transfer(d->spi, iov, iovcnt, rx, rxsize);
+#endif
+	if (d->tracer) {
+		trace(d, iov, iovcnt, rx, rxsize, err);
+	}
 
-	if (!validate_frame(frame, frame_size)) {
-		return 0;
+	return err;
+}
+
+static int writeread(struct qca_dev *d, const void *tx, size_t txsize,
+		void *rx, size_t rxsize)
+{
+	const struct qca_iovec iov = { .base = tx, .len = txsize };
+	return writeread_vec(d, &iov, 1, rx, rxsize);
+}
+
+static bool is_preceded(const struct qca_dev *d, qca_prio_t prio)
+{
+	for (int i = 0; i < (int)prio; i++) {
+		if (d->bus.waiting[i]) {
+			return true;
+		}
 	}
 
-	return frame_size;
+	return false;
 }
 
-static uint8_t *encode_spi_frame(uint8_t *buf, size_t bufsize, size_t datasize)
+/* The bus goes to the highest priority waiting once the current owner is
+ * done, so a TX never waits behind more than the request in flight. */
+static int lock_transaction(struct qca_dev *d, qca_prio_t prio,
+		uint32_t timeout_ms)
 {
-	if (datasize > QCA_ETH_MAXLEN ||
-			bufsize < datasize + QCA_SPI_WRAPPER_LEN + 2) {
-		QCA_ERROR("invalid parameters %u %u", datasize, bufsize);
-		return NULL;
+	const uint64_t deadline = timeout_ms?
+		qca_os_now_us() + (uint64_t)timeout_ms * 1000U : 0;
+	int err = 0;
+#if defined(QCA_STATS)
+	const uint64_t t0 = qca_stats_now_us();
+#endif
+
+	qca_os_lock(&d->bus.lock);
+	d->bus.waiting[prio]++;
+
+	while (d->bus.busy || is_preceded(d, prio)) {
+		if (qca_os_cond_wait(&d->bus.cond, &d->bus.lock, deadline)
+				== -ETIMEDOUT &&
+				(d->bus.busy || is_preceded(d, prio))) {
+			err = -ETIMEDOUT;
+			break;
+		}
 	}
 
-        /* The first two bytes are placeholders for the command */
-	buf[2] = 0xAA;
-	buf[3] = 0xAA;
-	buf[4] = 0xAA;
-	buf[5] = 0xAA;
-	buf[6] = (uint8_t)datasize; /* packet length */
-	buf[7] = (uint8_t)(datasize >> 8);
-	buf[8] = 0; /* protocol version */
-	buf[9] = 0;
-	/* ethernet frame */
-	buf[10 + datasize] = 0x55;
-	buf[11 + datasize] = 0x55;
+	d->bus.waiting[prio]--;
 
-	return &buf[10];
+	if (err) {
+		/* lower priorities may have been waiting behind this one */
+		qca_os_cond_broadcast(&d->bus.cond);
+	} else {
+		d->bus.busy = true;
+	}
+
+	qca_os_unlock(&d->bus.lock);
+
+#if defined(QCA_STATS)
+	const uint64_t elapsed = qca_stats_now_us() - t0;
+
+	if (err) {
+		QCA_STATS_INC(QCA_STATS_BUS_TIMEOUTS);
+	} else {
+		QCA_STATS_ADD(QCA_STATS_LOCK_WAIT_US, elapsed);
+		QCA_STATS_INC(QCA_STATS_LOCK_ACQUIRED);
+		QCA_STATS_RECORD((qca_stats_hist_t)
+				(QCA_STATS_HIST_BUS_WAIT_HIGH + prio), elapsed);
+	}
+#endif
+
+	return err;
+}
+
+static void unlock_transaction(struct qca_dev *d)
+{
+	qca_os_lock(&d->bus.lock);
+	d->bus.busy = false;
+	qca_os_cond_broadcast(&d->bus.cond);
+	qca_os_unlock(&d->bus.lock);
+}
+
+static int count_error(int err)
+{
+	if (err == -EAGAIN) {
+		QCA_STATS_INC(QCA_STATS_EAGAIN);
+	} else if (err == -EIO) {
+		QCA_STATS_INC(QCA_STATS_EIO);
+	}
+
+	return err;
+}
+
+static void encode_spi_header(uint8_t *hdr, size_t datasize)
+{
+	hdr[0] = 0xAA; /* start of frame */
+	hdr[1] = 0xAA;
+	hdr[2] = 0xAA;
+	hdr[3] = 0xAA;
+	hdr[4] = (uint8_t)datasize; /* packet length */
+	hdr[5] = (uint8_t)(datasize >> 8);
+	hdr[6] = 0; /* protocol version */
+	hdr[7] = 0;
 }
 
 static void encode_spi_request(uint8_t *cmd, qca_reg_t reg, bool read_req,
@@ -126,238 +322,894 @@ static void encode_spi_request(uint8_t *cmd, qca_reg_t reg, bool read_req,
 	}
 }
 
-static int read_register(struct lm_spi_device *iface,
+static int read_register(struct qca_dev *d,
 		qca_reg_t reg, uint16_t *value)
 {
 	uint8_t result[2];
 	uint8_t cmd[2];
 	encode_spi_request(cmd, reg, true, true);
-	int err = writeread(iface, cmd, sizeof(cmd), result, sizeof(result));
+	int err = writeread(d, cmd, sizeof(cmd), result, sizeof(result));
 	*value = (uint16_t)(((uint16_t)result[0] << 8) | result[1]);
 	return err;
 }
 
-static int write_register(struct lm_spi_device *iface,
+static int write_register(struct qca_dev *d,
 		qca_reg_t reg, uint16_t value)
 {
 	uint8_t cmd[4];
 	encode_spi_request(cmd, reg, false, true);
 	cmd[3] = (uint8_t)(value & 0xff);
 	cmd[2] = (uint8_t)(value >> 8);
-	return writeread(iface, cmd, sizeof(cmd), 0, 0);
+	return writeread(d, cmd, sizeof(cmd), 0, 0);
 }
 
-static int read_buffer_len(struct lm_spi_device *iface)
+static int read_buffer_len(struct qca_dev *d)
 {
 	uint16_t len = 0;
-	if (read_register(iface, QCA_REG_RDBUF_AVAILABLE, &len) == 0) {
+	if (read_register(d, QCA_REG_RDBUF_AVAILABLE, &len) == 0) {
 		return len;
 	}
 	return 0;
 }
 
-static int fetch_buffer(struct lm_spi_device *iface, uint16_t nr_to_write)
+static int fetch_buffer(struct qca_dev *d, uint16_t nr_to_write)
 {
 	uint8_t cmd[4];
 	encode_spi_request(cmd, QCA_REG_BUFSIZE, false, true);
 	cmd[2] = (uint8_t)(nr_to_write >> 8);
 	cmd[3] = (uint8_t)(nr_to_write & 0xff);
-	return writeread(iface, cmd, sizeof(cmd), 0, 0);
+	return writeread(d, cmd, sizeof(cmd), 0, 0);
 }
 
-static int read_buffer(struct lm_spi_device *iface,
+static int read_buffer(struct qca_dev *d,
 		void *buf, size_t expected_len)
 {
 	uint8_t cmd[2];
 	encode_spi_request(cmd, QCA_REG_BUFFER, true, false);
-	return writeread(iface, cmd, sizeof(cmd), buf, expected_len);
+	return writeread(d, cmd, sizeof(cmd), buf, expected_len);
 }
 
-static int write_buffer(struct lm_spi_device *iface,
-		void *data, size_t datasize)
+/* The command, then the header, the payload and the trailer of each frame
+ * go out as separate segments so that payloads are sent from where the
+ * caller keeps them. */
+static int write_buffer(struct qca_dev *d,
+		const struct qca_iovec *frames, size_t nr_frames)
 {
-	encode_spi_request((uint8_t *)data, QCA_REG_BUFFER, false, false);
-	return writeread(iface, data, datasize + 2, 0, 0);
+	static const uint8_t eof[QCA_RX_POSTFIX_LEN] = { 0x55, 0x55 };
+	uint8_t hdr[QCA_TX_COALESCE_MAX_FRAMES]
+		[QCA_SPI_WRAPPER_LEN - QCA_RX_POSTFIX_LEN];
+	struct qca_iovec iov[1 + QCA_TX_COALESCE_MAX_FRAMES * 3];
+	uint8_t cmd[2];
+	size_t iovcnt = 0;
+
+	encode_spi_request(cmd, QCA_REG_BUFFER, false, false);
+	iov[iovcnt++] = (struct qca_iovec) { .base = cmd, .len = sizeof(cmd) };
+
+	for (size_t i = 0; i < nr_frames; i++) {
+		encode_spi_header(hdr[i], frames[i].len);
+		iov[iovcnt++] = (struct qca_iovec) {
+			.base = hdr[i], .len = sizeof(hdr[i]) };
+		iov[iovcnt++] = frames[i];
+		iov[iovcnt++] = (struct qca_iovec) {
+			.base = eof, .len = sizeof(eof) };
+	}
+
+	return writeread_vec(d, iov, iovcnt, 0, 0);
 }
 
-static int write_to_qca(void *data, size_t datasize)
+/* Returns the number of frames written, taking as many as fit in both the
+ * chip write buffer and the coalescing budget. */
+static int write_to_qca(struct qca_dev *d,
+		const struct qca_iovec *frames, size_t nr_frames)
 {
-	if (!data || datasize == 0 || datasize > QCA_MAX_BUFSIZE) {
-		QCA_ERROR("invalid data %p %u", data, datasize);
-		return -EINVAL;
-	}
-
+	const size_t budget = d->profile.tx_coalesce;
+	size_t total = 0;
+	size_t n = 0;
 	int err;
 	uint16_t wrbuf = 0;
 
-	if ((err = read_register(m.spi, QCA_REG_WRBUF_AVAILABLE, &wrbuf)) ||
-			wrbuf < datasize) {
-		QCA_ERROR("failed to write %u bytes: %d, %u",
-				datasize, err, wrbuf);
+	if ((err = read_register(d, QCA_REG_WRBUF_AVAILABLE, &wrbuf))) {
+		QCA_ERROR("failed to read wrbuf: %d", err);
 		return -EIO;
 	}
 
-	if ((err = fetch_buffer(m.spi, (uint16_t)datasize)) == 0) {
-		err = write_buffer(m.spi, data, datasize);
+	nr_frames = MIN(nr_frames, QCA_TX_COALESCE_MAX_FRAMES);
+
+	for (; n < nr_frames; n++) {
+		const size_t frame_size = frames[n].len + QCA_SPI_WRAPPER_LEN;
+
+		if (total + frame_size > wrbuf ||
+				(n > 0 && total + frame_size > budget)) {
+			break;
+		}
+
+		total += frame_size;
 	}
 
-	return err;
+	if (n == 0) {
+		QCA_ERROR("failed to write %u bytes: %u",
+				frames[0].len + QCA_SPI_WRAPPER_LEN, wrbuf);
+		return -EIO;
+	}
+
+	if ((err = fetch_buffer(d, (uint16_t)total)) == 0) {
+		err = write_buffer(d, frames, n);
+	}
+
+	return err? err : (int)n;
 }
 
-int qca_read_reg(qca_reg_t reg, uint16_t *value)
+static size_t rxq_space(const struct qca_dev *d)
+{
+	return d->rx.capacity - ringbuf_length(d->rxq);
+}
+
+static bool grow_rxq(struct qca_dev *d, size_t required)
+{
+	size_t capacity = d->rx.capacity;
+
+	if (required <= capacity) {
+		return true;
+	}
+
+	while (capacity < required && capacity < d->rx.max_capacity) {
+		capacity = MIN(capacity * 2, d->rx.max_capacity);
+	}
+
+	if (capacity < required) {
+		return false;
+	}
+
+#if defined(QCA_STATIC)
+	return false; /* never reached as the queue is of the max size */
+#else
+	struct ringbuf *q = ringbuf_create(capacity);
+
+	if (q == NULL) {
+		QCA_ERROR("failed to grow rxq to %u", capacity);
+		return false;
+	}
+
+	uint8_t tmp[64];
+	size_t len;
+
+	/* qca_dev_read() may be looking at the queue from another thread */
+	qca_os_lock(&d->bus.lock);
+	while ((len = ringbuf_peek(d->rxq, 0, tmp, sizeof(tmp))) > 0) {
+		ringbuf_write(q, tmp, len);
+		ringbuf_consume(d->rxq, len);
+	}
+
+	ringbuf_destroy(d->rxq);
+	d->rxq = q;
+	d->rx.capacity = capacity;
+	d->rx.stats.grows++;
+	qca_os_unlock(&d->bus.lock);
+
+	return true;
+#endif
+}
+
+static size_t enqueue_rx(struct qca_dev *d, const uint8_t *data, size_t datasize)
+{
+	const size_t len = MIN(datasize, rxq_space(d));
+
+	if (len > 0 && ringbuf_write(d->rxq, data, len) != len) {
+		return 0;
+	}
+
+	d->rx.stats.peak = MAX(d->rx.stats.peak, ringbuf_length(d->rxq));
+
+	return len;
+}
+
+static void drop_rx(struct qca_dev *d, size_t len)
+{
+	ringbuf_consume(d->rxq, len);
+	d->rx.stats.overflow_drops += (uint32_t)len;
+}
+
+static bool is_rx_held(const struct qca_dev *d)
+{
+	return __atomic_load_n(&d->rx.held, __ATOMIC_ACQUIRE);
+}
+
+/* Makes room for len more bytes, growing the queue up to its max size. */
+static void reserve_rx(struct qca_dev *d, size_t len)
+{
+	const size_t required = MIN(ringbuf_length(d->rxq) + len,
+			d->rx.max_capacity);
+
+	if (required > d->rx.capacity) {
+		grow_rxq(d, required);
+	}
+}
+
+/* Delivers all complete frames in the queue, unless held. Returns -EAGAIN if
+ * a partial frame is left behind, 0 otherwise. */
+static int decapsulate(struct qca_dev *d, uint8_t *buf)
+{
+	while (ringbuf_length(d->rxq) > QCA_RX_PREFIX_LEN + QCA_RX_POSTFIX_LEN &&
+			!is_rx_held(d)) {
+		uint8_t p[QCA_RX_PREFIX_LEN];
+		ringbuf_peek(d->rxq, 0, p, sizeof(p));
+
+		const uint32_t frame_len = ((uint32_t)p[0] << 24) |
+			((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+		const uint8_t magic = p[4] ^ p[5] ^ p[6] ^ p[7];
+		const uint16_t ver = (uint16_t)((p[10] << 8) | p[11]);
+		const size_t packet_len = ((size_t)p[9] << 8) | p[8];
+		if (frame_len > QCA_MAX_BUFSIZE || packet_len > QCA_ETH_MAXLEN ||
+				p[4] != 0xaa || magic != 0 || ver != 0) {
+			ringbuf_consume(d->rxq, 1); /* drop one byte */
+			QCA_STATS_INC(QCA_STATS_RESYNC_DROPS);
+			continue;
+		}
+
+		const size_t required =
+			QCA_RX_PREFIX_LEN + packet_len + QCA_RX_POSTFIX_LEN;
+		if (required > ringbuf_length(d->rxq)) {
+			if (!grow_rxq(d, required)) {
+				/* never fits. resync from the next byte */
+				drop_rx(d, 1);
+				continue;
+			}
+			return -EAGAIN;
+		}
+
+		ringbuf_peek(d->rxq, QCA_RX_PREFIX_LEN, buf, packet_len);
+		ringbuf_consume(d->rxq, required);
+
+		QCA_STATS_INC(QCA_STATS_RX_FRAMES);
+		QCA_STATS_ADD(QCA_STATS_RX_BYTES, packet_len);
+
+		const bool stamping = is_timestamping(d);
+		struct qca_frame_meta meta = {
+			.dir = QCA_DIR_RX,
+			.read_us = d->rx.last_read_us,
+		};
+
+		if (stamping) {
+			meta.input_us = now_us();
+		}
+		if (d->tap) {
+			(*d->tap)(QCA_DIR_RX, buf, packet_len, d->tap_ctx);
+		}
+		if (stamping) {
+			meta.handler_us = now_us();
+		}
+		if (d->cb) {
+			(*d->cb)(buf, packet_len, d->cb_ctx);
+		}
+		if (stamping) {
+			meta.done_us = now_us();
+			record_rx_latency(&meta);
+		}
+		if (d->meta) {
+			(*d->meta)(buf, packet_len, &meta, d->meta_ctx);
+		}
+	}
+
+	return 0;
+}
+
+/* Returns true while the RX queue is above the high watermark, with
+ * hysteresis down to the low watermark. */
+static bool update_rx_backpressure(struct qca_dev *d)
+{
+	const size_t len = ringbuf_length(d->rxq);
+
+	if (d->rx.stats.throttled) {
+		if (len <= d->rx.low_watermark) {
+			d->rx.stats.throttled = false;
+		}
+	} else if (d->rx.high_watermark && len >= d->rx.high_watermark) {
+		d->rx.stats.throttled = true;
+		d->rx.stats.throttles++;
+	}
+
+	return d->rx.stats.throttled;
+}
+
+int qca_dev_read_reg(struct qca_dev *d, qca_reg_t reg, uint16_t *value)
 {
 	int err;
 
-	pthread_mutex_lock(&m.transaction_lock);
-	err = read_register(m.spi, reg, value);
-	pthread_mutex_unlock(&m.transaction_lock);
+	lock_transaction(d, QCA_PRIO_LOW, 0);
+	err = read_register(d, reg, value);
+	unlock_transaction(d);
 
 	return err;
 }
 
-int qca_write_reg(qca_reg_t reg, uint16_t value)
+int qca_dev_write_reg(struct qca_dev *d, qca_reg_t reg, uint16_t value)
 {
 	int err;
 
-	pthread_mutex_lock(&m.transaction_lock);
-	err = write_register(m.spi, reg, value);
-	pthread_mutex_unlock(&m.transaction_lock);
+	lock_transaction(d, QCA_PRIO_LOW, 0);
+	err = write_register(d, reg, value);
+	unlock_transaction(d);
 
 	return err;
 }
 
-int qca_clear_interrupt(void)
+int qca_dev_bus_submit(struct qca_dev *d,
+		struct qca_bus_op *ops, size_t nr_ops,
+		qca_prio_t prio, uint32_t timeout_ms)
 {
-	return qca_write_reg(QCA_REG_INT_SRC, 0xffff);
+	if (d == NULL || ops == NULL || nr_ops == 0 || prio >= QCA_PRIO_MAX) {
+		return -EINVAL;
+	}
+
+	int err = lock_transaction(d, prio, timeout_ms);
+
+	if (err) {
+		return err;
+	}
+
+	for (size_t i = 0; i < nr_ops && err == 0; i++) {
+		switch (ops[i].type) {
+		case QCA_BUS_OP_READ_REG:
+			err = read_register(d, ops[i].reg, &ops[i].value);
+			break;
+		case QCA_BUS_OP_WRITE_REG:
+			err = write_register(d, ops[i].reg, ops[i].value);
+			break;
+		default:
+			err = -EINVAL;
+			break;
+		}
+	}
+
+	unlock_transaction(d);
+
+	return count_error(err);
 }
 
-int qca_read(void *buf, size_t bufsize)
+int qca_dev_clear_interrupt(struct qca_dev *d)
 {
-	pthread_mutex_lock(&m.transaction_lock);
+	return qca_dev_write_reg(d, QCA_REG_INT_SRC, 0xffff);
+}
+
+int qca_dev_read(struct qca_dev *d, void *buf, size_t bufsize)
+{
+	lock_transaction(d, QCA_PRIO_NORMAL, 0);
 
 	int err = -EIO;
-	uint16_t len = (uint16_t)read_buffer_len(m.spi);
 
-	if (len == 0) {
-		err = 0;
+	/* the queue is swapped under the lock when qca_dev_input() grows it */
+	qca_os_lock(&d->bus.lock);
+	const bool throttled = update_rx_backpressure(d);
+	const size_t room = d->rx.max_capacity - ringbuf_length(d->rxq);
+	qca_os_unlock(&d->bus.lock);
+
+	if (throttled) {
+		err = -EBUSY;
 		goto out;
 	}
 
+	uint16_t len = (uint16_t)read_buffer_len(d);
+
 	len = MIN(len, (uint16_t)(bufsize-2));
+	len = (uint16_t)MIN(len, room);
+	if (d->profile.rx_chunk) {
+		len = MIN(len, d->profile.rx_chunk);
+	}
+
+	if (len == 0) {
+		err = 0;
+		goto out;
+	}
 
-	if (fetch_buffer(m.spi, len) == 0) {
-		if (read_buffer(m.spi, buf, len) == 0) {
+	if (fetch_buffer(d, len) == 0) {
+		if (read_buffer(d, buf, len) == 0) {
 			err = (int)len;
+			if (is_timestamping(d)) {
+				d->rx.last_read_us = now_us();
+			}
 		}
 	}
 
 out:
-	pthread_mutex_unlock(&m.transaction_lock);
-	return err;
+	unlock_transaction(d);
+	return count_error(err);
 }
 
-int qca_write_encoding(const void *data, size_t datasize)
+int qca_dev_write_frames_prio(struct qca_dev *d,
+		const struct qca_iovec *frames, size_t nr_frames,
+		qca_prio_t prio)
 {
-	uint8_t buf[QCA_MAX_BUFSIZE];
-	uint8_t *p = encode_spi_frame(buf, sizeof(buf), datasize);
-
-	if (!p) {
+	if (frames == NULL || nr_frames == 0 || prio >= QCA_PRIO_MAX) {
 		return -EINVAL;
 	}
 
-	memcpy(p, data, datasize);
+	for (size_t i = 0; i < nr_frames; i++) {
+		if (!frames[i].base || frames[i].len == 0 ||
+				frames[i].len > QCA_ETH_MAXLEN) {
+			QCA_ERROR("invalid data %p %u",
+					frames[i].base, frames[i].len);
+			return -EINVAL;
+		}
+	}
+
+	const bool stamping = is_timestamping(d);
+	struct qca_frame_meta meta = { .dir = QCA_DIR_TX, };
 
-	pthread_mutex_lock(&m.transaction_lock);
-	int err = write_to_qca(buf, get_frame_size(&buf[2]/*preserved cmd*/));
-	pthread_mutex_unlock(&m.transaction_lock);
+	if (stamping) {
+		meta.submit_us = now_us();
+	}
 
-	return err;
+	lock_transaction(d, prio, 0);
+	const int n = write_to_qca(d, frames, nr_frames);
+	if (stamping) {
+		meta.write_us = now_us();
+	}
+	unlock_transaction(d);
+
+	for (int i = 0; i < n; i++) {
+		QCA_STATS_INC(QCA_STATS_TX_FRAMES);
+		QCA_STATS_ADD(QCA_STATS_TX_BYTES, frames[i].len);
+		QCA_STATS_RECORD(QCA_STATS_HIST_TX_LATENCY,
+				meta.write_us - meta.submit_us);
+
+		if (d->tap) {
+			(*d->tap)(QCA_DIR_TX, frames[i].base, frames[i].len,
+					d->tap_ctx);
+		}
+		if (d->meta) {
+			(*d->meta)(frames[i].base, frames[i].len, &meta,
+					d->meta_ctx);
+		}
+	}
+
+	return count_error(n);
 }
 
-int qca_input(const void *instream, size_t instream_len)
+int qca_dev_write_frames(struct qca_dev *d,
+		const struct qca_iovec *frames, size_t nr_frames)
 {
-#define PREFIX_LEN	12 /* hw-generated frame length + SOF + PL + Ver */
-#define POSTFIX_LEN	2 /* 0x5555 */
-	uint8_t *buf = (uint8_t *)malloc(QCA_MAX_BUFSIZE);
+	return qca_dev_write_frames_prio(d, frames, nr_frames, QCA_PRIO_NORMAL);
+}
 
-	if (buf == NULL) {
-		QCA_ERROR("failed to allocate buffer");
-		return -ENOMEM;
+int qca_dev_write_encoding(struct qca_dev *d,
+		const void *data, size_t datasize)
+{
+	if (datasize > QCA_ETH_MAXLEN) {
+		QCA_ERROR("invalid parameters %u", datasize);
+		return -EINVAL;
 	}
 
-	ringbuf_write(m.rxq, instream, instream_len);
+	const struct qca_iovec frame = { .base = data, .len = datasize };
+	const int n = qca_dev_write_frames(d, &frame, 1);
 
-	while (ringbuf_length(m.rxq) > PREFIX_LEN + POSTFIX_LEN) {
-		uint8_t p[PREFIX_LEN];
-		ringbuf_peek(m.rxq, 0, p, sizeof(p));
+	return n < 0? n : 0;
+}
 
-		const uint32_t frame_len = (uint32_t)
-			((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
-		const uint8_t magic = p[4] ^ p[5] ^ p[6] ^ p[7];
-		const uint16_t ver = (uint16_t)((p[10] << 8) | p[11]);
-		if (frame_len > QCA_MAX_BUFSIZE ||
-				p[4] != 0xaa || magic != 0 || ver != 0) {
-			ringbuf_consume(m.rxq, 1); /* drop one byte */
-			continue;
-		}
+int qca_dev_input(struct qca_dev *d,
+		const void *instream, size_t instream_len)
+{
+	const uint8_t *p = (const uint8_t *)instream;
+	int err;
 
-		const size_t packet_len = ((size_t)p[9] << 8) | p[8];
-		const size_t received_len = ringbuf_length(m.rxq);
-		if (packet_len > received_len - PREFIX_LEN - POSTFIX_LEN) {
-			return -EAGAIN;
+	/* Feed the queue in chunks it can hold, delivering complete frames in
+	 * between, so that a burst of frames larger than the queue is not
+	 * truncated. While consumers hold the frames back, the queue grows to
+	 * keep them instead. */
+	do {
+		if (is_rx_held(d)) {
+			reserve_rx(d, instream_len);
 		}
 
-		ringbuf_read(m.rxq, PREFIX_LEN, buf, packet_len);
-		ringbuf_consume(m.rxq, PREFIX_LEN + packet_len + POSTFIX_LEN);
+		const size_t len = enqueue_rx(d, p, instream_len);
 
-		if (m.cb) {
-			(*m.cb)(buf, packet_len, m.cb_ctx);
+		p += len;
+		instream_len -= len;
+		err = decapsulate(d, d->rx.frame);
+
+		if (len == 0 && instream_len > 0) {
+			QCA_ERROR("rxq overflow: %u bytes dropped", instream_len);
+			d->rx.stats.overflow_drops += (uint32_t)instream_len;
+			break;
 		}
+	} while (instream_len > 0);
+
+	return count_error(err);
+}
+
+int qca_dev_get_rxq_stats(struct qca_dev *d, struct qca_rxq_stats *stats)
+{
+	if (d == NULL || stats == NULL) {
+		return -EINVAL;
 	}
 
-	free(buf);
+	qca_os_lock(&d->bus.lock);
+	*stats = d->rx.stats;
+	stats->capacity = d->rx.capacity;
+	stats->length = d->rxq? ringbuf_length(d->rxq) : 0;
+	qca_os_unlock(&d->bus.lock);
 
 	return 0;
 }
 
-int qca_reset(void)
+void qca_dev_hold_rx(struct qca_dev *d, bool hold)
 {
-	return qca_write_reg(QCA_REG_SPI_CONFIG, 0x40);
+	__atomic_store_n(&d->rx.held, hold, __ATOMIC_RELEASE);
 }
 
-int qca_init(struct lm_spi_device *spi_iface,
-		qca_handler_t handler, void *handler_ctx)
+void qca_dev_set_tap(struct qca_dev *d, qca_tap_t tap, void *tap_ctx)
+{
+	d->tap_ctx = tap_ctx;
+	d->tap = tap;
+}
+
+void qca_dev_set_spi_trace(struct qca_dev *d,
+		qca_spi_trace_t tracer, void *tracer_ctx)
+{
+	d->tracer_ctx = tracer_ctx;
+	d->tracer = tracer;
+}
+
+void qca_dev_set_frame_meta(struct qca_dev *d,
+		qca_frame_meta_t meta, void *meta_ctx)
+{
+	d->meta_ctx = meta_ctx;
+	d->meta = meta;
+
+	if (meta == NULL && !is_timestamping(d)) {
+		d->rx.last_read_us = 0;
+	}
+}
+
+/* Transfer sizes to time, the command left out */
+static const uint16_t probe_sizes[] = {
+	16, 32, 64, 128, 256, 512, 1024, QCA_XFER_MAXLEN,
+};
+
+/* Times a register read clocked out to len bytes. Only the first two carry
+ * the register, the rest are there for the timing. */
+static int probe(struct qca_dev *d, uint8_t *buf, size_t len, uint64_t *ns)
 {
-	m.cb = handler;
-	m.cb_ctx = handler_ctx;
-	m.spi = spi_iface;
-	m.rxq = ringbuf_create(QCA_RXQ_MAXSIZE);
+	uint8_t cmd[2];
+	encode_spi_request(cmd, QCA_REG_SIGNATURE, true, true);
 
-	pthread_mutex_init(&m.transaction_lock, NULL);
+	lock_transaction(d, QCA_PRIO_LOW, 0);
+	const uint64_t t0 = now_us();
+	int err = writeread(d, cmd, sizeof(cmd), buf, len);
+	/* below the clock resolution counts as a tick */
+	*ns = MAX(now_us() - t0, 1U) * 1000U;
+	unlock_transaction(d);
+
+	if (err == 0 && (((uint16_t)buf[0] << 8) | buf[1]) != QCA_SIGNATURE) {
+		err = -EIO;
+	}
+
+	return err;
+}
+
+/* Least squares fit of ns = transaction_ns + byte_ns * bytes */
+static void fit_cost(const uint64_t *ns, struct qca_spi_profile *profile)
+{
+	const int64_t n = (int64_t)ARRAY_COUNT(probe_sizes);
+	int64_t sx = 0;
+	int64_t sy = 0;
+	int64_t sxx = 0;
+	int64_t sxy = 0;
+
+	for (size_t i = 0; i < ARRAY_COUNT(probe_sizes); i++) {
+		const int64_t x = probe_sizes[i] + 2; /* with the command */
+		const int64_t y = (int64_t)ns[i];
+
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+
+	const int64_t den = n * sxx - sx * sx;
+	const int64_t b = MAX((n * sxy - sx * sy + den / 2) / den, 0);
+	const int64_t a = MAX((sy - b * sx) / n, 0);
+
+	profile->transaction_ns = (uint32_t)MIN(a, UINT32_MAX);
+	profile->byte_ns = (uint32_t)MIN(b, UINT32_MAX);
+}
+
+/* The most bytes a transfer carries within the latency budget by the
+ * fitted cost, the command aside */
+static size_t fit_budget(const struct qca_spi_profile *profile)
+{
+	const uint64_t budget_ns = (uint64_t)QCA_CALIBRATION_BUDGET_US * 1000U;
+
+	if (profile->transaction_ns >= budget_ns) {
+		return 0;
+	}
+	if (profile->byte_ns == 0) {
+		return QCA_XFER_MAXLEN;
+	}
+
+	const uint64_t n =
+		(budget_ns - profile->transaction_ns) / profile->byte_ns;
+
+	return n > 2? (size_t)MIN(n - 2, QCA_XFER_MAXLEN) : 0;
+}
+
+int qca_dev_calibrate(struct qca_dev *d, struct qca_spi_profile *profile)
+{
+	uint8_t buf[QCA_XFER_MAXLEN];
+	uint64_t ns[ARRAY_COUNT(probe_sizes)];
+	struct qca_spi_profile p = { 0, };
+	uint16_t wrbuf = 0;
+	int err;
+
+	for (size_t i = 0; i < ARRAY_COUNT(probe_sizes); i++) {
+		ns[i] = UINT64_MAX;
+
+		for (unsigned int r = 0; r < QCA_CALIBRATION_ROUNDS; r++) {
+			uint64_t t;
+
+			if ((err = probe(d, buf, probe_sizes[i], &t))) {
+				QCA_ERROR("calibration failed at %u: %d",
+						probe_sizes[i], err);
+				return count_error(err);
+			}
+
+			ns[i] = MIN(ns[i], t);
+		}
+	}
+
+	if ((err = qca_dev_read_reg(d, QCA_REG_WRBUF_AVAILABLE, &wrbuf))) {
+		return err;
+	}
+
+	fit_cost(ns, &p);
+
+	const size_t budget = fit_budget(&p);
+
+	/* a frame is not worth splitting to keep the bus free */
+	p.rx_chunk = (uint16_t)MAX(budget, QCA_RX_FRAME_MINLEN);
+	p.tx_coalesce = budget >= 2 * (QCA_MIN_PACKET_LEN + QCA_SPI_WRAPPER_LEN)?
+		(uint16_t)budget : 0;
+	p.rdbuf_watermark = QCA_RX_FRAME_MINLEN;
+
+	/* room for a whole coalesced write, or the largest frame if more */
+	const size_t batch = MAX(p.tx_coalesce,
+			QCA_ETH_MAXLEN + QCA_SPI_WRAPPER_LEN);
+	p.wrbuf_watermark = wrbuf > batch? (uint16_t)(wrbuf - batch) : 0;
+
+	if ((err = qca_dev_set_spi_profile(d, &p)) == 0 && profile) {
+		qca_dev_get_spi_profile(d, profile);
+	}
+
+	return err;
+}
 
+int qca_dev_set_spi_profile(struct qca_dev *d,
+		const struct qca_spi_profile *profile)
+{
+	struct qca_spi_profile p = { 0, };
 	int err = 0;
-#if !defined(UNIT_TEST)
-	uint16_t signature;
-	err |= qca_read_reg(QCA_REG_SIGNATURE, &signature);
-
-	if (signature != QCA_SIGNATURE || err) {
-		err |= qca_read_reg(QCA_REG_SIGNATURE, &signature);
-		if (signature != QCA_SIGNATURE || err) {
-			QCA_ERROR("QCA700x not found(%d): %x", err, signature);
-			return -ENODEV;
+
+	if (profile) {
+		p = *profile;
+		p.rx_chunk = (uint16_t)MIN(p.rx_chunk, QCA_XFER_MAXLEN);
+		p.tx_coalesce = (uint16_t)MIN(p.tx_coalesce, QCA_XFER_MAXLEN);
+	}
+
+	lock_transaction(d, QCA_PRIO_LOW, 0);
+
+	if (p.rdbuf_watermark) {
+		err = write_register(d,
+				QCA_REG_RDBUF_WATERMARK, p.rdbuf_watermark);
+	}
+	if (err == 0 && p.wrbuf_watermark) {
+		err = write_register(d,
+				QCA_REG_WRBUF_WATERMARK, p.wrbuf_watermark);
+	}
+	if (err == 0) {
+		d->profile = p;
+	}
+
+	unlock_transaction(d);
+
+	return count_error(err);
+}
+
+int qca_dev_get_spi_profile(const struct qca_dev *d,
+		struct qca_spi_profile *profile)
+{
+	if (d == NULL || profile == NULL) {
+		return -EINVAL;
+	}
+
+	*profile = d->profile;
+
+	return 0;
+}
+
+bool qca_dev_is_warm(const struct qca_dev *d)
+{
+	return d->warm;
+}
+
+int qca_dev_reset(struct qca_dev *d)
+{
+	return qca_dev_write_reg(d, QCA_REG_SPI_CONFIG, 0x40);
+}
+
+#if !defined(QCA_STATIC)
+static size_t round_up_pow2(size_t n)
+{
+	size_t v = 1;
+	while (v < n) {
+		v <<= 1;
+	}
+	return v;
+}
+#endif
+
+static void apply_rxq_conf(struct qca_dev *d, const struct qca_conf *conf)
+{
+	size_t size = QCA_RXQ_DEFAULT_SIZE;
+	size_t max_size = 0;
+	size_t high = 0;
+	size_t low = 0;
+
+	if (conf) {
+		size = conf->rxq_size? conf->rxq_size : size;
+		max_size = conf->rxq_max_size;
+		high = conf->rxq_high_watermark;
+		low = conf->rxq_low_watermark;
+	}
+
+#if defined(QCA_STATIC)
+	/* the queue is fixed at its static size */
+	size = max_size = QCA_STATIC_RXQ_SIZE;
+#else
+	/* ringbuf takes power of 2 sizes only */
+	size = round_up_pow2(size);
+	max_size = round_up_pow2(MAX(size, max_size));
+#endif
+	high = high? MIN(high, max_size) : max_size * 3 / 4;
+	low = low? low : high / 2;
+
+	/* Neither watermark may be crossed by a single partial frame alone.
+	 * Otherwise the queue would be throttled waiting for bytes that only
+	 * the throttled read can bring in. */
+	low = MAX(low, QCA_RX_FRAME_MAXLEN);
+	high = MAX(high, low);
+
+	memset(&d->rx, 0, sizeof(d->rx));
+	d->rx.capacity = size;
+	d->rx.max_capacity = max_size;
+	d->rx.high_watermark = high;
+	d->rx.low_watermark = low;
+}
+
+static struct ringbuf *create_rxq(struct qca_dev *d)
+{
+#if defined(QCA_STATIC)
+	if (!ringbuf_create_static(&d->rxq_static,
+			d->rxq_mem, sizeof(d->rxq_mem))) {
+		return NULL;
+	}
+	return &d->rxq_static;
+#else
+	return ringbuf_create(d->rx.capacity);
+#endif
+}
+
+static void destroy_rxq(struct qca_dev *d)
+{
+#if !defined(QCA_STATIC)
+	ringbuf_destroy(d->rxq);
+#else
+	(void)d;
+#endif
+}
+
+static struct qca_dev *alloc_dev(void)
+{
+#if defined(QCA_STATIC)
+	for (size_t i = 0; i < QCA_STATIC_DEVICES; i++) {
+		if (!__atomic_test_and_set(&devs[i].used, __ATOMIC_ACQUIRE)) {
+			memset(&devs[i], 0, offsetof(struct qca_dev, used));
+			return &devs[i];
 		}
 	}
+	return NULL;
+#else
+	struct qca_dev *d = (struct qca_dev *)qca_os_malloc(sizeof(*d));
 
-	err |= qca_write_reg(QCA_REG_ACT_CTR, 2);
-	err |= qca_write_reg(QCA_REG_INT_ENABLE,
-			0x41/*cpu_on and packet_available*/);
+	if (d) {
+		memset(d, 0, sizeof(*d));
+	}
+
+	return d;
+#endif
+}
 
-        /* Clear any interrupts that occurred before system initialization to
-         * avoid missing them. */
-	uint16_t intsrc;
-	err |= qca_read_reg(QCA_REG_INT_SRC, &intsrc);
-	err |= qca_write_reg(QCA_REG_INT_SRC, intsrc);
+static void free_dev(struct qca_dev *d)
+{
+#if defined(QCA_STATIC)
+	__atomic_clear(&d->used, __ATOMIC_RELEASE);
+#else
+	qca_os_free(d);
 #endif
+}
+
+/* Checks the signature, with a retry, and sets the chip up in one bus grant.
+ * When warm attaching, a modem that still has the ACT_CTR of an earlier run
+ * and has not raised CPU_ON since, i.e. has not rebooted, is left as is but
+ * for the interrupts. */
+static int setup_chip(struct qca_dev *d, bool warm_attach)
+{
+	uint16_t signature = 0;
+	uint16_t act_ctr = 0;
+	uint16_t intsrc = 0;
+	int err;
+
+	d->warm = false;
+	lock_transaction(d, QCA_PRIO_LOW, 0);
+
+	if ((err = read_register(d, QCA_REG_SIGNATURE, &signature)) ||
+			signature != QCA_SIGNATURE) {
+		err = read_register(d, QCA_REG_SIGNATURE, &signature);
+	}
+	if (err || signature != QCA_SIGNATURE) {
+		unlock_transaction(d);
+		QCA_ERROR("QCA700x not found(%d): %x", err, signature);
+		return -ENODEV;
+	}
+
+	if (warm_attach) {
+		err |= read_register(d, QCA_REG_ACT_CTR, &act_ctr);
+	}
+	err |= read_register(d, QCA_REG_INT_SRC, &intsrc);
+
+	d->warm = warm_attach && err == 0 &&
+		act_ctr == QCA_ACT_CTR_ATTACHED && !(intsrc & QCA_INT_CPU_ON);
+
+	if (!d->warm) {
+		err |= write_register(d, QCA_REG_ACT_CTR, QCA_ACT_CTR_ATTACHED);
+	}
+	/* Frames received before a warm attach are still in the read buffer,
+	 * so their PKT_AVLBL is left pending for the line to announce them. */
+	if (d->warm) {
+		intsrc &= (uint16_t)~QCA_INT_PKT_AVLBL;
+	}
+
+	err |= write_register(d, QCA_REG_INT_ENABLE,
+			QCA_INT_CPU_ON | QCA_INT_PKT_AVLBL);
+	/* Clear any interrupts that occurred before system initialization to
+	 * avoid missing them. */
+	err |= write_register(d, QCA_REG_INT_SRC, intsrc);
+
+	unlock_transaction(d);
+
+	return err;
+}
+
+static int init(struct qca_dev *d, struct lm_spi_device *spi_iface,
+		const struct qca_conf *conf,
+		qca_handler_t handler, void *handler_ctx)
+{
+	apply_rxq_conf(d, conf);
+
+	d->cb = handler;
+	d->cb_ctx = handler_ctx;
+	d->spi = spi_iface;
+	memset(&d->profile, 0, sizeof(d->profile));
+
+	if ((d->rxq = create_rxq(d)) == NULL) {
+		QCA_ERROR("failed to allocate rxq");
+		return -ENOMEM;
+	}
+
+	qca_os_cond_init(&d->bus.cond);
+	qca_os_lock_init(&d->bus.lock);
+	d->bus.busy = false;
+	memset(d->bus.waiting, 0, sizeof(d->bus.waiting));
+
+	const int err = setup_chip(d, conf && conf->warm_attach);
 
 	if (err) {
 		QCA_ERROR("QCA700x init failed(%d)", err);
@@ -366,8 +1218,156 @@ int qca_init(struct lm_spi_device *spi_iface,
 	return err;
 }
 
+static void deinit(struct qca_dev *d)
+{
+	qca_os_cond_deinit(&d->bus.cond);
+	qca_os_lock_deinit(&d->bus.lock);
+	destroy_rxq(d);
+	d->rxq = NULL;
+}
+
+struct qca_dev *qca_dev_create(struct lm_spi_device *spi_iface,
+		const struct qca_conf *conf,
+		qca_handler_t handler, void *handler_ctx)
+{
+	struct qca_dev *d = alloc_dev();
+
+	if (d == NULL) {
+		return NULL;
+	}
+
+	const int err = init(d, spi_iface, conf, handler, handler_ctx);
+
+	if (err) {
+		if (err != -ENOMEM) {
+			deinit(d);
+		}
+		free_dev(d);
+		return NULL;
+	}
+
+	return d;
+}
+
+void qca_dev_destroy(struct qca_dev *dev)
+{
+	if (dev) {
+		deinit(dev);
+		free_dev(dev);
+	}
+}
+
+int qca_init_with_conf(struct lm_spi_device *spi_iface,
+		const struct qca_conf *conf,
+		qca_handler_t handler, void *handler_ctx)
+{
+	return init(&m, spi_iface, conf, handler, handler_ctx);
+}
+
+int qca_init(struct lm_spi_device *spi_iface,
+		qca_handler_t handler, void *handler_ctx)
+{
+	return qca_init_with_conf(spi_iface, NULL, handler, handler_ctx);
+}
+
 void qca_deinit(void)
 {
-	pthread_mutex_destroy(&m.transaction_lock);
-	ringbuf_destroy(m.rxq);
+	deinit(&m);
+}
+
+int qca_reset(void)
+{
+	return qca_dev_reset(&m);
+}
+
+int qca_read_reg(qca_reg_t reg, uint16_t *value)
+{
+	return qca_dev_read_reg(&m, reg, value);
+}
+
+int qca_write_reg(qca_reg_t reg, uint16_t value)
+{
+	return qca_dev_write_reg(&m, reg, value);
+}
+
+int qca_bus_submit(struct qca_bus_op *ops, size_t nr_ops,
+		qca_prio_t prio, uint32_t timeout_ms)
+{
+	return qca_dev_bus_submit(&m, ops, nr_ops, prio, timeout_ms);
+}
+
+int qca_clear_interrupt(void)
+{
+	return qca_dev_clear_interrupt(&m);
+}
+
+int qca_read(void *buf, size_t bufsize)
+{
+	return qca_dev_read(&m, buf, bufsize);
+}
+
+int qca_input(const void *instream, size_t instream_len)
+{
+	return qca_dev_input(&m, instream, instream_len);
+}
+
+int qca_write_encoding(const void *data, size_t datasize)
+{
+	return qca_dev_write_encoding(&m, data, datasize);
+}
+
+int qca_write_frames(const struct qca_iovec *frames, size_t nr_frames)
+{
+	return qca_dev_write_frames(&m, frames, nr_frames);
+}
+
+int qca_write_frames_prio(const struct qca_iovec *frames, size_t nr_frames,
+		qca_prio_t prio)
+{
+	return qca_dev_write_frames_prio(&m, frames, nr_frames, prio);
+}
+
+int qca_calibrate(struct qca_spi_profile *profile)
+{
+	return qca_dev_calibrate(&m, profile);
+}
+
+int qca_set_spi_profile(const struct qca_spi_profile *profile)
+{
+	return qca_dev_set_spi_profile(&m, profile);
+}
+
+int qca_get_spi_profile(struct qca_spi_profile *profile)
+{
+	return qca_dev_get_spi_profile(&m, profile);
+}
+
+bool qca_is_warm(void)
+{
+	return qca_dev_is_warm(&m);
+}
+
+int qca_get_rxq_stats(struct qca_rxq_stats *stats)
+{
+	return qca_dev_get_rxq_stats(&m, stats);
+}
+
+void qca_hold_rx(bool hold)
+{
+	qca_dev_hold_rx(&m, hold);
+}
+
+void qca_set_tap(qca_tap_t tap, void *tap_ctx)
+{
+	qca_dev_set_tap(&m, tap, tap_ctx);
+}
+
+void qca_set_spi_trace(qca_spi_trace_t tracer, void *tracer_ctx)
+{
+	qca_dev_set_spi_trace(&m, tracer, tracer_ctx);
+}
+
+void qca_set_frame_meta(qca_frame_meta_t meta, void *meta_ctx)
+{
+	qca_dev_set_frame_meta(&m, meta, meta_ctx);
 }
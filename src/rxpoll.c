@@ -0,0 +1,268 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/rxpoll.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define INT_PKT_AVLBL			0x0001U
+
+/* The budget is checked between reads, so a round overshoots it by what a
+ * read of this size holds at most. */
+#define READ_BUFSIZE			QCA_MAX_BUFSIZE
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+struct qca_rxpoll {
+	struct qca_rxpoll_conf conf;
+	uint8_t buf[READ_BUFSIZE];
+
+	uint16_t delivered; /* in the current round */
+	uint8_t idle; /* empty rounds in a row */
+
+	struct qca_rxpoll_stats stats;
+};
+
+static int submit(struct qca_dev *dev,
+		struct qca_bus_op *ops, size_t nr_ops)
+{
+	if (dev) {
+		return qca_dev_bus_submit(dev, ops, nr_ops,
+				QCA_PRIO_NORMAL, 0);
+	}
+
+	return qca_bus_submit(ops, nr_ops, QCA_PRIO_NORMAL, 0);
+}
+
+static int read_frames(struct qca_rxpoll *rx, struct qca_dev *dev)
+{
+	if (dev) {
+		return qca_dev_read(dev, rx->buf, sizeof(rx->buf));
+	}
+
+	return qca_read(rx->buf, sizeof(rx->buf));
+}
+
+static int input(struct qca_rxpoll *rx, struct qca_dev *dev, size_t len)
+{
+	if (dev) {
+		return qca_dev_input(dev, rx->buf, len);
+	}
+
+	return qca_input(rx->buf, len);
+}
+
+static int write_reg(struct qca_dev *dev, qca_reg_t reg, uint16_t value)
+{
+	struct qca_bus_op op = {
+		.type = QCA_BUS_OP_WRITE_REG,
+		.reg = reg,
+		.value = value,
+	};
+
+	return submit(dev, &op, 1);
+}
+
+/* The sources are acknowledged by the mask rather than by the value read,
+ * so that it all goes in one bus grant. A source raised between the read
+ * and the acknowledgement, a register access apart, is lost; a frame is
+ * picked up by polling anyway. */
+static int mask_and_ack(struct qca_rxpoll *rx, struct qca_dev *dev,
+		uint16_t *int_src)
+{
+	struct qca_bus_op ops[] = {
+		{ .type = QCA_BUS_OP_WRITE_REG, .reg = QCA_REG_INT_ENABLE,
+			.value = (uint16_t)(rx->conf.int_mask &
+					~INT_PKT_AVLBL) },
+		{ .type = QCA_BUS_OP_READ_REG, .reg = QCA_REG_INT_SRC, },
+		{ .type = QCA_BUS_OP_WRITE_REG, .reg = QCA_REG_INT_SRC,
+			.value = (uint16_t)(rx->conf.int_mask |
+					INT_PKT_AVLBL) },
+	};
+	const int err = submit(dev, ops, sizeof(ops) / sizeof(*ops));
+
+	if (err == 0) {
+		*int_src = ops[1].value;
+	}
+
+	return err;
+}
+
+/* A frame landing after the last read latches PKT_AVLBL. It is cleared and
+ * the buffer checked once more before unmasking, and any frame after that
+ * asserts the line as soon as the interrupt is enabled. */
+static int rearm(struct qca_rxpoll *rx, struct qca_dev *dev)
+{
+	struct qca_bus_op ops[] = {
+		{ .type = QCA_BUS_OP_WRITE_REG, .reg = QCA_REG_INT_SRC,
+			.value = INT_PKT_AVLBL },
+		{ .type = QCA_BUS_OP_READ_REG, .reg = QCA_REG_RDBUF_AVAILABLE, },
+	};
+	int err = submit(dev, ops, sizeof(ops) / sizeof(*ops));
+
+	if (err) {
+		return err;
+	}
+
+	if (ops[1].value) {
+		rx->stats.rearm_aborts++;
+		return 1;
+	}
+
+	if ((err = write_reg(dev, QCA_REG_INT_ENABLE,
+			rx->conf.int_mask)) == 0) {
+		rx->stats.polling = false;
+		rx->stats.rearms++;
+	}
+
+	return err;
+}
+
+void qca_rxpoll_handler(const void *frame, size_t frame_size, void *ctx)
+{
+	struct qca_rxpoll *rx = (struct qca_rxpoll *)ctx;
+
+	rx->delivered++;
+	rx->stats.frames++;
+
+	if (rx->conf.handler) {
+		(*rx->conf.handler)(frame, frame_size, rx->conf.handler_ctx);
+	}
+}
+
+int qca_rxpoll_interrupt(struct qca_rxpoll *rx, struct qca_dev *dev,
+		uint16_t *int_src)
+{
+	uint16_t src = 0;
+
+	if (rx == NULL) {
+		return -EINVAL;
+	}
+
+	const int err = mask_and_ack(rx, dev, &src);
+
+	if (err) {
+		return err;
+	}
+
+	if (int_src) {
+		*int_src = src;
+	}
+
+	if (!rx->stats.polling) {
+		rx->stats.interrupts++;
+	}
+
+	/* polling until found idle again, whatever the sources were, as the
+	 * packet interrupt is masked from here on */
+	rx->stats.polling = true;
+	rx->idle = 0;
+
+	return 0;
+}
+
+int qca_rxpoll_poll(struct qca_rxpoll *rx, struct qca_dev *dev)
+{
+	if (rx == NULL) {
+		return -EINVAL;
+	}
+	if (!rx->stats.polling) {
+		return 0;
+	}
+
+	int len = 0;
+
+	rx->delivered = 0;
+	rx->stats.rounds++;
+
+	while (rx->delivered < rx->conf.budget) {
+		if ((len = read_frames(rx, dev)) <= 0) {
+			break;
+		}
+
+		const int err = input(rx, dev, (size_t)len);
+
+		if (err < 0 && err != -EAGAIN) {
+			QCA_ERROR("input failed(%d)", err);
+		}
+	}
+
+	if (len < 0 && len != -EBUSY) {
+		return len;
+	}
+
+	if (rx->delivered >= rx->conf.budget) {
+		rx->stats.budget_exhausted++;
+		rx->idle = 0;
+		return 1;
+	}
+
+	if (rx->delivered || len == -EBUSY) {
+		rx->idle = 0;
+		return 1;
+	}
+
+	rx->stats.empty_rounds++;
+
+	if (++rx->idle < rx->conf.idle_rounds) {
+		return 1;
+	}
+
+	const int err = rearm(rx, dev);
+
+	return err < 0? err : rx->stats.polling;
+}
+
+int qca_rxpoll_get_stats(const struct qca_rxpoll *rx,
+		struct qca_rxpoll_stats *stats)
+{
+	if (rx == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	*stats = rx->stats;
+
+	return 0;
+}
+
+struct qca_rxpoll *qca_rxpoll_create(const struct qca_rxpoll_conf *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	struct qca_rxpoll *rx =
+		(struct qca_rxpoll *)qca_os_malloc(sizeof(*rx));
+
+	if (rx == NULL) {
+		return NULL;
+	}
+
+	memset(rx, 0, sizeof(*rx));
+
+	rx->conf = *conf;
+
+	if (rx->conf.budget == 0) {
+		rx->conf.budget = QCA_RXPOLL_DEFAULT_BUDGET;
+	}
+	if (rx->conf.idle_rounds == 0) {
+		rx->conf.idle_rounds = QCA_RXPOLL_DEFAULT_IDLE_ROUNDS;
+	}
+	if (rx->conf.int_mask == 0) {
+		rx->conf.int_mask = QCA_RXPOLL_DEFAULT_INT_MASK;
+	}
+
+	return rx;
+}
+
+void qca_rxpoll_destroy(struct qca_rxpoll *rx)
+{
+	qca_os_free(rx);
+}
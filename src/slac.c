@@ -0,0 +1,613 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/slac.h"
+#include "qca/mme.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define ETH_MINLEN			60U
+#define FRAME_MAXLEN			160U
+
+/* The accumulators are padded to a multiple of the vector width so that the
+ * kernels run a fixed trip count with no remainder loop. */
+#define GROUPS_PADDED			64U
+
+#define MATCH_RESPONSE_MS		200U /* TT_match_response */
+#define MATCH_RETRIES			2U /* C_EV_match_retry */
+#define RESP_TYPE_OTHER_GP_STA		0x01U
+#define MVF_LEN_MATCH_CNF		0x56U
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+struct slac_parm_req {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+} __attribute__((packed));
+
+struct slac_parm_cnf {
+	uint8_t msound_target[6];
+	uint8_t num_sounds;
+	uint8_t timeout;
+	uint8_t resp_type;
+	uint8_t forwarding_sta[6];
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+} __attribute__((packed));
+
+struct start_atten_char_ind {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t num_sounds;
+	uint8_t timeout;
+	uint8_t resp_type;
+	uint8_t forwarding_sta[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+} __attribute__((packed));
+
+struct mnbc_sound_ind {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t sender_id[QCA_SLAC_ID_LEN];
+	uint8_t cnt;
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t reserved[8];
+	uint8_t rnd[16];
+} __attribute__((packed));
+
+struct atten_profile_ind {
+	uint8_t pev_mac[6];
+	uint8_t num_groups;
+	uint8_t reserved;
+	uint8_t aag[QCA_SLAC_GROUPS];
+} __attribute__((packed));
+
+struct atten_char_ind {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t source_address[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t source_id[QCA_SLAC_ID_LEN];
+	uint8_t resp_id[QCA_SLAC_ID_LEN];
+	uint8_t num_sounds;
+	uint8_t num_groups;
+	uint8_t aag[QCA_SLAC_GROUPS];
+} __attribute__((packed));
+
+struct atten_char_rsp {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t source_address[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t source_id[QCA_SLAC_ID_LEN];
+	uint8_t resp_id[QCA_SLAC_ID_LEN];
+	uint8_t result;
+} __attribute__((packed));
+
+struct slac_match_req {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t mvf_len[2]; /* little endian */
+	uint8_t pev_id[QCA_SLAC_ID_LEN];
+	uint8_t pev_mac[6];
+	uint8_t evse_id[QCA_SLAC_ID_LEN];
+	uint8_t evse_mac[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t reserved[8];
+} __attribute__((packed));
+
+struct slac_match_cnf {
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t mvf_len[2]; /* little endian */
+	uint8_t pev_id[QCA_SLAC_ID_LEN];
+	uint8_t pev_mac[6];
+	uint8_t evse_id[QCA_SLAC_ID_LEN];
+	uint8_t evse_mac[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t reserved[8];
+	uint8_t nid[QCA_SLAC_NID_LEN];
+	uint8_t reserved2;
+	uint8_t nmk[QCA_SLAC_NMK_LEN];
+} __attribute__((packed));
+
+typedef enum {
+	SESSION_FREE,
+	SESSION_PARM, /* SLAC_PARM.CNF sent */
+	SESSION_SOUNDING, /* collecting attenuation profiles */
+	SESSION_ATTEN_SENT, /* ATTEN_CHAR.IND sent, waiting for the response */
+	SESSION_MATCHING, /* waiting for SLAC_MATCH.REQ */
+} session_state_t;
+
+struct session {
+	uint16_t sum[GROUPS_PADDED];
+	session_state_t state;
+	uint8_t pev_mac[6];
+	uint8_t run_id[QCA_SLAC_RUN_ID_LEN];
+	uint8_t pev_id[QCA_SLAC_ID_LEN]; /* SOURCE_ID, from the M-SOUNDs */
+	uint8_t resp_id[QCA_SLAC_ID_LEN]; /* RESP_ID, the EVSE answering */
+	uint8_t app_type;
+	uint8_t security_type;
+	uint8_t num_groups;
+	uint8_t retries;
+	uint16_t count;
+	uint32_t deadline; /* of the current step */
+	uint32_t expiry; /* of the whole session */
+	struct qca_slac_result result;
+};
+
+struct qca_slac {
+	struct qca_slac_conf conf;
+	struct session *sessions;
+	uint8_t frame[FRAME_MAXLEN];
+};
+
+static const uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+/* Kept free of branches and at a fixed width so that the compiler turns it
+ * into vector adds. */
+static void accumulate(uint16_t *restrict sum, const uint8_t *restrict aag)
+{
+	for (size_t i = 0; i < GROUPS_PADDED; i++) {
+		sum[i] = (uint16_t)(sum[i] + aag[i]);
+	}
+}
+
+uint8_t qca_slac_average(uint8_t *avg, const uint16_t *sum, uint16_t count,
+		size_t num_groups)
+{
+	if (count == 0 || num_groups == 0) {
+		memset(avg, 0, num_groups);
+		return 0;
+	}
+
+	const uint32_t half = count / 2U;
+	uint32_t total = 0;
+
+	for (size_t i = 0; i < num_groups; i++) {
+		avg[i] = (uint8_t)((sum[i] + half) / count);
+		total += avg[i];
+	}
+
+	return (uint8_t)((total + num_groups / 2U) / num_groups);
+}
+
+static struct session *find_by_run_id(struct qca_slac *slac,
+		const uint8_t *run_id)
+{
+	for (size_t i = 0; i < slac->conf.max_sessions; i++) {
+		struct session *s = &slac->sessions[i];
+
+		if (s->state != SESSION_FREE &&
+				!memcmp(s->run_id, run_id, sizeof(s->run_id))) {
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+static struct session *find_by_mac(struct qca_slac *slac, const uint8_t *mac)
+{
+	for (size_t i = 0; i < slac->conf.max_sessions; i++) {
+		struct session *s = &slac->sessions[i];
+
+		if (s->state != SESSION_FREE &&
+				!memcmp(s->pev_mac, mac, sizeof(s->pev_mac))) {
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+static struct session *alloc_session(struct qca_slac *slac, const uint8_t *mac)
+{
+	struct session *s = find_by_mac(slac, mac); /* the EV started over */
+
+	for (size_t i = 0; s == NULL && i < slac->conf.max_sessions; i++) {
+		if (slac->sessions[i].state == SESSION_FREE) {
+			s = &slac->sessions[i];
+		}
+	}
+
+	if (s) {
+		memset(s, 0, sizeof(*s));
+	}
+
+	return s;
+}
+
+static void free_session(struct session *s)
+{
+	s->state = SESSION_FREE;
+}
+
+static void notify(struct qca_slac *slac, qca_slac_event_t event,
+		struct session *s)
+{
+	struct qca_slac_result *r = &s->result;
+
+	memcpy(r->pev_mac, s->pev_mac, sizeof(r->pev_mac));
+	memcpy(r->run_id, s->run_id, sizeof(r->run_id));
+
+	if (slac->conf.on_event) {
+		(*slac->conf.on_event)(event, r, slac->conf.on_event_ctx);
+	}
+}
+
+static uint8_t *put_header(struct qca_slac *slac, const uint8_t *dst,
+		uint16_t mmtype)
+{
+	uint8_t *p = slac->frame;
+
+	memset(p, 0, sizeof(slac->frame));
+	return &p[qca_mme_put_header(p, dst, slac->conf.evse_mac, mmtype)];
+}
+
+static int send_frame(struct qca_slac *slac, size_t payload_len)
+{
+	const size_t len = QCA_MME_HEADER_LEN + payload_len;
+
+	if (slac->conf.send == NULL) {
+		return -ENOTCONN;
+	}
+
+	return (*slac->conf.send)(slac->frame, len < ETH_MINLEN? ETH_MINLEN : len,
+			slac->conf.send_ctx);
+}
+
+static int send_parm_cnf(struct qca_slac *slac, const struct session *s)
+{
+	struct slac_parm_cnf *cnf = (struct slac_parm_cnf *)
+		put_header(slac, s->pev_mac, QCA_SLAC_MMTYPE_SLAC_PARM_CNF);
+
+	memcpy(cnf->msound_target, broadcast, sizeof(cnf->msound_target));
+	cnf->num_sounds = slac->conf.num_sounds;
+	cnf->timeout = slac->conf.timeout_100ms;
+	cnf->resp_type = RESP_TYPE_OTHER_GP_STA;
+	memcpy(cnf->forwarding_sta, s->pev_mac, sizeof(cnf->forwarding_sta));
+	cnf->app_type = s->app_type;
+	cnf->security_type = s->security_type;
+	memcpy(cnf->run_id, s->run_id, sizeof(cnf->run_id));
+
+	return send_frame(slac, sizeof(*cnf));
+}
+
+static int send_atten_char(struct qca_slac *slac, struct session *s)
+{
+	struct atten_char_ind *ind = (struct atten_char_ind *)
+		put_header(slac, s->pev_mac, QCA_SLAC_MMTYPE_ATTEN_CHAR_IND);
+
+	ind->app_type = s->app_type;
+	ind->security_type = s->security_type;
+	memcpy(ind->source_address, s->pev_mac, sizeof(ind->source_address));
+	memcpy(ind->run_id, s->run_id, sizeof(ind->run_id));
+	memcpy(ind->source_id, s->pev_id, sizeof(ind->source_id));
+	memcpy(ind->resp_id, s->resp_id, sizeof(ind->resp_id));
+	ind->num_sounds = s->result.num_sounds;
+	ind->num_groups = s->result.num_groups;
+	memcpy(ind->aag, s->result.avg, s->result.num_groups);
+
+	return send_frame(slac, sizeof(*ind));
+}
+
+static int send_match_cnf(struct qca_slac *slac, const struct session *s,
+		const struct slac_match_req *req)
+{
+	struct slac_match_cnf *cnf = (struct slac_match_cnf *)
+		put_header(slac, s->pev_mac, QCA_SLAC_MMTYPE_SLAC_MATCH_CNF);
+
+	cnf->app_type = s->app_type;
+	cnf->security_type = s->security_type;
+	cnf->mvf_len[0] = MVF_LEN_MATCH_CNF;
+	memcpy(cnf->pev_id, req->pev_id, sizeof(cnf->pev_id));
+	memcpy(cnf->pev_mac, s->pev_mac, sizeof(cnf->pev_mac));
+	memcpy(cnf->evse_id, req->evse_id, sizeof(cnf->evse_id));
+	memcpy(cnf->evse_mac, slac->conf.evse_mac, sizeof(cnf->evse_mac));
+	memcpy(cnf->run_id, s->run_id, sizeof(cnf->run_id));
+	memcpy(cnf->nid, slac->conf.nid, sizeof(cnf->nid));
+	memcpy(cnf->nmk, slac->conf.nmk, sizeof(cnf->nmk));
+
+	return send_frame(slac, sizeof(*cnf));
+}
+
+static void characterise(struct qca_slac *slac, struct session *s,
+		uint32_t now)
+{
+	struct qca_slac_result *r = &s->result;
+
+	r->num_sounds = (uint8_t)s->count;
+	r->num_groups = s->num_groups;
+	r->avg_total = qca_slac_average(r->avg, s->sum, s->count,
+			s->num_groups);
+
+	s->state = SESSION_ATTEN_SENT;
+	s->retries = 0;
+	s->deadline = now + MATCH_RESPONSE_MS;
+
+	if (send_atten_char(slac, s) != 0) {
+		QCA_ERROR("failed to send ATTEN_CHAR.IND");
+	}
+
+	notify(slac, QCA_SLAC_EVT_ATTEN_DONE, s);
+}
+
+static int handle_parm_req(struct qca_slac *slac, const uint8_t *src,
+		const struct slac_parm_req *req, uint32_t now)
+{
+	struct session *s = find_by_run_id(slac, req->run_id);
+
+	if (s == NULL) {
+		if ((s = alloc_session(slac, src)) == NULL) {
+			QCA_ERROR("no session left for a new EV");
+			return -ENOSPC;
+		}
+
+		memcpy(s->pev_mac, src, sizeof(s->pev_mac));
+		memcpy(s->run_id, req->run_id, sizeof(s->run_id));
+		memcpy(s->resp_id, slac->conf.evse_id, sizeof(s->resp_id));
+		s->app_type = req->app_type;
+		s->security_type = req->security_type;
+		s->state = SESSION_PARM;
+		s->expiry = now + QCA_SLAC_SESSION_TIMEOUT_MS;
+	}
+
+	/* a retried request gets the same confirmation again */
+	return send_parm_cnf(slac, s);
+}
+
+static int handle_start_atten_char(struct qca_slac *slac,
+		const struct start_atten_char_ind *ind, uint32_t now)
+{
+	struct session *s = find_by_run_id(slac, ind->run_id);
+
+	if (s == NULL || s->state != SESSION_PARM) {
+		return 0; /* repeated indications are expected */
+	}
+
+	s->state = SESSION_SOUNDING;
+	s->deadline = now + slac->conf.timeout_100ms * 100U;
+
+	return 0;
+}
+
+static int handle_mnbc_sound(struct qca_slac *slac,
+		const struct mnbc_sound_ind *ind)
+{
+	struct session *s = find_by_run_id(slac, ind->run_id);
+
+	if (s && s->state == SESSION_SOUNDING) {
+		memcpy(s->pev_id, ind->sender_id, sizeof(s->pev_id));
+	}
+
+	return 0;
+}
+
+static int handle_atten_profile(struct qca_slac *slac,
+		const struct atten_profile_ind *ind, uint32_t now)
+{
+	struct session *s = find_by_mac(slac, ind->pev_mac);
+	uint8_t aag[GROUPS_PADDED] = { 0, };
+
+	if (s == NULL || s->state != SESSION_SOUNDING ||
+			s->count >= slac->conf.num_sounds) {
+		return 0;
+	}
+
+	s->num_groups = (uint8_t)MIN(ind->num_groups, QCA_SLAC_GROUPS);
+	memcpy(aag, ind->aag, s->num_groups);
+	accumulate(s->sum, aag);
+	s->count++;
+
+	/* no need to wait out the window once all the sounds are in */
+	if (s->count >= slac->conf.num_sounds) {
+		characterise(slac, s, now);
+	}
+
+	return 0;
+}
+
+static int handle_atten_char_rsp(struct qca_slac *slac,
+		const struct atten_char_rsp *rsp, uint32_t now)
+{
+	struct session *s = find_by_run_id(slac, rsp->run_id);
+
+	if (s == NULL || s->state != SESSION_ATTEN_SENT) {
+		return 0;
+	}
+
+	if (rsp->result != 0) {
+		notify(slac, QCA_SLAC_EVT_TIMEOUT, s);
+		free_session(s);
+		return 0;
+	}
+
+	s->state = SESSION_MATCHING;
+	s->expiry = now + QCA_SLAC_SESSION_TIMEOUT_MS;
+
+	return 0;
+}
+
+static int handle_match_req(struct qca_slac *slac,
+		const struct slac_match_req *req)
+{
+	struct session *s = find_by_run_id(slac, req->run_id);
+
+	/* the response to ATTEN_CHAR may have been lost on the way */
+	if (s == NULL || (s->state != SESSION_MATCHING &&
+				s->state != SESSION_ATTEN_SENT)) {
+		return 0;
+	}
+
+	const int err = send_match_cnf(slac, s, req);
+
+	if (err == 0) {
+		notify(slac, QCA_SLAC_EVT_MATCHED, s);
+		free_session(s);
+	}
+
+	return err;
+}
+
+int qca_slac_input(struct qca_slac *slac,
+		const void *frame, size_t frame_size, uint32_t now_ms)
+{
+	const uint8_t *p = (const uint8_t *)frame;
+
+	if (slac == NULL || p == NULL) {
+		return -EINVAL;
+	}
+
+	if (frame_size < QCA_MME_HEADER_LEN ||
+			(((uint16_t)p[12] << 8) | p[13]) != QCA_MME_ETHERTYPE ||
+			p[14] != QCA_MME_MMV) {
+		return -ENOMSG;
+	}
+
+	const uint16_t mmtype = (uint16_t)(((uint16_t)p[16] << 8) | p[15]);
+	const uint8_t *payload = &p[QCA_MME_HEADER_LEN];
+	const size_t len = frame_size - QCA_MME_HEADER_LEN;
+
+#define PAYLOAD(type)	(len < sizeof(type)? NULL : (const type *)payload)
+	switch (mmtype) {
+	case QCA_SLAC_MMTYPE_SLAC_PARM_REQ: {
+		const struct slac_parm_req *req = PAYLOAD(struct slac_parm_req);
+		return req? handle_parm_req(slac, &p[6], req, now_ms) : -EBADMSG;
+	}
+	case QCA_SLAC_MMTYPE_START_ATTEN_CHAR_IND: {
+		const struct start_atten_char_ind *ind =
+			PAYLOAD(struct start_atten_char_ind);
+		return ind? handle_start_atten_char(slac, ind, now_ms) : -EBADMSG;
+	}
+	case QCA_SLAC_MMTYPE_MNBC_SOUND_IND: {
+		const struct mnbc_sound_ind *ind = PAYLOAD(struct mnbc_sound_ind);
+		return ind? handle_mnbc_sound(slac, ind) : -EBADMSG;
+	}
+	case QCA_SLAC_MMTYPE_ATTEN_PROFILE_IND: {
+		const struct atten_profile_ind *ind =
+			PAYLOAD(struct atten_profile_ind);
+		return ind? handle_atten_profile(slac, ind, now_ms) : -EBADMSG;
+	}
+	case QCA_SLAC_MMTYPE_ATTEN_CHAR_RSP: {
+		const struct atten_char_rsp *rsp = PAYLOAD(struct atten_char_rsp);
+		return rsp? handle_atten_char_rsp(slac, rsp, now_ms) : -EBADMSG;
+	}
+	case QCA_SLAC_MMTYPE_SLAC_MATCH_REQ: {
+		const struct slac_match_req *req = PAYLOAD(struct slac_match_req);
+		return req? handle_match_req(slac, req) : -EBADMSG;
+	}
+	default:
+		return -ENOMSG;
+	}
+#undef PAYLOAD
+}
+
+void qca_slac_poll(struct qca_slac *slac, uint32_t now_ms)
+{
+	if (slac == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < slac->conf.max_sessions; i++) {
+		struct session *s = &slac->sessions[i];
+
+		if (s->state == SESSION_FREE) {
+			continue;
+		}
+
+		if (qca_mme_is_expired(now_ms, s->expiry)) {
+			notify(slac, QCA_SLAC_EVT_TIMEOUT, s);
+			free_session(s);
+		} else if (s->state == SESSION_SOUNDING &&
+				qca_mme_is_expired(now_ms, s->deadline)) {
+			if (s->count) {
+				characterise(slac, s, now_ms);
+			} else {
+				notify(slac, QCA_SLAC_EVT_TIMEOUT, s);
+				free_session(s);
+			}
+		} else if (s->state == SESSION_ATTEN_SENT &&
+				qca_mme_is_expired(now_ms, s->deadline)) {
+			if (s->retries++ < MATCH_RETRIES) {
+				s->deadline = now_ms + MATCH_RESPONSE_MS;
+				send_atten_char(slac, s);
+			} else {
+				notify(slac, QCA_SLAC_EVT_TIMEOUT, s);
+				free_session(s);
+			}
+		}
+	}
+}
+
+size_t qca_slac_sessions(const struct qca_slac *slac)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; slac && i < slac->conf.max_sessions; i++) {
+		if (slac->sessions[i].state != SESSION_FREE) {
+			n++;
+		}
+	}
+
+	return n;
+}
+
+struct qca_slac *qca_slac_create(const struct qca_slac_conf *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	struct qca_slac *slac = (struct qca_slac *)qca_os_malloc(sizeof(*slac));
+
+	if (slac == NULL) {
+		return NULL;
+	}
+
+	memset(slac, 0, sizeof(*slac));
+
+	slac->conf = *conf;
+
+	if (slac->conf.num_sounds == 0) {
+		slac->conf.num_sounds = QCA_SLAC_DEFAULT_NUM_SOUNDS;
+	}
+	if (slac->conf.timeout_100ms == 0) {
+		slac->conf.timeout_100ms = QCA_SLAC_DEFAULT_TIMEOUT_100MS;
+	}
+	if (slac->conf.max_sessions == 0) {
+		slac->conf.max_sessions = QCA_SLAC_DEFAULT_SESSIONS;
+	}
+
+	const size_t size = slac->conf.max_sessions * sizeof(*slac->sessions);
+
+	if ((slac->sessions = (struct session *)qca_os_malloc(size)) == NULL) {
+		qca_os_free(slac);
+		return NULL;
+	}
+
+	memset(slac->sessions, 0, size);
+
+	return slac;
+}
+
+void qca_slac_destroy(struct qca_slac *slac)
+{
+	if (slac) {
+		qca_os_free(slac->sessions);
+		qca_os_free(slac);
+	}
+}
@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/spirec.h"
+#include "qca/qca.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(MIN)
+#define MIN(a, b)		(((a) > (b))? (b) : (a))
+#endif
+
+#define load(p)			__atomic_load_n(p, __ATOMIC_RELAXED)
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define inc(p)			__atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+#define add(p, v)		__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+
+_Static_assert((QCA_SPIREC_BUFSIZE & (QCA_SPIREC_BUFSIZE - 1)) == 0,
+		"QCA_SPIREC_BUFSIZE must be a power of two");
+
+/* The tracer is called with the bus lock held, so records are only queued
+ * here and the writer thread does the blocking write(). Tracer calls are
+ * serialized by the bus lock, making this a single-producer ring. */
+struct qca_spirec {
+	int fd;
+	bool running;
+	uint64_t t0;
+
+	struct qca_spirec_stats stats;
+
+	pthread_t writer;
+	size_t head; /* owned by the tracer */
+	size_t tail; /* owned by the writer */
+	uint8_t buf[QCA_SPIREC_BUFSIZE];
+};
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static int write_all(int fd, const void *data, size_t datasize)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	while (datasize > 0) {
+		const ssize_t n = write(fd, p, datasize);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+
+		p += n;
+		datasize -= (size_t)n;
+	}
+
+	return 0;
+}
+
+/* Writes out everything queued so far. Returns the number of bytes taken
+ * off the ring. */
+static size_t drain(struct qca_spirec *rec)
+{
+	const size_t head = load_acquire(&rec->head);
+	const size_t tail = rec->tail;
+	const size_t len = head - tail;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	const size_t off = tail & (sizeof(rec->buf) - 1);
+	const size_t first = MIN(len, sizeof(rec->buf) - off);
+
+	if (write_all(rec->fd, &rec->buf[off], first) != 0 ||
+			write_all(rec->fd, rec->buf, len - first) != 0) {
+		inc(&rec->stats.write_errors);
+	}
+
+	store_release(&rec->tail, head);
+
+	return len;
+}
+
+static void *writer_task(void *arg)
+{
+	struct qca_spirec *rec = (struct qca_spirec *)arg;
+	const struct timespec interval = {
+		.tv_sec = QCA_SPIREC_POLL_INTERVAL_MS / 1000U,
+		.tv_nsec = (long)(QCA_SPIREC_POLL_INTERVAL_MS % 1000U)
+			* 1000000L,
+	};
+
+	while (load_acquire(&rec->running)) {
+		if (drain(rec) == 0) {
+			nanosleep(&interval, NULL);
+		}
+	}
+
+	drain(rec);
+
+	return NULL;
+}
+
+static size_t append(struct qca_spirec *rec, size_t head,
+		const void *data, size_t datasize)
+{
+	if (datasize == 0) {
+		return head;
+	}
+
+	const size_t off = head & (sizeof(rec->buf) - 1);
+	const size_t first = MIN(datasize, sizeof(rec->buf) - off);
+
+	memcpy(&rec->buf[off], data, first);
+	memcpy(rec->buf, (const uint8_t *)data + first, datasize - first);
+
+	return head + datasize;
+}
+
+static void put_le(uint8_t *p, uint32_t value, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		p[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+void qca_spirec_trace(const void *tx, size_t txsize,
+		const void *rx, size_t rxsize, int err, void *ctx)
+{
+	struct qca_spirec *rec = (struct qca_spirec *)ctx;
+	uint8_t hdr[QCA_SPIREC_RECORD_HEADER_LEN];
+
+	txsize = tx? MIN(txsize, UINT16_MAX) : 0;
+	rxsize = rx? MIN(rxsize, UINT16_MAX) : 0;
+
+	const size_t len = sizeof(hdr) + txsize + rxsize;
+	size_t head = rec->head;
+
+	if (len > sizeof(rec->buf) - (head - load_acquire(&rec->tail))) {
+		inc(&rec->stats.dropped);
+		return;
+	}
+
+	put_le(&hdr[0], (uint32_t)(get_time_us() - rec->t0), 4);
+	put_le(&hdr[4], (uint32_t)txsize, 2);
+	put_le(&hdr[6], (uint32_t)rxsize, 2);
+	put_le(&hdr[8], (uint32_t)(uint16_t)(int16_t)err, 2);
+
+	head = append(rec, head, hdr, sizeof(hdr));
+	head = append(rec, head, tx, txsize);
+	head = append(rec, head, rx, rxsize);
+
+	store_release(&rec->head, head);
+
+	add(&rec->stats.bytes, (uint32_t)len);
+	inc(&rec->stats.records);
+}
+
+int qca_spirec_start(struct qca_spirec *rec)
+{
+	if (rec == NULL) {
+		return -EINVAL;
+	}
+	if (rec->running) {
+		return -EALREADY;
+	}
+
+	rec->running = true;
+
+	int err;
+
+	if ((err = pthread_create(&rec->writer, NULL, writer_task, rec))) {
+		rec->running = false;
+		return -err;
+	}
+
+	qca_set_spi_trace(qca_spirec_trace, rec);
+
+	return 0;
+}
+
+int qca_spirec_stop(struct qca_spirec *rec)
+{
+	if (rec == NULL) {
+		return -EINVAL;
+	}
+	if (!rec->running) {
+		return -EALREADY;
+	}
+
+	qca_set_spi_trace(NULL, NULL);
+
+	store_release(&rec->running, false);
+	pthread_join(rec->writer, NULL);
+
+	return load(&rec->stats.write_errors)? -EIO : 0;
+}
+
+int qca_spirec_get_stats(const struct qca_spirec *rec,
+		struct qca_spirec_stats *stats)
+{
+	if (rec == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	stats->records = load(&rec->stats.records);
+	stats->bytes = load(&rec->stats.bytes);
+	stats->dropped = load(&rec->stats.dropped);
+	stats->write_errors = load(&rec->stats.write_errors);
+
+	return 0;
+}
+
+struct qca_spirec *qca_spirec_create(int fd)
+{
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct qca_spirec *rec = (struct qca_spirec *)calloc(1, sizeof(*rec));
+
+	if (rec == NULL) {
+		return NULL;
+	}
+
+	uint8_t hdr[QCA_SPIREC_HEADER_LEN] = { 0, };
+	memcpy(hdr, QCA_SPIREC_MAGIC, 4);
+	hdr[4] = QCA_SPIREC_VERSION;
+
+	if (write_all(fd, hdr, sizeof(hdr)) != 0) {
+		free(rec);
+		return NULL;
+	}
+
+	rec->fd = fd;
+	rec->t0 = get_time_us();
+
+	return rec;
+}
+
+void qca_spirec_destroy(struct qca_spirec *rec)
+{
+	if (rec == NULL) {
+		return;
+	}
+
+	if (rec->running) {
+		qca_spirec_stop(rec);
+	}
+
+	free(rec);
+}
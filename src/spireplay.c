@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/spireplay.h"
+#include "qca/spirec.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if !defined(MIN)
+#define MIN(a, b)		(((a) > (b))? (b) : (a))
+#endif
+
+struct record {
+	uint16_t txsize;
+	uint16_t rxsize;
+	int16_t result;
+	const uint8_t *tx;
+	const uint8_t *rx;
+};
+
+struct qca_spireplay {
+	struct lm_spi_device dev; /* must be the first member */
+
+	const uint8_t *log;
+	size_t log_size;
+	size_t pos;
+	uint32_t flags;
+
+	struct qca_spireplay_stats stats;
+};
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* Returns the offset of the record following the one at @p pos, or 0 if the
+ * record is truncated. */
+static size_t parse_record(const struct qca_spireplay *replay, size_t pos,
+		struct record *rec)
+{
+	if (pos + QCA_SPIREC_RECORD_HEADER_LEN > replay->log_size) {
+		return 0;
+	}
+
+	const uint8_t *p = &replay->log[pos];
+
+	rec->txsize = get_le16(&p[4]);
+	rec->rxsize = get_le16(&p[6]);
+	rec->result = (int16_t)get_le16(&p[8]);
+	rec->tx = &p[QCA_SPIREC_RECORD_HEADER_LEN];
+	rec->rx = rec->tx + rec->txsize;
+
+	const size_t next = pos + QCA_SPIREC_RECORD_HEADER_LEN +
+		rec->txsize + rec->rxsize;
+
+	return next <= replay->log_size? next : 0;
+}
+
+static bool is_same_command(const struct record *rec,
+		const void *tx, size_t txsize)
+{
+	const size_t len = MIN(MIN(txsize, rec->txsize), 2);
+	return txsize > 0 && rec->txsize > 0 && memcmp(rec->tx, tx, len) == 0;
+}
+
+/* Returns the position of the next record, rewinding in the loop mode. */
+static size_t next_record(struct qca_spireplay *replay, size_t pos,
+		struct record *rec)
+{
+	size_t next = parse_record(replay, pos, rec);
+
+	if (next == 0 && (replay->flags & QCA_SPIREPLAY_LOOP)) {
+		replay->stats.loops++;
+		pos = QCA_SPIREC_HEADER_LEN;
+		next = parse_record(replay, pos, rec);
+	}
+
+	return next;
+}
+
+static int replay_writeread(struct lm_spi_device *self,
+		const void *tx, size_t txsize, void *rx, size_t rxsize)
+{
+	struct qca_spireplay *replay = (struct qca_spireplay *)self;
+	size_t pos = replay->pos;
+	struct record rec;
+
+	for (unsigned int i = 0; i < QCA_SPIREPLAY_SEARCH_WINDOW; i++) {
+		const size_t next = next_record(replay, pos, &rec);
+
+		if (next == 0) {
+			break;
+		}
+
+		if (is_same_command(&rec, tx, txsize)) {
+			const size_t len = MIN(rxsize, rec.rxsize);
+
+			if (rx && rxsize) {
+				memcpy(rx, rec.rx, len);
+				memset((uint8_t *)rx + len, 0, rxsize - len);
+			}
+
+			replay->stats.skipped += i;
+			replay->stats.transactions++;
+			replay->pos = next;
+
+			return rec.result;
+		}
+
+		pos = next;
+	}
+
+	if (rx && rxsize) {
+		memset(rx, 0, rxsize);
+	}
+
+	replay->stats.mismatches++;
+
+	return 0;
+}
+
+struct lm_spi_device *qca_spireplay_device(struct qca_spireplay *replay)
+{
+	return &replay->dev;
+}
+
+void qca_spireplay_rewind(struct qca_spireplay *replay)
+{
+	replay->pos = QCA_SPIREC_HEADER_LEN;
+}
+
+bool qca_spireplay_done(const struct qca_spireplay *replay)
+{
+	struct record rec;
+
+	if (replay->flags & QCA_SPIREPLAY_LOOP) {
+		return false;
+	}
+
+	return parse_record(replay, replay->pos, &rec) == 0;
+}
+
+int qca_spireplay_get_stats(const struct qca_spireplay *replay,
+		struct qca_spireplay_stats *stats)
+{
+	if (replay == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	*stats = replay->stats;
+
+	return 0;
+}
+
+struct qca_spireplay *qca_spireplay_create(const void *log, size_t log_size,
+		uint32_t flags)
+{
+	const uint8_t *p = (const uint8_t *)log;
+
+	if (p == NULL || log_size < QCA_SPIREC_HEADER_LEN ||
+			memcmp(p, QCA_SPIREC_MAGIC, 4) != 0 ||
+			p[4] != QCA_SPIREC_VERSION) {
+		return NULL;
+	}
+
+	struct qca_spireplay *replay =
+		(struct qca_spireplay *)calloc(1, sizeof(*replay));
+
+	if (replay == NULL) {
+		return NULL;
+	}
+
+	replay->dev.writeread = replay_writeread;
+	replay->log = p;
+	replay->log_size = log_size;
+	replay->flags = flags;
+	replay->pos = QCA_SPIREC_HEADER_LEN;
+
+	return replay;
+}
+
+void qca_spireplay_destroy(struct qca_spireplay *replay)
+{
+	free(replay);
+}
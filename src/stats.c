@@ -0,0 +1,151 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/stats.h"
+#include <errno.h>
+#include <string.h>
+
+#if !defined(ARRAY_COUNT)
+#define ARRAY_COUNT(x)		(sizeof(x) / sizeof((x)[0]))
+#endif
+
+#if defined(QCA_STATS)
+#include <stdbool.h>
+#include <time.h>
+
+#define load(p)			__atomic_load_n(p, __ATOMIC_RELAXED)
+#define store(p, v)		__atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define add(p, v)		__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+
+static struct qca_stats stats;
+
+static unsigned int get_bucket(uint32_t us)
+{
+	if (us == 0) {
+		return 0;
+	}
+
+	const unsigned int bits = 32U - (unsigned int)__builtin_clz(us);
+
+	if (bits >= QCA_STATS_HIST_BUCKETS) {
+		return QCA_STATS_HIST_BUCKETS - 1;
+	}
+
+	return bits;
+}
+
+static void update_max(uint32_t *max, uint32_t value)
+{
+	uint32_t cur = load(max);
+
+	while (value > cur && !__atomic_compare_exchange_n(max, &cur, value,
+			true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		/* cur is reloaded on failure */
+	}
+}
+
+void qca_stats_add(qca_stats_counter_t counter, uint32_t n)
+{
+	add(&stats.counters[counter], n);
+}
+
+void qca_stats_record(qca_stats_hist_t hist, uint32_t us)
+{
+	struct qca_stats_hist *p = &stats.hists[hist];
+
+	add(&p->count, 1);
+	add(&p->sum_us, us);
+	add(&p->buckets[get_bucket(us)], 1);
+	update_max(&p->max_us, us);
+}
+
+uint64_t qca_stats_now_us(void)
+{
+#if defined(QCA_STATS_TIME_US)
+	return (uint64_t)QCA_STATS_TIME_US();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+#endif
+}
+
+int qca_stats_snapshot(struct qca_stats *snapshot)
+{
+	if (snapshot == NULL) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < ARRAY_COUNT(stats.counters); i++) {
+		snapshot->counters[i] = load(&stats.counters[i]);
+	}
+
+	for (size_t i = 0; i < ARRAY_COUNT(stats.hists); i++) {
+		const struct qca_stats_hist *src = &stats.hists[i];
+		struct qca_stats_hist *dst = &snapshot->hists[i];
+
+		dst->count = load(&src->count);
+		dst->sum_us = load(&src->sum_us);
+		dst->max_us = load(&src->max_us);
+
+		for (size_t j = 0; j < ARRAY_COUNT(src->buckets); j++) {
+			dst->buckets[j] = load(&src->buckets[j]);
+		}
+	}
+
+	return 0;
+}
+
+void qca_stats_reset(void)
+{
+	uint32_t *p = (uint32_t *)&stats;
+
+	for (size_t i = 0; i < sizeof(stats) / sizeof(*p); i++) {
+		store(&p[i], 0);
+	}
+}
+#else /* !QCA_STATS */
+int qca_stats_snapshot(struct qca_stats *snapshot)
+{
+	if (snapshot) {
+		memset(snapshot, 0, sizeof(*snapshot));
+	}
+	return -ENOTSUP;
+}
+
+void qca_stats_reset(void)
+{
+}
+#endif
+
+const char *qca_stats_counter_stringify(qca_stats_counter_t counter)
+{
+	static const char *names[] = {
+		"rx_frames",
+		"rx_bytes",
+		"tx_frames",
+		"tx_bytes",
+		"spi_reg_read",
+		"spi_reg_write",
+		"spi_buf_read",
+		"spi_buf_write",
+		"resync_drops",
+		"eagain",
+		"eio",
+		"lock_acquired",
+		"lock_wait_us",
+		"bus_timeouts",
+	};
+
+	_Static_assert(ARRAY_COUNT(names) == QCA_STATS_COUNTER_MAX,
+			"counter names out of sync");
+
+	if ((size_t)counter >= ARRAY_COUNT(names)) {
+		return NULL;
+	}
+
+	return names[counter];
+}
@@ -0,0 +1,344 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/tapbridge.h"
+#include "qca/qca.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#define TUN_DEV				"/dev/net/tun"
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+#define load(p)			__atomic_load_n(p, __ATOMIC_RELAXED)
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define add(p, v)		__atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define inc(p)			add(p, 1)
+
+struct qca_tapbridge {
+	struct qca_tapbridge_conf conf;
+	int fd;
+	bool own_fd;
+
+	bool running;
+	pthread_t rx_thread;
+	pthread_t tx_thread;
+
+	uint8_t *rxbuf;
+	uint8_t *txbufs; /* batch of QCA_MAX_BUFSIZE slots */
+	struct qca_iovec *txframes;
+
+	struct qca_tapbridge_stats stats;
+};
+
+static int send_to_qca(const struct qca_iovec *frames, size_t nr_frames,
+		void *ctx)
+{
+	(void)ctx;
+	return qca_write_frames(frames, nr_frames);
+}
+
+static int pump_qca(void *buf, size_t bufsize, void *ctx)
+{
+	(void)ctx;
+	int len = qca_read(buf, bufsize);
+
+	if (len > 0) {
+		const int err = qca_input(buf, (size_t)len);
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	return len == -EBUSY? 0 : len;
+}
+
+static int open_tap(const char *ifname)
+{
+	struct ifreq ifr = { .ifr_flags = IFF_TAP | IFF_NO_PI, };
+	const int fd = open(TUN_DEV, O_RDWR | O_CLOEXEC);
+
+	if (fd < 0) {
+		QCA_ERROR("failed to open %s", TUN_DEV);
+		return -errno;
+	}
+
+	if (ifname) {
+		strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	}
+
+	if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+		const int err = -errno;
+		QCA_ERROR("failed to attach to %s", ifname? ifname : "tap");
+		close(fd);
+		return err;
+	}
+
+	return fd;
+}
+
+static bool wait_readable(int fd, uint32_t timeout_ms)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN, };
+	return poll(&pfd, 1, (int)timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
+/* A TAP descriptor moves exactly one frame per read or write, so frames
+ * cannot be coalesced into a single readv/writev. Instead, each wakeup
+ * drains what is pending, up to the batch size, before sending. */
+static size_t read_batch(struct qca_tapbridge *bridge)
+{
+	size_t n = 0;
+
+	while (n < bridge->conf.batch) {
+		uint8_t *buf = &bridge->txbufs[n * QCA_MAX_BUFSIZE];
+		const ssize_t len = read(bridge->fd, buf, QCA_MAX_BUFSIZE);
+
+		if (len <= 0) {
+			break;
+		}
+
+		bridge->txframes[n++] = (struct qca_iovec) {
+			.base = buf,
+			.len = (size_t)len,
+		};
+	}
+
+	return n;
+}
+
+static void *tx_task(void *arg)
+{
+	struct qca_tapbridge *bridge = (struct qca_tapbridge *)arg;
+
+	while (load_acquire(&bridge->running)) {
+		if (!wait_readable(bridge->fd, bridge->conf.poll_ms)) {
+			continue;
+		}
+
+		const size_t n = read_batch(bridge);
+
+		if (n) {
+			inc(&bridge->stats.tx_batches);
+		}
+
+		for (size_t i = 0; i < n;) {
+			const int sent = (*bridge->conf.send)(
+					&bridge->txframes[i], n - i,
+					bridge->conf.send_ctx);
+
+			if (sent <= 0) { /* drop the frame that failed */
+				inc(&bridge->stats.tx_errors);
+				i++;
+				continue;
+			}
+
+			for (int k = 0; k < sent; k++, i++) {
+				const size_t len = bridge->txframes[i].len;
+				inc(&bridge->stats.tx_frames);
+				add(&bridge->stats.tx_bytes, (uint32_t)len);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void *rx_task(void *arg)
+{
+	struct qca_tapbridge *bridge = (struct qca_tapbridge *)arg;
+
+	while (load_acquire(&bridge->running)) {
+		/* keep draining while the modem has frames, in one go */
+		const int len = (*bridge->conf.pump)(bridge->rxbuf,
+				bridge->conf.rx_bufsize, bridge->conf.pump_ctx);
+
+		if (len <= 0) {
+			usleep(bridge->conf.poll_ms * 1000U);
+		}
+	}
+
+	return NULL;
+}
+
+void qca_tapbridge_handler(const void *frame, size_t frame_size, void *ctx)
+{
+	struct qca_tapbridge *bridge = (struct qca_tapbridge *)ctx;
+
+	if (bridge == NULL || frame == NULL) {
+		return;
+	}
+
+	if (write(bridge->fd, frame, frame_size) != (ssize_t)frame_size) {
+		inc(&bridge->stats.rx_errors);
+		return;
+	}
+
+	inc(&bridge->stats.rx_frames);
+	add(&bridge->stats.rx_bytes, (uint32_t)frame_size);
+}
+
+int qca_tapbridge_fd(const struct qca_tapbridge *bridge)
+{
+	return bridge? bridge->fd : -1;
+}
+
+int qca_tapbridge_get_stats(const struct qca_tapbridge *bridge,
+		struct qca_tapbridge_stats *stats)
+{
+	if (bridge == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	stats->rx_frames = load(&bridge->stats.rx_frames);
+	stats->rx_bytes = load(&bridge->stats.rx_bytes);
+	stats->rx_errors = load(&bridge->stats.rx_errors);
+	stats->tx_frames = load(&bridge->stats.tx_frames);
+	stats->tx_bytes = load(&bridge->stats.tx_bytes);
+	stats->tx_errors = load(&bridge->stats.tx_errors);
+	stats->tx_batches = load(&bridge->stats.tx_batches);
+
+	return 0;
+}
+
+static void stop(struct qca_tapbridge *bridge, bool rx, bool tx)
+{
+	store_release(&bridge->running, false);
+
+	if (rx) {
+		pthread_join(bridge->rx_thread, NULL);
+	}
+	if (tx) {
+		pthread_join(bridge->tx_thread, NULL);
+	}
+}
+
+static int start(struct qca_tapbridge *bridge)
+{
+	int err;
+
+	bridge->running = true;
+
+	if ((err = pthread_create(&bridge->tx_thread, NULL,
+			tx_task, bridge))) {
+		bridge->running = false;
+		return -err;
+	}
+
+	if ((err = pthread_create(&bridge->rx_thread, NULL,
+			rx_task, bridge))) {
+		stop(bridge, false, true);
+		return -err;
+	}
+
+	return 0;
+}
+
+static void release(struct qca_tapbridge *bridge)
+{
+	if (bridge->own_fd && bridge->fd >= 0) {
+		close(bridge->fd);
+	}
+
+	free(bridge->txframes);
+	free(bridge->txbufs);
+	free(bridge->rxbuf);
+	free(bridge);
+}
+
+struct qca_tapbridge *qca_tapbridge_create(
+		const struct qca_tapbridge_conf *conf)
+{
+	if (conf == NULL || (conf->use_fd && conf->fd < 0)) {
+		return NULL;
+	}
+	if (conf->rx_bufsize && conf->rx_bufsize < QCA_MAX_BUFSIZE) {
+		QCA_ERROR("rx_bufsize %u is less than a frame",
+				conf->rx_bufsize);
+		return NULL;
+	}
+
+	struct qca_tapbridge *bridge =
+		(struct qca_tapbridge *)calloc(1, sizeof(*bridge));
+
+	if (bridge == NULL) {
+		return NULL;
+	}
+
+	bridge->conf = *conf;
+	bridge->fd = conf->use_fd? conf->fd : -1;
+
+	if (bridge->conf.batch == 0) {
+		bridge->conf.batch = QCA_TAPBRIDGE_DEFAULT_BATCH;
+	}
+	if (bridge->conf.poll_ms == 0) {
+		bridge->conf.poll_ms = QCA_TAPBRIDGE_DEFAULT_POLL_MS;
+	}
+	if (bridge->conf.rx_bufsize == 0) {
+		bridge->conf.rx_bufsize = QCA_TAPBRIDGE_DEFAULT_RX_BUFSIZE;
+	}
+	if (bridge->conf.send == NULL) {
+		bridge->conf.send = send_to_qca;
+	}
+	if (bridge->conf.pump == NULL) {
+		bridge->conf.pump = pump_qca;
+	}
+
+	bridge->rxbuf = (uint8_t *)malloc(bridge->conf.rx_bufsize);
+	bridge->txbufs = (uint8_t *)malloc(bridge->conf.batch *
+			QCA_MAX_BUFSIZE);
+	bridge->txframes = (struct qca_iovec *)calloc(bridge->conf.batch,
+			sizeof(*bridge->txframes));
+
+	if (!bridge->rxbuf || !bridge->txbufs || !bridge->txframes) {
+		QCA_ERROR("failed to allocate buffers");
+		goto out_err;
+	}
+
+	if (!conf->use_fd) {
+		if ((bridge->fd = open_tap(conf->ifname)) < 0) {
+			goto out_err;
+		}
+		bridge->own_fd = true;
+	}
+
+	/* the TX thread drains the descriptor until it would block */
+	const int flags = fcntl(bridge->fd, F_GETFL);
+
+	if (flags < 0 || fcntl(bridge->fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+			start(bridge) != 0) {
+		goto out_err;
+	}
+
+	return bridge;
+
+out_err:
+	release(bridge);
+	return NULL;
+}
+
+void qca_tapbridge_destroy(struct qca_tapbridge *bridge)
+{
+	if (bridge == NULL) {
+		return;
+	}
+
+	stop(bridge, true, true);
+	release(bridge);
+}
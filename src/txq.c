@@ -0,0 +1,311 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/txq.h"
+#include "qca/os.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define ETH_HEADER_LEN			14U
+#define ETHERTYPE_IPV4			0x0800U
+#define ETHERTYPE_ARP			0x0806U
+#define ETHERTYPE_VLAN			0x8100U
+#define ETHERTYPE_IPV6			0x86DDU
+#define ETHERTYPE_HOMEPLUG		0x887BU
+#define ETHERTYPE_HOMEPLUG_AV		0x88E1U
+#define FRAME_MAXLEN			1500U /* what qca_write_encoding takes */
+
+#if !defined(MIN)
+#define MIN(a, b)			(((a) > (b))? (b) : (a))
+#endif
+
+#if !defined(QCA_ERROR)
+#define QCA_ERROR(...)
+#endif
+
+struct slot {
+	uint16_t len;
+	uint8_t data[FRAME_MAXLEN];
+};
+
+struct queue {
+	struct slot *slots;
+	size_t depth;
+	size_t head;
+	size_t count;
+	uint8_t credit;
+};
+
+struct qca_txq {
+	struct qca_txq_conf conf;
+	struct queue queues[QCA_PRIO_MAX];
+	qca_os_lock_t lock;
+	struct qca_txq_stats stats;
+};
+
+static uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+/* Returns the queue to serve next, or -1 if all are empty. Called with the
+ * lock held. */
+static int pick_queue(struct qca_txq *txq)
+{
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < QCA_PRIO_MAX; i++) {
+			const struct queue *q = &txq->queues[i];
+
+			if (q->count == 0) {
+				continue;
+			}
+			if (txq->conf.weight[i] == 0 || q->credit > 0) {
+				return i;
+			}
+		}
+
+		/* every pending weighted queue used up its share. next round */
+		for (int i = 0; i < QCA_PRIO_MAX; i++) {
+			txq->queues[i].credit = txq->conf.weight[i];
+		}
+	}
+
+	return -1;
+}
+
+/* Lines up the frames at the head of the queue for one write, as many as
+ * its share and the limit allow. Queued slots are left alone by producers,
+ * so the frames are written from there without holding the lock. Called
+ * with the lock held. */
+static size_t collect(struct qca_txq *txq, int prio,
+		struct qca_iovec *frames, size_t limit)
+{
+	const struct queue *q = &txq->queues[prio];
+	size_t n = MIN(q->count, limit);
+
+	if (txq->conf.weight[prio]) {
+		n = MIN(n, q->credit);
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		const struct slot *slot = &q->slots[(q->head + i) % q->depth];
+		frames[i] = (struct qca_iovec) {
+			.base = slot->data, .len = slot->len };
+	}
+
+	return n;
+}
+
+static void pop(struct qca_txq *txq, int prio)
+{
+	struct queue *q = &txq->queues[prio];
+
+	qca_os_lock(&txq->lock);
+	q->head = (q->head + 1) % q->depth;
+	q->count--;
+	if (q->credit) {
+		q->credit--;
+	}
+	txq->stats.sent[prio]++;
+	qca_os_unlock(&txq->lock);
+}
+
+qca_prio_t qca_txq_classify(const void *frame, size_t frame_size)
+{
+	const uint8_t *p = (const uint8_t *)frame;
+
+	if (p == NULL || frame_size < ETH_HEADER_LEN) {
+		return QCA_PRIO_LOW;
+	}
+
+	uint16_t type = get_be16(&p[12]);
+
+	if (type == ETHERTYPE_VLAN && frame_size >= ETH_HEADER_LEN + 4) {
+		type = get_be16(&p[16]);
+	}
+
+	switch (type) {
+	case ETHERTYPE_HOMEPLUG_AV:
+	case ETHERTYPE_HOMEPLUG:
+		return QCA_PRIO_HIGH;
+	case ETHERTYPE_IPV4:
+	case ETHERTYPE_IPV6:
+	case ETHERTYPE_ARP:
+		return QCA_PRIO_NORMAL;
+	default:
+		return QCA_PRIO_LOW;
+	}
+}
+
+int qca_txq_enqueue(struct qca_txq *txq,
+		const void *frame, size_t frame_size, qca_prio_t prio)
+{
+	if (txq == NULL || frame == NULL || frame_size == 0 ||
+			frame_size > FRAME_MAXLEN || prio >= QCA_PRIO_MAX) {
+		return -EINVAL;
+	}
+
+	struct queue *q = &txq->queues[prio];
+	int err = 0;
+
+	qca_os_lock(&txq->lock);
+
+	if (q->count >= q->depth) {
+		txq->stats.drops[prio]++;
+		err = -ENOBUFS;
+	} else {
+		struct slot *slot = &q->slots[(q->head + q->count) % q->depth];
+
+		memcpy(slot->data, frame, frame_size);
+		slot->len = (uint16_t)frame_size;
+		q->count++;
+
+		txq->stats.enqueued[prio]++;
+		if (q->count > txq->stats.peak[prio]) {
+			txq->stats.peak[prio] = (uint32_t)q->count;
+		}
+	}
+
+	qca_os_unlock(&txq->lock);
+
+	return err;
+}
+
+int qca_txq_send(struct qca_txq *txq, const void *frame, size_t frame_size)
+{
+	return qca_txq_enqueue(txq, frame, frame_size,
+			qca_txq_classify(frame, frame_size));
+}
+
+int qca_txq_flush(struct qca_txq *txq, size_t budget)
+{
+	if (txq == NULL) {
+		return -EINVAL;
+	}
+
+	size_t sent = 0;
+	int err = 0;
+
+	while (budget == 0 || sent < budget) {
+		struct qca_iovec frames[QCA_TX_COALESCE_MAX_FRAMES];
+		const size_t limit = budget?
+			MIN(budget - sent, QCA_TX_COALESCE_MAX_FRAMES) :
+			QCA_TX_COALESCE_MAX_FRAMES;
+
+		qca_os_lock(&txq->lock);
+		const int prio = pick_queue(txq);
+		const size_t n = prio < 0? 0 : collect(txq, prio, frames, limit);
+		qca_os_unlock(&txq->lock);
+
+		if (n == 0) {
+			break;
+		}
+
+		const int written = qca_write_frames_prio(frames, n,
+				(qca_prio_t)prio);
+
+		if (written < 0) {
+			err = written;
+			qca_os_lock(&txq->lock);
+			txq->stats.errors++;
+			qca_os_unlock(&txq->lock);
+			break;
+		}
+
+		for (int i = 0; i < written; i++) {
+			pop(txq, prio);
+		}
+		sent += (size_t)written;
+	}
+
+	return sent? (int)sent : err;
+}
+
+size_t qca_txq_length(struct qca_txq *txq, qca_prio_t prio)
+{
+	if (txq == NULL || prio >= QCA_PRIO_MAX) {
+		return 0;
+	}
+
+	qca_os_lock(&txq->lock);
+	const size_t len = txq->queues[prio].count;
+	qca_os_unlock(&txq->lock);
+
+	return len;
+}
+
+int qca_txq_get_stats(struct qca_txq *txq, struct qca_txq_stats *stats)
+{
+	if (txq == NULL || stats == NULL) {
+		return -EINVAL;
+	}
+
+	qca_os_lock(&txq->lock);
+	*stats = txq->stats;
+	qca_os_unlock(&txq->lock);
+
+	return 0;
+}
+
+struct qca_txq *qca_txq_create(const struct qca_txq_conf *conf)
+{
+	struct qca_txq *txq = (struct qca_txq *)qca_os_malloc(sizeof(*txq));
+
+	if (txq == NULL) {
+		return NULL;
+	}
+
+	memset(txq, 0, sizeof(*txq));
+
+	if (conf) {
+		txq->conf = *conf;
+	}
+
+	for (int i = 0; i < QCA_PRIO_MAX; i++) {
+		struct queue *q = &txq->queues[i];
+
+		if (txq->conf.depth[i] == 0) {
+			txq->conf.depth[i] = QCA_TXQ_DEFAULT_DEPTH;
+		}
+
+		q->depth = txq->conf.depth[i];
+		q->credit = txq->conf.weight[i];
+		q->slots = (struct slot *)
+			qca_os_malloc(q->depth * sizeof(*q->slots));
+
+		if (q->slots == NULL) {
+			QCA_ERROR("failed to allocate txq %d", i);
+			goto out_free;
+		}
+	}
+
+	qca_os_lock_init(&txq->lock);
+
+	return txq;
+
+out_free:
+	for (int i = 0; i < QCA_PRIO_MAX; i++) {
+		qca_os_free(txq->queues[i].slots);
+	}
+	qca_os_free(txq);
+	return NULL;
+}
+
+void qca_txq_destroy(struct qca_txq *txq)
+{
+	if (txq == NULL) {
+		return;
+	}
+
+	qca_os_lock_deinit(&txq->lock);
+
+	for (int i = 0; i < QCA_PRIO_MAX; i++) {
+		qca_os_free(txq->queues[i].slots);
+	}
+
+	qca_os_free(txq);
+}
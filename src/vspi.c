@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "qca/vspi.h"
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+int lm_spi_writeread(struct lm_spi_device *self,
+		const void *txdata, size_t txdata_len,
+		void *rxbuf, size_t rxbuf_len)
+{
+	if (self == NULL || self->writeread == NULL) {
+		return -ENODEV;
+	}
+
+	return (*self->writeread)(self, txdata, txdata_len, rxbuf, rxbuf_len);
+}
+
+int qca_spi_writev(struct lm_spi_device *spi,
+		const struct qca_iovec *iov, size_t iovcnt,
+		void *rx, size_t rxsize)
+{
+	if (spi == NULL) {
+		return -ENODEV;
+	} else if (spi->writev) {
+		return (*spi->writev)(spi, iov, iovcnt, rx, rxsize);
+	} else if (iovcnt == 1) {
+		return lm_spi_writeread(spi, iov[0].base, iov[0].len,
+				rx, rxsize);
+	}
+
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	size_t len = 0;
+
+	for (size_t i = 0; i < iovcnt; i++) {
+		if (iov[i].len > sizeof(buf) - len) {
+			return -EINVAL;
+		}
+		memcpy(&buf[len], iov[i].base, iov[i].len);
+		len += iov[i].len;
+	}
+
+	return lm_spi_writeread(spi, buf, len, rx, rxsize);
+}
@@ -0,0 +1,28 @@
+COMPONENT_NAME = CAPTURE
+
+SRC_FILES = \
+	../src/capture.c \
+	../src/qca.c \
+	../src/os.c \
+	../src/emu.c \
+	../src/vspi.c \
+	../external/libmcu/modules/common/src/ringbuf.c \
+
+TEST_SRC_FILES = \
+	src/capture_test.cpp \
+	stubs/logging.c \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	../external/libmcu/modules/logging/include \
+	../external/libmcu/modules/common/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DUNIT_TEST \
+		    -include ../external/libmcu/modules/logging/include/libmcu/logging.h \
+
+LDFLAGS = -lpthread
+
+include runners/MakefileRunner
@@ -0,0 +1,24 @@
+COMPONENT_NAME = CORO
+
+SRC_FILES = \
+	../src/mme.c \
+
+TEST_SRC_FILES = \
+	src/coro_test.cpp \
+	stubs/logging.c \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	../external/libmcu/modules/logging/include \
+	../external/libmcu/modules/common/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DUNIT_TEST \
+		    -include ../external/libmcu/modules/logging/include/libmcu/logging.h \
+
+# the coroutine lowering of GCC emits switches with no default
+CPPUTEST_CXXFLAGS = -std=c++20 -Wno-switch-default
+
+include runners/MakefileRunner
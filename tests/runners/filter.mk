@@ -0,0 +1,23 @@
+COMPONENT_NAME = FILTER
+
+SRC_FILES = \
+	../src/filter.c \
+	../src/mme.c \
+	../src/os.c \
+
+TEST_SRC_FILES = \
+	src/filter_test.cpp \
+	stubs/logging.c \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	../external/libmcu/modules/logging/include \
+	../external/libmcu/modules/common/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DUNIT_TEST \
+		    -include ../external/libmcu/modules/logging/include/libmcu/logging.h \
+
+include runners/MakefileRunner
@@ -0,0 +1,25 @@
+COMPONENT_NAME = NVMZ
+
+SRC_FILES = \
+	../src/nvmz.c \
+	../src/nvmz_pack.c \
+	../src/nvm.c \
+	../src/os.c \
+	../external/libmcu/modules/common/src/ringbuf.c \
+
+TEST_SRC_FILES = \
+	src/nvmz_test.cpp \
+	stubs/logging.c \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	../external/libmcu/modules/logging/include \
+	../external/libmcu/modules/common/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DUNIT_TEST \
+		    -include ../external/libmcu/modules/logging/include/libmcu/logging.h \
+
+include runners/MakefileRunner
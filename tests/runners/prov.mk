@@ -0,0 +1,30 @@
+COMPONENT_NAME = PROV
+
+SRC_FILES = \
+	../src/prov.c \
+	../src/qca.c \
+	../src/os.c \
+	../src/mme.c \
+	../src/nvm.c \
+	../src/emu.c \
+	../src/vspi.c \
+	../external/libmcu/modules/common/src/ringbuf.c \
+
+TEST_SRC_FILES = \
+	src/prov_test.cpp \
+	stubs/logging.c \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+	../external/libmcu/modules/logging/include \
+	../external/libmcu/modules/common/include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DUNIT_TEST \
+		    -include ../external/libmcu/modules/logging/include/libmcu/logging.h \
+
+LDFLAGS = -lpthread
+
+include runners/MakefileRunner
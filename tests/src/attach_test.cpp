@@ -0,0 +1,66 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/attach.h"
+#include "qca/mme.h"
+
+static size_t make_cnf(struct qca_mme_sw_ver_cnf *cnf, const char *version) {
+	memset(cnf, 0, sizeof(*cnf));
+	cnf->version_len = (uint8_t)(strlen(version) + 1);
+	memcpy(cnf->version, version, cnf->version_len);
+	return sizeof(*cnf);
+}
+
+TEST_GROUP(ATTACH) {
+	struct qca_mme_sw_ver_cnf cnf;
+	struct qca_attach_record rec;
+	uint64_t fp;
+
+	void setup(void) {
+		const uint8_t fw[] = { 1, 2, 3, 4 };
+		const uint8_t pib[] = { 5, 6 };
+		fp = qca_attach_fingerprint(fw, sizeof(fw),
+				QCA_ATTACH_FINGERPRINT_INIT);
+		fp = qca_attach_fingerprint(pib, sizeof(pib), fp);
+		make_cnf(&cnf, "MAC-QCA7000-1.2.5.3207-00");
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ATTACH, fingerprint_ShouldChange_WhenAnyByteChanges) {
+	const uint8_t a[] = { 1, 2, 3, 4, 5, 6 };
+	const uint8_t b[] = { 1, 2, 3, 4, 5, 7 };
+
+	CHECK(fp == qca_attach_fingerprint(a, sizeof(a),
+			QCA_ATTACH_FINGERPRINT_INIT));
+	CHECK(fp != qca_attach_fingerprint(b, sizeof(b),
+			QCA_ATTACH_FINGERPRINT_INIT));
+}
+
+TEST(ATTACH, match_ShouldReturnTrue_WhenVersionAndImagesAreSame) {
+	LONGS_EQUAL(0, qca_attach_save(&rec, &cnf, sizeof(cnf), fp));
+	CHECK(qca_attach_match(&rec, &cnf, sizeof(cnf), fp));
+}
+
+TEST(ATTACH, match_ShouldReturnFalse_WhenImagesChanged) {
+	qca_attach_save(&rec, &cnf, sizeof(cnf), fp);
+	CHECK_FALSE(qca_attach_match(&rec, &cnf, sizeof(cnf), fp + 1));
+}
+
+TEST(ATTACH, match_ShouldReturnFalse_WhenModemRunsAnotherVersion) {
+	qca_attach_save(&rec, &cnf, sizeof(cnf), fp);
+	make_cnf(&cnf, "MAC-QCA7000-1.2.5.3208-00");
+	CHECK_FALSE(qca_attach_match(&rec, &cnf, sizeof(cnf), fp));
+}
+
+TEST(ATTACH, save_ShouldFail_WhenConfirmationTellsFailure) {
+	cnf.status = 1;
+	LONGS_EQUAL(-EINVAL, qca_attach_save(&rec, &cnf, sizeof(cnf), fp));
+	LONGS_EQUAL(-EINVAL, qca_attach_save(&rec, &cnf, 2, fp));
+	CHECK_FALSE(qca_attach_match(&rec, &cnf, sizeof(cnf), fp));
+}
@@ -0,0 +1,126 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+
+#define FRAME_MINLEN		(12U + QCA_MIN_PACKET_LEN + 2U)
+
+static struct qca_emu *emu;
+
+/* Time goes by only as the emulator spends it on the bus, so that the
+ * probes measure exactly the cost configured. */
+uint64_t fake_clock_us(void) {
+	struct qca_emu_stats stats = { 0, };
+
+	if (emu) {
+		qca_emu_get_stats(emu, &stats);
+	}
+
+	return stats.busy_ns / 1000U;
+}
+
+TEST_GROUP(CALIBRATE) {
+	struct qca_spi_profile profile;
+
+	void setup(void) {
+		emu = NULL;
+		memset(&profile, 0, sizeof(profile));
+	}
+	void teardown(void) {
+		qca_deinit();
+		qca_emu_destroy(emu);
+		emu = NULL;
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void start(uint32_t transaction_ns, uint32_t byte_ns) {
+		struct qca_emu_conf conf = {
+			.rdbuf_size = 0,
+			.wrbuf_size = 0,
+			.transaction_ns = transaction_ns,
+			.byte_ns = byte_ns,
+		};
+		emu = qca_emu_create(&conf);
+		qca_init(qca_emu_device(emu), NULL, NULL);
+	}
+};
+
+TEST(CALIBRATE, ShouldFitBusCost) {
+	start(20000, 1000);
+
+	LONGS_EQUAL(0, qca_calibrate(&profile));
+
+	LONGS_EQUAL(20000, profile.transaction_ns);
+	LONGS_EQUAL(1000, profile.byte_ns);
+}
+
+TEST(CALIBRATE, ShouldBoundTransfersByLatencyBudget) {
+	start(20000, 1000);
+
+	qca_calibrate(&profile);
+
+	/* 500us less the fixed 20us at 1us a byte, the command aside */
+	LONGS_EQUAL(478, profile.rx_chunk);
+	LONGS_EQUAL(478, profile.tx_coalesce);
+}
+
+TEST(CALIBRATE, ShouldTakeWholeBuffer_WhenBusFastEnough) {
+	start(0, 100);
+
+	qca_calibrate(&profile);
+
+	LONGS_EQUAL(QCA_MAX_BUFSIZE - 2, profile.rx_chunk);
+	LONGS_EQUAL(QCA_MAX_BUFSIZE - 2, profile.tx_coalesce);
+}
+
+TEST(CALIBRATE, ShouldNotCoalesce_WhenTwoFramesExceedBudget) {
+	start(400000, 1000);
+
+	qca_calibrate(&profile);
+
+	LONGS_EQUAL(98, profile.rx_chunk);
+	LONGS_EQUAL(0, profile.tx_coalesce);
+}
+
+TEST(CALIBRATE, ShouldReadWholeFrame_WhenBudgetTooTight) {
+	start(480000, 1000);
+
+	qca_calibrate(&profile);
+
+	LONGS_EQUAL(FRAME_MINLEN, profile.rx_chunk);
+	LONGS_EQUAL(0, profile.tx_coalesce);
+}
+
+TEST(CALIBRATE, ShouldSetWatermarks) {
+	uint16_t value = 0;
+	start(20000, 1000);
+
+	qca_calibrate(&profile);
+
+	qca_read_reg(QCA_REG_RDBUF_WATERMARK, &value);
+	LONGS_EQUAL(FRAME_MINLEN, value);
+	LONGS_EQUAL(profile.rdbuf_watermark, value);
+	/* room for the largest frame, above the coalesced write */
+	qca_read_reg(QCA_REG_WRBUF_WATERMARK, &value);
+	LONGS_EQUAL(QCA_EMU_HW_BUFSIZE - 1510, value);
+}
+
+TEST(CALIBRATE, ShouldApplySavedProfile_AfterReset) {
+	struct qca_spi_profile saved;
+	uint16_t value = 0;
+	start(20000, 1000);
+	qca_calibrate(&profile);
+
+	qca_reset();
+	LONGS_EQUAL(0, qca_set_spi_profile(&profile));
+
+	qca_get_spi_profile(&saved);
+	MEMCMP_EQUAL(&profile, &saved, sizeof(profile));
+	qca_read_reg(QCA_REG_RDBUF_WATERMARK, &value);
+	LONGS_EQUAL(profile.rdbuf_watermark, value);
+}
@@ -0,0 +1,213 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/capture.h"
+
+#define SHB_LEN		28
+#define IDB_LEN		20
+#define EPB_FIXED_LEN	44
+
+static uint32_t get_u32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static void make_frame(uint8_t *frame, size_t len, uint16_t ethertype) {
+	memset(frame, 0xA5, len);
+	frame[12] = (uint8_t)(ethertype >> 8);
+	frame[13] = (uint8_t)ethertype;
+}
+
+TEST_GROUP(CAPTURE) {
+	struct qca_capture *cap;
+	struct qca_capture_stats stats;
+	FILE *file;
+	uint8_t out[16384];
+	size_t outlen;
+
+	void setup(void) {
+		cap = NULL;
+		file = tmpfile();
+		outlen = 0;
+	}
+	void teardown(void) {
+		qca_capture_destroy(cap);
+		fclose(file);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void start(const struct qca_capture_conf *conf) {
+		cap = qca_capture_create(conf);
+		CHECK(cap != NULL);
+		LONGS_EQUAL(0, qca_capture_start(cap, fileno(file)));
+	}
+	void stop_and_collect(void) {
+		LONGS_EQUAL(0, qca_capture_stop(cap));
+		lseek(fileno(file), 0, SEEK_SET);
+		const ssize_t n = read(fileno(file), out, sizeof(out));
+		CHECK(n >= 0);
+		outlen = (size_t)n;
+		qca_capture_get_stats(cap, &stats);
+	}
+	const uint8_t *epb(unsigned index) {
+		size_t off = SHB_LEN + IDB_LEN;
+		for (unsigned i = 0; i < index && off < outlen; i++) {
+			off += get_u32(&out[off + 4]);
+		}
+		return &out[off < sizeof(out)? off : 0];
+	}
+};
+
+TEST(CAPTURE, start_ShouldWriteSectionAndInterfaceHeaders) {
+	struct qca_capture_conf conf = { .snaplen = 128, };
+	start(&conf);
+	stop_and_collect();
+
+	LONGS_EQUAL(SHB_LEN + IDB_LEN, outlen);
+	LONGS_EQUAL(0x0A0D0D0A, get_u32(&out[0]));
+	LONGS_EQUAL(SHB_LEN, get_u32(&out[4]));
+	LONGS_EQUAL(0x1A2B3C4D, get_u32(&out[8]));
+	LONGS_EQUAL(1, get_u16(&out[12]));
+	LONGS_EQUAL(SHB_LEN, get_u32(&out[SHB_LEN - 4]));
+
+	const uint8_t *idb = &out[SHB_LEN];
+	LONGS_EQUAL(1, get_u32(&idb[0]));
+	LONGS_EQUAL(IDB_LEN, get_u32(&idb[4]));
+	LONGS_EQUAL(1, get_u16(&idb[8])); /* LINKTYPE_ETHERNET */
+	LONGS_EQUAL(128, get_u32(&idb[12]));
+	LONGS_EQUAL(IDB_LEN, get_u32(&idb[16]));
+}
+
+TEST(CAPTURE, frame_ShouldBeWrittenAsEnhancedPacketBlock) {
+	uint8_t frame[61];
+	make_frame(frame, sizeof(frame), 0x0800);
+
+	start(NULL);
+	qca_capture_frame(QCA_DIR_RX, frame, sizeof(frame), cap);
+	qca_capture_frame(QCA_DIR_TX, frame, sizeof(frame), cap);
+	stop_and_collect();
+
+	LONGS_EQUAL(2, stats.captured);
+	LONGS_EQUAL(2, stats.written);
+	LONGS_EQUAL(0, stats.write_errors);
+
+	const uint32_t block_len = EPB_FIXED_LEN + 64; /* padded to 4 */
+	LONGS_EQUAL(SHB_LEN + IDB_LEN + block_len * 2, outlen);
+
+	const uint8_t *p = epb(0);
+	LONGS_EQUAL(6, get_u32(&p[0]));
+	LONGS_EQUAL(block_len, get_u32(&p[4]));
+	LONGS_EQUAL(0, get_u32(&p[8]));
+	LONGS_EQUAL(sizeof(frame), get_u32(&p[20]));
+	LONGS_EQUAL(sizeof(frame), get_u32(&p[24]));
+	MEMCMP_EQUAL(frame, &p[28], sizeof(frame));
+	LONGS_EQUAL(0, p[28 + sizeof(frame)]); /* padding */
+	LONGS_EQUAL(2, get_u16(&p[28 + 64])); /* epb_flags */
+	LONGS_EQUAL(4, get_u16(&p[28 + 64 + 2]));
+	LONGS_EQUAL(1, get_u32(&p[28 + 64 + 4])); /* inbound */
+	LONGS_EQUAL(0, get_u32(&p[28 + 64 + 8])); /* opt_endofopt */
+	LONGS_EQUAL(block_len, get_u32(&p[block_len - 4]));
+
+	p = epb(1);
+	LONGS_EQUAL(2, get_u32(&p[28 + 64 + 4])); /* outbound */
+}
+
+TEST(CAPTURE, frame_ShouldBeTruncated_WhenLongerThanSnaplen) {
+	struct qca_capture_conf conf = { .snaplen = 32, };
+	uint8_t frame[200];
+	make_frame(frame, sizeof(frame), 0x0800);
+
+	start(&conf);
+	qca_capture_frame(QCA_DIR_RX, frame, sizeof(frame), cap);
+	stop_and_collect();
+
+	const uint8_t *p = epb(0);
+	LONGS_EQUAL(EPB_FIXED_LEN + 32, get_u32(&p[4]));
+	LONGS_EQUAL(32, get_u32(&p[20]));
+	LONGS_EQUAL(sizeof(frame), get_u32(&p[24]));
+	MEMCMP_EQUAL(frame, &p[28], 32);
+}
+
+TEST(CAPTURE, frame_ShouldBeFiltered_WhenNotHomePlug) {
+	struct qca_capture_conf conf = {
+		.flags = QCA_CAPTURE_RX | QCA_CAPTURE_HOMEPLUG_ONLY,
+	};
+	uint8_t ip[64];
+	uint8_t hpav[64];
+	make_frame(ip, sizeof(ip), 0x0800);
+	make_frame(hpav, sizeof(hpav), 0x88E1);
+
+	start(&conf);
+	qca_capture_frame(QCA_DIR_RX, ip, sizeof(ip), cap);
+	qca_capture_frame(QCA_DIR_RX, hpav, sizeof(hpav), cap);
+	qca_capture_frame(QCA_DIR_TX, hpav, sizeof(hpav), cap);
+	qca_capture_frame(QCA_DIR_RX, ip, 10, cap); /* runt */
+	stop_and_collect();
+
+	LONGS_EQUAL(1, stats.captured);
+	LONGS_EQUAL(3, stats.filtered);
+	LONGS_EQUAL(1, stats.written);
+	LONGS_EQUAL(0x88E1, ((uint16_t)epb(0)[28 + 12] << 8) | epb(0)[28 + 13]);
+}
+
+TEST(CAPTURE, frame_ShouldBeDropped_WhenRingFull) {
+	struct qca_capture_conf conf = { .slots = 3, .snaplen = 64, };
+	uint8_t frame[64];
+	make_frame(frame, sizeof(frame), 0x0800);
+
+	/* nothing drains the ring until the writer starts */
+	cap = qca_capture_create(&conf);
+	for (unsigned i = 0; i < 6; i++) {
+		frame[0] = (uint8_t)i;
+		qca_capture_frame(QCA_DIR_RX, frame, sizeof(frame), cap);
+	}
+	qca_capture_get_stats(cap, &stats);
+	LONGS_EQUAL(4, stats.captured); /* rounded up to a power of two */
+	LONGS_EQUAL(2, stats.dropped);
+
+	LONGS_EQUAL(0, qca_capture_start(cap, fileno(file)));
+	stop_and_collect();
+
+	LONGS_EQUAL(4, stats.written);
+	for (unsigned i = 0; i < 4; i++) {
+		LONGS_EQUAL(i, epb(i)[28]);
+	}
+}
+
+TEST(CAPTURE, start_ShouldInstallTap_WhenDriverRunning) {
+	struct qca_emu *emu = qca_emu_create(NULL);
+	uint8_t frame[60];
+	make_frame(frame, sizeof(frame), 0x88E1);
+
+	qca_init(qca_emu_device(emu), NULL, NULL);
+	start(NULL);
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	stop_and_collect();
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	qca_deinit();
+	qca_emu_destroy(emu);
+
+	LONGS_EQUAL(1, stats.written);
+	MEMCMP_EQUAL(frame, &epb(0)[28], sizeof(frame));
+}
+
+TEST(CAPTURE, start_ShouldReturnEINVAL_WhenInvalidFd) {
+	cap = qca_capture_create(NULL);
+	LONGS_EQUAL(-EINVAL, qca_capture_start(cap, -1));
+	LONGS_EQUAL(-EALREADY, qca_capture_stop(cap));
+}
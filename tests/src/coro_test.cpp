@@ -0,0 +1,176 @@
+/* before CppUTest, whose leak detector redefines new */
+#include "qca/coro.hpp"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const uint8_t host[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t modem[6] = { 0x00, 0xB0, 0x52, 0x12, 0x34, 0x56 };
+
+static uint8_t sent[4][64];
+static size_t nr_sent;
+
+static int send_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)ctx;
+	if (nr_sent < 4) {
+		memcpy(sent[nr_sent], frame,
+				frame_size < 64? frame_size : 64);
+	}
+	nr_sent++;
+	return mock().actualCall(__func__).returnIntValueOrDefault(0);
+}
+
+static size_t make_cnf_from(uint8_t *frame, const uint8_t *src,
+		uint16_t mmtype, uint8_t first) {
+	memset(frame, 0, 64);
+	qca_mme_put_header(frame, host, src, mmtype);
+	frame[19] = 0x00;
+	frame[20] = 0xB0;
+	frame[21] = 0x52;
+	frame[22] = first;
+	return 64;
+}
+
+static size_t make_cnf(uint8_t *frame, uint16_t mmtype, uint8_t first) {
+	return make_cnf_from(frame, modem, mmtype, first);
+}
+
+static int results[4];
+static size_t nr_results;
+static uint8_t first_byte;
+
+static qca::task<void> get_version(qca::device &dev) {
+	qca::response r = co_await dev.sw_version();
+	results[nr_results++] = r.err;
+	if (r.err == 0) {
+		first_byte = r.body()[0];
+	}
+}
+
+static qca::task<void> read_pib(qca::device &dev) {
+	qca::response r = co_await dev.module_read(qca::module_id::pib,
+			0x100, 1024, 50);
+	results[nr_results++] = r.err;
+}
+
+TEST_GROUP(CORO) {
+	qca::event_loop *loop;
+	qca::device *dev;
+	uint8_t frame[64];
+
+	void setup(void) {
+		nr_sent = 0;
+		nr_results = 0;
+		first_byte = 0;
+		mock().ignoreOtherCalls();
+		loop = new qca::event_loop();
+		dev = new qca::device(*loop, host, modem, send_frame, NULL);
+	}
+	void teardown(void) {
+		delete dev;
+		delete loop;
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(CORO, ShouldSendRequest_WhenAwaited) {
+	LONGS_EQUAL(0, loop->spawn(get_version(*dev)));
+
+	LONGS_EQUAL(1, nr_sent);
+	MEMCMP_EQUAL(modem, &sent[0][0], 6);
+	MEMCMP_EQUAL(host, &sent[0][6], 6);
+	LONGS_EQUAL(0x88, sent[0][12]);
+	LONGS_EQUAL(0x00, sent[0][15]);
+	LONGS_EQUAL(0xA0, sent[0][16]);
+	LONGS_EQUAL(0, nr_results);
+}
+
+TEST(CORO, ShouldResume_WhenConfirmed) {
+	loop->spawn(get_version(*dev));
+
+	CHECK(loop->input(*dev, frame, make_cnf(frame, 0xA001, 0x5A)));
+	LONGS_EQUAL(0, nr_results);
+	LONGS_EQUAL(1, loop->tick(1));
+	LONGS_EQUAL(1, nr_results);
+	LONGS_EQUAL(0, results[0]);
+	LONGS_EQUAL(0x5A, first_byte);
+	CHECK(loop->idle());
+}
+
+TEST(CORO, input_ShouldIgnoreFrames_WhenNoRequestMatches) {
+	loop->spawn(get_version(*dev));
+
+	CHECK_FALSE(loop->input(*dev, frame, make_cnf(frame, 0xA025, 0)));
+	CHECK_FALSE(loop->input(*dev, frame, make_cnf(frame, 0xA000, 0)));
+	CHECK_FALSE(loop->idle());
+}
+
+TEST(CORO, input_ShouldIgnoreConfirmation_WhenFromAnotherStation) {
+	const uint8_t station[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x99 };
+	loop->spawn(get_version(*dev));
+
+	CHECK_FALSE(loop->input(*dev, frame,
+				make_cnf_from(frame, station, 0xA001, 0)));
+	CHECK_FALSE(loop->idle());
+	CHECK(loop->input(*dev, frame, make_cnf(frame, 0xA001, 0)));
+}
+
+TEST(CORO, input_ShouldCompleteOnlyRequestsOfGivenDevice) {
+	const uint8_t modem2[6] = { 0x00, 0xB0, 0x52, 0x65, 0x43, 0x21 };
+	qca::device dev2(*loop, host, modem2, send_frame, NULL);
+
+	loop->spawn(get_version(*dev));
+	loop->spawn(get_version(dev2));
+
+	CHECK(loop->input(dev2, frame,
+				make_cnf_from(frame, modem2, 0xA001, 0x22)));
+	LONGS_EQUAL(1, loop->tick(1));
+	LONGS_EQUAL(0x22, first_byte);
+	CHECK_FALSE(loop->input(dev2, frame,
+				make_cnf_from(frame, modem2, 0xA001, 0x33)));
+	CHECK(loop->input(*dev, frame, make_cnf(frame, 0xA001, 0x11)));
+	LONGS_EQUAL(1, loop->tick(2));
+	LONGS_EQUAL(0x11, first_byte);
+	CHECK(loop->idle());
+}
+
+TEST(CORO, ShouldTimeout_WhenNotConfirmed) {
+	loop->tick(1000);
+	loop->spawn(read_pib(*dev));
+
+	LONGS_EQUAL(0x24, sent[0][15]);
+	LONGS_EQUAL(0x02, sent[0][22]); /* module after the OUI */
+	LONGS_EQUAL(0, loop->tick(1049));
+	LONGS_EQUAL(1, loop->tick(1050));
+	LONGS_EQUAL(-ETIMEDOUT, results[0]);
+}
+
+TEST(CORO, ShouldRunRequestsConcurrently) {
+	loop->spawn(get_version(*dev));
+	loop->spawn(read_pib(*dev));
+	LONGS_EQUAL(2, nr_sent);
+
+	loop->input(*dev, frame, make_cnf(frame, 0xA025, 0));
+	loop->input(*dev, frame, make_cnf(frame, 0xA001, 0));
+	LONGS_EQUAL(2, loop->tick(1));
+	LONGS_EQUAL(2, nr_results);
+}
+
+TEST(CORO, ShouldComplete_WhenCancelled) {
+	loop->spawn(get_version(*dev));
+	dev->cancel();
+	loop->tick(1);
+	LONGS_EQUAL(-ECANCELED, results[0]);
+}
+
+TEST(CORO, ShouldResumeAtOnce_WhenSendFails) {
+	mock().expectOneCall("send_frame").andReturnValue(-EIO);
+	loop->spawn(get_version(*dev));
+	LONGS_EQUAL(1, nr_results);
+	LONGS_EQUAL(-EIO, results[0]);
+}
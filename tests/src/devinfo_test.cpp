@@ -0,0 +1,142 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/devinfo.h"
+
+static int request(qca_mmtype_t type, void *ctx) {
+	(void)ctx;
+	return mock().actualCall(__func__)
+		.withParameter("type", type)
+		.returnIntValueOrDefault(0);
+}
+
+TEST_GROUP(DEVINFO) {
+	struct qca_devinfo *cache;
+	struct qca_devinfo_conf conf;
+	uint8_t buf[QCA_DEVINFO_MAXLEN];
+
+	void setup(void) {
+		memset(&conf, 0, sizeof(conf));
+		conf.ttl_ms[QCA_DEVINFO_SW_VER] = 60000;
+		conf.timeout_ms = 100;
+		conf.request = request;
+		cache = qca_devinfo_create(&conf);
+	}
+	void teardown(void) {
+		qca_devinfo_destroy(cache);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void fill(void) {
+		const uint8_t ver[] = { 0, 1, 2, 3 };
+		qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_SW_VER, QCA_MME_CNF),
+				ver, sizeof(ver), 0);
+		qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_NW_INFO, QCA_MME_CNF),
+				ver, sizeof(ver), 0);
+		qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_NW_STAT, QCA_MME_CNF),
+				ver, sizeof(ver), 0);
+	}
+};
+
+TEST(DEVINFO, poll_ShouldRequestEveryItem_WhenEmpty) {
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_SW_VER);
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_INFO);
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_STAT);
+	qca_devinfo_poll(cache, 0);
+}
+
+TEST(DEVINFO, poll_ShouldNotRequestAgain_WhenOutstanding) {
+	mock().expectNCalls(3, "request").ignoreOtherParameters();
+	qca_devinfo_poll(cache, 0);
+	qca_devinfo_poll(cache, 99);
+	mock().checkExpectations();
+
+	mock().expectNCalls(3, "request").ignoreOtherParameters();
+	qca_devinfo_poll(cache, 100);
+}
+
+TEST(DEVINFO, get_ShouldReturnNoData_WhenNotReceivedYet) {
+	LONGS_EQUAL(-ENODATA, qca_devinfo_get(cache, QCA_DEVINFO_SW_VER,
+				buf, sizeof(buf), NULL));
+}
+
+TEST(DEVINFO, get_ShouldReturnCachedConfirmation) {
+	const uint8_t ver[] = { 0, 7, 'v', '1' };
+	uint32_t updated;
+
+	LONGS_EQUAL(0, qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_SW_VER, QCA_MME_CNF),
+				ver, sizeof(ver), 1234));
+	LONGS_EQUAL(sizeof(ver), qca_devinfo_get(cache, QCA_DEVINFO_SW_VER,
+				buf, sizeof(buf), &updated));
+	MEMCMP_EQUAL(ver, buf, sizeof(ver));
+	LONGS_EQUAL(1234, updated);
+}
+
+TEST(DEVINFO, input_ShouldIgnoreUninterestedMessages) {
+	const uint8_t body[4] = { 0, };
+
+	LONGS_EQUAL(-ENOMSG, qca_devinfo_input(cache, 0x6064,
+				body, sizeof(body), 0));
+	LONGS_EQUAL(-ENOMSG, qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_HST_ACTION, QCA_MME_CNF),
+				body, sizeof(body), 0));
+	LONGS_EQUAL(-ENOMSG, qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_SW_VER, QCA_MME_IND),
+				body, sizeof(body), 0));
+}
+
+TEST(DEVINFO, poll_ShouldRequestOnlyExpiredItems) {
+	fill();
+
+	qca_devinfo_poll(cache, QCA_DEVINFO_DEFAULT_TTL_MS - 1);
+	mock().checkExpectations();
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_INFO);
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_STAT);
+	qca_devinfo_poll(cache, QCA_DEVINFO_DEFAULT_TTL_MS);
+}
+
+TEST(DEVINFO, handle_interrupt_ShouldInvalidateAll_WhenCpuStarted) {
+	fill();
+
+	qca_devinfo_handle_interrupt(cache, 0x0002);
+	qca_devinfo_poll(cache, 1);
+	mock().checkExpectations();
+
+	mock().expectNCalls(3, "request").ignoreOtherParameters();
+	qca_devinfo_handle_interrupt(cache, 0x0040);
+	qca_devinfo_poll(cache, 2);
+	mock().checkExpectations();
+
+	/* the last values stay readable until refreshed */
+	LONGS_EQUAL(4, qca_devinfo_get(cache, QCA_DEVINFO_SW_VER,
+				buf, sizeof(buf), NULL));
+}
+
+TEST(DEVINFO, input_ShouldInvalidateNetworkItems_WhenLinkStatusChanged) {
+	const uint8_t status = 1;
+	fill();
+
+	LONGS_EQUAL(0, qca_devinfo_input(cache,
+				qca_mme_mmtype(QCA_MMTYPE_PL_LINK_STATUS, QCA_MME_IND),
+				&status, sizeof(status), 1));
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_INFO);
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_NW_STAT);
+	qca_devinfo_poll(cache, 2);
+}
@@ -0,0 +1,94 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/diag.h"
+
+static uint8_t cnf[5 + 578];
+
+static void make_tonemap(uint8_t mod, uint16_t carriers) {
+	memset(cnf, 0, sizeof(cnf));
+	cnf[3] = (uint8_t)carriers;
+	cnf[4] = (uint8_t)(carriers >> 8);
+	for (uint16_t i = 0; i < carriers; i++) {
+		cnf[5 + i / 2] |= (uint8_t)(mod << ((i % 2) * 4));
+	}
+}
+
+TEST_GROUP(DIAG) {
+	struct qca_tonemap tm;
+	uint16_t changed[8];
+
+	void setup(void) {
+		memset(&tm, 0, sizeof(tm));
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(DIAG, tonemap_decode_ShouldUnpackCarriers) {
+	make_tonemap(QCA_MOD_1024QAM, 917);
+
+	LONGS_EQUAL(917, qca_tonemap_decode(&tm, cnf, sizeof(cnf), false,
+				changed, 8));
+	LONGS_EQUAL(917, tm.nr_active);
+	LONGS_EQUAL(QCA_MOD_1024QAM, tm.mod[0]);
+	LONGS_EQUAL(10, tm.bits[916]);
+	LONGS_EQUAL(QCA_MOD_NONE, tm.mod[917]);
+	LONGS_EQUAL(0, changed[0]);
+	LONGS_EQUAL(7, changed[7]);
+}
+
+TEST(DIAG, tonemap_decode_ShouldReportOnlyChangedCarriers) {
+	make_tonemap(QCA_MOD_256QAM, 917);
+	qca_tonemap_decode(&tm, cnf, sizeof(cnf), false, NULL, 0);
+
+	LONGS_EQUAL(0, qca_tonemap_decode(&tm, cnf, sizeof(cnf), false,
+				changed, 8));
+
+	cnf[5 + 300] = (uint8_t)((QCA_MOD_QPSK << 4) | QCA_MOD_256QAM);
+	LONGS_EQUAL(1, qca_tonemap_decode(&tm, cnf, sizeof(cnf), false,
+				changed, 8));
+	LONGS_EQUAL(601, changed[0]);
+	LONGS_EQUAL(QCA_MOD_QPSK, tm.mod[601]);
+}
+
+TEST(DIAG, tonemap_decode_ShouldFail_WhenStatusIsError) {
+	make_tonemap(QCA_MOD_QPSK, 10);
+	cnf[0] = 1;
+	LONGS_EQUAL(-EIO, qca_tonemap_decode(&tm, cnf, sizeof(cnf), false,
+				NULL, 0));
+}
+
+TEST(DIAG, tonemap_summarize_ShouldEstimatePhyRate) {
+	struct qca_tonemap_summary summary;
+	make_tonemap(QCA_MOD_1024QAM, 917);
+	qca_tonemap_decode(&tm, cnf, sizeof(cnf), false, NULL, 0);
+	tm.mod[0] = QCA_MOD_QPSK;
+	tm.bits[0] = 2;
+	tm.snr[0] = 5;
+
+	qca_tonemap_summarize(&tm, &summary);
+
+	LONGS_EQUAL(917, summary.loaded);
+	LONGS_EQUAL(916 * 10 + 2, summary.bits_per_symbol);
+	LONGS_EQUAL(5, summary.min_snr);
+	LONGS_EQUAL(29, summary.mean_snr);
+	LONGS_EQUAL(150055, summary.phy_rate_kbps);
+}
+
+TEST(DIAG, link_stats_decode_ShouldComputeErrorRate) {
+	uint8_t buf[4 + 48] = { 0, 1, 2, 1, };
+	struct qca_link_stats stats;
+	buf[4 + 16] = 0xe0; /* pb_passed 992 */
+	buf[4 + 17] = 0x03;
+	buf[4 + 24] = 8; /* pb_failed */
+
+	LONGS_EQUAL(0, qca_link_stats_decode(&stats, buf, sizeof(buf)));
+	LONGS_EQUAL(992, stats.pb_passed);
+	LONGS_EQUAL(8, stats.pb_failed);
+	LONGS_EQUAL(8, stats.pb_error_permille);
+}
@@ -0,0 +1,435 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/filter.h"
+
+static struct qca_mme_classification last_msg;
+static struct qca_mme_multicast_info last_group;
+static struct qca_mme_bw_limit last_bw;
+static uint8_t encoded[128];
+static size_t encoded_len;
+
+static int request(qca_mmtype_t type, const void *msg, size_t msglen,
+		void *ctx) {
+	(void)ctx;
+	encoded_len = qca_encode_mme((struct qca_mme *)encoded, type,
+			msg, msglen);
+	if (type == QCA_MMTYPE_CLASSIIFCATION && msglen == sizeof(last_msg)) {
+		memcpy(&last_msg, msg, sizeof(last_msg));
+	} else if (type == QCA_MMTYPE_MULTICAST_INFO &&
+			msglen == sizeof(last_group)) {
+		memcpy(&last_group, msg, sizeof(last_group));
+	} else if (type == QCA_MMTYPE_BW_LIMIT && msglen == sizeof(last_bw)) {
+		memcpy(&last_bw, msg, sizeof(last_bw));
+	}
+	return mock().actualCall(__func__)
+		.withParameter("type", type)
+		.returnIntValueOrDefault(0);
+}
+
+static const uint8_t mcast[6] = { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t host[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t mdns[6] = { 0x01, 0x00, 0x5E, 0x00, 0x00, 0xFB };
+static const uint8_t bcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+TEST_GROUP(FILTER) {
+	struct qca_filter *filter;
+	struct qca_filter_conf conf;
+	struct qca_filter_rule rule;
+	struct qca_filter_rule_stats stats;
+
+	void setup(void) {
+		memset(&conf, 0, sizeof(conf));
+		conf.timeout_ms = 100;
+		conf.request = request;
+		filter = qca_filter_create(&conf);
+
+		memset(&rule, 0, sizeof(rule));
+		rule.action = QCA_FILTER_DROP_RX;
+		rule.nr_classifiers = 1;
+		rule.classifiers[0].field = QCA_FILTER_ETH_DA;
+		memcpy(rule.classifiers[0].value, mcast, sizeof(mcast));
+	}
+	void teardown(void) {
+		qca_filter_destroy(filter);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void confirm_type(qca_mmtype_t type, uint8_t status) {
+		LONGS_EQUAL(0, qca_filter_input(filter,
+				qca_mme_mmtype(type, QCA_MME_CNF),
+				&status, sizeof(status), 0));
+	}
+	void confirm(uint8_t status) {
+		confirm_type(QCA_MMTYPE_CLASSIIFCATION, status);
+	}
+	int program(void) {
+		const int id = qca_filter_add(filter, &rule);
+		mock().expectOneCall("request").ignoreOtherParameters();
+		qca_filter_poll(filter, 0);
+		confirm(0);
+		mock().checkExpectations();
+		return id;
+	}
+	size_t udp_frame(uint8_t *buf, const uint8_t *da, uint16_t port) {
+		memset(buf, 0, 42);
+		memcpy(&buf[0], da, 6);
+		memcpy(&buf[6], host, 6);
+		buf[12] = 0x08; buf[13] = 0x00;
+		buf[14] = 0x45;
+		buf[23] = 17;
+		buf[36] = (uint8_t)(port >> 8);
+		buf[37] = (uint8_t)port;
+		return 42;
+	}
+};
+
+TEST(FILTER, add_ShouldReturnEINVAL_WhenRuleHasNoClassifiers) {
+	rule.nr_classifiers = 0;
+	LONGS_EQUAL(-EINVAL, qca_filter_add(filter, &rule));
+	rule.nr_classifiers = QCA_FILTER_MAX_CLASSIFIERS + 1;
+	LONGS_EQUAL(-EINVAL, qca_filter_add(filter, &rule));
+}
+
+TEST(FILTER, add_ShouldReturnENOSPC_WhenAllSlotsTaken) {
+	for (unsigned i = 0; i < QCA_FILTER_MAX_RULES; i++) {
+		LONGS_EQUAL(i, qca_filter_add(filter, &rule));
+	}
+	LONGS_EQUAL(-ENOSPC, qca_filter_add(filter, &rule));
+}
+
+TEST(FILTER, poll_ShouldSendClassificationRule_WhenAdded) {
+	rule.match_any = true;
+	rule.nr_classifiers = 2;
+	rule.classifiers[1].field = QCA_FILTER_UDP_DP;
+	rule.classifiers[1].negate = true;
+	rule.classifiers[1].value[1] = 15;
+	qca_filter_add(filter, &rule);
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_CLASSIIFCATION);
+	qca_filter_poll(filter, 0);
+
+	LONGS_EQUAL(0, last_msg.control);
+	LONGS_EQUAL(0, last_msg.volatility);
+	LONGS_EQUAL(0x07, last_msg.action);
+	LONGS_EQUAL(1, last_msg.operand);
+	LONGS_EQUAL(2, last_msg.num_classifiers);
+	LONGS_EQUAL(0x00, last_msg.classifiers[0].pid);
+	LONGS_EQUAL(0, last_msg.classifiers[0].operand);
+	MEMCMP_EQUAL(mcast, last_msg.classifiers[0].value, sizeof(mcast));
+	LONGS_EQUAL(0x0F, last_msg.classifiers[1].pid);
+	LONGS_EQUAL(1, last_msg.classifiers[1].operand);
+	LONGS_EQUAL(15, last_msg.classifiers[1].value[1]);
+}
+
+TEST(FILTER, poll_ShouldSendOneRequestAtATime) {
+	qca_filter_add(filter, &rule);
+	qca_filter_add(filter, &rule);
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	qca_filter_poll(filter, 99);
+	mock().checkExpectations();
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	confirm(0);
+	qca_filter_poll(filter, 99);
+	mock().checkExpectations();
+
+	confirm(0);
+	qca_filter_poll(filter, 200);
+	LONGS_EQUAL(0, qca_filter_get_stats(filter, 1, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_ACTIVE, stats.state);
+}
+
+TEST(FILTER, poll_ShouldSendAgain_WhenTimedOut) {
+	qca_filter_add(filter, &rule);
+
+	mock().expectNCalls(2, "request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	qca_filter_poll(filter, 100);
+}
+
+TEST(FILTER, input_ShouldMarkRuleRejected_WhenModemRefuses) {
+	const int id = qca_filter_add(filter, &rule);
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	confirm(1);
+	qca_filter_poll(filter, 1000);
+
+	LONGS_EQUAL(0, qca_filter_get_stats(filter, id, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_REJECTED, stats.state);
+	LONGS_EQUAL(0, stats.programmed);
+}
+
+TEST(FILTER, input_ShouldReturnENOMSG_WhenNotClassification) {
+	const uint8_t status = 0;
+	LONGS_EQUAL(-ENOMSG, qca_filter_input(filter,
+				qca_mme_mmtype(QCA_MMTYPE_SW_VER, QCA_MME_CNF),
+				&status, sizeof(status), 0));
+}
+
+TEST(FILTER, handle_interrupt_ShouldProgramAgain_WhenModemRestarted) {
+	const int id = program();
+
+	qca_filter_handle_interrupt(filter, 0);
+	qca_filter_poll(filter, 1000);
+	mock().checkExpectations();
+
+	qca_filter_handle_interrupt(filter, QCA_MME_INT_CPU_ON);
+	LONGS_EQUAL(0, qca_filter_get_stats(filter, id, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_PENDING, stats.state);
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 1000);
+	confirm(0);
+
+	LONGS_EQUAL(0, qca_filter_get_stats(filter, id, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_ACTIVE, stats.state);
+	LONGS_EQUAL(2, stats.programmed);
+}
+
+TEST(FILTER, remove_ShouldSendRemoval_WhenActive) {
+	const int id = program();
+
+	LONGS_EQUAL(0, qca_filter_remove(filter, id));
+	LONGS_EQUAL(-ENOENT, qca_filter_get_stats(filter, id, &stats));
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(1, last_msg.control);
+	confirm(0);
+
+	LONGS_EQUAL(id, qca_filter_add(filter, &rule));
+}
+
+TEST(FILTER, remove_ShouldNotTalkToModem_WhenNotProgrammedYet) {
+	const int id = qca_filter_add(filter, &rule);
+
+	LONGS_EQUAL(0, qca_filter_remove(filter, id));
+	LONGS_EQUAL(-ENOENT, qca_filter_remove(filter, id));
+	qca_filter_poll(filter, 0);
+}
+
+TEST(FILTER, remove_ShouldRemoveAfterConfirmed_WhenBeingAdded) {
+	const int id = qca_filter_add(filter, &rule);
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(0, qca_filter_remove(filter, id));
+	mock().checkExpectations();
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	confirm(0);
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(1, last_msg.control);
+}
+
+TEST(FILTER, match_ShouldDropAndCount_WhenRuleMatches) {
+	uint8_t frame[64];
+	const int id = program();
+
+	CHECK_TRUE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, host, 5353)));
+
+	LONGS_EQUAL(0, qca_filter_get_stats(filter, id, &stats));
+	LONGS_EQUAL(1, stats.host_hits);
+}
+
+TEST(FILTER, match_ShouldRequireAllClassifiers_WhenNotMatchAny) {
+	uint8_t frame[64];
+
+	rule.nr_classifiers = 2;
+	rule.classifiers[1].field = QCA_FILTER_UDP_DP;
+	rule.classifiers[1].value[0] = 5353 >> 8;
+	rule.classifiers[1].value[1] = 5353 & 0xff;
+	qca_filter_add(filter, &rule);
+
+	CHECK_TRUE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5354)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, host, 5353)));
+}
+
+TEST(FILTER, match_ShouldNotMatch_WhenFieldMissing) {
+	uint8_t frame[64];
+
+	rule.classifiers[0].field = QCA_FILTER_TCP_DP;
+	rule.classifiers[0].negate = true;
+	qca_filter_add(filter, &rule);
+
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+}
+
+TEST(FILTER, match_ShouldIgnoreTxRules) {
+	uint8_t frame[64];
+
+	rule.action = QCA_FILTER_DROP_TX;
+	qca_filter_add(filter, &rule);
+
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+}
+
+TEST(FILTER, join_ShouldReturnEINVAL_WhenNotMulticast) {
+	LONGS_EQUAL(-EINVAL, qca_filter_join(filter, host));
+	LONGS_EQUAL(-EINVAL, qca_filter_join(filter, bcast));
+	LONGS_EQUAL(0, qca_filter_join(filter, mcast));
+	LONGS_EQUAL(-EEXIST, qca_filter_join(filter, mcast));
+}
+
+TEST(FILTER, poll_ShouldSendMulticastInfo_WhenJoined) {
+	const int id = qca_filter_join(filter, mdns);
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_MULTICAST_INFO);
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(0, last_group.control);
+	LONGS_EQUAL(0, last_group.volatility);
+	MEMCMP_EQUAL(mdns, last_group.group, sizeof(mdns));
+
+	/* a confirmation of another type does not complete it */
+	confirm(0);
+	LONGS_EQUAL(0, qca_filter_get_group_stats(filter, id, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_PENDING, stats.state);
+
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+	LONGS_EQUAL(0, qca_filter_get_group_stats(filter, id, &stats));
+	LONGS_EQUAL(QCA_FILTER_RULE_ACTIVE, stats.state);
+	LONGS_EQUAL(1, stats.programmed);
+}
+
+TEST(FILTER, leave_ShouldSendRemoval_WhenActive) {
+	const int id = qca_filter_join(filter, mdns);
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+	mock().checkExpectations();
+
+	LONGS_EQUAL(0, qca_filter_leave(filter, id));
+	LONGS_EQUAL(-ENOENT, qca_filter_leave(filter, id));
+	LONGS_EQUAL(-ENOENT, qca_filter_get_group_stats(filter, id, &stats));
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_MULTICAST_INFO);
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(1, last_group.control);
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+
+	LONGS_EQUAL(id, qca_filter_join(filter, mdns));
+}
+
+TEST(FILTER, match_ShouldDropOtherGroups_WhenJoined) {
+	uint8_t frame[64];
+
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+
+	const int id = qca_filter_join(filter, mdns);
+
+	CHECK_TRUE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mdns, 5353)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, bcast, 67)));
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, host, 5353)));
+
+	LONGS_EQUAL(0, qca_filter_get_group_stats(filter, id, &stats));
+	LONGS_EQUAL(1, stats.host_hits);
+
+	qca_filter_leave(filter, id);
+	CHECK_FALSE(qca_filter_match(filter, frame,
+				udp_frame(frame, mcast, 5353)));
+}
+
+TEST(FILTER, poll_ShouldSendBwLimit_WhenSet) {
+	LONGS_EQUAL(0, qca_filter_set_bw_limit(filter, 0x0102));
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_BW_LIMIT);
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(1, last_bw.control);
+	MEMCMP_EQUAL("\x02\x01", &last_bw.limit, 2);
+	confirm_type(QCA_MMTYPE_BW_LIMIT, 0);
+	qca_filter_poll(filter, 1000);
+}
+
+TEST(FILTER, set_bw_limit_ShouldSendAgain_WhenChangedWhileOutstanding) {
+	qca_filter_set_bw_limit(filter, 10);
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	qca_filter_set_bw_limit(filter, 20);
+	mock().checkExpectations();
+
+	mock().expectOneCall("request").ignoreOtherParameters();
+	confirm_type(QCA_MMTYPE_BW_LIMIT, 0);
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(20, last_bw.limit);
+}
+
+TEST(FILTER, handle_interrupt_ShouldProgramGroupAndBwLimitAgain) {
+	qca_filter_join(filter, mdns);
+	qca_filter_set_bw_limit(filter, 10);
+	mock().expectNCalls(2, "request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+	qca_filter_poll(filter, 0);
+	confirm_type(QCA_MMTYPE_BW_LIMIT, 0);
+	qca_filter_poll(filter, 0);
+	mock().checkExpectations();
+
+	qca_filter_handle_interrupt(filter, QCA_MME_INT_CPU_ON);
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_MULTICAST_INFO);
+	qca_filter_poll(filter, 0);
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+	mock().checkExpectations();
+
+	mock().expectOneCall("request")
+		.withParameter("type", QCA_MMTYPE_BW_LIMIT);
+	qca_filter_poll(filter, 0);
+}
+
+TEST(FILTER, handle_interrupt_ShouldNotSendBwLimit_WhenNoLimit) {
+	qca_filter_set_bw_limit(filter, 0);
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	confirm_type(QCA_MMTYPE_BW_LIMIT, 0);
+
+	qca_filter_handle_interrupt(filter, QCA_MME_INT_CPU_ON);
+	qca_filter_poll(filter, 0);
+}
+
+TEST(FILTER, request_ShouldCarryBody_WhenEncoded) {
+	const uint8_t oui[3] = { 0x00, 0xB0, 0x52 };
+
+	qca_filter_join(filter, mdns);
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(QCA_MME_OUI_LEN + sizeof(last_group), encoded_len);
+	MEMCMP_EQUAL(oui, encoded, sizeof(oui));
+	LONGS_EQUAL(0, encoded[3]); /* add */
+	MEMCMP_EQUAL(mdns, &encoded[5], sizeof(mdns));
+	confirm_type(QCA_MMTYPE_MULTICAST_INFO, 0);
+	mock().checkExpectations();
+
+	qca_filter_set_bw_limit(filter, 0x0102);
+	mock().expectOneCall("request").ignoreOtherParameters();
+	qca_filter_poll(filter, 0);
+	LONGS_EQUAL(QCA_MME_OUI_LEN + sizeof(last_bw), encoded_len);
+	MEMCMP_EQUAL("\x01\x02\x01", &encoded[3], 3);
+}
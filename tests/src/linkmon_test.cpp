@@ -0,0 +1,155 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/linkmon.h"
+#include "qca/mme.h"
+
+static int request(void *ctx) {
+	(void)ctx;
+	return mock().actualCall(__func__).returnIntValueOrDefault(0);
+}
+
+static void on_event(const struct qca_linkmon_event *event, void *ctx) {
+	(void)ctx;
+	mock().actualCall(__func__)
+		.withParameter("state", event->state)
+		.withParameter("prev", event->prev)
+		.withParameter("timestamp", event->timestamp_ms);
+}
+
+TEST_GROUP(LINKMON) {
+	struct qca_linkmon *mon;
+	struct qca_linkmon_conf conf;
+
+	void setup(void) {
+		memset(&conf, 0, sizeof(conf));
+		conf.min_interval_ms = 100;
+		conf.max_interval_ms = 800;
+		conf.timeout_ms = 50;
+		conf.max_missed = 2;
+		conf.request = request;
+		mon = qca_linkmon_create(&conf);
+		qca_linkmon_subscribe(mon, on_event, NULL);
+	}
+	void teardown(void) {
+		qca_linkmon_destroy(mon);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void confirm(uint8_t link, uint32_t now) {
+		const uint8_t body[2] = { 0, link };
+		LONGS_EQUAL(0, qca_linkmon_input(mon,
+					qca_mme_mmtype(QCA_MMTYPE_PL_LINK_STATUS,
+						QCA_MME_CNF),
+					body, sizeof(body), now));
+	}
+};
+
+TEST(LINKMON, poll_ShouldRequestAtOnce_WhenStarted) {
+	mock().expectOneCall("request");
+	LONGS_EQUAL(50, qca_linkmon_poll(mon, 1000));
+	LONGS_EQUAL(QCA_LINK_UNKNOWN, qca_linkmon_state(mon));
+}
+
+TEST(LINKMON, input_ShouldNotifySubscribers_WhenStateChanged) {
+	mock().expectOneCall("request");
+	qca_linkmon_poll(mon, 0);
+
+	mock().expectOneCall("on_event")
+		.withParameter("state", QCA_LINK_UP)
+		.withParameter("prev", QCA_LINK_UNKNOWN)
+		.withParameter("timestamp", 10);
+	confirm(1, 10);
+	LONGS_EQUAL(QCA_LINK_UP, qca_linkmon_state(mon));
+}
+
+TEST(LINKMON, poll_ShouldBackOff_WhenStable) {
+	mock().expectNCalls(5, "request");
+	mock().expectOneCall("on_event").ignoreOtherParameters();
+
+	uint32_t now = 0;
+	qca_linkmon_poll(mon, now);
+	confirm(1, now);
+	LONGS_EQUAL(100, qca_linkmon_poll(mon, now));
+
+	const uint32_t expected[] = { 200, 400, 800, 800 };
+	for (size_t i = 0; i < 4; i++) {
+		now += qca_linkmon_poll(mon, now);
+		qca_linkmon_poll(mon, now);
+		confirm(1, now);
+		LONGS_EQUAL(expected[i], qca_linkmon_poll(mon, now));
+	}
+}
+
+TEST(LINKMON, poll_ShouldGoBackToMinInterval_WhenLinkLost) {
+	mock().expectNCalls(3, "request");
+	mock().expectNCalls(2, "on_event").ignoreOtherParameters();
+
+	qca_linkmon_poll(mon, 0);
+	confirm(1, 0);
+	qca_linkmon_poll(mon, 100);
+	confirm(1, 100);
+	qca_linkmon_poll(mon, 300);
+	confirm(0, 300);
+
+	LONGS_EQUAL(QCA_LINK_DOWN, qca_linkmon_state(mon));
+	LONGS_EQUAL(100, qca_linkmon_poll(mon, 300));
+}
+
+TEST(LINKMON, input_ShouldTriggerQuery_WhenIndicated) {
+	mock().expectNCalls(2, "request");
+	mock().expectOneCall("on_event").ignoreOtherParameters();
+
+	qca_linkmon_poll(mon, 0);
+	confirm(1, 0);
+	LONGS_EQUAL(0, qca_linkmon_input(mon,
+				qca_mme_mmtype(QCA_MMTYPE_PL_LINK_STATUS,
+					QCA_MME_IND), NULL, 0, 20));
+	LONGS_EQUAL(50, qca_linkmon_poll(mon, 20));
+}
+
+TEST(LINKMON, poll_ShouldTurnUnknown_WhenConfirmationsMissed) {
+	mock().expectNCalls(3, "request");
+	mock().expectOneCall("on_event").ignoreOtherParameters();
+	qca_linkmon_poll(mon, 0);
+	confirm(1, 0);
+	qca_linkmon_poll(mon, 100);
+	qca_linkmon_poll(mon, 150);
+	mock().checkExpectations();
+
+	mock().expectOneCall("request");
+	mock().expectOneCall("on_event")
+		.withParameter("state", QCA_LINK_UNKNOWN)
+		.withParameter("prev", QCA_LINK_UP)
+		.withParameter("timestamp", 200);
+	qca_linkmon_poll(mon, 200);
+}
+
+TEST(LINKMON, handle_interrupt_ShouldResetState_WhenCpuStarted) {
+	mock().expectOneCall("request");
+	mock().expectOneCall("on_event").ignoreOtherParameters();
+	qca_linkmon_poll(mon, 0);
+	confirm(1, 0);
+	mock().checkExpectations();
+
+	mock().expectOneCall("on_event")
+		.withParameter("state", QCA_LINK_UNKNOWN)
+		.withParameter("prev", QCA_LINK_UP)
+		.withParameter("timestamp", 30);
+	mock().expectOneCall("request");
+	qca_linkmon_handle_interrupt(mon, 0x0040, 30);
+	LONGS_EQUAL(50, qca_linkmon_poll(mon, 30));
+}
+
+TEST(LINKMON, subscribe_ShouldFail_WhenFull) {
+	for (size_t i = 1; i < QCA_LINKMON_MAX_SUBSCRIBERS; i++) {
+		LONGS_EQUAL(0, qca_linkmon_subscribe(mon, on_event, &conf));
+	}
+	LONGS_EQUAL(-ENOSPC, qca_linkmon_subscribe(mon, on_event, &conf));
+	LONGS_EQUAL(0, qca_linkmon_unsubscribe(mon, on_event, NULL));
+	LONGS_EQUAL(-ENOENT, qca_linkmon_unsubscribe(mon, on_event, NULL));
+}
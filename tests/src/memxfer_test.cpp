@@ -0,0 +1,290 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <vector>
+#include "qca/memxfer.h"
+
+#define BASE			0x1000U
+#define CHUNK			16U
+
+struct request {
+	qca_mmtype_t type;
+	std::vector<uint8_t> body;
+};
+
+static std::vector<struct request> requests;
+static uint8_t memory[256];
+static std::vector<size_t> sunk;
+static struct qca_memxfer *cancelled;
+
+static uint32_t get_le32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+	for (int i = 0; i < 4; i++) {
+		p[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+static int send(qca_mmtype_t type, const void *body, size_t body_len,
+		void *ctx) {
+	(void)ctx;
+	const uint8_t *p = (const uint8_t *)body;
+	requests.push_back({ type, std::vector<uint8_t>(p, p + body_len) });
+	return 0;
+}
+
+static int sink(size_t offset, const void *data, size_t len, void *ctx) {
+	uint8_t *buf = (uint8_t *)ctx;
+	memcpy(&buf[offset], data, len);
+	sunk.push_back(offset);
+	return 0;
+}
+
+static int sink_and_cancel(size_t offset, const void *data, size_t len,
+		void *ctx) {
+	(void)data;
+	(void)len;
+	(void)ctx;
+	sunk.push_back(offset);
+	qca_memxfer_cancel(cancelled);
+	return 0;
+}
+
+static void cancel_on_progress(size_t done, size_t total, void *ctx) {
+	(void)total;
+	(void)ctx;
+	sunk.push_back(done);
+	qca_memxfer_cancel(cancelled);
+}
+
+static void on_progress(size_t done, size_t total, void *ctx) {
+	(void)ctx;
+	mock().actualCall(__func__)
+		.withParameter("done", done)
+		.withParameter("total", total);
+}
+
+TEST_GROUP(MEMXFER) {
+	struct qca_memxfer *xfer;
+	struct qca_memxfer_conf conf;
+	uint8_t buf[sizeof(memory)];
+
+	void setup(void) {
+		requests.clear();
+		sunk.clear();
+		for (size_t i = 0; i < sizeof(memory); i++) {
+			memory[i] = (uint8_t)(i * 7 + 3);
+		}
+		memset(buf, 0, sizeof(buf));
+
+		memset(&conf, 0, sizeof(conf));
+		conf.window = 2;
+		conf.chunk = CHUNK;
+		conf.timeout_ms = 100;
+		conf.retries = 1;
+		conf.send = send;
+		xfer = qca_memxfer_create(&conf);
+		cancelled = xfer;
+	}
+	void teardown(void) {
+		qca_memxfer_destroy(xfer);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int respond(size_t i, uint8_t status = 0) {
+		const struct request &req = requests.at(i);
+		const uint32_t addr = get_le32(&req.body[0]);
+		const uint32_t len = get_le32(&req.body[4]);
+		uint8_t cnf[sizeof(struct qca_mme_rd_mem_cnf) + CHUNK];
+		size_t cnf_len = sizeof(struct qca_mme_wr_mem_cnf);
+
+		cnf[0] = status;
+		put_le32(&cnf[1], addr);
+		put_le32(&cnf[5], len);
+
+		if (req.type == QCA_MMTYPE_RD_MEM) {
+			memcpy(&cnf[9], &memory[addr - BASE], len);
+			cnf_len += len;
+		} else {
+			memcpy(&memory[addr - BASE], &req.body[8], len);
+		}
+
+		return qca_memxfer_input(xfer, qca_mme_mmtype(req.type, QCA_MME_CNF), cnf, cnf_len, 0);
+	}
+};
+
+TEST(MEMXFER, read_ShouldKeepWindowOfRequestsInFlight) {
+	LONGS_EQUAL(0, qca_memxfer_read(xfer, BASE, buf, CHUNK * 5, 0));
+	LONGS_EQUAL(2, requests.size());
+	LONGS_EQUAL(QCA_MMTYPE_RD_MEM, requests[0].type);
+	LONGS_EQUAL(BASE, get_le32(&requests[0].body[0]));
+	LONGS_EQUAL(CHUNK, get_le32(&requests[0].body[4]));
+	LONGS_EQUAL(BASE + CHUNK, get_le32(&requests[1].body[0]));
+	LONGS_EQUAL(1, qca_memxfer_status(xfer));
+
+	respond(0);
+	LONGS_EQUAL(3, requests.size());
+	LONGS_EQUAL(BASE + CHUNK * 2, get_le32(&requests[2].body[0]));
+}
+
+TEST(MEMXFER, read_ShouldFillBuffer_WhenAllConfirmed) {
+	const size_t len = CHUNK * 3 + 5;
+
+	LONGS_EQUAL(0, qca_memxfer_read(xfer, BASE, buf, len, 0));
+	for (size_t i = 0; i < 4; i++) {
+		LONGS_EQUAL(0, respond(i));
+	}
+
+	LONGS_EQUAL(4, requests.size());
+	LONGS_EQUAL(5, get_le32(&requests[3].body[4]));
+	LONGS_EQUAL(0, qca_memxfer_status(xfer));
+	MEMCMP_EQUAL(memory, buf, len);
+	LONGS_EQUAL(0, buf[len]);
+}
+
+TEST(MEMXFER, read_to_ShouldDeliverInAddressOrder_WhenConfirmedOutOfOrder) {
+	conf.window = 4;
+	conf.on_progress = on_progress;
+	qca_memxfer_destroy(xfer);
+	xfer = qca_memxfer_create(&conf);
+
+	LONGS_EQUAL(0, qca_memxfer_read_to(xfer, BASE, CHUNK * 4,
+				sink, buf, 0));
+	LONGS_EQUAL(4, requests.size());
+
+	respond(2);
+	respond(1);
+	LONGS_EQUAL(0, sunk.size());
+
+	mock().expectOneCall("on_progress")
+		.withParameter("done", CHUNK * 3)
+		.withParameter("total", CHUNK * 4);
+	respond(0);
+	mock().checkExpectations();
+
+	mock().expectOneCall("on_progress")
+		.withParameter("done", CHUNK * 4)
+		.withParameter("total", CHUNK * 4);
+	respond(3);
+
+	LONGS_EQUAL(4, sunk.size());
+	for (size_t i = 0; i < sunk.size(); i++) {
+		LONGS_EQUAL(i * CHUNK, sunk[i]);
+	}
+	MEMCMP_EQUAL(memory, buf, CHUNK * 4);
+	LONGS_EQUAL(0, qca_memxfer_status(xfer));
+}
+
+TEST(MEMXFER, write_ShouldSendDataInChunks) {
+	uint8_t data[CHUNK * 2 + 1];
+	memset(data, 0xA5, sizeof(data));
+
+	LONGS_EQUAL(0, qca_memxfer_write(xfer, BASE + 8, data,
+				sizeof(data), 0));
+	for (size_t i = 0; i < 3; i++) {
+		LONGS_EQUAL(QCA_MMTYPE_WR_MEM, requests.at(i).type);
+		respond(i);
+	}
+
+	LONGS_EQUAL(0, qca_memxfer_status(xfer));
+	MEMCMP_EQUAL(data, &memory[8], sizeof(data));
+	LONGS_EQUAL((uint8_t)((8 + sizeof(data)) * 7 + 3),
+			memory[8 + sizeof(data)]);
+}
+
+TEST(MEMXFER, poll_ShouldRetransmit_WhenTimedOut) {
+	struct qca_memxfer_stats stats;
+
+	qca_memxfer_read(xfer, BASE, buf, CHUNK, 0);
+	qca_memxfer_poll(xfer, 99);
+	LONGS_EQUAL(1, requests.size());
+	qca_memxfer_poll(xfer, 100);
+	LONGS_EQUAL(2, requests.size());
+	CHECK(requests[0].body == requests[1].body);
+
+	respond(1);
+	LONGS_EQUAL(0, qca_memxfer_status(xfer));
+	qca_memxfer_get_stats(xfer, &stats);
+	LONGS_EQUAL(2, stats.requests);
+	LONGS_EQUAL(1, stats.retransmits);
+}
+
+TEST(MEMXFER, poll_ShouldFail_WhenRetriesRunOut) {
+	qca_memxfer_read(xfer, BASE, buf, CHUNK, 0);
+	qca_memxfer_poll(xfer, 100);
+	qca_memxfer_poll(xfer, 200);
+	LONGS_EQUAL(2, requests.size());
+	LONGS_EQUAL(-ETIMEDOUT, qca_memxfer_status(xfer));
+}
+
+TEST(MEMXFER, poll_ShouldFailAtFirstTimeout_WhenNoRetry) {
+	qca_memxfer_destroy(xfer);
+	conf.retries = QCA_MEMXFER_NO_RETRY;
+	xfer = qca_memxfer_create(&conf);
+	cancelled = xfer;
+
+	qca_memxfer_read(xfer, BASE, buf, CHUNK, 0);
+	qca_memxfer_poll(xfer, 100);
+	LONGS_EQUAL(1, requests.size());
+	LONGS_EQUAL(-ETIMEDOUT, qca_memxfer_status(xfer));
+}
+
+TEST(MEMXFER, read_to_ShouldStop_WhenSinkCancels) {
+	qca_memxfer_read_to(xfer, BASE, CHUNK * 4, sink_and_cancel, NULL, 0);
+	respond(1);
+	respond(0);
+
+	LONGS_EQUAL(-ECANCELED, qca_memxfer_status(xfer));
+	LONGS_EQUAL(1, sunk.size());
+	LONGS_EQUAL(2, requests.size());
+	LONGS_EQUAL(0, qca_memxfer_read(xfer, BASE, buf, CHUNK, 0));
+}
+
+TEST(MEMXFER, read_ShouldStop_WhenProgressCallbackCancels) {
+	qca_memxfer_destroy(xfer);
+	conf.on_progress = cancel_on_progress;
+	xfer = qca_memxfer_create(&conf);
+	cancelled = xfer;
+
+	qca_memxfer_read(xfer, BASE, buf, CHUNK * 4, 0);
+	respond(0);
+
+	LONGS_EQUAL(-ECANCELED, qca_memxfer_status(xfer));
+	LONGS_EQUAL(1, sunk.size());
+	LONGS_EQUAL(CHUNK, sunk[0]);
+}
+
+TEST(MEMXFER, input_ShouldFail_WhenModemRefuses) {
+	qca_memxfer_read(xfer, BASE, buf, CHUNK * 2, 0);
+	respond(1, 0x10);
+	LONGS_EQUAL(-EIO, qca_memxfer_status(xfer));
+}
+
+TEST(MEMXFER, input_ShouldIgnoreConfirmation_WhenNotInFlight) {
+	struct qca_memxfer_stats stats;
+
+	qca_memxfer_read(xfer, BASE, buf, CHUNK, 0);
+	respond(0);
+	LONGS_EQUAL(0, respond(0));
+
+	qca_memxfer_get_stats(xfer, &stats);
+	LONGS_EQUAL(1, stats.stale);
+	LONGS_EQUAL(-ENOMSG, qca_memxfer_input(xfer,
+				qca_mme_mmtype(QCA_MMTYPE_SW_VER, QCA_MME_CNF),
+				buf, 16, 0));
+}
+
+TEST(MEMXFER, read_ShouldReturnBusy_WhenInProgress) {
+	LONGS_EQUAL(0, qca_memxfer_read(xfer, BASE, buf, CHUNK, 0));
+	LONGS_EQUAL(-EBUSY, qca_memxfer_write(xfer, BASE, buf, CHUNK, 0));
+	qca_memxfer_cancel(xfer);
+	LONGS_EQUAL(-ECANCELED, qca_memxfer_status(xfer));
+	LONGS_EQUAL(0, qca_memxfer_read(xfer, BASE, buf, CHUNK, 0));
+}
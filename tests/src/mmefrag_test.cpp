@@ -0,0 +1,167 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/mmefrag.h"
+
+#define MMTYPE			0xA025U
+
+static uint8_t frames[16][1514];
+static size_t frame_len[16];
+static size_t nr_frames;
+
+static int send_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)ctx;
+	memcpy(frames[nr_frames], frame, frame_size);
+	frame_len[nr_frames++] = frame_size;
+	return 0;
+}
+
+TEST_GROUP(MMEFRAG) {
+	struct qca_mmefrag *frag;
+	struct qca_mme_view view;
+	uint8_t dst[6] = { 0x00, 0xB0, 0x52, 0x00, 0x00, 0x01 };
+	uint8_t src[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+	uint8_t body[4000];
+
+	void setup(void) {
+		nr_frames = 0;
+		for (size_t i = 0; i < sizeof(body); i++) {
+			body[i] = (uint8_t)(i * 7);
+		}
+
+		struct qca_mmefrag_conf conf = {
+			.contexts = 2,
+			.arena_size = 6000,
+			.timeout_ms = 100,
+		};
+		frag = qca_mmefrag_create(&conf);
+	}
+	void teardown(void) {
+		qca_mmefrag_destroy(frag);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(MMEFRAG, send_ShouldNotFragment_WhenFitsInOneFrame) {
+	LONGS_EQUAL(1, qca_mmefrag_send(dst, src, MMTYPE, 5, body, 100, 0,
+				send_frame, NULL));
+	LONGS_EQUAL(119, frame_len[0]);
+	LONGS_EQUAL(0, frames[0][17]);
+	LONGS_EQUAL(0, frames[0][18]);
+
+	LONGS_EQUAL(1, qca_mmefrag_input(frag, frames[0], frame_len[0], 0,
+				&view));
+	POINTERS_EQUAL(&frames[0][19], view.body);
+	LONGS_EQUAL(100, view.body_len);
+	LONGS_EQUAL(MMTYPE, view.mmtype);
+	MEMCMP_EQUAL(src, view.src, 6);
+}
+
+TEST(MMEFRAG, send_ShouldSplitIntoFragments) {
+	LONGS_EQUAL(3, qca_mmefrag_send(dst, src, MMTYPE, 5, body, 3100, 0,
+				send_frame, NULL));
+	LONGS_EQUAL(1500, frame_len[0]);
+	LONGS_EQUAL(1500, frame_len[1]);
+	LONGS_EQUAL(19 + 3100 - 2 * 1481, frame_len[2]);
+	LONGS_EQUAL(0x20, frames[0][17]);
+	LONGS_EQUAL(0x22, frames[2][17]);
+	LONGS_EQUAL(5, frames[2][18]);
+}
+
+TEST(MMEFRAG, send_ShouldFail_WhenTooManyFragments) {
+	LONGS_EQUAL(-EMSGSIZE, qca_mmefrag_send(dst, src, MMTYPE, 0, body,
+				sizeof(body), 100, send_frame, NULL));
+	LONGS_EQUAL(0, nr_frames);
+}
+
+TEST(MMEFRAG, input_ShouldReassemble_WhenInOrder) {
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 3100, 0, send_frame, NULL);
+
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[0], frame_len[0], 0,
+				&view));
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[1], frame_len[1], 0,
+				&view));
+	LONGS_EQUAL(1, qca_mmefrag_input(frag, frames[2], frame_len[2], 0,
+				&view));
+	LONGS_EQUAL(3100, view.body_len);
+	MEMCMP_EQUAL(body, view.body, 3100);
+}
+
+TEST(MMEFRAG, input_ShouldReassemble_WhenLastArrivesFirst) {
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 3100, 0, send_frame, NULL);
+
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[2], frame_len[2], 0,
+				&view));
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[1], frame_len[1], 0,
+				&view));
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[1], frame_len[1], 0,
+				&view));
+	LONGS_EQUAL(1, qca_mmefrag_input(frag, frames[0], frame_len[0], 0,
+				&view));
+	LONGS_EQUAL(3100, view.body_len);
+	MEMCMP_EQUAL(body, view.body, 3100);
+}
+
+TEST(MMEFRAG, input_ShouldKeepMessagesApart_WhenInterleaved) {
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 2000, 0, send_frame, NULL);
+	qca_mmefrag_send(dst, src, MMTYPE, 2, &body[1], 2000, 0,
+			send_frame, NULL);
+
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[0], frame_len[0], 0,
+				&view));
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[3], frame_len[3], 0,
+				&view));
+	LONGS_EQUAL(1, qca_mmefrag_input(frag, frames[1], frame_len[1], 0,
+				&view));
+	MEMCMP_EQUAL(body, view.body, 2000);
+	LONGS_EQUAL(1, qca_mmefrag_input(frag, frames[2], frame_len[2], 0,
+				&view));
+	MEMCMP_EQUAL(&body[1], view.body, 2000);
+}
+
+TEST(MMEFRAG, input_ShouldFail_WhenNoContextLeft) {
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 2000, 0, send_frame, NULL);
+	qca_mmefrag_send(dst, src, MMTYPE, 2, body, 2000, 0, send_frame, NULL);
+	qca_mmefrag_send(dst, src, MMTYPE, 3, body, 2000, 0, send_frame, NULL);
+
+	qca_mmefrag_input(frag, frames[0], frame_len[0], 0, &view);
+	qca_mmefrag_input(frag, frames[2], frame_len[2], 0, &view);
+	LONGS_EQUAL(-ENOSPC, qca_mmefrag_input(frag, frames[4], frame_len[4],
+				0, &view));
+}
+
+TEST(MMEFRAG, input_ShouldFail_WhenArenaIsFull) {
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 2000, 0, send_frame, NULL);
+
+	/* the last fragment first reserves room for maximum fragments */
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[1], frame_len[1], 0,
+				&view));
+	qca_mmefrag_send(dst, src, MMTYPE, 2, body, 4000, 0, send_frame, NULL);
+	LONGS_EQUAL(-ENOMEM, qca_mmefrag_input(frag, frames[2], frame_len[2],
+				0, &view));
+}
+
+TEST(MMEFRAG, poll_ShouldDropIncompleteMessages_WhenTimedOut) {
+	struct qca_mmefrag_stats stats;
+	qca_mmefrag_send(dst, src, MMTYPE, 1, body, 2000, 0, send_frame, NULL);
+
+	qca_mmefrag_input(frag, frames[0], frame_len[0], 0, &view);
+	qca_mmefrag_poll(frag, 100);
+	LONGS_EQUAL(0, qca_mmefrag_input(frag, frames[1], frame_len[1], 100,
+				&view));
+
+	qca_mmefrag_get_stats(frag, &stats);
+	LONGS_EQUAL(1, stats.timeouts);
+	LONGS_EQUAL(0, stats.reassembled);
+}
+
+TEST(MMEFRAG, input_ShouldReturnNoMsg_WhenNotHomePlug) {
+	uint8_t frame[60] = { 0, };
+	frame[12] = 0x08;
+	LONGS_EQUAL(-ENOMSG, qca_mmefrag_input(frag, frame, sizeof(frame), 0,
+				&view));
+}
@@ -0,0 +1,165 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <vector>
+#include "qca/nvmz.h"
+#include "qca/nvm.h"
+
+#define BLOCK_SIZE		512U
+
+struct image {
+	std::vector<uint8_t> data;
+};
+
+static size_t source(uint32_t offset, void *buf, size_t bufsize, void *ctx) {
+	const struct image *img = (const struct image *)ctx;
+
+	if (offset >= img->data.size()) {
+		return 0;
+	}
+
+	const size_t len = std::min(bufsize, img->data.size() - offset);
+	memcpy(buf, &img->data[offset], len);
+	return len;
+}
+
+static void add_module(std::vector<uint8_t> &nvm, qca_nvm_image_t type,
+		size_t len, bool last, uint32_t seed) {
+	qca_nvm_header_t hdr;
+	const size_t at = nvm.size();
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.EntryType = type;
+	hdr.ImageLength = (uint32_t)len;
+	hdr.ImageNvmAddress = (uint32_t)(at + sizeof(hdr));
+	hdr.NextNvmHeaderPtr = last? 0xffffffffU :
+		(uint32_t)(at + sizeof(hdr) + len);
+	nvm.insert(nvm.end(), (const uint8_t *)&hdr,
+			(const uint8_t *)&hdr + sizeof(hdr));
+
+	for (size_t i = 0; i < len; i++) {
+		if (seed) { /* xorshift, does not compress */
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			nvm.push_back((uint8_t)seed);
+		} else {
+			nvm.push_back((uint8_t)((i / 16) & 0x7));
+		}
+	}
+}
+
+static int nr_headers;
+
+static bool count_header(const qca_nvm_header_t *header, void *ctx) {
+	(void)header;
+	(void)ctx;
+	nr_headers++;
+	return true;
+}
+
+TEST_GROUP(NVMZ) {
+	std::vector<uint8_t> nvm;
+	struct image packed;
+	struct qca_nvmz *z;
+
+	void setup(void) {
+		nvm.clear();
+		add_module(nvm, QCA_NVM_IMAGE_FIRMWARE, 3000, false, 0);
+		add_module(nvm, QCA_NVM_IMAGE_MEMCTL, 700, false, 1);
+		add_module(nvm, QCA_NVM_IMAGE_PIB, 1000, true, 0);
+
+		packed.data.resize(qca_nvmz_bound(nvm.size(), BLOCK_SIZE));
+		const int len = qca_nvmz_compress(nvm.data(), nvm.size(),
+				BLOCK_SIZE, packed.data.data(), packed.data.size());
+		CHECK(len > 0);
+		packed.data.resize((size_t)len);
+
+		z = qca_nvmz_create(source, &packed);
+		CHECK(z != NULL);
+	}
+	void teardown(void) {
+		qca_nvmz_destroy(z);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(NVMZ, compress_ShouldShrinkImage_WhenCompressible) {
+	CHECK(packed.data.size() < nvm.size() / 2);
+	LONGS_EQUAL(nvm.size(), qca_nvmz_size(z));
+}
+
+TEST(NVMZ, read_ShouldReturnImageAsIs) {
+	std::vector<uint8_t> out(nvm.size() + 10);
+	size_t total = 0;
+	size_t len;
+
+	/* odd sizes to cross the block boundaries */
+	while ((len = qca_nvmz_read(&out[total], 333, z)) > 0) {
+		total += len;
+	}
+
+	LONGS_EQUAL(nvm.size(), total);
+	MEMCMP_EQUAL(nvm.data(), out.data(), nvm.size());
+}
+
+TEST(NVMZ, iterate_ShouldWalkHeaders_WhenImageCompressed) {
+	nr_headers = 0;
+	LONGS_EQUAL(0, qca_nvm_iterate(qca_nvmz_read, qca_nvmz_size(z),
+			count_header, z));
+	LONGS_EQUAL(3, nr_headers);
+}
+
+TEST(NVMZ, seek_ShouldReadModule_WhenLocated) {
+	uint32_t offset = 0;
+	uint8_t buf[sizeof(qca_nvm_header_t) + 1000];
+	const uint32_t expected = 2 * sizeof(qca_nvm_header_t) + 3000 + 700;
+
+	LONGS_EQUAL(0, qca_nvm_locate(QCA_NVM_IMAGE_PIB, qca_nvmz_read, z,
+			qca_nvmz_size(z), &offset));
+	LONGS_EQUAL(expected, offset);
+
+	LONGS_EQUAL(0, qca_nvmz_seek(z, offset));
+	LONGS_EQUAL(sizeof(buf), qca_nvmz_read(buf, sizeof(buf), z));
+	MEMCMP_EQUAL(&nvm[offset], buf, sizeof(buf));
+	LONGS_EQUAL(0, qca_nvmz_read(buf, sizeof(buf), z));
+
+	/* and back into an incompressible block */
+	LONGS_EQUAL(0, qca_nvmz_seek(z, 3500));
+	LONGS_EQUAL(100, qca_nvmz_read(buf, 100, z));
+	MEMCMP_EQUAL(&nvm[3500], buf, 100);
+	LONGS_EQUAL(-EINVAL, qca_nvmz_seek(z, (uint32_t)nvm.size() + 1));
+}
+
+TEST(NVMZ, create_ShouldFail_WhenBlockLargerThanReaderTakes) {
+	struct image big;
+	big.data.resize(qca_nvmz_bound(nvm.size(), QCA_NVMZ_BLOCK_MAXLEN * 2));
+	const int len = qca_nvmz_compress(nvm.data(), nvm.size(),
+			QCA_NVMZ_BLOCK_MAXLEN * 2, big.data.data(),
+			big.data.size());
+	CHECK(len > 0);
+	big.data.resize((size_t)len);
+
+	POINTERS_EQUAL(NULL, qca_nvmz_create(source, &big));
+	big.data[0] = 'X';
+	POINTERS_EQUAL(NULL, qca_nvmz_create(source, &big));
+}
+
+TEST(NVMZ, read_ShouldStop_WhenBlockCorrupted) {
+	uint8_t buf[BLOCK_SIZE];
+	/* the second offset of the index points past the first block */
+	packed.data[sizeof(struct qca_nvmz_header) + 4] = 0xff;
+	packed.data[sizeof(struct qca_nvmz_header) + 5] = 0xff;
+
+	LONGS_EQUAL(0, qca_nvmz_read(buf, sizeof(buf), z));
+}
+
+TEST(NVMZ, compress_ShouldFail_WhenBufferTooSmall) {
+	uint8_t buf[64];
+	LONGS_EQUAL(-ENOSPC, qca_nvmz_compress(nvm.data(), nvm.size(),
+			BLOCK_SIZE, buf, sizeof(buf)));
+}
@@ -0,0 +1,78 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "qca/os.h"
+
+static qca_os_lock_t lock;
+static qca_os_cond_t cond;
+static bool ready;
+
+static void *wake_up(void *arg) {
+	(void)arg;
+	usleep(1000);
+	qca_os_lock(&lock);
+	ready = true;
+	qca_os_cond_broadcast(&cond);
+	qca_os_unlock(&lock);
+	return NULL;
+}
+
+TEST_GROUP(OS) {
+	void setup(void) {
+		ready = false;
+		qca_os_lock_init(&lock);
+		qca_os_cond_init(&cond);
+	}
+	void teardown(void) {
+		qca_os_cond_deinit(&cond);
+		qca_os_lock_deinit(&lock);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(OS, now_us_ShouldBeMonotonic) {
+	const uint64_t t0 = qca_os_now_us();
+	usleep(1000);
+	CHECK(qca_os_now_us() - t0 >= 1000);
+}
+
+TEST(OS, cond_wait_ShouldTimeOut_WhenNotWokenUp) {
+	const uint64_t t0 = qca_os_now_us();
+	int err = 0;
+
+	qca_os_lock(&lock);
+	while (err == 0) {
+		err = qca_os_cond_wait(&cond, &lock, t0 + 2000);
+	}
+	qca_os_unlock(&lock);
+
+	LONGS_EQUAL(-ETIMEDOUT, err);
+	CHECK(qca_os_now_us() - t0 >= 2000);
+}
+
+TEST(OS, cond_wait_ShouldReturn_WhenBroadcast) {
+	pthread_t thread;
+
+	qca_os_lock(&lock);
+	pthread_create(&thread, NULL, wake_up, NULL);
+	while (!ready) {
+		LONGS_EQUAL(0, qca_os_cond_wait(&cond, &lock,
+					qca_os_now_us() + 1000000));
+	}
+	qca_os_unlock(&lock);
+
+	pthread_join(thread, NULL);
+	CHECK(ready);
+}
+
+TEST(OS, malloc_ShouldReturnUsableMemory) {
+	uint8_t *p = (uint8_t *)qca_os_malloc(16);
+	CHECK(p != NULL);
+	p[15] = 1;
+	qca_os_free(p);
+}
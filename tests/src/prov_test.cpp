@@ -0,0 +1,269 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/prov.h"
+
+#define NR_MODEMS		3
+#define FIRMWARE_LEN		2500
+
+struct modem {
+	struct qca_emu *emu;
+	pthread_mutex_t lock;
+	std::vector<std::vector<uint8_t>> pending;
+	uint8_t module[3][4096];
+	bool committed[3];
+	bool refuse;
+	bool corrupt;
+	bool silent;
+};
+
+static struct modem modems[NR_MODEMS];
+static volatile bool running;
+
+static uint16_t get_le16(const uint8_t *p) {
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le16(uint8_t *p, uint16_t v) {
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+	for (int i = 0; i < 4; i++) {
+		p[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+/* Answers WR_MOD, RD_MOD and MOD_NVM. The confirmation is queued, as the
+ * emulator is locked while it hands over a frame. */
+static void on_tx(const void *frame, size_t frame_size, void *ctx) {
+	struct modem *m = (struct modem *)ctx;
+	const uint8_t *p = (const uint8_t *)frame;
+	const uint8_t *req = &p[22];
+	const uint16_t mmtype = get_le16(&p[15]);
+	std::vector<uint8_t> cnf(22, 0);
+
+	(void)frame_size;
+
+	if (m->silent) {
+		return;
+	}
+
+	memcpy(&cnf[0], &p[6], 6);
+	memcpy(&cnf[6], &p[0], 6);
+	cnf[12] = 0x88;
+	cnf[13] = 0xE1;
+	cnf[14] = 1;
+	put_le16(&cnf[15], (uint16_t)(mmtype | 1));
+	cnf[19] = 0x00;
+	cnf[20] = 0xB0;
+	cnf[21] = 0x52;
+
+	const uint8_t id = req[0];
+	const uint16_t len = get_le16(&req[2]);
+	const uint32_t offset = get_le32(&req[4]);
+	uint8_t body[16 + 1024] = { 0, };
+	size_t body_len = 0;
+
+	switch ((mmtype & 0x1FFFU) >> 2) {
+	case QCA_MMTYPE_WR_MOD:
+		memcpy(&m->module[id][offset], &req[12], len);
+		body[0] = m->refuse? 1 : 0;
+		body[1] = id;
+		put_le16(&body[3], len);
+		put_le32(&body[5], offset);
+		body_len = sizeof(struct qca_mme_wr_mod_cnf);
+		break;
+	case QCA_MMTYPE_RD_MOD:
+		body[4] = id;
+		put_le16(&body[6], len);
+		put_le32(&body[8], offset);
+		memcpy(&body[16], &m->module[id][offset], len);
+		if (m->corrupt) {
+			body[16] ^= 0xFF;
+		}
+		body_len = 16U + len;
+		break;
+	case QCA_MMTYPE_MOD_NVM:
+		m->committed[id] = true;
+		body[1] = id;
+		body_len = sizeof(struct qca_mme_mod_nvm_cnf);
+		break;
+	default:
+		return;
+	}
+
+	cnf.insert(cnf.end(), body, body + body_len);
+	if (cnf.size() < 60) {
+		cnf.resize(60);
+	}
+
+	pthread_mutex_lock(&m->lock);
+	m->pending.push_back(cnf);
+	pthread_mutex_unlock(&m->lock);
+}
+
+static void *respond(void *arg) {
+	(void)arg;
+
+	while (running) {
+		for (int i = 0; i < NR_MODEMS; i++) {
+			struct modem *m = &modems[i];
+			pthread_mutex_lock(&m->lock);
+			for (auto &cnf : m->pending) {
+				qca_emu_inject(m->emu, cnf.data(), cnf.size());
+			}
+			m->pending.clear();
+			pthread_mutex_unlock(&m->lock);
+		}
+		usleep(200);
+	}
+
+	return NULL;
+}
+
+TEST_GROUP(PROV) {
+	pthread_t responder;
+	struct qca_prov_conf conf;
+	struct qca_prov_board boards[NR_MODEMS];
+	struct qca_prov_report reports[NR_MODEMS];
+	uint8_t pib[sizeof(qca_nvm_pib_t) + 16];
+	uint8_t firmware[FIRMWARE_LEN];
+
+	void setup(void) {
+		for (int i = 0; i < NR_MODEMS; i++) {
+			struct modem *m = &modems[i];
+			struct qca_emu_conf emu_conf = {
+				.backend = QCA_EMU_BACKEND_CALLBACK,
+				.on_tx = on_tx,
+				.on_tx_ctx = m,
+			};
+
+			m->pending.clear();
+			memset(m->module, 0, sizeof(m->module));
+			memset(m->committed, 0, sizeof(m->committed));
+			m->refuse = m->corrupt = m->silent = false;
+			pthread_mutex_init(&m->lock, NULL);
+			m->emu = qca_emu_create(&emu_conf);
+
+			memset(&boards[i], 0, sizeof(boards[i]));
+			boards[i].spi = qca_emu_device(m->emu);
+			boards[i].mac[5] = (uint8_t)(i + 1);
+			memset(boards[i].dak, 0xD0 + i, sizeof(boards[i].dak));
+			memset(boards[i].nmk, 0xE0 + i, sizeof(boards[i].nmk));
+		}
+
+		for (size_t i = 0; i < sizeof(firmware); i++) {
+			firmware[i] = (uint8_t)(i * 13);
+		}
+		memset(pib, 0x11, sizeof(pib));
+		put_le16(&pib[offsetof(qca_nvm_pib_t, length)], sizeof(pib));
+
+		memset(&conf, 0, sizeof(conf));
+		conf.pib = pib;
+		conf.pib_len = sizeof(pib);
+		conf.firmware = firmware;
+		conf.firmware_len = sizeof(firmware);
+		conf.workers = NR_MODEMS;
+		conf.timeout_ms = 100;
+
+		running = true;
+		pthread_create(&responder, NULL, respond, NULL);
+	}
+	void teardown(void) {
+		running = false;
+		pthread_join(responder, NULL);
+
+		for (int i = 0; i < NR_MODEMS; i++) {
+			qca_emu_destroy(modems[i].emu);
+			pthread_mutex_destroy(&modems[i].lock);
+			modems[i].pending.clear();
+		}
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(PROV, personalize_ShouldSetKeysAndChecksum) {
+	const qca_nvm_pib_t *p = (const qca_nvm_pib_t *)pib;
+
+	LONGS_EQUAL(0, qca_prov_personalize(pib, sizeof(pib), &boards[1]));
+	MEMCMP_EQUAL(boards[1].mac, p->mac, sizeof(p->mac));
+	MEMCMP_EQUAL(boards[1].dak, p->dak, sizeof(p->dak));
+	MEMCMP_EQUAL(boards[1].nmk, p->nmk, sizeof(p->nmk));
+	LONGS_EQUAL(0, qca_calc_chksum(pib, sizeof(pib), 0));
+}
+
+TEST(PROV, personalize_ShouldReturnEINVAL_WhenPibTooShort) {
+	LONGS_EQUAL(-EINVAL, qca_prov_personalize(pib,
+				sizeof(qca_nvm_pib_t) - 1, &boards[0]));
+}
+
+TEST(PROV, run_ShouldProvisionEveryBoard) {
+	LONGS_EQUAL(0, qca_prov_run(&conf, boards, NR_MODEMS, reports));
+
+	for (int i = 0; i < NR_MODEMS; i++) {
+		const qca_nvm_pib_t *p =
+			(const qca_nvm_pib_t *)modems[i].module[2];
+
+		LONGS_EQUAL(QCA_PROV_STAGE_DONE, reports[i].stage);
+		LONGS_EQUAL(0, reports[i].err);
+		LONGS_EQUAL(sizeof(firmware) + sizeof(pib),
+				reports[i].bytes_written);
+		LONGS_EQUAL(sizeof(firmware) + sizeof(pib),
+				reports[i].bytes_verified);
+		MEMCMP_EQUAL(firmware, modems[i].module[1], sizeof(firmware));
+		MEMCMP_EQUAL(boards[i].mac, p->mac, sizeof(p->mac));
+		LONGS_EQUAL(0, qca_calc_chksum(p, sizeof(pib), 0));
+		CHECK(modems[i].committed[1]);
+		CHECK(modems[i].committed[2]);
+	}
+}
+
+TEST(PROV, run_ShouldCarryOnWithOthers_WhenBoardRefuses) {
+	modems[1].refuse = true;
+
+	LONGS_EQUAL(1, qca_prov_run(&conf, boards, NR_MODEMS, reports));
+
+	LONGS_EQUAL(QCA_PROV_STAGE_UPLOAD, reports[1].stage);
+	LONGS_EQUAL(-EIO, reports[1].err);
+	CHECK(!modems[1].committed[2]);
+	LONGS_EQUAL(QCA_PROV_STAGE_DONE, reports[0].stage);
+	LONGS_EQUAL(QCA_PROV_STAGE_DONE, reports[2].stage);
+}
+
+TEST(PROV, run_ShouldNotCommit_WhenReadbackMismatches) {
+	modems[0].corrupt = true;
+
+	LONGS_EQUAL(1, qca_prov_run(&conf, boards, 1, reports));
+
+	LONGS_EQUAL(QCA_PROV_STAGE_VERIFY, reports[0].stage);
+	LONGS_EQUAL(-EIO, reports[0].err);
+	CHECK(!modems[0].committed[1]);
+}
+
+TEST(PROV, run_ShouldTimeOut_WhenBoardIsSilent) {
+	modems[0].silent = true;
+	conf.timeout_ms = 10;
+	conf.retries = 1;
+
+	LONGS_EQUAL(1, qca_prov_run(&conf, boards, 1, reports));
+
+	LONGS_EQUAL(QCA_PROV_STAGE_UPLOAD, reports[0].stage);
+	LONGS_EQUAL(-ETIMEDOUT, reports[0].err);
+	LONGS_EQUAL(1, reports[0].retransmits);
+}
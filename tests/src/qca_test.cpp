@@ -0,0 +1,402 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+
+static uint8_t rxframe[QCA_MAX_BUFSIZE];
+static size_t rxframe_len;
+static int rxcount;
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)ctx;
+	memcpy(rxframe, frame, frame_size);
+	rxframe_len = frame_size;
+	rxcount++;
+}
+
+static void make_frame(uint8_t *buf, size_t len, uint8_t seed) {
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = (uint8_t)(seed + i);
+	}
+}
+
+static int drain(void) {
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	int total = 0;
+	int len;
+
+	while ((len = qca_read(buf, sizeof(buf))) > 0) {
+		qca_input(buf, (size_t)len);
+		total += len;
+	}
+
+	return total;
+}
+
+TEST_GROUP(QCA) {
+	struct qca_emu *emu;
+
+	void setup(void) {
+		rxframe_len = 0;
+		rxcount = 0;
+		emu = qca_emu_create(NULL);
+		qca_init(qca_emu_device(emu), on_frame, NULL);
+	}
+	void teardown(void) {
+		qca_deinit();
+		qca_emu_destroy(emu);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(QCA, read_reg_ShouldReturnSignature) {
+	uint16_t value = 0;
+	LONGS_EQUAL(0, qca_read_reg(QCA_REG_SIGNATURE, &value));
+	LONGS_EQUAL(QCA_SIGNATURE, value);
+}
+
+TEST(QCA, read_ShouldReturnZero_WhenNothingReceived) {
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	LONGS_EQUAL(0, qca_read(buf, sizeof(buf)));
+}
+
+TEST(QCA, write_encoding_ShouldLoopBackFrame) {
+	uint8_t frame[100];
+	make_frame(frame, sizeof(frame), 1);
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	drain();
+
+	LONGS_EQUAL(1, rxcount);
+	LONGS_EQUAL(sizeof(frame), rxframe_len);
+	MEMCMP_EQUAL(frame, rxframe, sizeof(frame));
+}
+
+TEST(QCA, input_ShouldPadShortFrames) {
+	uint8_t frame[20];
+	make_frame(frame, sizeof(frame), 2);
+
+	qca_emu_inject(emu, frame, sizeof(frame));
+	drain();
+
+	LONGS_EQUAL(1, rxcount);
+	LONGS_EQUAL(QCA_MIN_PACKET_LEN, rxframe_len);
+	MEMCMP_EQUAL(frame, rxframe, sizeof(frame));
+}
+
+TEST(QCA, input_ShouldDeliverAllFrames_WhenBurstExceedsRxQueue) {
+	uint8_t frame[1400];
+	make_frame(frame, sizeof(frame), 3);
+
+	LONGS_EQUAL(0, qca_emu_inject(emu, frame, sizeof(frame)));
+	LONGS_EQUAL(0, qca_emu_inject(emu, frame, sizeof(frame)));
+	drain();
+
+	struct qca_rxq_stats stats;
+	qca_get_rxq_stats(&stats);
+	LONGS_EQUAL(2, rxcount);
+	LONGS_EQUAL(0, stats.overflow_drops);
+	LONGS_EQUAL(0, stats.length);
+}
+
+TEST(QCA, input_ShouldResync_WhenGarbageInStream) {
+	const uint8_t garbage[] = { 0x00, 0xaa, 0x12, 0x55, 0xaa, 0xaa };
+	uint8_t frame[80];
+	make_frame(frame, sizeof(frame), 4);
+
+	qca_input(garbage, sizeof(garbage));
+	qca_emu_inject(emu, frame, sizeof(frame));
+	drain();
+
+	LONGS_EQUAL(1, rxcount);
+	MEMCMP_EQUAL(frame, rxframe, sizeof(frame));
+}
+
+TEST(QCA, read_ShouldBackOff_WhenFramesHeldUntilReleased) {
+	const struct qca_emu_conf emu_conf = {
+		.rdbuf_size = 16384,
+		.backend = QCA_EMU_BACKEND_CALLBACK,
+	};
+	const struct qca_conf conf = {
+		.rxq_size = 2048,
+		.rxq_max_size = 8192,
+		.rxq_high_watermark = 4096,
+		.rxq_low_watermark = 2048,
+	};
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	uint8_t frame[1000];
+	struct qca_rxq_stats stats;
+	int len;
+
+	qca_deinit();
+	qca_emu_destroy(emu);
+	emu = qca_emu_create(&emu_conf);
+	LONGS_EQUAL(0, qca_init_with_conf(qca_emu_device(emu), &conf,
+				on_frame, NULL));
+
+	make_frame(frame, sizeof(frame), 5);
+	for (int i = 0; i < 8; i++) {
+		LONGS_EQUAL(0, qca_emu_inject(emu, frame, sizeof(frame)));
+	}
+
+	qca_hold_rx(true);
+	while ((len = qca_read(buf, sizeof(buf))) > 0) {
+		qca_input(buf, (size_t)len);
+	}
+
+	LONGS_EQUAL(-EBUSY, len);
+	LONGS_EQUAL(0, rxcount);
+	qca_get_rxq_stats(&stats);
+	CHECK_TRUE(stats.throttled);
+	LONGS_EQUAL(1, stats.throttles);
+	CHECK(stats.length >= 4096);
+	CHECK(stats.capacity > 2048);
+
+	qca_hold_rx(false);
+	qca_input(NULL, 0);
+	CHECK(rxcount >= 4);
+	drain();
+
+	qca_get_rxq_stats(&stats);
+	LONGS_EQUAL(8, rxcount);
+	CHECK_FALSE(stats.throttled);
+	LONGS_EQUAL(0, stats.overflow_drops);
+	LONGS_EQUAL(0, stats.length);
+}
+
+TEST(QCA, reset_ShouldClearBuffersAndRaiseCpuOn) {
+	uint8_t frame[100];
+	uint16_t value;
+	make_frame(frame, sizeof(frame), 5);
+	qca_emu_inject(emu, frame, sizeof(frame));
+	qca_clear_interrupt();
+
+	LONGS_EQUAL(0, qca_reset());
+
+	qca_read_reg(QCA_REG_RDBUF_AVAILABLE, &value);
+	LONGS_EQUAL(0, value);
+	qca_read_reg(QCA_REG_INT_SRC, &value);
+	LONGS_EQUAL(QCA_EMU_INT_CPU_ON, value);
+}
+
+TEST(QCA, write_encoding_ShouldFail_WhenWriteBufferFull) {
+	struct qca_emu_conf conf = {
+		.rdbuf_size = 0,
+		.wrbuf_size = 64,
+		.backend = QCA_EMU_BACKEND_CALLBACK,
+	};
+	qca_deinit();
+	qca_emu_destroy(emu);
+	emu = qca_emu_create(&conf);
+	qca_init(qca_emu_device(emu), on_frame, NULL);
+
+	uint8_t frame[100];
+	make_frame(frame, sizeof(frame), 6);
+	LONGS_EQUAL(-EIO, qca_write_encoding(frame, sizeof(frame)));
+}
+
+static uint8_t wire[QCA_MAX_BUFSIZE];
+static size_t wire_len;
+
+static void trace_buffer_write(const void *tx, size_t txsize,
+		const void *rx, size_t rxsize, int err, void *ctx) {
+	(void)rx;
+	(void)rxsize;
+	(void)err;
+	(void)ctx;
+	if (((const uint8_t *)tx)[0] == 0x00) { /* buffer write */
+		memcpy(wire, tx, txsize);
+		wire_len = txsize;
+	}
+}
+
+TEST(QCA, write_encoding_ShouldSendWholeFrame_WhenSentInSegments) {
+	const uint8_t header[] = { 0x00, 0x00, 0xaa, 0xaa, 0xaa, 0xaa,
+		70, 0x00, 0x00, 0x00 };
+	uint8_t frame[70];
+	make_frame(frame, sizeof(frame), 7);
+	qca_set_spi_trace(trace_buffer_write, NULL);
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+
+	LONGS_EQUAL(sizeof(header) + sizeof(frame) + 2, wire_len);
+	MEMCMP_EQUAL(header, wire, sizeof(header));
+	MEMCMP_EQUAL(frame, &wire[sizeof(header)], sizeof(frame));
+	LONGS_EQUAL(0x55, wire[wire_len - 2]);
+	LONGS_EQUAL(0x55, wire[wire_len - 1]);
+	qca_set_spi_trace(NULL, NULL);
+}
+
+TEST(QCA, bus_submit_ShouldRunOperationsInOrder) {
+	struct qca_bus_op ops[] = {
+		{ QCA_BUS_OP_WRITE_REG, QCA_REG_RDBUF_WATERMARK, 0x123 },
+		{ QCA_BUS_OP_READ_REG, QCA_REG_RDBUF_WATERMARK, 0 },
+		{ QCA_BUS_OP_READ_REG, QCA_REG_SIGNATURE, 0 },
+	};
+
+	LONGS_EQUAL(0, qca_bus_submit(ops, 3, QCA_PRIO_HIGH, 0));
+	LONGS_EQUAL(0x123, ops[1].value);
+	LONGS_EQUAL(QCA_SIGNATURE, ops[2].value);
+}
+
+static int nested_err;
+
+static void submit_while_bus_held(const void *tx, size_t txsize,
+		const void *rx, size_t rxsize, int err, void *ctx) {
+	(void)tx;
+	(void)txsize;
+	(void)rx;
+	(void)rxsize;
+	(void)err;
+	(void)ctx;
+	struct qca_bus_op op = { QCA_BUS_OP_READ_REG, QCA_REG_SIGNATURE, 0 };
+	nested_err = qca_bus_submit(&op, 1, QCA_PRIO_HIGH, 1);
+}
+
+TEST(QCA, bus_submit_ShouldTimeout_WhenBusNotGranted) {
+	uint16_t value;
+	qca_set_spi_trace(submit_while_bus_held, NULL);
+	qca_read_reg(QCA_REG_SIGNATURE, &value);
+	qca_set_spi_trace(NULL, NULL);
+
+	LONGS_EQUAL(-ETIMEDOUT, nested_err);
+}
+
+static struct qca_frame_meta metas[2];
+static int nr_metas;
+
+static void on_frame_meta(const void *frame, size_t frame_size,
+		const struct qca_frame_meta *meta, void *ctx) {
+	(void)frame;
+	(void)frame_size;
+	(void)ctx;
+	if (nr_metas < 2) {
+		metas[nr_metas] = *meta;
+	}
+	nr_metas++;
+}
+
+TEST(QCA, frame_meta_ShouldStampEachStage_WhenReceived) {
+	uint8_t frame[80];
+	make_frame(frame, sizeof(frame), 8);
+	nr_metas = 0;
+	qca_set_frame_meta(on_frame_meta, NULL);
+
+	qca_emu_inject(emu, frame, sizeof(frame));
+	drain();
+	qca_set_frame_meta(NULL, NULL);
+
+	LONGS_EQUAL(1, nr_metas);
+	LONGS_EQUAL(QCA_DIR_RX, metas[0].dir);
+	CHECK(metas[0].read_us != 0);
+	CHECK(metas[0].input_us >= metas[0].read_us);
+	CHECK(metas[0].handler_us >= metas[0].input_us);
+	CHECK(metas[0].done_us >= metas[0].handler_us);
+	LONGS_EQUAL(0, metas[0].submit_us);
+}
+
+TEST(QCA, frame_meta_ShouldStampSubmitAndWrite_WhenSent) {
+	uint8_t frame[80];
+	make_frame(frame, sizeof(frame), 9);
+	nr_metas = 0;
+	qca_set_frame_meta(on_frame_meta, NULL);
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	qca_set_frame_meta(NULL, NULL);
+
+	LONGS_EQUAL(1, nr_metas);
+	LONGS_EQUAL(QCA_DIR_TX, metas[0].dir);
+	CHECK(metas[0].submit_us != 0);
+	CHECK(metas[0].write_us >= metas[0].submit_us);
+	LONGS_EQUAL(0, metas[0].read_us);
+}
+
+TEST(QCA, write_frames_ShouldPackFramesInOneTransaction_WhenCoalescing) {
+	struct qca_spi_profile profile = { 0, };
+	struct qca_emu_stats before, after;
+	uint8_t frame[3][100];
+	const struct qca_iovec frames[] = {
+		{ frame[0], sizeof(frame[0]) },
+		{ frame[1], sizeof(frame[1]) },
+		{ frame[2], sizeof(frame[2]) },
+	};
+	make_frame(frame[0], sizeof(frame[0]), 10);
+	make_frame(frame[1], sizeof(frame[1]), 11);
+	make_frame(frame[2], sizeof(frame[2]), 12);
+
+	LONGS_EQUAL(1, qca_write_frames(frames, 3));
+
+	/* room for two frames of 110 bytes on the wire */
+	profile.tx_coalesce = 250;
+	LONGS_EQUAL(0, qca_set_spi_profile(&profile));
+	qca_emu_get_stats(emu, &before);
+	LONGS_EQUAL(2, qca_write_frames(&frames[1], 2));
+	qca_emu_get_stats(emu, &after);
+	LONGS_EQUAL(3, after.transactions - before.transactions);
+
+	drain();
+	LONGS_EQUAL(3, rxcount);
+	MEMCMP_EQUAL(frame[2], rxframe, sizeof(frame[2]));
+}
+
+TEST(QCA, read_ShouldFetchNoMoreThanChunk_WhenProfileSet) {
+	struct qca_spi_profile profile = { 0, };
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	uint8_t frame[200];
+	make_frame(frame, sizeof(frame), 13);
+	profile.rx_chunk = 64;
+	qca_set_spi_profile(&profile);
+	qca_emu_inject(emu, frame, sizeof(frame));
+
+	LONGS_EQUAL(64, qca_read(buf, sizeof(buf)));
+	qca_input(buf, 64);
+	drain();
+
+	LONGS_EQUAL(1, rxcount);
+	MEMCMP_EQUAL(frame, rxframe, sizeof(frame));
+}
+
+TEST(QCA, init_ShouldAttachWarm_WhenModemLeftSetUp) {
+	const struct qca_conf conf = { .warm_attach = true, };
+	CHECK_FALSE(qca_is_warm());
+
+	qca_deinit();
+	LONGS_EQUAL(0, qca_init_with_conf(qca_emu_device(emu), &conf,
+			on_frame, NULL));
+	CHECK(qca_is_warm());
+}
+
+TEST(QCA, init_ShouldKeepPacketInterrupt_WhenAttachedWithFrameQueued) {
+	const struct qca_conf conf = { .warm_attach = true, };
+	uint8_t frame[100];
+	make_frame(frame, sizeof(frame), 21);
+
+	qca_emu_inject(emu, frame, sizeof(frame));
+	qca_deinit();
+	LONGS_EQUAL(0, qca_init_with_conf(qca_emu_device(emu), &conf,
+			on_frame, NULL));
+
+	CHECK(qca_is_warm());
+	CHECK(qca_emu_irq_pending(emu));
+	drain();
+	LONGS_EQUAL(1, rxcount);
+	MEMCMP_EQUAL(frame, rxframe, sizeof(frame));
+}
+
+TEST(QCA, init_ShouldAttachCold_WhenModemRebooted) {
+	const struct qca_conf conf = { .warm_attach = true, };
+	uint16_t value = 0;
+
+	qca_deinit();
+	qca_emu_reset(emu);
+	LONGS_EQUAL(0, qca_init_with_conf(qca_emu_device(emu), &conf,
+			on_frame, NULL));
+	CHECK_FALSE(qca_is_warm());
+	qca_read_reg(QCA_REG_ACT_CTR, &value);
+	LONGS_EQUAL(2, value);
+}
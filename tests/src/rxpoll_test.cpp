@@ -0,0 +1,158 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/rxpoll.h"
+
+static int rxcount;
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)frame;
+	(void)frame_size;
+	(void)ctx;
+	rxcount++;
+}
+
+TEST_GROUP(RXPOLL) {
+	struct qca_emu *emu;
+	struct qca_rxpoll *rx;
+	struct qca_rxpoll_stats stats;
+	uint8_t frame[400];
+
+	void setup(void) {
+		rxcount = 0;
+		memset(frame, 0x5A, sizeof(frame));
+
+		struct qca_rxpoll_conf conf = {
+			.budget = 3,
+			.idle_rounds = 2,
+			.handler = on_frame,
+		};
+		rx = qca_rxpoll_create(&conf);
+		emu = qca_emu_create(NULL);
+		qca_init(qca_emu_device(emu), qca_rxpoll_handler, rx);
+		qca_write_reg(QCA_REG_INT_ENABLE, QCA_RXPOLL_DEFAULT_INT_MASK);
+		qca_write_reg(QCA_REG_INT_SRC, 0xffff);
+	}
+	void teardown(void) {
+		qca_deinit();
+		qca_emu_destroy(emu);
+		qca_rxpoll_destroy(rx);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void inject(int n) {
+		for (int i = 0; i < n; i++) {
+			qca_emu_inject(emu, frame, sizeof(frame));
+		}
+	}
+};
+
+TEST(RXPOLL, interrupt_ShouldMaskPacketInterrupt) {
+	uint16_t int_src = 0;
+	uint16_t enable = 0;
+
+	inject(1);
+	CHECK(qca_emu_irq_pending(emu));
+
+	LONGS_EQUAL(0, qca_rxpoll_interrupt(rx, NULL, &int_src));
+	LONGS_EQUAL(QCA_EMU_INT_PKT_AVLBL, int_src);
+	qca_read_reg(QCA_REG_INT_ENABLE, &enable);
+	LONGS_EQUAL(QCA_EMU_INT_CPU_ON, enable);
+
+	inject(1);
+	CHECK_FALSE(qca_emu_irq_pending(emu));
+}
+
+TEST(RXPOLL, interrupt_ShouldAcknowledgeSources) {
+	uint16_t int_src = 0;
+
+	inject(1);
+	qca_rxpoll_interrupt(rx, NULL, NULL);
+
+	qca_read_reg(QCA_REG_INT_SRC, &int_src);
+	LONGS_EQUAL(0, int_src);
+}
+
+TEST(RXPOLL, poll_ShouldStopAtBudget_WhenFramesKeepComing) {
+	inject(7);
+	qca_rxpoll_interrupt(rx, NULL, NULL);
+
+	LONGS_EQUAL(1, qca_rxpoll_poll(rx, NULL));
+	CHECK(rxcount >= 3 && rxcount < 7);
+
+	qca_rxpoll_get_stats(rx, &stats);
+	LONGS_EQUAL(1, stats.budget_exhausted);
+	CHECK(stats.polling);
+}
+
+TEST(RXPOLL, poll_ShouldRearm_WhenIdleForRounds) {
+	uint16_t enable = 0;
+
+	inject(2);
+	qca_rxpoll_interrupt(rx, NULL, NULL);
+
+	LONGS_EQUAL(1, qca_rxpoll_poll(rx, NULL));
+	LONGS_EQUAL(2, rxcount);
+	LONGS_EQUAL(1, qca_rxpoll_poll(rx, NULL));
+	LONGS_EQUAL(0, qca_rxpoll_poll(rx, NULL));
+
+	qca_read_reg(QCA_REG_INT_ENABLE, &enable);
+	LONGS_EQUAL(QCA_RXPOLL_DEFAULT_INT_MASK, enable);
+	CHECK_FALSE(qca_emu_irq_pending(emu));
+
+	qca_rxpoll_get_stats(rx, &stats);
+	LONGS_EQUAL(1, stats.interrupts);
+	LONGS_EQUAL(3, stats.rounds);
+	LONGS_EQUAL(2, stats.empty_rounds);
+	LONGS_EQUAL(1, stats.rearms);
+	LONGS_EQUAL(2, stats.frames);
+	CHECK_FALSE(stats.polling);
+
+	inject(1);
+	CHECK(qca_emu_irq_pending(emu));
+}
+
+TEST(RXPOLL, poll_ShouldKeepPolling_WhenFrameArrivesBeforeRearm) {
+	inject(1);
+	qca_rxpoll_interrupt(rx, NULL, NULL);
+	qca_rxpoll_poll(rx, NULL);
+	qca_rxpoll_poll(rx, NULL);
+	inject(1);
+	LONGS_EQUAL(1, qca_rxpoll_poll(rx, NULL));
+	LONGS_EQUAL(2, rxcount);
+}
+
+TEST(RXPOLL, poll_ShouldReturnZero_WhenNotPolling) {
+	LONGS_EQUAL(0, qca_rxpoll_poll(rx, NULL));
+}
+
+TEST(RXPOLL, ShouldDrainGivenDevice) {
+	struct qca_rxpoll_conf conf = { .handler = on_frame, };
+	struct qca_rxpoll *rx2 = qca_rxpoll_create(&conf);
+	struct qca_emu *emu2 = qca_emu_create(NULL);
+	struct qca_dev *dev = qca_dev_create(qca_emu_device(emu2), NULL,
+			qca_rxpoll_handler, rx2);
+	uint16_t enable = 0;
+
+	qca_dev_write_reg(dev, QCA_REG_INT_ENABLE, QCA_RXPOLL_DEFAULT_INT_MASK);
+	qca_emu_inject(emu2, frame, sizeof(frame));
+
+	LONGS_EQUAL(0, qca_rxpoll_interrupt(rx2, dev, NULL));
+	qca_dev_read_reg(dev, QCA_REG_INT_ENABLE, &enable);
+	LONGS_EQUAL(QCA_EMU_INT_CPU_ON, enable);
+	LONGS_EQUAL(1, qca_rxpoll_poll(rx2, dev));
+	LONGS_EQUAL(1, rxcount);
+
+	qca_read_reg(QCA_REG_INT_ENABLE, &enable);
+	LONGS_EQUAL(QCA_RXPOLL_DEFAULT_INT_MASK, enable);
+
+	qca_dev_destroy(dev);
+	qca_emu_destroy(emu2);
+	qca_rxpoll_destroy(rx2);
+}
@@ -0,0 +1,207 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/slac.h"
+
+static const uint8_t evse_mac[6] = { 0x02, 0, 0, 0, 0, 0x01 };
+static const uint8_t ev1_mac[6] = { 0x02, 0, 0, 0, 0, 0x11 };
+static const uint8_t ev2_mac[6] = { 0x02, 0, 0, 0, 0, 0x22 };
+static const uint8_t evse_id[QCA_SLAC_ID_LEN] = "EVSE-0123456789A";
+
+static uint8_t sent[8][160];
+static size_t sent_len[8];
+static int sent_count;
+static struct qca_slac_result results[4];
+static qca_slac_event_t events[4];
+static int event_count;
+
+static int on_send(const void *frame, size_t frame_size, void *ctx) {
+	(void)ctx;
+	if (sent_count < 8) {
+		memcpy(sent[sent_count], frame, frame_size);
+		sent_len[sent_count++] = frame_size;
+	}
+	return 0;
+}
+
+static void on_event(qca_slac_event_t event,
+		const struct qca_slac_result *result, void *ctx) {
+	(void)ctx;
+	if (event_count < 4) {
+		events[event_count] = event;
+		results[event_count++] = *result;
+	}
+}
+
+static size_t make_mme(uint8_t *buf, const uint8_t *src, uint16_t mmtype,
+		const uint8_t *payload, size_t len) {
+	memset(buf, 0, 160);
+	memset(buf, 0xff, 6);
+	memcpy(&buf[6], src, 6);
+	buf[12] = 0x88;
+	buf[13] = 0xE1;
+	buf[14] = 1;
+	buf[15] = (uint8_t)mmtype;
+	buf[16] = (uint8_t)(mmtype >> 8);
+	memcpy(&buf[19], payload, len);
+	return 19 + len;
+}
+
+static uint16_t get_mmtype(int i) {
+	return (uint16_t)(sent[i][15] | (sent[i][16] << 8));
+}
+
+TEST_GROUP(SLAC) {
+	struct qca_slac *slac;
+	uint8_t frame[160];
+
+	void setup(void) {
+		struct qca_slac_conf conf;
+		memset(&conf, 0, sizeof(conf));
+		memcpy(conf.evse_mac, evse_mac, sizeof(evse_mac));
+		memcpy(conf.evse_id, evse_id, sizeof(evse_id));
+		conf.num_sounds = 3;
+		conf.send = on_send;
+		conf.on_event = on_event;
+
+		sent_count = 0;
+		event_count = 0;
+		slac = qca_slac_create(&conf);
+	}
+	void teardown(void) {
+		qca_slac_destroy(slac);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void parm_req(const uint8_t *mac, uint8_t run) {
+		uint8_t req[10] = { 0, 0, run, run, run, run, run, run, run, run };
+		size_t len = make_mme(frame, mac, QCA_SLAC_MMTYPE_SLAC_PARM_REQ,
+				req, sizeof(req));
+		LONGS_EQUAL(0, qca_slac_input(slac, frame, len, 0));
+	}
+	void start_atten(uint8_t run, uint32_t now) {
+		uint8_t ind[19] = { 0, };
+		memset(&ind[11], run, 8);
+		size_t len = make_mme(frame, ev1_mac,
+				QCA_SLAC_MMTYPE_START_ATTEN_CHAR_IND,
+				ind, sizeof(ind));
+		LONGS_EQUAL(0, qca_slac_input(slac, frame, len, now));
+	}
+	void profile(const uint8_t *mac, uint8_t value) {
+		uint8_t ind[66];
+		memcpy(ind, mac, 6);
+		ind[6] = QCA_SLAC_GROUPS;
+		ind[7] = 0;
+		memset(&ind[8], value, QCA_SLAC_GROUPS);
+		size_t len = make_mme(frame, evse_mac,
+				QCA_SLAC_MMTYPE_ATTEN_PROFILE_IND,
+				ind, sizeof(ind));
+		LONGS_EQUAL(0, qca_slac_input(slac, frame, len, 10));
+	}
+};
+
+TEST(SLAC, attenChar_ShouldCarrySourceAndResponderIds) {
+	const uint8_t pev_id[QCA_SLAC_ID_LEN] = "PEV-0123456789AB";
+	uint8_t sound[52] = { 0, };
+
+	memcpy(&sound[2], pev_id, sizeof(pev_id));
+	memset(&sound[20], 1, 8); /* run id */
+
+	parm_req(ev1_mac, 1);
+	start_atten(1, 0);
+	size_t len = make_mme(frame, ev1_mac, QCA_SLAC_MMTYPE_MNBC_SOUND_IND,
+			sound, sizeof(sound));
+	LONGS_EQUAL(0, qca_slac_input(slac, frame, len, 5));
+	profile(ev1_mac, 20);
+	profile(ev1_mac, 20);
+	profile(ev1_mac, 20);
+
+	LONGS_EQUAL(QCA_SLAC_MMTYPE_ATTEN_CHAR_IND, get_mmtype(1));
+	/* app, security, source address and run id before the ids */
+	MEMCMP_EQUAL(pev_id, &sent[1][19 + 16], sizeof(pev_id));
+	MEMCMP_EQUAL(evse_id, &sent[1][19 + 16 + 17], sizeof(evse_id));
+}
+
+TEST(SLAC, average_ShouldRoundToNearest) {
+	const uint16_t sum[3] = { 30, 31, 32 };
+	uint8_t avg[3];
+
+	LONGS_EQUAL(10, qca_slac_average(avg, sum, 3, 3));
+	LONGS_EQUAL(10, avg[0]);
+	LONGS_EQUAL(10, avg[1]);
+	LONGS_EQUAL(11, avg[2]);
+}
+
+TEST(SLAC, input_ShouldIgnoreOtherFrames) {
+	memset(frame, 0, sizeof(frame));
+	frame[12] = 0x86;
+	frame[13] = 0xDD;
+	LONGS_EQUAL(-ENOMSG, qca_slac_input(slac, frame, 60, 0));
+}
+
+TEST(SLAC, ShouldMatchEv_WhenExchangeCompletes) {
+	parm_req(ev1_mac, 1);
+	LONGS_EQUAL(1, sent_count);
+	LONGS_EQUAL(QCA_SLAC_MMTYPE_SLAC_PARM_CNF, get_mmtype(0));
+	MEMCMP_EQUAL(ev1_mac, sent[0], 6);
+
+	start_atten(1, 0);
+	profile(ev1_mac, 20);
+	profile(ev1_mac, 22);
+	profile(ev1_mac, 30);
+
+	LONGS_EQUAL(2, sent_count);
+	LONGS_EQUAL(QCA_SLAC_MMTYPE_ATTEN_CHAR_IND, get_mmtype(1));
+	LONGS_EQUAL(1, event_count);
+	LONGS_EQUAL(QCA_SLAC_EVT_ATTEN_DONE, events[0]);
+	LONGS_EQUAL(3, results[0].num_sounds);
+	LONGS_EQUAL(24, results[0].avg[0]);
+	LONGS_EQUAL(24, results[0].avg_total);
+
+	uint8_t req[66] = { 0, };
+	memset(&req[50], 1, 8); /* run id */
+	size_t len = make_mme(frame, ev1_mac, QCA_SLAC_MMTYPE_SLAC_MATCH_REQ,
+			req, sizeof(req));
+	LONGS_EQUAL(0, qca_slac_input(slac, frame, len, 20));
+
+	LONGS_EQUAL(3, sent_count);
+	LONGS_EQUAL(QCA_SLAC_MMTYPE_SLAC_MATCH_CNF, get_mmtype(2));
+	LONGS_EQUAL(QCA_SLAC_EVT_MATCHED, events[1]);
+	LONGS_EQUAL(0, qca_slac_sessions(slac));
+}
+
+TEST(SLAC, ShouldKeepSessionsApart_WhenTwoEvsSound) {
+	parm_req(ev1_mac, 1);
+	parm_req(ev2_mac, 2);
+	LONGS_EQUAL(2, qca_slac_sessions(slac));
+
+	start_atten(1, 0);
+	start_atten(2, 0);
+	for (int i = 0; i < 3; i++) {
+		profile(ev1_mac, 10);
+		profile(ev2_mac, 40);
+	}
+
+	LONGS_EQUAL(2, event_count);
+	MEMCMP_EQUAL(ev1_mac, results[0].pev_mac, 6);
+	LONGS_EQUAL(10, results[0].avg_total);
+	MEMCMP_EQUAL(ev2_mac, results[1].pev_mac, 6);
+	LONGS_EQUAL(40, results[1].avg_total);
+}
+
+TEST(SLAC, poll_ShouldCharacterise_WhenSoundWindowExpires) {
+	parm_req(ev1_mac, 1);
+	start_atten(1, 0);
+	profile(ev1_mac, 20);
+
+	qca_slac_poll(slac, 599);
+	LONGS_EQUAL(0, event_count);
+	qca_slac_poll(slac, 600);
+	LONGS_EQUAL(1, event_count);
+	LONGS_EQUAL(1, results[0].num_sounds);
+	LONGS_EQUAL(20, results[0].avg_total);
+}
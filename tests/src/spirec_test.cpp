@@ -0,0 +1,129 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/spirec.h"
+#include "qca/spireplay.h"
+
+static uint8_t received[256];
+static size_t received_len;
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)ctx;
+	memcpy(received, frame, frame_size);
+	received_len = frame_size;
+}
+
+static void exchange(const uint8_t *frame, size_t len) {
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	int n;
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, len));
+	while ((n = qca_read(buf, sizeof(buf))) > 0) {
+		qca_input(buf, (size_t)n);
+	}
+}
+
+TEST_GROUP(SPIREC) {
+	FILE *file;
+	uint8_t log[65536];
+	size_t loglen;
+
+	void setup(void) {
+		file = tmpfile();
+		loglen = 0;
+		received_len = 0;
+	}
+	void teardown(void) {
+		fclose(file);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void load_log(void) {
+		lseek(fileno(file), 0, SEEK_SET);
+		const ssize_t n = read(fileno(file), log, sizeof(log));
+		CHECK(n > 0);
+		loglen = (size_t)n;
+	}
+};
+
+TEST(SPIREC, create_ShouldWriteHeader) {
+	struct qca_spirec *rec = qca_spirec_create(fileno(file));
+	qca_spirec_destroy(rec);
+	load_log();
+
+	LONGS_EQUAL(QCA_SPIREC_HEADER_LEN, loglen);
+	MEMCMP_EQUAL(QCA_SPIREC_MAGIC, log, 4);
+	LONGS_EQUAL(QCA_SPIREC_VERSION, log[4]);
+}
+
+TEST(SPIREC, trace_ShouldDropRecord_WhenBufferFull) {
+	struct qca_spirec *rec = qca_spirec_create(fileno(file));
+	struct qca_spirec_stats stats;
+	static uint8_t big[QCA_SPIREC_BUFSIZE];
+
+	/* not started, so nothing drains the buffer */
+	qca_spirec_trace(big, 16, NULL, 0, 0, rec);
+	qca_spirec_trace(big, sizeof(big) - 16, NULL, 0, 0, rec);
+	qca_spirec_get_stats(rec, &stats);
+	LONGS_EQUAL(1, stats.records);
+	LONGS_EQUAL(1, stats.dropped);
+	LONGS_EQUAL(QCA_SPIREC_RECORD_HEADER_LEN + 16, stats.bytes);
+
+	qca_spirec_destroy(rec);
+}
+
+TEST(SPIREC, replay_ShouldReproduceSession_WhenRecorded) {
+	struct qca_emu *emu = qca_emu_create(NULL);
+	struct qca_spirec *rec = qca_spirec_create(fileno(file));
+	struct qca_spirec_stats recstats;
+	uint8_t frame[100];
+
+	for (size_t i = 0; i < sizeof(frame); i++) {
+		frame[i] = (uint8_t)i;
+	}
+
+	LONGS_EQUAL(0, qca_spirec_start(rec));
+	qca_init(qca_emu_device(emu), on_frame, NULL);
+	exchange(frame, sizeof(frame));
+	qca_deinit();
+	LONGS_EQUAL(0, qca_spirec_stop(rec));
+	qca_spirec_get_stats(rec, &recstats);
+	qca_spirec_destroy(rec);
+	qca_emu_destroy(emu);
+
+	LONGS_EQUAL(sizeof(frame), received_len);
+	CHECK(recstats.records > 0);
+	LONGS_EQUAL(0, recstats.dropped);
+	LONGS_EQUAL(0, recstats.write_errors);
+
+	load_log();
+	LONGS_EQUAL(QCA_SPIREC_HEADER_LEN + recstats.bytes, loglen);
+
+	struct qca_spireplay *replay = qca_spireplay_create(log, loglen, 0);
+	struct qca_spireplay_stats stats;
+	CHECK(replay != NULL);
+
+	received_len = 0;
+	memset(received, 0, sizeof(received));
+	qca_init(qca_spireplay_device(replay), on_frame, NULL);
+	exchange(frame, sizeof(frame));
+	qca_deinit();
+
+	qca_spireplay_get_stats(replay, &stats);
+	CHECK(qca_spireplay_done(replay));
+	LONGS_EQUAL(0, stats.mismatches);
+	LONGS_EQUAL(0, stats.skipped);
+	LONGS_EQUAL(recstats.records, stats.transactions);
+	LONGS_EQUAL(sizeof(frame), received_len);
+	MEMCMP_EQUAL(frame, received, sizeof(frame));
+
+	qca_spireplay_destroy(replay);
+}
@@ -0,0 +1,164 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/qca.h"
+#include "qca/emu.h"
+#include "qca/stats.h"
+
+static int rxcount;
+
+static void on_frame(const void *frame, size_t frame_size, void *ctx) {
+	(void)frame;
+	(void)frame_size;
+	(void)ctx;
+	rxcount++;
+}
+
+static void drain(void) {
+	uint8_t buf[QCA_MAX_BUFSIZE];
+	int len;
+
+	while ((len = qca_read(buf, sizeof(buf))) > 0) {
+		qca_input(buf, (size_t)len);
+	}
+}
+
+static uint32_t sum_buckets(const struct qca_stats_hist *hist) {
+	uint32_t sum = 0;
+	for (unsigned i = 0; i < QCA_STATS_HIST_BUCKETS; i++) {
+		sum += hist->buckets[i];
+	}
+	return sum;
+}
+
+TEST_GROUP(STATS) {
+	struct qca_emu *emu;
+	struct qca_stats stats;
+
+	void setup(void) {
+		rxcount = 0;
+		emu = qca_emu_create(NULL);
+		qca_init(qca_emu_device(emu), on_frame, NULL);
+		qca_stats_reset();
+	}
+	void teardown(void) {
+		qca_deinit();
+		qca_emu_destroy(emu);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(STATS, snapshot_ShouldBeZero_WhenReset) {
+	uint8_t frame[100] = { 0, };
+	qca_write_encoding(frame, sizeof(frame));
+	qca_stats_reset();
+
+	LONGS_EQUAL(0, qca_stats_snapshot(&stats));
+	for (unsigned i = 0; i < QCA_STATS_COUNTER_MAX; i++) {
+		LONGS_EQUAL(0, stats.counters[i]);
+	}
+	LONGS_EQUAL(0, stats.hists[QCA_STATS_HIST_SPI_LATENCY].count);
+}
+
+TEST(STATS, snapshot_ShouldCountFramesAndBytes_WhenLoopedBack) {
+	uint8_t frame[100] = { 0, };
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	drain();
+
+	qca_stats_snapshot(&stats);
+	LONGS_EQUAL(2, rxcount);
+	LONGS_EQUAL(2, stats.counters[QCA_STATS_TX_FRAMES]);
+	LONGS_EQUAL(200, stats.counters[QCA_STATS_TX_BYTES]);
+	LONGS_EQUAL(2, stats.counters[QCA_STATS_RX_FRAMES]);
+	LONGS_EQUAL(200, stats.counters[QCA_STATS_RX_BYTES]);
+	LONGS_EQUAL(2, stats.counters[QCA_STATS_SPI_BUF_WRITE]);
+	CHECK(stats.counters[QCA_STATS_SPI_BUF_READ] >= 1);
+	CHECK(stats.counters[QCA_STATS_SPI_REG_READ] >= 2);
+	CHECK(stats.counters[QCA_STATS_SPI_REG_WRITE] >= 2);
+}
+
+TEST(STATS, snapshot_ShouldRecordEveryTransaction_InLatencyHistogram) {
+	uint16_t value;
+
+	qca_read_reg(QCA_REG_SIGNATURE, &value);
+	qca_write_reg(QCA_REG_RDBUF_WATERMARK, 1);
+
+	qca_stats_snapshot(&stats);
+	const struct qca_stats_hist *hist =
+		&stats.hists[QCA_STATS_HIST_SPI_LATENCY];
+	LONGS_EQUAL(2, hist->count);
+	LONGS_EQUAL(2, sum_buckets(hist));
+	CHECK(hist->max_us <= hist->sum_us);
+	LONGS_EQUAL(2, stats.counters[QCA_STATS_LOCK_ACQUIRED]);
+	LONGS_EQUAL(2, stats.hists[QCA_STATS_HIST_BUS_WAIT_LOW].count);
+}
+
+TEST(STATS, write_ShouldTakeBusAtNormalPriority_WhenNotGiven) {
+	uint8_t frame[100] = { 0, };
+	const struct qca_iovec iov = { frame, sizeof(frame) };
+
+	LONGS_EQUAL(0, qca_write_encoding(frame, sizeof(frame)));
+	LONGS_EQUAL(1, qca_write_frames(&iov, 1));
+	LONGS_EQUAL(1, qca_write_frames_prio(&iov, 1, QCA_PRIO_HIGH));
+	LONGS_EQUAL(-EINVAL, qca_write_frames_prio(&iov, 1, QCA_PRIO_MAX));
+
+	qca_stats_snapshot(&stats);
+	LONGS_EQUAL(2, stats.hists[QCA_STATS_HIST_BUS_WAIT_NORMAL].count);
+	LONGS_EQUAL(1, stats.hists[QCA_STATS_HIST_BUS_WAIT_HIGH].count);
+}
+
+TEST(STATS, snapshot_ShouldRecordRxStages_WhenFrameDelivered) {
+	uint8_t frame[80] = { 0, };
+
+	qca_emu_inject(emu, frame, sizeof(frame));
+	drain();
+
+	qca_stats_snapshot(&stats);
+	LONGS_EQUAL(1, stats.hists[QCA_STATS_HIST_RX_LATENCY].count);
+	LONGS_EQUAL(1, stats.hists[QCA_STATS_HIST_RX_QUEUE].count);
+	LONGS_EQUAL(1, stats.hists[QCA_STATS_HIST_RX_HANDLER].count);
+}
+
+TEST(STATS, snapshot_ShouldCountResyncDrops_WhenGarbageInStream) {
+	const uint8_t garbage[] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+		0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+
+	qca_input(garbage, sizeof(garbage));
+
+	qca_stats_snapshot(&stats);
+	CHECK(stats.counters[QCA_STATS_RESYNC_DROPS] > 0);
+	LONGS_EQUAL(0, rxcount);
+}
+
+TEST(STATS, snapshot_ShouldCountEio_WhenWriteBufferFull) {
+	struct qca_emu_conf conf = {
+		.rdbuf_size = 0,
+		.wrbuf_size = 64,
+		.backend = QCA_EMU_BACKEND_CALLBACK,
+	};
+	uint8_t frame[100] = { 0, };
+
+	qca_deinit();
+	qca_emu_destroy(emu);
+	emu = qca_emu_create(&conf);
+	qca_init(qca_emu_device(emu), on_frame, NULL);
+	qca_stats_reset();
+
+	LONGS_EQUAL(-EIO, qca_write_encoding(frame, sizeof(frame)));
+	qca_stats_snapshot(&stats);
+	LONGS_EQUAL(1, stats.counters[QCA_STATS_EIO]);
+}
+
+TEST(STATS, stringify_ShouldNameEveryCounter) {
+	for (unsigned i = 0; i < QCA_STATS_COUNTER_MAX; i++) {
+		CHECK(qca_stats_counter_stringify((qca_stats_counter_t)i) != NULL);
+	}
+	STRCMP_EQUAL("rx_frames", qca_stats_counter_stringify(QCA_STATS_RX_FRAMES));
+	POINTERS_EQUAL(NULL, qca_stats_counter_stringify(QCA_STATS_COUNTER_MAX));
+}
@@ -0,0 +1,183 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "qca/tapbridge.h"
+#include "qca/qca.h"
+
+int qca_write_frames(const struct qca_iovec *frames, size_t nr_frames) {
+	(void)frames;
+	return (int)nr_frames;
+}
+
+int qca_read(void *buf, size_t bufsize) {
+	(void)buf;
+	(void)bufsize;
+	return 0;
+}
+
+int qca_input(const void *instream, size_t instream_len) {
+	(void)instream;
+	(void)instream_len;
+	return 0;
+}
+
+static uint8_t sent[8][64];
+static size_t sent_len[8];
+static size_t nr_sent;
+static size_t nr_calls;
+static size_t max_per_call;
+static int nr_pumped;
+
+static int send_frames(const struct qca_iovec *frames, size_t nr_frames,
+		void *ctx) {
+	(void)ctx;
+	const size_t n = nr_frames < max_per_call? nr_frames : max_per_call;
+	const size_t i = __atomic_load_n(&nr_sent, __ATOMIC_RELAXED);
+	for (size_t k = 0; k < n && i + k < 8; k++) {
+		memcpy(sent[i + k], frames[k].base, frames[k].len);
+		sent_len[i + k] = frames[k].len;
+	}
+	__atomic_fetch_add(&nr_calls, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&nr_sent, i + n, __ATOMIC_RELEASE);
+	return (int)n;
+}
+
+static int pump(void *buf, size_t bufsize, void *ctx) {
+	(void)buf;
+	(void)bufsize;
+	(void)ctx;
+	__atomic_fetch_add(&nr_pumped, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static void wait_for(const size_t *counter, size_t expected) {
+	for (int i = 0; i < 1000; i++) {
+		if (__atomic_load_n(counter, __ATOMIC_ACQUIRE) >= expected) {
+			return;
+		}
+		usleep(1000);
+	}
+}
+
+TEST_GROUP(TAPBRIDGE) {
+	struct qca_tapbridge *bridge;
+	struct qca_tapbridge_conf conf;
+	int fds[2];
+
+	void setup(void) {
+		nr_sent = 0;
+		nr_calls = 0;
+		max_per_call = 8;
+		nr_pumped = 0;
+		/* a seqpacket socket keeps frame boundaries like a TAP */
+		socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds);
+
+		memset(&conf, 0, sizeof(conf));
+		conf.use_fd = true;
+		conf.fd = fds[0];
+		conf.poll_ms = 1;
+		conf.send = send_frames;
+		conf.pump = pump;
+		bridge = qca_tapbridge_create(&conf);
+	}
+	void write_frames(unsigned n) {
+		uint8_t frame[60];
+		for (uint8_t i = 0; i < n; i++) {
+			memset(frame, i, sizeof(frame));
+			LONGS_EQUAL(sizeof(frame) - i,
+					write(fds[1], frame, sizeof(frame) - i));
+		}
+	}
+	void teardown(void) {
+		qca_tapbridge_destroy(bridge);
+		close(fds[0]);
+		close(fds[1]);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(TAPBRIDGE, create_ShouldUseGivenDescriptor) {
+	CHECK(bridge != NULL);
+	LONGS_EQUAL(fds[0], qca_tapbridge_fd(bridge));
+}
+
+TEST(TAPBRIDGE, handler_ShouldWriteFrameToInterface) {
+	uint8_t frame[60];
+	uint8_t buf[64];
+	struct qca_tapbridge_stats stats;
+
+	memset(frame, 0xA5, sizeof(frame));
+	qca_tapbridge_handler(frame, sizeof(frame), bridge);
+
+	LONGS_EQUAL(sizeof(frame), read(fds[1], buf, sizeof(buf)));
+	MEMCMP_EQUAL(frame, buf, sizeof(frame));
+
+	qca_tapbridge_get_stats(bridge, &stats);
+	LONGS_EQUAL(1, stats.rx_frames);
+	LONGS_EQUAL(60, stats.rx_bytes);
+}
+
+TEST(TAPBRIDGE, create_ShouldFail_WhenRxBufferCannotHoldFrame) {
+	struct qca_tapbridge_conf bad = conf;
+	bad.rx_bufsize = QCA_MAX_BUFSIZE - 1;
+	POINTERS_EQUAL(NULL, qca_tapbridge_create(&bad));
+}
+
+TEST(TAPBRIDGE, create_ShouldFail_WhenGivenDescriptorInvalid) {
+	struct qca_tapbridge_conf bad = conf;
+	bad.fd = -1;
+	POINTERS_EQUAL(NULL, qca_tapbridge_create(&bad));
+}
+
+TEST(TAPBRIDGE, ShouldSendFramesReadFromInterface) {
+	struct qca_tapbridge_stats stats;
+
+	qca_tapbridge_destroy(bridge);
+	/* queued before the bridge starts, so that a wakeup finds them all */
+	write_frames(3);
+	bridge = qca_tapbridge_create(&conf);
+
+	wait_for(&nr_sent, 3);
+
+	LONGS_EQUAL(3, nr_sent);
+	for (uint8_t i = 0; i < 3; i++) {
+		LONGS_EQUAL(60 - i, sent_len[i]);
+		LONGS_EQUAL(i, sent[i][0]);
+	}
+
+	qca_tapbridge_get_stats(bridge, &stats);
+	LONGS_EQUAL(3, stats.tx_frames);
+	LONGS_EQUAL(177, stats.tx_bytes);
+	LONGS_EQUAL(1, stats.tx_batches);
+	LONGS_EQUAL(1, nr_calls);
+}
+
+TEST(TAPBRIDGE, ShouldSendRest_WhenBatchPartiallyTaken) {
+	struct qca_tapbridge_stats stats;
+
+	qca_tapbridge_destroy(bridge);
+	write_frames(3);
+	max_per_call = 2;
+	bridge = qca_tapbridge_create(&conf);
+
+	wait_for(&nr_sent, 3);
+
+	LONGS_EQUAL(3, nr_sent);
+	LONGS_EQUAL(2, nr_calls);
+	LONGS_EQUAL(58, sent_len[2]);
+	qca_tapbridge_get_stats(bridge, &stats);
+	LONGS_EQUAL(3, stats.tx_frames);
+	LONGS_EQUAL(0, stats.tx_errors);
+}
+
+TEST(TAPBRIDGE, ShouldPumpModem_WhenRunning) {
+	usleep(20000);
+	CHECK(__atomic_load_n(&nr_pumped, __ATOMIC_RELAXED) > 0);
+}
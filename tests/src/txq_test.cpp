@@ -0,0 +1,148 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <errno.h>
+#include <string.h>
+#include "qca/qca.h"
+#include "qca/txq.h"
+#include "qca/emu.h"
+
+static uint8_t sent[16];
+static size_t sent_count;
+
+static void on_tx(const void *frame, size_t frame_size, void *ctx) {
+	(void)frame_size;
+	(void)ctx;
+	if (sent_count < sizeof(sent)) {
+		sent[sent_count++] = ((const uint8_t *)frame)[14];
+	}
+}
+
+static void make_frame(uint8_t *buf, uint16_t ethertype, uint8_t tag) {
+	memset(buf, 0, 64);
+	buf[12] = (uint8_t)(ethertype >> 8);
+	buf[13] = (uint8_t)ethertype;
+	buf[14] = tag;
+}
+
+TEST_GROUP(TXQ) {
+	struct qca_emu *emu;
+	struct qca_txq *txq;
+
+	void setup(void) {
+		struct qca_emu_conf conf = {
+			.rdbuf_size = 0,
+			.wrbuf_size = 0,
+			.transaction_ns = 0,
+			.byte_ns = 0,
+			.backend = QCA_EMU_BACKEND_CALLBACK,
+			.tap_name = NULL,
+			.on_tx = on_tx,
+		};
+		sent_count = 0;
+		emu = qca_emu_create(&conf);
+		qca_init(qca_emu_device(emu), NULL, NULL);
+		txq = NULL;
+	}
+	void teardown(void) {
+		qca_txq_destroy(txq);
+		qca_deinit();
+		qca_emu_destroy(emu);
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(TXQ, classify_ShouldPutHomePlugFirst) {
+	uint8_t frame[64];
+
+	make_frame(frame, 0x88E1, 0);
+	LONGS_EQUAL(QCA_PRIO_HIGH, qca_txq_classify(frame, sizeof(frame)));
+	make_frame(frame, 0x86DD, 0);
+	LONGS_EQUAL(QCA_PRIO_NORMAL, qca_txq_classify(frame, sizeof(frame)));
+	make_frame(frame, 0x1234, 0);
+	LONGS_EQUAL(QCA_PRIO_LOW, qca_txq_classify(frame, sizeof(frame)));
+}
+
+TEST(TXQ, flush_ShouldSendHighPriorityFirst) {
+	uint8_t frame[64];
+	txq = qca_txq_create(NULL);
+
+	make_frame(frame, 0x86DD, 1);
+	qca_txq_send(txq, frame, sizeof(frame));
+	make_frame(frame, 0x1234, 2);
+	qca_txq_send(txq, frame, sizeof(frame));
+	make_frame(frame, 0x88E1, 3);
+	qca_txq_send(txq, frame, sizeof(frame));
+
+	LONGS_EQUAL(3, qca_txq_flush(txq, 0));
+	LONGS_EQUAL(3, sent_count);
+	LONGS_EQUAL(3, sent[0]);
+	LONGS_EQUAL(1, sent[1]);
+	LONGS_EQUAL(2, sent[2]);
+}
+
+TEST(TXQ, flush_ShouldShareBus_WhenWeighted) {
+	struct qca_txq_conf conf = {
+		.depth = { 0, 0, 0 },
+		.weight = { 0, 2, 1 },
+	};
+	uint8_t frame[64];
+	txq = qca_txq_create(&conf);
+
+	for (uint8_t i = 0; i < 4; i++) {
+		make_frame(frame, 0x86DD, 1);
+		qca_txq_send(txq, frame, sizeof(frame));
+		make_frame(frame, 0x1234, 2);
+		qca_txq_send(txq, frame, sizeof(frame));
+	}
+
+	LONGS_EQUAL(6, qca_txq_flush(txq, 6));
+	const uint8_t expected[] = { 1, 1, 2, 1, 1, 2 };
+	MEMCMP_EQUAL(expected, sent, sizeof(expected));
+}
+
+TEST(TXQ, enqueue_ShouldFail_WhenQueueFull) {
+	struct qca_txq_conf conf = {
+		.depth = { 1, 1, 1 },
+		.weight = { 0, 0, 0 },
+	};
+	uint8_t frame[64];
+	struct qca_txq_stats stats;
+	txq = qca_txq_create(&conf);
+	make_frame(frame, 0x88E1, 0);
+
+	LONGS_EQUAL(0, qca_txq_send(txq, frame, sizeof(frame)));
+	LONGS_EQUAL(-ENOBUFS, qca_txq_send(txq, frame, sizeof(frame)));
+	qca_txq_get_stats(txq, &stats);
+	LONGS_EQUAL(1, stats.drops[QCA_PRIO_HIGH]);
+}
+
+TEST(TXQ, flush_ShouldCoalesceFramesInOneWrite_WhenProfileAllows) {
+	struct qca_txq_conf conf = {
+		.depth = { 0, 0, 0 },
+		.weight = { 0, 2, 0 },
+	};
+	struct qca_spi_profile profile = { 0, };
+	struct qca_emu_stats before, after;
+	uint8_t frame[64];
+	txq = qca_txq_create(&conf);
+	profile.tx_coalesce = 1024;
+	qca_set_spi_profile(&profile);
+
+	for (uint8_t i = 1; i <= 3; i++) {
+		make_frame(frame, 0x86DD, i);
+		qca_txq_send(txq, frame, sizeof(frame));
+	}
+
+	qca_emu_get_stats(emu, &before);
+	LONGS_EQUAL(3, qca_txq_flush(txq, 0));
+	qca_emu_get_stats(emu, &after);
+
+	const uint8_t expected[] = { 1, 2, 3 };
+	MEMCMP_EQUAL(expected, sent, sizeof(expected));
+	/* two frames by the weight, then the last one. each write takes
+	 * WRBUF_AVAILABLE, BUFSIZE and the buffer write */
+	LONGS_EQUAL(6, after.transactions - before.transactions);
+}
@@ -0,0 +1,20 @@
+#ifndef FAKE_CLOCK_H
+#define FAKE_CLOCK_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Stands in for the monotonic clock of the platform layer, so that a test
+ * decides how time goes by. */
+uint64_t fake_clock_us(void);
+
+#define QCA_OS_TIME_US()	fake_clock_us()
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* FAKE_CLOCK_H */
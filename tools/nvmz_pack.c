@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Pazzk <team@pazzk.net>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Compresses an NVM image into the format of qca/nvmz.h, to be stored on
+ * the device in place of the image. */
+
+#include "qca/nvmz.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [options] <image> <output>\n"
+			"  --block <bytes>      block size, up to %u for "
+			"readers of the default build\n",
+			prog, QCA_NVMZ_BLOCK_MAXLEN);
+}
+
+static void *read_file(const char *path, size_t *len)
+{
+	FILE *f = fopen(path, "rb");
+	void *data = NULL;
+	long size;
+
+	if (f == NULL) {
+		perror(path);
+		return NULL;
+	}
+
+	if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+			fseek(f, 0, SEEK_SET) == 0 &&
+			(data = malloc((size_t)size)) != NULL) {
+		if (fread(data, 1, (size_t)size, f) == (size_t)size) {
+			*len = (size_t)size;
+		} else {
+			free(data);
+			data = NULL;
+		}
+	}
+
+	if (data == NULL) {
+		fprintf(stderr, "%s: failed to read\n", path);
+	}
+
+	fclose(f);
+	return data;
+}
+
+static int write_file(const char *path, const void *data, size_t len)
+{
+	FILE *f = fopen(path, "wb");
+
+	if (f == NULL) {
+		perror(path);
+		return -errno;
+	}
+
+	const size_t written = fwrite(data, 1, len, f);
+
+	if (fclose(f) != 0 || written != len) {
+		fprintf(stderr, "%s: failed to write\n", path);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	size_t block_size = QCA_NVMZ_BLOCK_MAXLEN;
+	const char *paths[2];
+	size_t nr_paths = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--block") && i + 1 < argc) {
+			block_size = (size_t)strtoul(argv[++i], NULL, 0);
+		} else if (argv[i][0] != '-' && nr_paths < 2) {
+			paths[nr_paths++] = argv[i];
+		} else {
+			nr_paths = 0;
+			break;
+		}
+	}
+
+	if (nr_paths != 2 || block_size == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	size_t image_len = 0;
+	void *image = read_file(paths[0], &image_len);
+
+	if (image == NULL) {
+		return 1;
+	}
+
+	const size_t bufsize = qca_nvmz_bound(image_len, block_size);
+	void *buf = malloc(bufsize);
+	int len = -ENOMEM;
+
+	if (buf) {
+		len = qca_nvmz_compress(image, image_len, block_size,
+				buf, bufsize);
+	}
+
+	if (len < 0) {
+		fprintf(stderr, "failed to compress: %s\n", strerror(-len));
+	} else if (write_file(paths[1], buf, (size_t)len) == 0) {
+		fprintf(stderr, "%zu -> %d bytes in blocks of %zu\n",
+				image_len, len, block_size);
+	} else {
+		len = -EIO;
+	}
+
+	free(buf);
+	free(image);
+
+	return len < 0;
+}